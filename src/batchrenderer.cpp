@@ -0,0 +1,228 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "batchrenderer.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace dbcon = database_constants;
+namespace histcon = history_constants;
+
+BatchRenderer::BatchRenderer(BatchRenderOptions options, QObject *parent)
+    : QObject(parent), options(std::move(options))
+{
+    qRegisterMetaType<HistoryChunk>();
+    this->tasksRunning = 0;
+    this->failed = 0;
+    if (this->options.threads > 0)
+        this->pool.setMaxThreadCount(this->options.threads);
+}
+
+BatchRenderer::~BatchRenderer() { this->pool.waitForDone(); }
+bool BatchRenderer::start(const std::vector<long long> &recIds)
+{
+    if (this->tasksRunning > 0)
+        return false;
+    this->failed = 0;
+    if (!QDir().mkpath(this->options.outputDir)) {
+        LogInstance::get_instance().eal_error(
+            "Can not create output directory " +
+            this->options.outputDir.toStdString());
+        return false;
+    }
+    if (!this->queryJobs(recIds) || this->jobs.empty())
+        return false;
+
+    // every task needs its own connection, the default connection belongs to
+    // the GUI thread.
+    QString dbFile = QSqlDatabase::database().databaseName();
+    int maxPoints = this->options.width * histcon::POINTS_PER_PIXEL;
+    this->tasksRunning = static_cast<int>(this->jobs.size());
+    for (size_t i = 0; i < this->jobs.size(); i++) {
+        BatchRenderTask *task = new BatchRenderTask(
+            this, static_cast<int>(i), this->jobs[i], dbFile, maxPoints);
+        task->setAutoDelete(true);
+        this->pool.start(task);
+    }
+    return true;
+}
+
+void BatchRenderer::taskLoaded(int taskNo, HistoryChunk data)
+{
+    const BatchRenderJob &job = this->jobs.at(static_cast<size_t>(taskNo));
+    bool success = this->render(job, data);
+    if (!success)
+        this->failed++;
+    emit this->rendered(job.outputFile, success);
+    this->tasksRunning--;
+    if (this->tasksRunning == 0)
+        emit this->finished(this->failed);
+}
+
+bool BatchRenderer::queryJobs(const std::vector<long long> &recIds)
+{
+    this->jobs.clear();
+    QString where;
+    if (!recIds.empty()) {
+        QStringList placeholders;
+        for (size_t i = 0; i < recIds.size(); i++) {
+            placeholders << "?";
+        }
+        where = QString(" WHERE ") + dbcon::TBL_RECORDING_ID + " IN (" +
+                placeholders.join(", ") + ")";
+    }
+    QSqlQuery query;
+    // clang-format off
+    query.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_ID + ", "
+                  + dbcon::TBL_RECORDING_NAME + ", "
+                  + dbcon::TBL_RECORDING_CHAN + ", "
+                  + dbcon::TBL_RECORDING_START + ", "
+                  + dbcon::TBL_RECORDING_STOP + ", "
+                  + dbcon::TBL_RECORDING_FILE + " FROM " + dbcon::TBL_RECORDING
+                  + where + " ORDER BY " + dbcon::TBL_RECORDING_ID);
+    // clang-format on
+    for (size_t i = 0; i < recIds.size(); i++) {
+        query.bindValue(static_cast<int>(i), recIds[i]);
+    }
+    if (!query.exec()) {
+        LogInstance::get_instance().eal_error(
+            query.lastError().text().toStdString());
+        return false;
+    }
+    std::vector<long long> found;
+    while (query.next()) {
+        BatchRenderJob job;
+        job.recId = query.value(0).toLongLong();
+        job.recName = query.value(1).toString();
+        job.channels = query.value(2).toInt();
+        job.from = query.value(3).toDateTime().toMSecsSinceEpoch();
+        // a running recording has no end yet
+        job.to = query.value(4).isNull()
+                     ? QDateTime::currentMSecsSinceEpoch()
+                     : query.value(4).toDateTime().toMSecsSinceEpoch();
+        job.dataFile = query.value(5).toString();
+        found.push_back(job.recId);
+        if (this->options.from.isValid())
+            job.from =
+                std::max(job.from, this->options.from.toMSecsSinceEpoch());
+        if (this->options.to.isValid())
+            job.to = std::min(job.to, this->options.to.toMSecsSinceEpoch());
+        if (job.to <= job.from) {
+            LogInstance::get_instance().eal_info(
+                "Recording " + std::to_string(job.recId) +
+                " has no data in the time range");
+            continue;
+        }
+        job.outputFile = this->options.outputDir + QDir::separator() +
+                         QString("recording_%1.").arg(job.recId) +
+                         this->options.format;
+        this->jobs.push_back(std::move(job));
+    }
+    for (const auto id : recIds) {
+        if (std::find(found.begin(), found.end(), id) == found.end()) {
+            LogInstance::get_instance().eal_error("There is no recording " +
+                                                  std::to_string(id));
+            this->failed++;
+        }
+    }
+    return true;
+}
+
+bool BatchRenderer::render(const BatchRenderJob &job, const HistoryChunk &data)
+{
+    if (data.keys.isEmpty()) {
+        LogInstance::get_instance().eal_error(
+            "No data for recording " + std::to_string(job.recId));
+        return false;
+    }
+    QCustomPlot plot;
+    HistoryViewer::setupPlot(&plot, job.channels, job.from, job.to);
+    plot.plotLayout()->insertRow(0);
+    plot.plotLayout()->addElement(
+        0, 0, new QCPTextElement(&plot, job.recName,
+                                 QFont("sans", 12, QFont::Bold)));
+    // voltage, current and wattage per channel
+    const bool visible[3] = {this->options.voltage, this->options.current,
+                             this->options.wattage};
+    for (int i = 0; i < plot.graphCount(); i++) {
+        QCPGraph *graph = plot.graph(i);
+        if (static_cast<size_t>(i) < data.values.size())
+            graph->setData(data.keys, data.values.at(i), true);
+        if (!visible[i % 3]) {
+            graph->setVisible(false);
+            graph->removeFromLegend();
+        }
+    }
+    QList<QCPAxis *> valueAxes =
+        plot.axisRect()->axes(QCPAxis::AxisType::atLeft);
+    for (int i = 0; i < valueAxes.size() && i < 3; i++) {
+        valueAxes.at(i)->setVisible(visible[i]);
+    }
+    HistoryViewer::rescaleValueAxes(&plot);
+
+    bool success = false;
+    if (this->options.format == "pdf") {
+        success = plot.savePdf(job.outputFile, this->options.width,
+                               this->options.height);
+    } else {
+        success = plot.savePng(job.outputFile, this->options.width,
+                               this->options.height);
+    }
+    if (!success) {
+        LogInstance::get_instance().eal_error("Can not write " +
+                                              job.outputFile.toStdString());
+    }
+    return success;
+}
+
+BatchRenderTask::BatchRenderTask(BatchRenderer *renderer, int taskNo,
+                                 BatchRenderJob job, QString dbFile,
+                                 int maxPoints)
+    : renderer(renderer),
+      taskNo(taskNo),
+      job(std::move(job)),
+      dbFile(std::move(dbFile)),
+      maxPoints(maxPoints)
+{
+}
+
+void BatchRenderTask::run()
+{
+    HistoryChunk data;
+    data.values.resize(static_cast<size_t>(this->job.channels) * 3);
+    {
+        HistoryLoader loader(this->dbFile, this->job.recId, this->job.dataFile,
+                             this->job.channels);
+        // the loader lives in this thread, the chunks are delivered directly
+        QObject::connect(&loader, &HistoryLoader::chunkLoaded,
+                         [&data](HistoryChunk chunk) {
+                             data.keys += chunk.keys;
+                             for (size_t i = 0; i < data.values.size() &&
+                                                i < chunk.values.size();
+                                  i++) {
+                                 data.values[i] += chunk.values[i];
+                             }
+                             data.last = chunk.last;
+                         });
+        loader.setCurrentRequest(1);
+        loader.load(1, this->job.from, this->job.to, this->maxPoints);
+    }
+    QMetaObject::invokeMethod(this->renderer, "taskLoaded",
+                              Qt::QueuedConnection, Q_ARG(int, this->taskNo),
+                              Q_ARG(HistoryChunk, data));
+}
@@ -0,0 +1,144 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QDateTime>
+#include <QDir>
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <vector>
+
+#include "databasedef.h"
+#include "historyloader.h"
+#include "historyviewer.h"
+#include "log_instance.h"
+#include "qcustomplot.h"
+
+/**
+ * @brief Options of the batch rendering mode
+ */
+struct BatchRenderOptions {
+    QString outputDir;
+    QString format = "png"; /**< png or pdf */
+    int width = 1200;
+    int height = 800;
+    bool voltage = true;
+    bool current = true;
+    bool wattage = true;
+    QDateTime from; /**< Start of the time range, invalid for no limit */
+    QDateTime to;   /**< End of the time range, invalid for no limit */
+    int threads = 0; /**< Loader threads, 0 for one per core */
+};
+
+/**
+ * @brief A recording that should be rendered
+ */
+struct BatchRenderJob {
+    long long recId;
+    QString recName;
+    int channels;
+    QString dataFile; /**< Binary recording file, empty for SQLite recordings */
+    qint64 from;      /**< ms since epoch */
+    qint64 to;        /**< ms since epoch */
+    QString outputFile;
+};
+
+/**
+ * @brief Render stored recordings to image files without user interaction
+ *
+ * @details
+ *
+ * Every recording is loaded by its own task on a thread pool with a
+ * HistoryLoader at the resolution of the image, so a long recording only
+ * reads its rollups. QCustomPlot is a widget and can only be used in the GUI
+ * thread, the loaded data is therefore plotted and saved in the thread of the
+ * renderer while the other tasks are still loading. Together with the
+ * offscreen platform plugin no display is needed.
+ */
+class BatchRenderer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BatchRenderer(BatchRenderOptions options, QObject *parent = 0);
+    ~BatchRenderer();
+
+    /**
+     * @brief Start rendering recordings of the default database
+     *
+     * @param recIds Recordings to render, all recordings if empty
+     *
+     * @return False if there is nothing to render
+     */
+    bool start(const std::vector<long long> &recIds);
+
+signals:
+    /**
+     * @brief A recording has been rendered to outputFile or failed
+     */
+    void rendered(QString outputFile, bool success);
+    /**
+     * @brief Emitted when all recordings have been rendered
+     *
+     * @param failed Number of recordings that could not be rendered
+     */
+    void finished(int failed);
+
+private slots:
+    void taskLoaded(int taskNo, HistoryChunk data);
+
+private:
+    BatchRenderOptions options;
+    QThreadPool pool;
+    std::vector<BatchRenderJob> jobs;
+    int tasksRunning;
+    int failed;
+
+    bool queryJobs(const std::vector<long long> &recIds);
+    bool render(const BatchRenderJob &job, const HistoryChunk &data);
+};
+
+/**
+ * @brief Load the data of a single recording for the BatchRenderer
+ */
+class BatchRenderTask : public QRunnable
+{
+public:
+    BatchRenderTask(BatchRenderer *renderer, int taskNo, BatchRenderJob job,
+                    QString dbFile, int maxPoints);
+
+    void run() override;
+
+private:
+    BatchRenderer *renderer;
+    int taskNo;
+    BatchRenderJob job;
+    QString dbFile;
+    int maxPoints;
+};
+
+#endif  // BATCHRENDERER_H
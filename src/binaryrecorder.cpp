@@ -0,0 +1,259 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "binaryrecorder.h"
+
+#include <limits>
+
+namespace bincon = binary_recording_constants;
+namespace binutil = binary_recording_utils;
+
+BinaryRecorder::BinaryRecorder()
+{
+    this->channels = 0;
+    this->recordSize = 0;
+    this->samples = 0;
+}
+
+BinaryRecorder::~BinaryRecorder() { this->close(); }
+QString BinaryRecorder::newRecordingFile(const QString &dir)
+{
+    return dir + QDir::separator() + bincon::DIRECTORY + QDir::separator() +
+           QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss-zzz") + "." +
+           bincon::DATA_SUFFIX;
+}
+
+bool BinaryRecorder::open(const QString &fileName, int channels,
+                          int voltageAccuracy, int currentAccuracy)
+{
+    ealogger::Logger &log = LogInstance::get_instance();
+    this->close();
+    QFileInfo fi(fileName);
+    if (!QDir().mkpath(fi.absolutePath())) {
+        log.eal_error("Can not create recording directory: " +
+                      fi.absolutePath().toStdString());
+        return false;
+    }
+    this->channels = channels;
+    this->recordSize = binutil::recordSize(channels);
+    this->dataFile.setFileName(fileName);
+    this->indexFile.setFileName(binutil::indexFileName(fileName));
+    if (!this->dataFile.open(QIODevice::WriteOnly | QIODevice::Append) ||
+        !this->indexFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        log.eal_error("Can not open binary recording " + fileName.toStdString());
+        log.eal_error(this->dataFile.errorString().toStdString());
+        this->close();
+        return false;
+    }
+    if (this->dataFile.size() == 0) {
+        if (!this->writeHeader(voltageAccuracy, currentAccuracy)) {
+            this->close();
+            return false;
+        }
+        this->samples = 0;
+    } else {
+        // appending to an existing recording, the channel layout must match.
+        if (!this->checkHeader(voltageAccuracy, currentAccuracy)) {
+            this->close();
+            return false;
+        }
+        // Cut off a partially written last record so samples stay aligned.
+        this->samples =
+            (this->dataFile.size() - bincon::HEADER_SIZE) / this->recordSize;
+        this->dataFile.resize(bincon::HEADER_SIZE +
+                              this->samples * this->recordSize);
+    }
+    log.eal_info("Binary recording opened " + fileName.toStdString());
+    return true;
+}
+
+void BinaryRecorder::close()
+{
+    if (this->dataFile.isOpen()) {
+        this->dataFile.flush();
+        this->dataFile.close();
+    }
+    if (this->indexFile.isOpen()) {
+        this->indexFile.flush();
+        this->indexFile.close();
+    }
+}
+
+bool BinaryRecorder::isOpen() const { return this->dataFile.isOpen(); }
+QString BinaryRecorder::getFileName() const
+{
+    return this->dataFile.fileName();
+}
+
+bool BinaryRecorder::append(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer)
+{
+    if (!this->isOpen() || statusBuffer.empty())
+        return false;
+
+    QByteArray records(static_cast<int>(statusBuffer.size()) * this->recordSize,
+                       '\0');
+    QByteArray index;
+    uchar *dst = reinterpret_cast<uchar *>(records.data());
+    for (const auto &status : statusBuffer) {
+        if (this->samples % bincon::INDEX_INTERVAL == 0) {
+            uchar entry[bincon::INDEX_ENTRY_SIZE];
+            qToLittleEndian<qint64>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(
+                    status->getTime().time_since_epoch())
+                    .count(),
+                entry);
+            qToLittleEndian<qint64>(this->samples, entry + 8);
+            index.append(reinterpret_cast<const char *>(entry),
+                         bincon::INDEX_ENTRY_SIZE);
+        }
+        this->encodeSample(status, dst);
+        dst += this->recordSize;
+        this->samples++;
+    }
+
+    ealogger::Logger &log = LogInstance::get_instance();
+    if (this->dataFile.write(records) != records.size() ||
+        !this->dataFile.flush()) {
+        log.eal_error("Can not write binary recording " +
+                      this->dataFile.fileName().toStdString());
+        log.eal_error(this->dataFile.errorString().toStdString());
+        return false;
+    }
+    if (!index.isEmpty() && (this->indexFile.write(index) != index.size() ||
+                             !this->indexFile.flush())) {
+        log.eal_error("Can not write binary recording index " +
+                      this->indexFile.fileName().toStdString());
+        log.eal_error(this->indexFile.errorString().toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool BinaryRecorder::append(const std::shared_ptr<PowerSupplyStatus> &powStatus)
+{
+    return this->append(
+        std::vector<std::shared_ptr<PowerSupplyStatus>>{powStatus});
+}
+
+bool BinaryRecorder::writeHeader(int voltageAccuracy, int currentAccuracy)
+{
+    uchar header[bincon::HEADER_SIZE];
+    std::memset(header, 0, bincon::HEADER_SIZE);
+    std::memcpy(header, bincon::MAGIC, sizeof(bincon::MAGIC));
+    qToLittleEndian<quint32>(bincon::FORMAT_VERSION, header + 8);
+    qToLittleEndian<quint32>(bincon::HEADER_SIZE, header + 12);
+    qToLittleEndian<quint32>(static_cast<quint32>(this->channels), header + 16);
+    qToLittleEndian<quint32>(static_cast<quint32>(this->recordSize),
+                             header + 20);
+    qToLittleEndian<qint32>(voltageAccuracy, header + 24);
+    qToLittleEndian<qint32>(currentAccuracy, header + 28);
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 32);
+    qToLittleEndian<quint32>(bincon::INDEX_INTERVAL, header + 40);
+    if (this->dataFile.write(reinterpret_cast<const char *>(header),
+                             bincon::HEADER_SIZE) != bincon::HEADER_SIZE) {
+        LogInstance::get_instance().eal_error(
+            "Can not write binary recording header " +
+            this->dataFile.errorString().toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool BinaryRecorder::checkHeader(int voltageAccuracy, int currentAccuracy)
+{
+    ealogger::Logger &log = LogInstance::get_instance();
+    // the data file is opened write only, read the header separately
+    QFile headerFile(this->dataFile.fileName());
+    QByteArray header;
+    if (headerFile.open(QIODevice::ReadOnly))
+        header = headerFile.read(bincon::HEADER_SIZE);
+    if (header.size() != bincon::HEADER_SIZE) {
+        log.eal_error("Can not read binary recording header " +
+                      this->dataFile.fileName().toStdString());
+        return false;
+    }
+    const uchar *data = reinterpret_cast<const uchar *>(header.constData());
+    if (std::memcmp(data, bincon::MAGIC, sizeof(bincon::MAGIC)) != 0 ||
+        qFromLittleEndian<quint32>(data + 8) != bincon::FORMAT_VERSION ||
+        qFromLittleEndian<quint32>(data + 12) != bincon::HEADER_SIZE) {
+        log.eal_error("Unsupported binary recording format " +
+                      this->dataFile.fileName().toStdString());
+        return false;
+    }
+    if (qFromLittleEndian<quint32>(data + 16) !=
+            static_cast<quint32>(this->channels) ||
+        qFromLittleEndian<quint32>(data + 20) !=
+            static_cast<quint32>(this->recordSize) ||
+        qFromLittleEndian<qint32>(data + 24) != voltageAccuracy ||
+        qFromLittleEndian<qint32>(data + 28) != currentAccuracy) {
+        log.eal_error("Binary recording " +
+                      this->dataFile.fileName().toStdString() +
+                      " was recorded with another channel layout");
+        return false;
+    }
+    return true;
+}
+
+void BinaryRecorder::encodeSample(
+    const std::shared_ptr<PowerSupplyStatus> &powStatus, uchar *dst)
+{
+    qToLittleEndian<qint64>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            powStatus->getTime().time_since_epoch())
+            .count(),
+        dst);
+    qToLittleEndian<quint32>(static_cast<quint32>(powStatus->getDuration()),
+                             dst + 8);
+    quint8 flags = 0;
+    if (powStatus->getOcp())
+        flags |= bincon::FLAG_OCP;
+    if (powStatus->getOvp())
+        flags |= bincon::FLAG_OVP;
+    if (powStatus->getOtp())
+        flags |= bincon::FLAG_OTP;
+    dst[12] = flags;
+
+    // set values may not be known yet for the first measurements
+    auto value = [](auto getter) {
+        try {
+            return getter();
+        } catch (const std::out_of_range &) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+    };
+    for (int channel = 1; channel <= this->channels; channel++) {
+        uchar *ch = dst + bincon::SAMPLE_HEADER_SIZE +
+                    (channel - 1) * bincon::CHANNEL_SIZE;
+        binutil::putDouble(
+            ch, value([&]() { return powStatus->getVoltage(channel); }));
+        binutil::putDouble(
+            ch + 8, value([&]() { return powStatus->getVoltageSet(channel); }));
+        binutil::putDouble(
+            ch + 16, value([&]() { return powStatus->getCurrent(channel); }));
+        binutil::putDouble(
+            ch + 24, value([&]() { return powStatus->getCurrentSet(channel); }));
+        binutil::putDouble(
+            ch + 32, value([&]() { return powStatus->getWattage(channel); }));
+        try {
+            ch[40] = powStatus->getChannelOutput(channel) ? 1 : 0;
+            ch[41] =
+                static_cast<quint8>(powStatus->getChannelMode(channel));
+        } catch (const std::out_of_range &) {
+        }
+    }
+}
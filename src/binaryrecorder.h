@@ -0,0 +1,101 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARYRECORDER_H
+#define BINARYRECORDER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "binaryrecording.h"
+#include "log_instance.h"
+#include "powersupplystatus.h"
+
+/**
+ * @brief Recording backend writing fixed size sample records to a file
+ *
+ * @details
+ *
+ * This is the alternative to DBConnector::insertMeasurement for high rate or
+ * very long recordings. Samples are appended to a data file and a periodic
+ * seek index is maintained in a second file. There is no per row overhead
+ * like with SQLite, a whole buffer of measurements ends up in one write call.
+ *
+ * The recording itself is still registered in the Recording table of the
+ * database so it shows up in the history tab.
+ */
+class BinaryRecorder
+{
+public:
+    BinaryRecorder();
+    ~BinaryRecorder();
+
+    /**
+     * @brief Generate a new unique data file name in directory dir
+     */
+    static QString newRecordingFile(const QString &dir);
+
+    /**
+     * @brief Open a data file for appending
+     *
+     * @param fileName Data file, the index file name is derived from it
+     * @param channels Number of channels of the device
+     * @param voltageAccuracy Voltage accuracy in decimal places
+     * @param currentAccuracy Current accuracy in decimal places
+     *
+     * @return True if the file could be opened. False as well if an existing
+     * file was recorded with another channel layout or accuracy.
+     */
+    bool open(const QString &fileName, int channels, int voltageAccuracy,
+              int currentAccuracy);
+    void close();
+    bool isOpen() const;
+    QString getFileName() const;
+
+    /**
+     * @brief Append a buffer of measurements with one write call
+     */
+    bool append(const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer);
+    bool append(const std::shared_ptr<PowerSupplyStatus> &powStatus);
+
+private:
+    QFile dataFile;
+    QFile indexFile;
+    int channels;
+    int recordSize;
+    long long samples;
+
+    bool writeHeader(int voltageAccuracy, int currentAccuracy);
+    /**
+     * @brief Check the header of an existing data file before appending
+     *
+     * @return True if the file was written with the same layout
+     */
+    bool checkHeader(int voltageAccuracy, int currentAccuracy);
+    void encodeSample(const std::shared_ptr<PowerSupplyStatus> &powStatus,
+                      uchar *dst);
+};
+
+#endif  // BINARYRECORDER_H
@@ -0,0 +1,130 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARYRECORDING_H
+#define BINARYRECORDING_H
+
+#include <QDir>
+#include <QFileInfo>
+#include <QString>
+#include <QtEndian>
+
+#include <cstring>
+
+/**
+ * @brief Layout of the binary recording files
+ *
+ * @details
+ *
+ * A binary recording consists of two append only files. The data file starts
+ * with a fixed header of HEADER_SIZE bytes followed by fixed size sample
+ * records. The size of a record only depends on the number of channels so the
+ * position of sample n can be computed directly which makes the file easy to
+ * memory map. The index file next to it holds a (time, sample) pair for every
+ * INDEX_INTERVAL-th sample and is used to seek by time.
+ *
+ * All values are stored little endian.
+ *
+ * Header
+ * | Offset | Type    | Content                                |
+ * |--------|---------|----------------------------------------|
+ * | 0      | char[8] | MAGIC                                  |
+ * | 8      | quint32 | Format version                         |
+ * | 12     | quint32 | Header size                            |
+ * | 16     | quint32 | Number of channels                     |
+ * | 20     | quint32 | Record size                            |
+ * | 24     | qint32  | Voltage accuracy (decimal places)      |
+ * | 28     | qint32  | Current accuracy (decimal places)      |
+ * | 32     | qint64  | Start time, ms since epoch             |
+ * | 40     | quint32 | Index interval                         |
+ *
+ * Sample record
+ * | Offset | Type    | Content                                |
+ * |--------|---------|----------------------------------------|
+ * | 0      | qint64  | Measure time, ms since epoch           |
+ * | 8      | quint32 | Duration of the status request in ms   |
+ * | 12     | quint8  | Flags (OCP, OVP, OTP)                  |
+ * | 16     | ...     | One CHANNEL_SIZE block per channel     |
+ *
+ * Channel block
+ * | Offset | Type    | Content                                |
+ * |--------|---------|----------------------------------------|
+ * | 0      | double  | Voltage                                |
+ * | 8      | double  | Voltage set                            |
+ * | 16     | double  | Current                                |
+ * | 24     | double  | Current set                            |
+ * | 32     | double  | Wattage                                |
+ * | 40     | quint8  | Output                                 |
+ * | 41     | quint8  | Mode                                   |
+ */
+namespace binary_recording_constants
+{
+const char MAGIC[8] = {'L', 'P', 'Q', 'R', 'E', 'C', '\0', '\0'};
+const quint32 FORMAT_VERSION = 1;
+
+const char *const DATA_SUFFIX = "lpqrec";
+const char *const INDEX_SUFFIX = "lpqidx";
+const char *const DIRECTORY = "recordings";
+
+const int HEADER_SIZE = 64;
+const int SAMPLE_HEADER_SIZE = 16;
+const int CHANNEL_SIZE = 48;
+const int INDEX_ENTRY_SIZE = 16;
+const int INDEX_INTERVAL = 256;
+
+enum FLAGS : quint8 { FLAG_OCP = 0x01, FLAG_OVP = 0x02, FLAG_OTP = 0x04 };
+}
+
+namespace binary_recording_utils
+{
+namespace bincon = binary_recording_constants;
+
+/**
+ * @brief Size of one sample record in bytes
+ */
+inline int recordSize(int channels)
+{
+    return bincon::SAMPLE_HEADER_SIZE + channels * bincon::CHANNEL_SIZE;
+}
+
+/**
+ * @brief Get the file name of the seek index that belongs to a data file
+ */
+inline QString indexFileName(const QString &dataFile)
+{
+    QFileInfo fi(dataFile);
+    return fi.absolutePath() + QDir::separator() + fi.completeBaseName() + "." +
+           bincon::INDEX_SUFFIX;
+}
+
+inline void putDouble(uchar *dst, double value)
+{
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, dst);
+}
+
+inline double getDouble(const uchar *src)
+{
+    quint64 bits = qFromLittleEndian<quint64>(src);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+}
+
+#endif  // BINARYRECORDING_H
@@ -0,0 +1,222 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "binaryrecordingreader.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace globcon = global_constants;
+namespace bincon = binary_recording_constants;
+namespace binutil = binary_recording_utils;
+
+BinaryRecordingReader::BinaryRecordingReader(QString fileName)
+{
+    this->dataFile.setFileName(std::move(fileName));
+    this->indexFile.setFileName(
+        binutil::indexFileName(this->dataFile.fileName()));
+    this->data = nullptr;
+    this->index = nullptr;
+    this->indexEntries = 0;
+    this->channels = 0;
+    this->recordSize = 0;
+    this->voltageAccuracy = 0;
+    this->currentAccuracy = 0;
+    this->startTime = 0;
+    this->samples = 0;
+}
+
+BinaryRecordingReader::~BinaryRecordingReader() { this->close(); }
+bool BinaryRecordingReader::open()
+{
+    ealogger::Logger &log = LogInstance::get_instance();
+    this->close();
+    if (!this->dataFile.open(QIODevice::ReadOnly)) {
+        log.eal_error("Can not open binary recording " +
+                      this->dataFile.fileName().toStdString());
+        log.eal_error(this->dataFile.errorString().toStdString());
+        return false;
+    }
+    qint64 fileSize = this->dataFile.size();
+    if (fileSize < bincon::HEADER_SIZE) {
+        log.eal_error("Binary recording is truncated " +
+                      this->dataFile.fileName().toStdString());
+        this->close();
+        return false;
+    }
+    this->data = this->dataFile.map(0, fileSize);
+    if (this->data == nullptr) {
+        log.eal_error("Can not map binary recording " +
+                      this->dataFile.fileName().toStdString());
+        this->close();
+        return false;
+    }
+    if (std::memcmp(this->data, bincon::MAGIC, sizeof(bincon::MAGIC)) != 0 ||
+        qFromLittleEndian<quint32>(this->data + 8) != bincon::FORMAT_VERSION) {
+        log.eal_error("Unsupported binary recording format " +
+                      this->dataFile.fileName().toStdString());
+        this->close();
+        return false;
+    }
+    quint32 headerSize = qFromLittleEndian<quint32>(this->data + 12);
+    this->channels =
+        static_cast<int>(qFromLittleEndian<quint32>(this->data + 16));
+    this->recordSize =
+        static_cast<int>(qFromLittleEndian<quint32>(this->data + 20));
+    this->voltageAccuracy = qFromLittleEndian<qint32>(this->data + 24);
+    this->currentAccuracy = qFromLittleEndian<qint32>(this->data + 28);
+    this->startTime = qFromLittleEndian<qint64>(this->data + 32);
+    if (headerSize != bincon::HEADER_SIZE ||
+        this->recordSize != binutil::recordSize(this->channels)) {
+        log.eal_error("Corrupt binary recording header " +
+                      this->dataFile.fileName().toStdString());
+        this->close();
+        return false;
+    }
+    this->samples = (fileSize - bincon::HEADER_SIZE) / this->recordSize;
+
+    // the index is optional, without it findSample searches the whole file
+    if (this->indexFile.open(QIODevice::ReadOnly)) {
+        this->indexEntries = this->indexFile.size() / bincon::INDEX_ENTRY_SIZE;
+        if (this->indexEntries > 0) {
+            this->index = this->indexFile.map(
+                0, this->indexEntries * bincon::INDEX_ENTRY_SIZE);
+        }
+        if (this->index == nullptr) {
+            this->indexEntries = 0;
+        }
+    }
+    return true;
+}
+
+void BinaryRecordingReader::close()
+{
+    if (this->data != nullptr) {
+        this->dataFile.unmap(const_cast<uchar *>(this->data));
+        this->data = nullptr;
+    }
+    if (this->index != nullptr) {
+        this->indexFile.unmap(const_cast<uchar *>(this->index));
+        this->index = nullptr;
+    }
+    this->indexEntries = 0;
+    this->samples = 0;
+    this->dataFile.close();
+    this->indexFile.close();
+}
+
+bool BinaryRecordingReader::isOpen() const { return this->data != nullptr; }
+int BinaryRecordingReader::getChannels() const { return this->channels; }
+int BinaryRecordingReader::getVoltageAccuracy() const
+{
+    return this->voltageAccuracy;
+}
+
+int BinaryRecordingReader::getCurrentAccuracy() const
+{
+    return this->currentAccuracy;
+}
+
+long long BinaryRecordingReader::getStartTime() const
+{
+    return this->startTime;
+}
+
+long long BinaryRecordingReader::getSampleCount() const
+{
+    return this->samples;
+}
+
+long long BinaryRecordingReader::sampleTime(long long sampleNo) const
+{
+    return qFromLittleEndian<qint64>(this->record(sampleNo));
+}
+
+long long BinaryRecordingReader::findSample(long long msecsSinceEpoch) const
+{
+    long long lower = 0;
+    long long upper = this->samples;
+    if (this->indexEntries > 0) {
+        // last index entry with a time <= msecsSinceEpoch
+        long long first = 0;
+        long long last = this->indexEntries;
+        while (first < last) {
+            long long mid = first + (last - first) / 2;
+            const uchar *entry = this->index + mid * bincon::INDEX_ENTRY_SIZE;
+            if (qFromLittleEndian<qint64>(entry) <= msecsSinceEpoch) {
+                first = mid + 1;
+            } else {
+                last = mid;
+            }
+        }
+        if (first > 0) {
+            lower = qFromLittleEndian<qint64>(
+                this->index + (first - 1) * bincon::INDEX_ENTRY_SIZE + 8);
+        }
+        if (first < this->indexEntries) {
+            upper = qFromLittleEndian<qint64>(
+                this->index + first * bincon::INDEX_ENTRY_SIZE + 8);
+        }
+        lower = std::min(lower, this->samples);
+        upper = std::min(upper, this->samples);
+    }
+    while (lower < upper) {
+        long long mid = lower + (upper - lower) / 2;
+        if (this->sampleTime(mid) < msecsSinceEpoch) {
+            lower = mid + 1;
+        } else {
+            upper = mid;
+        }
+    }
+    return lower;
+}
+
+std::shared_ptr<PowerSupplyStatus> BinaryRecordingReader::sample(
+    long long sampleNo) const
+{
+    auto powStatus = std::make_shared<PowerSupplyStatus>();
+    const uchar *rec = this->record(sampleNo);
+    powStatus->setTime(std::chrono::system_clock::time_point(
+        std::chrono::milliseconds(qFromLittleEndian<qint64>(rec))));
+    powStatus->setDuration(qFromLittleEndian<quint32>(rec + 8));
+    quint8 flags = rec[12];
+    powStatus->setOcp(flags & bincon::FLAG_OCP);
+    powStatus->setOvp(flags & bincon::FLAG_OVP);
+    powStatus->setOtp(flags & bincon::FLAG_OTP);
+    for (int channel = 1; channel <= this->channels; channel++) {
+        const uchar *ch = rec + bincon::SAMPLE_HEADER_SIZE +
+                          (channel - 1) * bincon::CHANNEL_SIZE;
+        powStatus->setVoltage(std::make_pair(channel, binutil::getDouble(ch)));
+        powStatus->setVoltageSet(
+            std::make_pair(channel, binutil::getDouble(ch + 8)));
+        powStatus->setCurrent(
+            std::make_pair(channel, binutil::getDouble(ch + 16)));
+        powStatus->setCurrentSet(
+            std::make_pair(channel, binutil::getDouble(ch + 24)));
+        powStatus->setWattage(
+            std::make_pair(channel, binutil::getDouble(ch + 32)));
+        powStatus->setChannelOutput(std::make_pair(channel, ch[40] != 0));
+        powStatus->setChannelMode(
+            std::make_pair(channel, static_cast<globcon::LPQ_MODE>(ch[41])));
+    }
+    return powStatus;
+}
+
+const uchar *BinaryRecordingReader::record(long long sampleNo) const
+{
+    return this->data + bincon::HEADER_SIZE + sampleNo * this->recordSize;
+}
@@ -0,0 +1,94 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARYRECORDINGREADER_H
+#define BINARYRECORDINGREADER_H
+
+#include <QFile>
+#include <QString>
+
+#include <chrono>
+#include <memory>
+
+#include "binaryrecording.h"
+#include "log_instance.h"
+#include "powersupplystatus.h"
+
+/**
+ * @brief Read access to a binary recording using a memory mapped file
+ *
+ * @details
+ *
+ * The data file is mapped as a whole when the reader is opened. Samples that
+ * are appended afterwards by a running BinaryRecorder are not visible until
+ * the reader is reopened. A partially written sample at the end of the file is
+ * ignored.
+ */
+class BinaryRecordingReader
+{
+public:
+    explicit BinaryRecordingReader(QString fileName);
+    ~BinaryRecordingReader();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+
+    int getChannels() const;
+    int getVoltageAccuracy() const;
+    int getCurrentAccuracy() const;
+    long long getStartTime() const;
+    long long getSampleCount() const;
+
+    /**
+     * @brief Measure time of a sample in ms since epoch
+     */
+    long long sampleTime(long long sampleNo) const;
+    /**
+     * @brief Find the first sample with a measure time >= msecsSinceEpoch
+     *
+     * @return Sample number or getSampleCount() if there is no such sample
+     *
+     * @details
+     *
+     * Uses the seek index to narrow down the search range to INDEX_INTERVAL
+     * samples and does a binary search inside this range.
+     */
+    long long findSample(long long msecsSinceEpoch) const;
+    /**
+     * @brief Decode a sample into a PowerSupplyStatus object
+     */
+    std::shared_ptr<PowerSupplyStatus> sample(long long sampleNo) const;
+
+private:
+    QFile dataFile;
+    QFile indexFile;
+    const uchar *data;
+    const uchar *index;
+    long long indexEntries;
+
+    int channels;
+    int recordSize;
+    int voltageAccuracy;
+    int currentAccuracy;
+    long long startTime;
+    long long samples;
+
+    const uchar *record(long long sampleNo) const;
+};
+
+#endif  // BINARYRECORDINGREADER_H
@@ -0,0 +1,124 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "channelstatistics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+
+namespace statcon = statistics_constants;
+
+void RunningStatistics::add(double value)
+{
+    if (std::isnan(value))
+        return;
+    this->samples++;
+    if (this->samples == 1) {
+        this->min = value;
+        this->max = value;
+    } else {
+        this->min = std::min(this->min, value);
+        this->max = std::max(this->max, value);
+    }
+    double delta = value - this->mean;
+    this->mean += delta / this->samples;
+    this->m2 += delta * (value - this->mean);
+    this->meanSquare += (value * value - this->meanSquare) / this->samples;
+}
+
+void RunningStatistics::reset() { *this = RunningStatistics(); }
+long long RunningStatistics::getSamples() const { return this->samples; }
+double RunningStatistics::getMin() const { return this->min; }
+double RunningStatistics::getMax() const { return this->max; }
+double RunningStatistics::getMean() const { return this->mean; }
+double RunningStatistics::getStdDev() const
+{
+    if (this->samples == 0)
+        return 0;
+    return std::sqrt(this->m2 / this->samples);
+}
+
+double RunningStatistics::getRms() const { return std::sqrt(this->meanSquare); }
+void ChannelStatistics::add(long long timeMs, double voltage, double current,
+                            double wattage)
+{
+    this->addValues(voltage, current);
+    if (!this->started) {
+        this->started = true;
+        this->firstTime = timeMs;
+    } else {
+        long long dt = timeMs - this->lastTime;
+        if (dt <= 0)
+            return;
+        if (dt <= statcon::MAX_INTEGRATION_GAP) {
+            // ms to h
+            double hours = dt / 3600000.0;
+            double energy = (this->lastWattage + wattage) / 2 * hours;
+            double charge = (this->lastCurrent + current) / 2 * hours;
+            if (!std::isnan(energy))
+                this->energy += energy;
+            if (!std::isnan(charge))
+                this->charge += charge;
+        }
+    }
+    this->lastTime = timeMs;
+    this->lastCurrent = current;
+    this->lastWattage = wattage;
+}
+
+void ChannelStatistics::add(const std::shared_ptr<PowerSupplyStatus> &powStatus,
+                            int channel)
+{
+    double voltage, current, wattage;
+    try {
+        voltage = powStatus->getVoltage(channel);
+        current = powStatus->getCurrent(channel);
+        wattage = powStatus->getWattage(channel);
+    } catch (const std::out_of_range &) {
+        return;
+    }
+    this->add(std::chrono::duration_cast<std::chrono::milliseconds>(
+                  powStatus->getTime().time_since_epoch())
+                  .count(),
+              voltage, current, wattage);
+}
+
+void ChannelStatistics::reset() { *this = ChannelStatistics(); }
+const RunningStatistics &ChannelStatistics::getVoltage() const
+{
+    return this->voltage;
+}
+
+const RunningStatistics &ChannelStatistics::getCurrent() const
+{
+    return this->current;
+}
+
+double ChannelStatistics::getEnergy() const { return this->energy; }
+double ChannelStatistics::getCharge() const { return this->charge; }
+long long ChannelStatistics::getDuration() const
+{
+    return this->lastTime - this->firstTime;
+}
+
+void ChannelStatistics::addValues(double voltage, double current)
+{
+    this->voltage.add(voltage);
+    this->current.add(current);
+}
@@ -0,0 +1,125 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CHANNELSTATISTICS_H
+#define CHANNELSTATISTICS_H
+
+#include <memory>
+
+#include "powersupplystatus.h"
+
+namespace statistics_constants
+{
+/**
+ * @brief Samples that are further apart in ms are not integrated
+ *
+ * @details
+ *
+ * Such a gap means the device was not polled, e.g. because the connection was
+ * lost.
+ */
+const long long MAX_INTEGRATION_GAP = 10000;
+}
+
+/**
+ * @brief Streaming min, max, mean, standard deviation and RMS of one quantity
+ *
+ * @details
+ *
+ * Mean and variance are updated with Welford's algorithm, the mean of the
+ * squares for the RMS the same way. Adding a value is O(1) and numerically
+ * stable for long runs.
+ */
+class RunningStatistics
+{
+public:
+    void add(double value);
+    void reset();
+
+    long long getSamples() const;
+    double getMin() const;
+    double getMax() const;
+    double getMean() const;
+    /**
+     * @brief Population standard deviation
+     */
+    double getStdDev() const;
+    double getRms() const;
+
+private:
+    long long samples = 0;
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double m2 = 0; /**< Sum of squared differences from the mean */
+    double meanSquare = 0;
+};
+
+/**
+ * @brief Running statistics of one channel
+ *
+ * @details
+ *
+ * Besides the statistics of voltage and current the energy and the charge are
+ * integrated over the measure time of the samples with the trapezoidal rule.
+ * Samples have to be added in chronological order, a sample that is not newer
+ * than the previous one only counts for the value statistics.
+ */
+class ChannelStatistics
+{
+public:
+    void add(long long timeMs, double voltage, double current, double wattage);
+    /**
+     * @brief Add the values of channel of a status object
+     *
+     * @details
+     *
+     * Status objects without this channel are ignored.
+     */
+    void add(const std::shared_ptr<PowerSupplyStatus> &powStatus, int channel);
+    void reset();
+
+    const RunningStatistics &getVoltage() const;
+    const RunningStatistics &getCurrent() const;
+    /**
+     * @brief Integrated energy in Wh
+     */
+    double getEnergy() const;
+    /**
+     * @brief Integrated charge in Ah
+     */
+    double getCharge() const;
+    /**
+     * @brief Time between the first and the last sample in ms
+     */
+    long long getDuration() const;
+
+private:
+    RunningStatistics voltage;
+    RunningStatistics current;
+    double energy = 0;
+    double charge = 0;
+    bool started = false;
+    long long firstTime = 0;
+    long long lastTime = 0;
+    double lastCurrent = 0;
+    double lastWattage = 0;
+
+    void addValues(double voltage, double current);
+};
+
+#endif  // CHANNELSTATISTICS_H
@@ -0,0 +1,144 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "controlloop.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ctrlcon = control_constants;
+namespace globcon = global_constants;
+
+void ControlLoop::configure(int channel, const ControlConfig &config)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (config.mode == ctrlcon::CONTROL_MODE::OFF) {
+        this->loops.erase(channel);
+        return;
+    }
+    ChannelLoop loop;
+    loop.config = config;
+    this->loops[channel] = loop;
+}
+
+bool ControlLoop::isActive()
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return !this->loops.empty();
+}
+
+std::vector<int> ControlLoop::getChannels()
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    std::vector<int> channels;
+    for (const auto &loop : this->loops) {
+        channels.push_back(loop.first);
+    }
+    return channels;
+}
+
+std::vector<ControlAction> ControlLoop::update(int channel, double voltage,
+                                               double current,
+                                               double voltageSet,
+                                               bool &finished)
+{
+    finished = false;
+    std::lock_guard<std::mutex> lock(this->mtx);
+    auto it = this->loops.find(channel);
+    if (it == this->loops.end() || std::isnan(voltage) || std::isnan(current))
+        return {};
+    std::vector<ControlAction> actions;
+    switch (it->second.config.mode) {
+    case ctrlcon::CONTROL_MODE::CONSTANT_POWER:
+        actions = this->updatePower(channel, it->second, voltage, current,
+                                    voltageSet);
+        break;
+    case ctrlcon::CONTROL_MODE::CC_CV_CHARGE:
+        actions = this->updateCharge(channel, it->second, voltage, current,
+                                     finished);
+        break;
+    case ctrlcon::CONTROL_MODE::OFF:
+        break;
+    }
+    if (finished)
+        this->loops.erase(it);
+    return actions;
+}
+
+std::vector<ControlAction> ControlLoop::updatePower(int channel,
+                                                    ChannelLoop &loop,
+                                                    double voltage,
+                                                    double current,
+                                                    double voltageSet)
+{
+    ControlAction action;
+    action.channel = channel;
+    action.target = globcon::LPQ_DATATYPE::SETVOLTAGE;
+    if (loop.phase == PHASE::START || current < ctrlcon::MIN_CURRENT) {
+        // without a load there is nothing to estimate, start low and let the
+        // loop raise the voltage
+        loop.phase = PHASE::CC;
+        if (current >= ctrlcon::MIN_CURRENT || voltageSet > 0)
+            return {};
+        action.value = std::min(1.0, loop.config.voltageLimit);
+        return {action};
+    }
+    double resistance = voltage / current;
+    double target = std::sqrt(loop.config.power * resistance);
+    double value = voltageSet + ctrlcon::POWER_GAIN * (target - voltageSet);
+    action.value = std::max(0.0, std::min(value, loop.config.voltageLimit));
+    return {action};
+}
+
+std::vector<ControlAction> ControlLoop::updateCharge(int channel,
+                                                     ChannelLoop &loop,
+                                                     double voltage,
+                                                     double current,
+                                                     bool &finished)
+{
+    if (loop.phase == PHASE::START) {
+        loop.phase = PHASE::CC;
+        ControlAction currentAction;
+        currentAction.channel = channel;
+        currentAction.target = globcon::LPQ_DATATYPE::SETCURRENT;
+        currentAction.value = loop.config.chargeCurrent;
+        ControlAction voltageAction;
+        voltageAction.channel = channel;
+        voltageAction.target = globcon::LPQ_DATATYPE::SETVOLTAGE;
+        voltageAction.value = loop.config.chargeVoltage;
+        return {currentAction, voltageAction};
+    }
+    if (loop.phase == PHASE::CC &&
+        voltage >=
+            loop.config.chargeVoltage * (1 - ctrlcon::CV_TOLERANCE)) {
+        loop.phase = PHASE::CV;
+    }
+    if (loop.phase != PHASE::CV)
+        return {};
+    if (current > loop.config.terminationCurrent) {
+        loop.lowCurrentCycles = 0;
+        return {};
+    }
+    // a single low reading may be noise
+    if (++loop.lowCurrentCycles < ctrlcon::TERMINATION_CYCLES)
+        return {};
+    finished = true;
+    ControlAction off;
+    off.channel = channel;
+    off.outputOff = true;
+    return {off};
+}
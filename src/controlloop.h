@@ -0,0 +1,149 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CONTROLLOOP_H
+#define CONTROLLOOP_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "global.h"
+
+namespace control_constants
+{
+enum class CONTROL_MODE {
+    OFF = 0,
+    CONSTANT_POWER, /**< Adjust the set voltage to a power */
+    CC_CV_CHARGE    /**< Constant current, constant voltage charge */
+};
+/**
+ * @brief Minimum period of the control cycles in ms
+ */
+const int MIN_PERIOD = 20;
+/**
+ * @brief Currents below this value in A mean there is no load
+ */
+const double MIN_CURRENT = 0.001;
+/**
+ * @brief Fraction of the voltage error that is corrected per cycle
+ */
+const double POWER_GAIN = 0.5;
+/**
+ * @brief Relative deviation from the charge voltage that counts as CV phase
+ */
+const double CV_TOLERANCE = 0.01;
+/**
+ * @brief Consecutive cycles below the termination current that end a charge
+ */
+const int TERMINATION_CYCLES = 3;
+}
+
+/**
+ * @brief Parameters of a control mode
+ *
+ * @details
+ *
+ * CONSTANT_POWER uses power and voltageLimit, CC_CV_CHARGE the charge values.
+ */
+struct ControlConfig {
+    control_constants::CONTROL_MODE mode = control_constants::CONTROL_MODE::OFF;
+    double power = 0;        /**< W */
+    double voltageLimit = 0; /**< V */
+    double chargeVoltage = 0;
+    double chargeCurrent = 0;
+    double terminationCurrent = 0; /**< Charge ends below this current */
+};
+
+/**
+ * @brief Setpoint change requested by a control loop
+ */
+struct ControlAction {
+    int channel = 0;
+    /**
+     * @brief SETVOLTAGE or SETCURRENT
+     */
+    global_constants::LPQ_DATATYPE target =
+        global_constants::LPQ_DATATYPE::SETVOLTAGE;
+    double value = 0;
+    /**
+     * @brief Switch the output off instead of changing a setpoint
+     */
+    bool outputOff = false;
+};
+
+/**
+ * @brief Closed loop control modes the hardware does not offer
+ *
+ * @details
+ *
+ * The loops are evaluated by the serial worker thread of PowerSupplySCPI
+ * with every fresh measurement of a channel and return the setpoint changes
+ * the worker writes right away. Configuration happens on the GUI thread, the
+ * class has its own mutex so it never waits for the serial port.
+ *
+ * Constant power assumes a mostly resistive load. The set voltage is moved
+ * towards sqrt(P * R) with R estimated from the last measurement.
+ *
+ * A CC-CV charge sets the charge current and voltage once, the supply itself
+ * switches from CC to CV. The charge ends when the current stays below the
+ * termination current in the CV phase, the output is switched off then and
+ * the loop of the channel is removed.
+ */
+class ControlLoop
+{
+public:
+    /**
+     * @brief Set the control mode of a channel, OFF removes the loop
+     */
+    void configure(int channel, const ControlConfig &config);
+    bool isActive();
+    /**
+     * @brief Channels with an active loop
+     */
+    std::vector<int> getChannels();
+    /**
+     * @brief Evaluate the loop of channel with a fresh measurement
+     *
+     * @param finished Set to true if the loop ended with this update
+     *
+     * @return Setpoint changes, empty if nothing has to change
+     */
+    std::vector<ControlAction> update(int channel, double voltage,
+                                      double current, double voltageSet,
+                                      bool &finished);
+
+private:
+    enum class PHASE { START = 0, CC, CV };
+    struct ChannelLoop {
+        ControlConfig config;
+        PHASE phase = PHASE::START;
+        int lowCurrentCycles = 0;
+    };
+
+    std::mutex mtx;
+    std::map<int, ChannelLoop> loops;
+
+    std::vector<ControlAction> updatePower(int channel, ChannelLoop &loop,
+                                           double voltage, double current,
+                                           double voltageSet);
+    std::vector<ControlAction> updateCharge(int channel, ChannelLoop &loop,
+                                            double voltage, double current,
+                                            bool &finished);
+};
+
+#endif  // CONTROLLOOP_H
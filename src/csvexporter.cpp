@@ -0,0 +1,560 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "csvexporter.h"
+
+#include <charconv>
+#include <utility>
+
+namespace dbcon = database_constants;
+namespace csvcon = csv_export_constants;
+
+CsvExporter::CsvExporter(QObject *parent) : QObject(parent)
+{
+    this->tasksRunning = 0;
+    this->success = true;
+    this->progressTimer.setInterval(csvcon::PROGRESS_INTERVAL);
+    QObject::connect(&this->progressTimer, &QTimer::timeout, [this]() {
+        emit this->progress(this->state->rowsDone.load(),
+                            this->state->rowsTotal.load());
+    });
+}
+
+CsvExporter::~CsvExporter()
+{
+    if (this->isRunning()) {
+        this->cancel();
+        this->pool.waitForDone();
+        this->removeParts();
+    }
+}
+
+bool CsvExporter::start(std::vector<CsvExportJob> jobs, QString csvFile,
+                        rollup_constants::LEVEL level)
+{
+    if (this->isRunning() || jobs.empty())
+        return false;
+
+    LogInstance::get_instance().eal_info("Exporting data to csv file " +
+                                         csvFile.toStdString());
+    this->csvFile = std::move(csvFile);
+    this->level = level;
+    this->state = std::make_shared<ExportState>();
+    this->partFiles.clear();
+    this->success = true;
+    this->errorString = "";
+    this->tasksRunning = static_cast<int>(jobs.size());
+
+    // every task needs its own connection, the default connection belongs to
+    // the GUI thread.
+    QString dbFile = QSqlDatabase::database().databaseName();
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].level = level;
+        this->partFiles.push_back(this->csvFile +
+                                  QString(".part%1").arg(i));
+        CsvExportTask *task =
+            new CsvExportTask(this, static_cast<int>(i), std::move(jobs[i]),
+                              dbFile, this->partFiles.back(), this->state);
+        task->setAutoDelete(true);
+        this->pool.start(task);
+    }
+    this->progressTimer.start();
+    return true;
+}
+
+bool CsvExporter::isRunning() const { return this->tasksRunning > 0; }
+void CsvExporter::cancel()
+{
+    if (this->state)
+        this->state->canceled = true;
+}
+
+void CsvExporter::taskFinished(int taskNo, bool success, QString errorString)
+{
+    if (!success && this->success) {
+        this->success = false;
+        this->errorString = std::move(errorString);
+        if (!this->state->canceled) {
+            LogInstance::get_instance().eal_error(
+                "Could not export recording " + std::to_string(taskNo) + ": " +
+                this->errorString.toStdString());
+        }
+    }
+    this->tasksRunning--;
+    if (this->tasksRunning == 0)
+        this->finishExport();
+}
+
+void CsvExporter::finishExport()
+{
+    this->progressTimer.stop();
+    emit this->progress(this->state->rowsDone.load(),
+                        this->state->rowsTotal.load());
+    if (this->state->canceled) {
+        this->removeParts();
+        emit this->finished(false, "Export canceled");
+        return;
+    }
+    if (this->success && !this->mergeParts()) {
+        this->success = false;
+    }
+    this->removeParts();
+    emit this->finished(this->success, this->errorString);
+}
+
+bool CsvExporter::mergeParts()
+{
+    QFile csvf(this->csvFile);
+    if (!csvf.open(QIODevice::WriteOnly | QIODevice::Truncate |
+                   QIODevice::Text)) {
+        this->errorString = "Can not open " + this->csvFile + ": " +
+                            csvf.errorString();
+        return false;
+    }
+    csvf.write(this->level == rollup_constants::LEVEL::RAW
+                   ? csvcon::CSV_HEADER
+                   : csvcon::CSV_ROLLUP_HEADER);
+    for (const auto &partFile : this->partFiles) {
+        QFile part(partFile);
+        if (!part.open(QIODevice::ReadOnly)) {
+            this->errorString = "Can not open " + partFile;
+            return false;
+        }
+        while (!part.atEnd()) {
+            QByteArray chunk = part.read(csvcon::WRITE_BUFFER_SIZE);
+            if (csvf.write(chunk) != chunk.size()) {
+                this->errorString = "Can not write " + this->csvFile + ": " +
+                                    csvf.errorString();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void CsvExporter::removeParts()
+{
+    for (const auto &partFile : this->partFiles) {
+        QFile::remove(partFile);
+    }
+    this->partFiles.clear();
+}
+
+CsvExportTask::CsvExportTask(CsvExporter *exporter, int taskNo,
+                             CsvExportJob job, QString dbFile,
+                             QString partFile,
+                             std::shared_ptr<CsvExporter::ExportState> state)
+    : exporter(exporter),
+      taskNo(taskNo),
+      job(std::move(job)),
+      dbFile(std::move(dbFile)),
+      partFile(std::move(partFile)),
+      state(std::move(state))
+{
+}
+
+void CsvExportTask::run()
+{
+    QString errorString;
+    bool success = false;
+    this->out.setFileName(this->partFile);
+    if (!this->out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorString =
+            "Can not open " + this->partFile + ": " + this->out.errorString();
+    } else {
+        this->buffer.reserve(csvcon::WRITE_BUFFER_SIZE + 4096);
+        // the quoted recording and device names are the same for every row
+        this->rowPrefix = "\"" + this->job.recName.toUtf8() + "\";\"" +
+                          this->job.devName.toUtf8() + "\";";
+        if (this->job.level != rollup_constants::LEVEL::RAW) {
+            success = this->exportRollup(errorString);
+        } else if (this->job.dataFile.isEmpty()) {
+            success = this->exportDatabase(errorString);
+        } else {
+            success = this->exportBinary(errorString);
+        }
+        if (success && !this->flushBuffer(true)) {
+            success = false;
+            errorString = "Can not write " + this->partFile + ": " +
+                          this->out.errorString();
+        }
+        this->out.close();
+    }
+    QMetaObject::invokeMethod(this->exporter, "taskFinished",
+                              Qt::QueuedConnection, Q_ARG(int, this->taskNo),
+                              Q_ARG(bool, success),
+                              Q_ARG(QString, errorString));
+}
+
+QString CsvExportTask::connectionName() const
+{
+    return QString("csvexport_%1_%2")
+        .arg(this->taskNo)
+        .arg(reinterpret_cast<quintptr>(this), 0, 16);
+}
+
+bool CsvExportTask::exportDatabase(QString &errorString)
+{
+    QString connectionName = this->connectionName();
+    bool success = true;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(this->dbFile);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            errorString = db.lastError().text();
+            success = false;
+        }
+
+        if (success) {
+            QSqlQuery countQuery(db);
+            countQuery.prepare(QString("SELECT COUNT(*) FROM ") +
+                               dbcon::TBL_MEASUREMENT + " WHERE " +
+                               dbcon::TBL_MEASUREMENT_REC + " = ?");
+            countQuery.bindValue(0, this->job.recId);
+            if (countQuery.exec() && countQuery.next()) {
+                this->state->rowsTotal +=
+                    countQuery.value(0).toLongLong() * this->job.channels;
+            }
+        }
+
+        QSqlQuery getMeasurements(db);
+        getMeasurements.setForwardOnly(true);
+        // clang-format off
+        if (success && !getMeasurements.prepare(QString("SELECT m.") + dbcon::TBL_MEASUREMENT_OCP + ", "
+                                    + "m." + dbcon::TBL_MEASUREMENT_OVP + ", "
+                                    + "m." + dbcon::TBL_MEASUREMENT_OTP + ", "
+                                    + "m." + dbcon::TBL_MEASUREMENT_TRMODE + ", "
+                                    + "m." + dbcon::TBL_MEASUREMENT_TIME + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_CHAN + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_OUTPUT + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_MODE + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_V + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_VS + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_A + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_AS + ", "
+                                    + "c." + dbcon::TBL_CHANNEL_W + " \n"
+                                    + "FROM " + dbcon::TBL_CHANNEL + " AS c \n"
+                                    + "INNER JOIN " + dbcon::TBL_MEASUREMENT + " AS m \n"
+                                    + "ON c." + dbcon::TBL_CHANNEL_MES + " = m." + dbcon::TBL_MEASUREMENT_ID + "\n"
+                                    + "WHERE m." + dbcon::TBL_MEASUREMENT_REC + " = ? \n"
+                                    + "ORDER BY m." + dbcon::TBL_MEASUREMENT_TIME + ", c." + dbcon::TBL_CHANNEL_ID)) {
+            errorString = getMeasurements.lastError().text();
+            success = false;
+        }
+        // clang-format on
+        if (success) {
+            getMeasurements.bindValue(0, this->job.recId);
+            if (!getMeasurements.exec()) {
+                errorString = getMeasurements.lastError().text();
+                success = false;
+            }
+        }
+        long long rows = 0;
+        while (success && getMeasurements.next()) {
+            if (this->rollup) {
+                long long timeMs =
+                    QDateTime::fromString(getMeasurements.value(4).toString(),
+                                          Qt::ISODateWithMs)
+                        .toMSecsSinceEpoch();
+                this->rollup->add(timeMs, getMeasurements.value(5).toInt(),
+                                  getMeasurements.value(8).toDouble(),
+                                  getMeasurements.value(10).toDouble(),
+                                  getMeasurements.value(12).toDouble());
+                // only buckets that can not receive more rows are written
+                if ((rows + 1) % 1024 == 0)
+                    this->appendRollups(this->rollup->take(timeMs));
+            } else {
+                this->appendMeasurement(getMeasurements);
+            }
+
+            if (++rows % 1024 == 0) {
+                this->state->rowsDone += 1024;
+                if (this->state->canceled) {
+                    errorString = "Export canceled";
+                    success = false;
+                }
+            }
+            if (success && !this->flushBuffer(false)) {
+                errorString = "Can not write " + this->partFile + ": " +
+                              this->out.errorString();
+                success = false;
+            }
+        }
+        this->state->rowsDone += rows % 1024;
+        if (success && this->rollup)
+            this->appendRollups(this->rollup->take());
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return success;
+}
+
+void CsvExportTask::appendMeasurement(const QSqlQuery &query)
+{
+    this->buffer.append(this->rowPrefix);
+    this->appendBool(query.value(0));
+    this->buffer.append(';');
+    this->appendBool(query.value(1));
+    this->buffer.append(';');
+    this->appendBool(query.value(2));
+    this->buffer.append(';');
+    QVariant trmode = query.value(3);
+    if (!trmode.isNull())
+        this->appendInt(trmode.toLongLong());
+    this->buffer.append(';');
+    // datetime is stored as text, no need to convert it
+    this->buffer.append(query.value(4).toString().toUtf8());
+    this->buffer.append(';');
+    this->appendInt(query.value(5).toLongLong());
+    this->buffer.append(';');
+    this->appendBool(query.value(6));
+    this->buffer.append(';');
+    this->appendInt(query.value(7).toLongLong());
+    for (int i = 8; i < 13; i++) {
+        this->buffer.append(';');
+        this->appendDouble(query.value(i).toDouble());
+    }
+    this->buffer.append('\n');
+}
+
+bool CsvExportTask::exportBinary(QString &errorString)
+{
+    BinaryRecordingReader reader(this->job.dataFile);
+    if (!reader.open()) {
+        errorString = "Can not open binary recording " + this->job.dataFile;
+        return false;
+    }
+    this->state->rowsTotal += reader.getSampleCount() * reader.getChannels();
+    for (long long i = 0; i < reader.getSampleCount(); i++) {
+        if (i % 1024 == 0 && this->state->canceled) {
+            errorString = "Export canceled";
+            return false;
+        }
+        std::shared_ptr<PowerSupplyStatus> powStatus = reader.sample(i);
+        long long timeMs = reader.sampleTime(i);
+        if (this->rollup) {
+            for (int channel = 1; channel <= reader.getChannels(); channel++) {
+                this->rollup->add(timeMs, channel,
+                                  powStatus->getVoltage(channel),
+                                  powStatus->getCurrent(channel),
+                                  powStatus->getWattage(channel));
+            }
+            if ((i + 1) % 1024 == 0)
+                this->appendRollups(this->rollup->take(timeMs));
+        } else {
+            this->appendSample(powStatus, timeMs, reader.getChannels());
+        }
+        this->state->rowsDone += reader.getChannels();
+        if (!this->flushBuffer(false)) {
+            errorString = "Can not write " + this->partFile + ": " +
+                          this->out.errorString();
+            return false;
+        }
+    }
+    if (this->rollup)
+        this->appendRollups(this->rollup->take());
+    return true;
+}
+
+void CsvExportTask::appendSample(
+    const std::shared_ptr<PowerSupplyStatus> &powStatus, long long timeMs,
+    int channels)
+{
+    QByteArray dt = QDateTime::fromMSecsSinceEpoch(timeMs)
+                        .toString(Qt::ISODateWithMs)
+                        .toUtf8();
+    for (int channel = 1; channel <= channels; channel++) {
+        // same columns as the database export, tracking mode is unknown
+        this->buffer.append(this->rowPrefix);
+        this->appendInt(powStatus->getOcp());
+        this->buffer.append(';');
+        this->appendInt(powStatus->getOvp());
+        this->buffer.append(';');
+        this->appendInt(powStatus->getOtp());
+        this->buffer.append(";;");
+        this->buffer.append(dt);
+        this->buffer.append(';');
+        this->appendInt(channel);
+        this->buffer.append(';');
+        this->appendInt(powStatus->getChannelOutput(channel));
+        this->buffer.append(';');
+        this->appendInt(static_cast<int>(powStatus->getChannelMode(channel)));
+        this->buffer.append(';');
+        this->appendDouble(powStatus->getVoltage(channel));
+        this->buffer.append(';');
+        this->appendDouble(powStatus->getVoltageSet(channel));
+        this->buffer.append(';');
+        this->appendDouble(powStatus->getCurrent(channel));
+        this->buffer.append(';');
+        this->appendDouble(powStatus->getCurrentSet(channel));
+        this->buffer.append(';');
+        this->appendDouble(powStatus->getWattage(channel));
+        this->buffer.append('\n');
+    }
+}
+
+bool CsvExportTask::exportRollup(QString &errorString)
+{
+    QString connectionName = this->connectionName();
+    bool success = true;
+    bool stored = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(this->dbFile);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            errorString = db.lastError().text();
+            success = false;
+        }
+
+        QString where = QString(" WHERE ") + dbcon::TBL_ROLLUP_REC +
+                        " = ? AND " + dbcon::TBL_ROLLUP_LEVEL + " = ?";
+        long long buckets = 0;
+        if (success) {
+            QSqlQuery countQuery(db);
+            countQuery.prepare(QString("SELECT COUNT(*) FROM ") +
+                               dbcon::TBL_ROLLUP + where);
+            countQuery.bindValue(0, this->job.recId);
+            countQuery.bindValue(1, static_cast<int>(this->job.level));
+            if (countQuery.exec() && countQuery.next())
+                buckets = countQuery.value(0).toLongLong();
+            stored = buckets > 0;
+        }
+
+        if (success && stored) {
+            this->state->rowsTotal += buckets;
+            QString columns = QString(dbcon::TBL_ROLLUP_BUCKET) + ", " +
+                              dbcon::TBL_ROLLUP_CHAN + ", " +
+                              dbcon::TBL_ROLLUP_SAMPLES;
+            for (const auto &quantity : dbcon::TBL_ROLLUP_QUANTITIES) {
+                for (const auto &aggregate : dbcon::TBL_ROLLUP_AGGREGATES) {
+                    columns += ", " + quantity + "_" + aggregate;
+                }
+            }
+            QSqlQuery getBuckets(db);
+            getBuckets.setForwardOnly(true);
+            getBuckets.prepare("SELECT " + columns + " FROM " +
+                               dbcon::TBL_ROLLUP + where + " ORDER BY " +
+                               dbcon::TBL_ROLLUP_BUCKET + ", " +
+                               dbcon::TBL_ROLLUP_CHAN);
+            getBuckets.bindValue(0, this->job.recId);
+            getBuckets.bindValue(1, static_cast<int>(this->job.level));
+            if (!getBuckets.exec()) {
+                errorString = getBuckets.lastError().text();
+                success = false;
+            }
+            long long rows = 0;
+            while (success && getBuckets.next()) {
+                this->buffer.append(this->rowPrefix);
+                this->buffer.append(
+                    QDateTime::fromMSecsSinceEpoch(
+                        getBuckets.value(0).toLongLong())
+                        .toString(Qt::ISODateWithMs)
+                        .toUtf8());
+                this->buffer.append(';');
+                this->appendInt(getBuckets.value(1).toLongLong());
+                this->buffer.append(';');
+                this->appendInt(getBuckets.value(2).toLongLong());
+                for (int i = 3; i < 15; i++) {
+                    this->buffer.append(';');
+                    this->appendDouble(getBuckets.value(i).toDouble());
+                }
+                this->buffer.append('\n');
+                if (++rows % 1024 == 0) {
+                    this->state->rowsDone += 1024;
+                    if (this->state->canceled) {
+                        errorString = "Export canceled";
+                        success = false;
+                    }
+                }
+                if (success && !this->flushBuffer(false)) {
+                    errorString = "Can not write " + this->partFile + ": " +
+                                  this->out.errorString();
+                    success = false;
+                }
+            }
+            this->state->rowsDone += rows % 1024;
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    if (!success || stored)
+        return success;
+
+    // recorded before rollups existed, aggregate the raw measurements
+    LogInstance::get_instance().eal_debug(
+        "No rollups stored for recording " + std::to_string(this->job.recId) +
+        ", aggregating raw measurements");
+    this->rollup = std::unique_ptr<RollupAccumulator>(
+        new RollupAccumulator({this->job.level}));
+    if (this->job.dataFile.isEmpty())
+        return this->exportDatabase(errorString);
+    return this->exportBinary(errorString);
+}
+
+void CsvExportTask::appendRollups(const std::vector<RollupBucket> &buckets)
+{
+    for (const auto &bucket : buckets) {
+        this->buffer.append(this->rowPrefix);
+        this->buffer.append(QDateTime::fromMSecsSinceEpoch(bucket.bucketStart)
+                                .toString(Qt::ISODateWithMs)
+                                .toUtf8());
+        this->buffer.append(';');
+        this->appendInt(bucket.channel);
+        this->buffer.append(';');
+        this->appendInt(bucket.samples);
+        for (const RollupValue *value :
+             {&bucket.voltage, &bucket.current, &bucket.wattage}) {
+            for (double v : {value->min, value->max, value->mean, value->last}) {
+                this->buffer.append(';');
+                this->appendDouble(v);
+            }
+        }
+        this->buffer.append('\n');
+    }
+}
+
+bool CsvExportTask::flushBuffer(bool force)
+{
+    if (this->buffer.isEmpty() ||
+        (!force && this->buffer.size() < csvcon::WRITE_BUFFER_SIZE))
+        return true;
+    bool ok = this->out.write(this->buffer) == this->buffer.size();
+    // keep the allocated memory for the next rows
+    this->buffer.resize(0);
+    return ok;
+}
+
+void CsvExportTask::appendInt(long long value)
+{
+    char num[24];
+    auto result = std::to_chars(num, num + sizeof(num), value);
+    this->buffer.append(num, static_cast<int>(result.ptr - num));
+}
+
+void CsvExportTask::appendDouble(double value)
+{
+    // 10 significant digits are more than any supported device delivers.
+    // QByteArray::number does not depend on the C locale, snprintf would
+    // write a decimal comma for many users.
+    this->buffer.append(QByteArray::number(value, 'g', 10));
+}
+
+void CsvExportTask::appendBool(const QVariant &value)
+{
+    if (!value.isNull())
+        this->appendInt(value.toLongLong());
+}
@@ -0,0 +1,214 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef CSVEXPORTER_H
+#define CSVEXPORTER_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QObject>
+#include <QRunnable>
+#include <QString>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariant>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "binaryrecordingreader.h"
+#include "databasedef.h"
+#include "log_instance.h"
+#include "rollupaccumulator.h"
+
+/**
+ * @brief A recording that should be exported
+ */
+struct CsvExportJob {
+    long long recId;
+    QString recName;
+    QString devName;
+    int channels;
+    QString dataFile; /**< Binary recording file, empty for SQLite recordings */
+    rollup_constants::LEVEL level; /**< Set by CsvExporter::start */
+};
+
+namespace csv_export_constants
+{
+const char *const CSV_HEADER =
+    "Recording;Device;OCP;OVP;OTP;TrackingMode;DateTime;Channel;"
+    "Output;Mode;Voltage;VoltageSet;Current;CurrentSet;Wattage\n";
+const char *const CSV_ROLLUP_HEADER =
+    "Recording;Device;DateTime;Channel;Samples;"
+    "VoltageMin;VoltageMax;VoltageMean;VoltageLast;"
+    "CurrentMin;CurrentMax;CurrentMean;CurrentLast;"
+    "WattageMin;WattageMax;WattageMean;WattageLast\n";
+/**
+ * @brief Size of the write buffer of an export task
+ */
+const int WRITE_BUFFER_SIZE = 1 << 20;
+/**
+ * @brief Interval in ms the progress of the export tasks is reported
+ */
+const int PROGRESS_INTERVAL = 100;
+}
+
+/**
+ * @brief Export recordings to a CSV file in the background
+ *
+ * @details
+ *
+ * Every recording is exported by its own task on a thread pool. Each task uses
+ * its own database connection and writes into a part file with a large write
+ * buffer. Numbers are formatted directly into this buffer. When all tasks are
+ * done the part files are concatenated in the order of the jobs.
+ *
+ * Recordings can also be exported at the resolution of a rollup level. The
+ * buckets are read from the Rollup table, recordings without rollups are
+ * aggregated from the raw measurements on the fly.
+ *
+ * The exporter lives in the GUI thread and reports the progress with
+ * signals.
+ */
+class CsvExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CsvExporter(QObject *parent = 0);
+    ~CsvExporter();
+
+    /**
+     * @brief Start the export
+     *
+     * @param jobs Recordings to export
+     * @param csvFile Target file
+     * @param level Resolution of the export
+     *
+     * @return False if an export is already running
+     */
+    bool start(std::vector<CsvExportJob> jobs, QString csvFile,
+               rollup_constants::LEVEL level = rollup_constants::LEVEL::RAW);
+    bool isRunning() const;
+
+signals:
+    /**
+     * @brief Rows written and estimated number of rows
+     */
+    void progress(long long rowsDone, long long rowsTotal);
+    /**
+     * @brief Emitted when the export has finished or was canceled
+     *
+     * @param success True if all recordings were exported
+     * @param errorString Description of the first error
+     */
+    void finished(bool success, QString errorString);
+
+public slots:
+    void cancel();
+
+private slots:
+    void taskFinished(int taskNo, bool success, QString errorString);
+
+private:
+    /**
+     * @brief Shared state between the exporter and its tasks
+     */
+    struct ExportState {
+        std::atomic<long long> rowsDone{0};
+        std::atomic<long long> rowsTotal{0};
+        std::atomic<bool> canceled{false};
+    };
+
+    QThreadPool pool;
+    QTimer progressTimer;
+    std::shared_ptr<ExportState> state;
+    std::vector<QString> partFiles;
+    QString csvFile;
+    rollup_constants::LEVEL level;
+    int tasksRunning;
+    bool success;
+    QString errorString;
+
+    void finishExport();
+    /**
+     * @brief Concatenate header and part files to the target file
+     */
+    bool mergeParts();
+    void removeParts();
+
+    friend class CsvExportTask;
+};
+
+/**
+ * @brief Export a single recording to a part file
+ */
+class CsvExportTask : public QRunnable
+{
+public:
+    CsvExportTask(CsvExporter *exporter, int taskNo, CsvExportJob job,
+                  QString dbFile, QString partFile,
+                  std::shared_ptr<CsvExporter::ExportState> state);
+
+    void run() override;
+
+private:
+    CsvExporter *exporter;
+    int taskNo;
+    CsvExportJob job;
+    QString dbFile;
+    QString partFile;
+    std::shared_ptr<CsvExporter::ExportState> state;
+
+    QByteArray buffer;
+    QByteArray rowPrefix;
+    QFile out;
+    /**
+     * @brief Aggregates raw measurements if the rollups have to be computed
+     */
+    std::unique_ptr<RollupAccumulator> rollup;
+
+    QString connectionName() const;
+    bool exportDatabase(QString &errorString);
+    bool exportBinary(QString &errorString);
+    /**
+     * @brief Export the stored rollup buckets of the recording
+     *
+     * @details
+     *
+     * Falls back to exportDatabase or exportBinary with a RollupAccumulator if
+     * the recording has no stored buckets.
+     */
+    bool exportRollup(QString &errorString);
+    void appendMeasurement(const QSqlQuery &query);
+    void appendSample(const std::shared_ptr<PowerSupplyStatus> &powStatus,
+                      long long timeMs, int channels);
+    void appendRollups(const std::vector<RollupBucket> &buckets);
+    bool flushBuffer(bool force);
+
+    void appendInt(long long value);
+    void appendDouble(double value);
+    void appendBool(const QVariant &value);
+};
+
+#endif  // CSVEXPORTER_H
@@ -44,6 +44,8 @@ const char *const TBL_RECORDING_CHAN = "channels";
 const char *const TBL_RECORDING_START = "time_start";
 const char *const TBL_RECORDING_STOP = "time_stop";
 const char *const TBL_RECORDING_TS = "timestamp";
+const char *const TBL_RECORDING_FILE =
+    "datafile"; /**< Binary recording file, NULL for SQLite recordings */
 
 /**
  * @brief Information on Measurement are stored in this table
@@ -78,6 +80,83 @@ const char *const TBL_CHANNEL_A = "current";
 const char *const TBL_CHANNEL_AS = "current_set";
 const char *const TBL_CHANNEL_W = "wattage";
 const char *const TBL_CHANNEL_TS = "timestamp";
+
+/**
+ * @brief Downsampled measurements, see RollupAccumulator
+ *
+ * @details
+ *
+ * The columns for voltage, current and wattage are named like
+ * voltage_min, voltage_max, voltage_mean and voltage_last.
+ */
+const char *const TBL_ROLLUP = "Rollup";
+const char *const TBL_ROLLUP_ID = "id";
+const char *const TBL_ROLLUP_REC = "recording";
+const char *const TBL_ROLLUP_LEVEL = "level";
+const char *const TBL_ROLLUP_CHAN = "channelno";
+const char *const TBL_ROLLUP_BUCKET = "bucket";
+const char *const TBL_ROLLUP_SAMPLES = "samples";
+const std::vector<QString> TBL_ROLLUP_QUANTITIES = {"voltage", "current",
+                                                    "wattage"};
+const std::vector<QString> TBL_ROLLUP_AGGREGATES = {"min", "max", "mean",
+                                                    "last"};
+
+/**
+ * @brief Running statistics of every channel of a recording, see
+ * ChannelStatistics
+ *
+ * @details
+ *
+ * The columns for voltage and current are named like voltage_min, voltage_max,
+ * voltage_mean, voltage_stddev and voltage_rms.
+ */
+const char *const TBL_STATISTICS = "RecordingStatistics";
+const char *const TBL_STATISTICS_ID = "id";
+const char *const TBL_STATISTICS_REC = "recording";
+const char *const TBL_STATISTICS_CHAN = "channelno";
+const char *const TBL_STATISTICS_SAMPLES = "samples";
+const char *const TBL_STATISTICS_DURATION = "duration";
+const char *const TBL_STATISTICS_ENERGY = "energy_wh";
+const char *const TBL_STATISTICS_CHARGE = "charge_ah";
+const std::vector<QString> TBL_STATISTICS_QUANTITIES = {"voltage", "current"};
+const std::vector<QString> TBL_STATISTICS_AGGREGATES = {"min", "max", "mean",
+                                                        "stddev", "rms"};
+
+/**
+ * @brief Trips of the safety watchdog, see SafetyWatchdog
+ *
+ * @details
+ *
+ * Events are stored with and without an active recording. The recording is
+ * set to NULL when the recording is deleted.
+ */
+const char *const TBL_WATCHDOG = "WatchdogEvent";
+const char *const TBL_WATCHDOG_ID = "id";
+const char *const TBL_WATCHDOG_REC = "recording";
+const char *const TBL_WATCHDOG_TIME = "event_time";
+const char *const TBL_WATCHDOG_CHAN = "channelno";
+const char *const TBL_WATCHDOG_RULE = "rule";
+const char *const TBL_WATCHDOG_TYPE = "type";
+const char *const TBL_WATCHDOG_THRESHOLD = "threshold";
+const char *const TBL_WATCHDOG_VALUE = "value";
+const char *const TBL_WATCHDOG_LATENCY = "latency_us";
+/**
+ * @brief 0 if the output could not be switched off after the trip
+ */
+const char *const TBL_WATCHDOG_OUTPUT_OFF = "output_off";
+
+const char *const IDX_MEASUREMENT_REC = "idx_measurement_recording";
+const char *const IDX_CHANNEL_MES = "idx_channel_measurement";
+
+/**
+ * @brief Version of the schema stored as PRAGMA user_version
+ *
+ * @details
+ *
+ * Increase this whenever initTables or migrateTables change, databases with
+ * the current version skip the schema checks when they are opened.
+ */
+const int SCHEMA_VERSION = 2;
 }
 
 namespace database_utils
@@ -98,6 +177,8 @@ inline void setDBOptimizations()
 {
     QSqlDatabase db = QSqlDatabase::database();
     QSqlQuery("PRAGMA foreign_keys = ON", db);
+    // only has an effect on new databases, see migrateTables
+    QSqlQuery("PRAGMA auto_vacuum = INCREMENTAL", db);
     QSqlQuery("PRAGMA journal_mode = MEMORY", db);
     QSqlQuery("PRAGMA temp_store = MEMORY", db);
     // TODO: Think about sqlite page and cache size
@@ -110,14 +191,21 @@ inline void setDBOptimizations()
 
 /**
  * @brief Init all necessary database tables
+ *
+ * @return False if a table could not be created
  */
-inline void initTables()
+inline bool initTables()
 {
     std::vector<QSqlQuery> queryVec;
     QSqlDatabase db = QSqlDatabase::database();
     QSqlQuery queryRec(db);
     QSqlQuery queryMes(db);
     QSqlQuery queryCha(db);
+    QSqlQuery queryRol(db);
+    QSqlQuery queryStat(db);
+    QSqlQuery queryWd(db);
+    QSqlQuery queryIdxMes(db);
+    QSqlQuery queryIdxCha(db);
     // clang-format off
     queryRec.prepare(QString("CREATE TABLE IF NOT EXISTS ") + dbcon::TBL_RECORDING + " ("
                      + dbcon::TBL_RECORDING_ID + " INTEGER PRIMARY KEY, "
@@ -128,7 +216,8 @@ inline void initTables()
                      + dbcon::TBL_RECORDING_CHAN + " INTEGER NOT NULL, "
                      + dbcon::TBL_RECORDING_START + " DATETIME NOT NULL, "
                      + dbcon::TBL_RECORDING_STOP + " DATETIME, "
-                     + dbcon::TBL_RECORDING_TS + " DATEIME NOT NULL DEFAULT (STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW')))");
+                     + dbcon::TBL_RECORDING_TS + " DATEIME NOT NULL DEFAULT (STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW')), "
+                     + dbcon::TBL_RECORDING_FILE + " TEXT)");
     queryMes.prepare(QString("CREATE TABLE IF NOT EXISTS ") + dbcon::TBL_MEASUREMENT + " ("
                      + dbcon::TBL_MEASUREMENT_ID + " INTEGER PRIMARY KEY, "
                      + dbcon::TBL_MEASUREMENT_REC + " INTEGER NOT NULL, "
@@ -154,11 +243,72 @@ inline void initTables()
                      + dbcon::TBL_CHANNEL_TS + " DATETIME NOT NULL DEFAULT(STRFTIME('%Y-%m-%d %H:%M:%f', 'NOW')), "
                      + "FOREIGN KEY (" + dbcon::TBL_CHANNEL_MES + ") "
                      + "REFERENCES " + dbcon::TBL_MEASUREMENT + "(" + dbcon::TBL_MEASUREMENT_ID + ") ON DELETE CASCADE)");
-    // TODO: Add some indexes? Especially on the foreign key columns.
+    QString rollupValues;
+    for (const auto &quantity : dbcon::TBL_ROLLUP_QUANTITIES) {
+        for (const auto &aggregate : dbcon::TBL_ROLLUP_AGGREGATES) {
+            rollupValues += quantity + "_" + aggregate + " DOUBLE, ";
+        }
+    }
+    queryRol.prepare(QString("CREATE TABLE IF NOT EXISTS ") + dbcon::TBL_ROLLUP + " ("
+                     + dbcon::TBL_ROLLUP_ID + " INTEGER PRIMARY KEY, "
+                     + dbcon::TBL_ROLLUP_REC + " INTEGER NOT NULL, "
+                     + dbcon::TBL_ROLLUP_LEVEL + " INTEGER NOT NULL, "
+                     + dbcon::TBL_ROLLUP_CHAN + " INTEGER NOT NULL, "
+                     + dbcon::TBL_ROLLUP_BUCKET + " INTEGER NOT NULL, "
+                     + dbcon::TBL_ROLLUP_SAMPLES + " INTEGER NOT NULL, "
+                     + rollupValues
+                     + "UNIQUE (" + dbcon::TBL_ROLLUP_REC + ", " + dbcon::TBL_ROLLUP_LEVEL + ", "
+                     + dbcon::TBL_ROLLUP_BUCKET + ", " + dbcon::TBL_ROLLUP_CHAN + "), "
+                     + "FOREIGN KEY (" + dbcon::TBL_ROLLUP_REC + ") "
+                     + "REFERENCES " + dbcon::TBL_RECORDING + "(" + dbcon::TBL_RECORDING_ID + ") ON DELETE CASCADE)");
+    QString statisticsValues;
+    for (const auto &quantity : dbcon::TBL_STATISTICS_QUANTITIES) {
+        for (const auto &aggregate : dbcon::TBL_STATISTICS_AGGREGATES) {
+            statisticsValues += quantity + "_" + aggregate + " DOUBLE, ";
+        }
+    }
+    queryStat.prepare(QString("CREATE TABLE IF NOT EXISTS ") + dbcon::TBL_STATISTICS + " ("
+                      + dbcon::TBL_STATISTICS_ID + " INTEGER PRIMARY KEY, "
+                      + dbcon::TBL_STATISTICS_REC + " INTEGER NOT NULL, "
+                      + dbcon::TBL_STATISTICS_CHAN + " INTEGER NOT NULL, "
+                      + dbcon::TBL_STATISTICS_SAMPLES + " INTEGER NOT NULL, "
+                      + dbcon::TBL_STATISTICS_DURATION + " INTEGER NOT NULL, "
+                      + dbcon::TBL_STATISTICS_ENERGY + " DOUBLE, "
+                      + dbcon::TBL_STATISTICS_CHARGE + " DOUBLE, "
+                      + statisticsValues
+                      + "UNIQUE (" + dbcon::TBL_STATISTICS_REC + ", " + dbcon::TBL_STATISTICS_CHAN + "), "
+                      + "FOREIGN KEY (" + dbcon::TBL_STATISTICS_REC + ") "
+                      + "REFERENCES " + dbcon::TBL_RECORDING + "(" + dbcon::TBL_RECORDING_ID + ") ON DELETE CASCADE)");
+    queryWd.prepare(QString("CREATE TABLE IF NOT EXISTS ") + dbcon::TBL_WATCHDOG + " ("
+                    + dbcon::TBL_WATCHDOG_ID + " INTEGER PRIMARY KEY, "
+                    + dbcon::TBL_WATCHDOG_REC + " INTEGER, "
+                    + dbcon::TBL_WATCHDOG_TIME + " DATETIME NOT NULL, "
+                    + dbcon::TBL_WATCHDOG_CHAN + " INTEGER NOT NULL, "
+                    + dbcon::TBL_WATCHDOG_RULE + " INTEGER NOT NULL, "
+                    + dbcon::TBL_WATCHDOG_TYPE + " INTEGER NOT NULL, "
+                    + dbcon::TBL_WATCHDOG_THRESHOLD + " DOUBLE, "
+                    + dbcon::TBL_WATCHDOG_VALUE + " DOUBLE, "
+                    + dbcon::TBL_WATCHDOG_LATENCY + " INTEGER, "
+                    + dbcon::TBL_WATCHDOG_OUTPUT_OFF + " INTEGER NOT NULL DEFAULT 1, "
+                    + "FOREIGN KEY (" + dbcon::TBL_WATCHDOG_REC + ") "
+                    + "REFERENCES " + dbcon::TBL_RECORDING + "(" + dbcon::TBL_RECORDING_ID + ") ON DELETE SET NULL)");
+    // indexes on the foreign key columns so reading a recording does not need
+    // a full table scan. Measurements of a recording are ordered by time.
+    queryIdxMes.prepare(QString("CREATE INDEX IF NOT EXISTS ") + dbcon::IDX_MEASUREMENT_REC
+                        + " ON " + dbcon::TBL_MEASUREMENT + " ("
+                        + dbcon::TBL_MEASUREMENT_REC + ", " + dbcon::TBL_MEASUREMENT_TIME + ")");
+    queryIdxCha.prepare(QString("CREATE INDEX IF NOT EXISTS ") + dbcon::IDX_CHANNEL_MES
+                        + " ON " + dbcon::TBL_CHANNEL + " ("
+                        + dbcon::TBL_CHANNEL_MES + ")");
     // clang-format on
     queryVec.push_back(std::move(queryRec));
     queryVec.push_back(std::move(queryMes));
     queryVec.push_back(std::move(queryCha));
+    queryVec.push_back(std::move(queryRol));
+    queryVec.push_back(std::move(queryStat));
+    queryVec.push_back(std::move(queryWd));
+    queryVec.push_back(std::move(queryIdxMes));
+    queryVec.push_back(std::move(queryIdxCha));
     // TODO: Are transactions supported for DDL?
     db.transaction();
     for (auto &query : queryVec) {
@@ -169,10 +319,92 @@ inline void initTables()
                 query.lastError().text().toStdString());
             LogInstance::get_instance().eal_error(
                 db.lastError().text().toStdString());
-            return;
+            return false;
         }
     }
-    db.commit();
+    return db.commit();
+}
+
+/**
+ * @brief Append column to table if it does not exist yet
+ *
+ * @return True if the column was added
+ */
+inline bool addMissingColumn(const char *table, const char *column,
+                             const char *definition)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery tableInfo(QString("PRAGMA table_info(") + table + ")", db);
+    while (tableInfo.next()) {
+        if (tableInfo.value(1).toString() == column)
+            return false;
+    }
+    QSqlQuery alter(db);
+    if (!alter.exec(QString("ALTER TABLE ") + table + " ADD COLUMN " + column +
+                    " " + definition)) {
+        LogInstance::get_instance().eal_error("Can not migrate DB Table " +
+                                              std::string(table));
+        LogInstance::get_instance().eal_error(
+            alter.lastError().text().toStdString());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Update tables created by older versions of labpowerqt
+ *
+ * @details
+ *
+ * New columns are always appended to a table so the column order is the same
+ * for new and migrated databases.
+ */
+inline void migrateTables()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    addMissingColumn(dbcon::TBL_RECORDING, dbcon::TBL_RECORDING_FILE, "TEXT");
+    if (addMissingColumn(dbcon::TBL_WATCHDOG, dbcon::TBL_WATCHDOG_OUTPUT_OFF,
+                         "INTEGER NOT NULL DEFAULT 1")) {
+        // older versions stored a failed trip without latency
+        QSqlQuery(QString("UPDATE ") + dbcon::TBL_WATCHDOG + " SET " +
+                      dbcon::TBL_WATCHDOG_OUTPUT_OFF + " = 0 WHERE " +
+                      dbcon::TBL_WATCHDOG_LATENCY + " IS NULL",
+                  db);
+    }
+
+    // Databases created by older versions do not support incremental vacuum.
+    // Switching needs a full VACUUM of the whole file, which is left to the
+    // compact action of the history tab.
+    QSqlQuery autoVacuum("PRAGMA auto_vacuum", db);
+    if (autoVacuum.next() && autoVacuum.value(0).toInt() == 0) {
+        LogInstance::get_instance().eal_info(
+            "Free pages of " + db.databaseName().toStdString() +
+            " can only be reclaimed after compacting the database");
+    }
+}
+
+/**
+ * @brief Create and migrate the tables if the schema of the database is older
+ * than SCHEMA_VERSION
+ *
+ * @details
+ *
+ * Opening an up to date database only costs a single query instead of the
+ * DDL statements of initTables and the table inspection of migrateTables.
+ */
+inline void updateSchema()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery version("PRAGMA user_version", db);
+    if (version.next() && version.value(0).toInt() >= dbcon::SCHEMA_VERSION)
+        return;
+    LogInstance::get_instance().eal_info("Updating database schema");
+    if (!initTables())
+        return;
+    migrateTables();
+    QSqlQuery(QString("PRAGMA user_version = ") +
+                  QString::number(dbcon::SCHEMA_VERSION),
+              db);
 }
 
 /**
@@ -203,7 +435,7 @@ inline void initDatabase(QString driver, QString dbFile)
                 "Can not open Database: " + db.lastError().text().toStdString());
         } else {
             setDBOptimizations();
-            initTables();
+            updateSchema();
         }
     }
 }
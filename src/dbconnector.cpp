@@ -25,6 +25,7 @@ namespace dbutil = database_utils;
 DBConnector::DBConnector() : QObject()
 {
     this->recID = -1;
+    ScopedTiming timing("startup.database.ms");
     QSettings settings;
     settings.beginGroup(setcon::RECORD_GROUP);
     dbutil::initDatabase(
@@ -45,7 +46,8 @@ DBConnector::~DBConnector()
     QSqlDatabase::database().close();
 }
 
-void DBConnector::startRecording(QString recName)
+long long DBConnector::getRecordingID() const { return this->recID; }
+void DBConnector::startRecording(QString recName, QString dataFile)
 {
     QSettings settings;
     settings.beginGroup(setcon::DEVICE_GROUP);
@@ -60,7 +62,8 @@ void DBConnector::startRecording(QString recName)
                       + dbcon::TBL_RECORDING_PROTO + ", "
                       + dbcon::TBL_RECORDING_PORT + ", "
                       + dbcon::TBL_RECORDING_CHAN + ", "
-                      + dbcon::TBL_RECORDING_START + ") VALUES(?, ?, ?, ?, ?, ?)");
+                      + dbcon::TBL_RECORDING_START + ", "
+                      + dbcon::TBL_RECORDING_FILE + ") VALUES(?, ?, ?, ?, ?, ?, ?)");
     // clang-format on
     recInsert.bindValue(0, recName);
     recInsert.bindValue(1, settings.value(setcon::DEVICE_NAME));
@@ -68,6 +71,8 @@ void DBConnector::startRecording(QString recName)
     recInsert.bindValue(3, settings.value(setcon::DEVICE_PORT));
     recInsert.bindValue(4, settings.value(setcon::DEVICE_CHANNELS));
     recInsert.bindValue(5, QDateTime::currentDateTime());
+    recInsert.bindValue(6, dataFile.isEmpty() ? QVariant(QVariant::String)
+                                              : QVariant(dataFile));
     if (recInsert.exec()) {
         db.commit();
     } else {
@@ -82,6 +87,7 @@ void DBConnector::startRecording(QString recName)
         return;
     }
     this->recID = this->maxID(dbcon::TBL_RECORDING, dbcon::TBL_RECORDING_ID);
+    this->recordingStatistics.clear();
 }
 
 void DBConnector::stopRecording()
@@ -107,34 +113,40 @@ void DBConnector::stopRecording()
         LogInstance::get_instance().eal_error(
             db.lastError().text().toStdString());
     }
+    this->recID = -1;
 }
 
-void DBConnector::insertMeasurement(
-    std::vector<std::shared_ptr<PowerSupplyStatus>> statusBuffer)
+void DBConnector::beginTransaction()
+{
+    QSqlDatabase::database().transaction();
+}
+
+void DBConnector::commitTransaction()
 {
-    // should we run this in a separate thread? If the user sets the buffer size
-    // very high we could get into trouble here with a non responsive ui.
     QSqlDatabase db = QSqlDatabase::database();
-    db.transaction();
-    for (const auto &status : statusBuffer) {
-        this->insertMeasurement(status);
-    }
     if (!db.commit()) {
-        LogInstance::get_instance().eal_error(
-            "Can not commit insert of status buffer");
+        LogInstance::get_instance().eal_error("Can not commit flush");
         LogInstance::get_instance().eal_error(
             db.lastError().text().toStdString());
         db.rollback();
     }
 }
 
+void DBConnector::insertMeasurement(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer)
+{
+    // The controller keeps the buffer size within a time budget based on the
+    // measured cost of the whole flush, see RecordFlushPolicy.
+    for (const auto &status : statusBuffer) {
+        this->insertMeasurement(status);
+    }
+}
+
 void DBConnector::insertMeasurement(std::shared_ptr<PowerSupplyStatus> powStatus)
 {
     if (this->recID == -1)
         return;
-    QSettings settings;
-    settings.beginGroup(setcon::DEVICE_GROUP);
-    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
+    int channels = SettingsCache::get_instance().snapshot().deviceChannels;
 
     ealogger::Logger &log = LogInstance::get_instance();
 
@@ -181,8 +193,7 @@ void DBConnector::insertMeasurement(std::shared_ptr<PowerSupplyStatus> powStatus
     if (maxIDMeasurement == -1)
         return;
     insertQueryChannel.bindValue(0, maxIDMeasurement);
-    for (int channel = 1;
-         channel <= settings.value(setcon::DEVICE_CHANNELS).toInt(); channel++) {
+    for (int channel = 1; channel <= channels; channel++) {
         insertQueryChannel.bindValue(1, channel);
         insertQueryChannel.bindValue(2, powStatus->getChannelOutput(channel));
         insertQueryChannel.bindValue(
@@ -199,6 +210,185 @@ void DBConnector::insertMeasurement(std::shared_ptr<PowerSupplyStatus> powStatus
     }
 }
 
+bool DBConnector::updateRollups(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer)
+{
+    if (this->recID == -1 || statusBuffer.empty())
+        return true;
+    int channels = SettingsCache::get_instance().snapshot().deviceChannels;
+
+    RollupAccumulator accumulator;
+    for (const auto &status : statusBuffer) {
+        accumulator.add(status, channels);
+    }
+    std::vector<RollupBucket> buckets = accumulator.take();
+
+    // A bucket may already exist from a previous flush. Merge them, the
+    // update expressions see the values of the stored row.
+    QString columns;
+    QString placeholders;
+    QString updates = QString(dbcon::TBL_ROLLUP_SAMPLES) + " = " +
+                      dbcon::TBL_ROLLUP_SAMPLES + " + excluded." +
+                      dbcon::TBL_ROLLUP_SAMPLES;
+    for (const auto &quantity : dbcon::TBL_ROLLUP_QUANTITIES) {
+        QString min = quantity + "_min";
+        QString max = quantity + "_max";
+        QString mean = quantity + "_mean";
+        QString last = quantity + "_last";
+        columns += ", " + min + ", " + max + ", " + mean + ", " + last;
+        placeholders += ", ?, ?, ?, ?";
+        updates += ", " + min + " = MIN(" + min + ", excluded." + min + ")";
+        updates += ", " + max + " = MAX(" + max + ", excluded." + max + ")";
+        updates += ", " + mean + " = (" + mean + " * " +
+                   dbcon::TBL_ROLLUP_SAMPLES + " + excluded." + mean +
+                   " * excluded." + dbcon::TBL_ROLLUP_SAMPLES + ") / (" +
+                   dbcon::TBL_ROLLUP_SAMPLES + " + excluded." +
+                   dbcon::TBL_ROLLUP_SAMPLES + ")";
+        updates += ", " + last + " = excluded." + last;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery upsertQuery(db);
+    // clang-format off
+    upsertQuery.prepare(QString("INSERT INTO ") + dbcon::TBL_ROLLUP
+                        + " (" + dbcon::TBL_ROLLUP_REC + ", "
+                        + dbcon::TBL_ROLLUP_LEVEL + ", "
+                        + dbcon::TBL_ROLLUP_CHAN + ", "
+                        + dbcon::TBL_ROLLUP_BUCKET + ", "
+                        + dbcon::TBL_ROLLUP_SAMPLES + columns + ") VALUES(?, ?, ?, ?, ?" + placeholders + ") "
+                        + "ON CONFLICT (" + dbcon::TBL_ROLLUP_REC + ", " + dbcon::TBL_ROLLUP_LEVEL + ", "
+                        + dbcon::TBL_ROLLUP_BUCKET + ", " + dbcon::TBL_ROLLUP_CHAN + ") "
+                        + "DO UPDATE SET " + updates);
+    // clang-format on
+    for (const auto &bucket : buckets) {
+        upsertQuery.bindValue(0, this->recID);
+        upsertQuery.bindValue(1, static_cast<int>(bucket.level));
+        upsertQuery.bindValue(2, bucket.channel);
+        upsertQuery.bindValue(3, bucket.bucketStart);
+        upsertQuery.bindValue(4, bucket.samples);
+        int pos = 5;
+        for (const RollupValue *value :
+             {&bucket.voltage, &bucket.current, &bucket.wattage}) {
+            upsertQuery.bindValue(pos++, value->min);
+            upsertQuery.bindValue(pos++, value->max);
+            upsertQuery.bindValue(pos++, value->mean);
+            upsertQuery.bindValue(pos++, value->last);
+        }
+        if (!upsertQuery.exec()) {
+            LogInstance::get_instance().eal_error(
+                "Can not update rollup of recording " +
+                std::to_string(this->recID));
+            LogInstance::get_instance().eal_error(
+                upsertQuery.lastError().text().toStdString());
+            return false;
+        }
+    }
+    return true;
+}
+
+void DBConnector::updateStatistics(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer)
+{
+    if (this->recID == -1)
+        return;
+    int channels = SettingsCache::get_instance().snapshot().deviceChannels;
+    if (this->recordingStatistics.size() != static_cast<size_t>(channels))
+        this->recordingStatistics.resize(static_cast<size_t>(channels));
+    for (const auto &status : statusBuffer) {
+        for (int i = 1; i <= channels; i++) {
+            this->recordingStatistics[static_cast<size_t>(i) - 1].add(status,
+                                                                      i);
+        }
+    }
+}
+
+void DBConnector::insertWatchdogEvent(const WatchdogTrip &trip)
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery insertQuery(db);
+    // clang-format off
+    insertQuery.prepare(QString("INSERT INTO ") + dbcon::TBL_WATCHDOG
+                        + " (" + dbcon::TBL_WATCHDOG_REC + ", "
+                        + dbcon::TBL_WATCHDOG_TIME + ", "
+                        + dbcon::TBL_WATCHDOG_CHAN + ", "
+                        + dbcon::TBL_WATCHDOG_RULE + ", "
+                        + dbcon::TBL_WATCHDOG_TYPE + ", "
+                        + dbcon::TBL_WATCHDOG_THRESHOLD + ", "
+                        + dbcon::TBL_WATCHDOG_VALUE + ", "
+                        + dbcon::TBL_WATCHDOG_LATENCY + ", "
+                        + dbcon::TBL_WATCHDOG_OUTPUT_OFF + ") VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    // clang-format on
+    insertQuery.bindValue(0, this->recID == -1 ? QVariant(QVariant::LongLong)
+                                               : QVariant(this->recID));
+    insertQuery.bindValue(1, QDateTime::fromMSecsSinceEpoch(trip.time));
+    insertQuery.bindValue(2, trip.channel);
+    insertQuery.bindValue(3, trip.rule + 1);
+    insertQuery.bindValue(4, static_cast<int>(trip.type));
+    insertQuery.bindValue(5, trip.threshold);
+    insertQuery.bindValue(6, trip.value);
+    insertQuery.bindValue(7, trip.latency == -1 ? QVariant(QVariant::LongLong)
+                                                : QVariant(trip.latency));
+    insertQuery.bindValue(8, trip.outputOff ? 1 : 0);
+    if (!insertQuery.exec()) {
+        LogInstance::get_instance().eal_error("Can not store watchdog event");
+        LogInstance::get_instance().eal_error(
+            insertQuery.lastError().text().toStdString());
+    }
+}
+
+bool DBConnector::storeStatistics()
+{
+    if (this->recID == -1)
+        return true;
+    QString columns;
+    QString placeholders;
+    for (const auto &quantity : dbcon::TBL_STATISTICS_QUANTITIES) {
+        for (const auto &aggregate : dbcon::TBL_STATISTICS_AGGREGATES) {
+            columns += ", " + quantity + "_" + aggregate;
+            placeholders += ", ?";
+        }
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    QSqlQuery replaceQuery(db);
+    // clang-format off
+    replaceQuery.prepare(QString("INSERT OR REPLACE INTO ") + dbcon::TBL_STATISTICS
+                         + " (" + dbcon::TBL_STATISTICS_REC + ", "
+                         + dbcon::TBL_STATISTICS_CHAN + ", "
+                         + dbcon::TBL_STATISTICS_SAMPLES + ", "
+                         + dbcon::TBL_STATISTICS_DURATION + ", "
+                         + dbcon::TBL_STATISTICS_ENERGY + ", "
+                         + dbcon::TBL_STATISTICS_CHARGE + columns + ") VALUES(?, ?, ?, ?, ?, ?" + placeholders + ")");
+    // clang-format on
+    for (size_t i = 0; i < this->recordingStatistics.size(); i++) {
+        const ChannelStatistics &stats = this->recordingStatistics[i];
+        replaceQuery.bindValue(0, this->recID);
+        replaceQuery.bindValue(1, static_cast<int>(i) + 1);
+        replaceQuery.bindValue(2, stats.getVoltage().getSamples());
+        replaceQuery.bindValue(3, stats.getDuration());
+        replaceQuery.bindValue(4, stats.getEnergy());
+        replaceQuery.bindValue(5, stats.getCharge());
+        int pos = 6;
+        for (const RunningStatistics *value :
+             {&stats.getVoltage(), &stats.getCurrent()}) {
+            replaceQuery.bindValue(pos++, value->getMin());
+            replaceQuery.bindValue(pos++, value->getMax());
+            replaceQuery.bindValue(pos++, value->getMean());
+            replaceQuery.bindValue(pos++, value->getStdDev());
+            replaceQuery.bindValue(pos++, value->getRms());
+        }
+        if (!replaceQuery.exec()) {
+            LogInstance::get_instance().eal_error(
+                "Can not store statistics of recording " +
+                std::to_string(this->recID));
+            LogInstance::get_instance().eal_error(
+                replaceQuery.lastError().text().toStdString());
+            return false;
+        }
+    }
+    return true;
+}
+
 long long DBConnector::maxID(const QString &table, const QString &id)
 {
     QSqlDatabase db = QSqlDatabase::database();
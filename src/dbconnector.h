@@ -37,8 +37,13 @@
 
 #include "databasedef.h"
 #include "global.h"
+#include "channelstatistics.h"
 #include "log_instance.h"
+#include "perfmetrics.h"
 #include "powersupplystatus.h"
+#include "rollupaccumulator.h"
+#include "safetywatchdog.h"
+#include "settingscache.h"
 #include "settingsdefinitions.h"
 
 /**
@@ -56,16 +61,78 @@ public:
     DBConnector();
     ~DBConnector();
 
+    /**
+     * @brief ID of the active recording, -1 if not recording
+     */
+    long long getRecordingID() const;
+
 public slots:
 
-    void startRecording(QString recName);
+    /**
+     * @brief Register a new recording
+     *
+     * @param recName Name of the recording
+     * @param dataFile Binary recording file if the measurements are not stored
+     * in the database.
+     */
+    void startRecording(QString recName, QString dataFile = QString());
     void stopRecording();
+    /**
+     * @brief Start the transaction of a buffer flush
+     *
+     * @details
+     *
+     * Measurements, rollups and statistics of a flush are written in one
+     * transaction, so a flush costs a single commit and a crash never leaves
+     * measurements without their rollups.
+     */
+    void beginTransaction();
+    /**
+     * @brief Commit the transaction of a buffer flush, rolls back on failure
+     */
+    void commitTransaction();
+    /**
+     * @brief Insert a buffer of measurements, call within beginTransaction
+     * and commitTransaction
+     */
     void insertMeasurement(
-        std::vector<std::shared_ptr<PowerSupplyStatus>> statusBuffer);
+        const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer);
     void insertMeasurement(std::shared_ptr<PowerSupplyStatus> powStatus);
+    /**
+     * @brief Merge the measurements into the rollup buckets of the recording
+     *
+     * @details
+     *
+     * Called for every flushed buffer independent of the recording backend,
+     * within beginTransaction and commitTransaction.
+     *
+     * @return False if a bucket could not be stored
+     */
+    bool updateRollups(
+        const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer);
+    /**
+     * @brief Feed the statistics of the recording with the measurements
+     */
+    void updateStatistics(
+        const std::vector<std::shared_ptr<PowerSupplyStatus>> &statusBuffer);
+    /**
+     * @brief Replace the stored statistics of the recording, call within
+     * beginTransaction and commitTransaction
+     *
+     * @return False if the statistics could not be stored
+     */
+    bool storeStatistics();
+    /**
+     * @brief Store a watchdog trip, linked to the active recording if any
+     */
+    void insertWatchdogEvent(const WatchdogTrip &trip);
 
 private:
     long long recID;
+    /**
+     * @brief Statistics of every channel since the recording was started
+     */
+    std::vector<ChannelStatistics> recordingStatistics;
 
     long long maxID(const QString &table, const QString &id);
 };
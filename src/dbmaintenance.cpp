@@ -0,0 +1,473 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "dbmaintenance.h"
+
+#include <algorithm>
+
+namespace dbcon = database_constants;
+namespace setcon = settings_constants;
+namespace setdef = settings_default;
+namespace maintcon = db_maintenance_constants;
+
+DBMaintenance::DBMaintenance() : QObject()
+{
+    this->activeRecording = -1;
+    this->running = false;
+    this->pool.setMaxThreadCount(1);
+    this->retentionTimer.setInterval(maintcon::RETENTION_INTERVAL);
+    this->vacuumTimer.setInterval(maintcon::VACUUM_INTERVAL);
+    QObject::connect(&this->retentionTimer, &QTimer::timeout, this,
+                     &DBMaintenance::applyRetention);
+    QObject::connect(&this->vacuumTimer, &QTimer::timeout, this,
+                     &DBMaintenance::vacuumStep);
+    this->retentionTimer.start();
+    // apply the policies once the event loop is running
+    QTimer::singleShot(0, this, &DBMaintenance::applyRetention);
+}
+
+DBMaintenance::~DBMaintenance() { this->pool.waitForDone(); }
+
+void DBMaintenance::setActiveRecording(long long recID)
+{
+    this->activeRecording = recID;
+}
+
+bool DBMaintenance::deleteRecordings(std::vector<long long> recIDs)
+{
+    if (this->running) {
+        emit this->maintenanceFailed("Database maintenance is already running");
+        return false;
+    }
+    if (this->activeRecording != -1 &&
+        std::find(recIDs.begin(), recIDs.end(), this->activeRecording) !=
+            recIDs.end()) {
+        emit this->maintenanceFailed(
+            "The active recording can not be deleted");
+        return false;
+    }
+    if (recIDs.empty())
+        return true;
+    this->startTask(JOB::REMOVE, std::move(recIDs));
+    return true;
+}
+
+bool DBMaintenance::compactDatabase()
+{
+    if (this->running) {
+        emit this->maintenanceFailed("Database maintenance is already running");
+        return false;
+    }
+    if (this->activeRecording != -1) {
+        emit this->maintenanceFailed(
+            "The database can not be compacted while recording");
+        return false;
+    }
+    this->startTask(JOB::COMPACT, {});
+    return true;
+}
+
+bool DBMaintenance::isRunning() const { return this->running; }
+
+void DBMaintenance::startTask(JOB job, std::vector<long long> recIDs,
+                              RetentionPolicy policy)
+{
+    this->running = true;
+    this->vacuumTimer.stop();
+    DBMaintenanceTask *task = new DBMaintenanceTask(
+        this, job, std::move(recIDs), QSqlDatabase::database().databaseName(),
+        policy);
+    task->setAutoDelete(true);
+    this->pool.start(task);
+}
+
+bool DBMaintenance::removeRecordings(QSqlDatabase db,
+                                     const std::vector<long long> &recIDs)
+{
+    if (recIDs.empty())
+        return true;
+    ealogger::Logger &log = LogInstance::get_instance();
+    std::vector<QString> dataFiles;
+    db.transaction();
+    for (size_t i = 0; i < recIDs.size(); i += maintcon::DELETE_BATCH) {
+        size_t batchEnd = std::min(recIDs.size(), i + maintcon::DELETE_BATCH);
+        QString placeholders;
+        for (size_t j = i; j < batchEnd; j++) {
+            placeholders += j == i ? "?" : ", ?";
+        }
+        QString where = QString(" WHERE ") + dbcon::TBL_RECORDING_ID +
+                        " IN (" + placeholders + ")";
+
+        // binary files are removed once the transaction is committed
+        QSqlQuery fileQuery(db);
+        fileQuery.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_FILE +
+                          " FROM " + dbcon::TBL_RECORDING + where + " AND " +
+                          dbcon::TBL_RECORDING_FILE + " IS NOT NULL");
+        QSqlQuery deleteQuery(db);
+        // measurements, channels and rollups are deleted by the foreign keys
+        deleteQuery.prepare(QString("DELETE FROM ") + dbcon::TBL_RECORDING +
+                            where);
+        for (size_t j = i; j < batchEnd; j++) {
+            fileQuery.bindValue(static_cast<int>(j - i), recIDs[j]);
+            deleteQuery.bindValue(static_cast<int>(j - i), recIDs[j]);
+        }
+        if (fileQuery.exec()) {
+            while (fileQuery.next()) {
+                dataFiles.push_back(fileQuery.value(0).toString());
+            }
+        }
+        if (!deleteQuery.exec()) {
+            log.eal_error("Can not delete recordings");
+            log.eal_error(deleteQuery.lastError().text().toStdString());
+            db.rollback();
+            return false;
+        }
+    }
+    if (!db.commit()) {
+        log.eal_error("Can not commit deletion of recordings");
+        log.eal_error(db.lastError().text().toStdString());
+        db.rollback();
+        return false;
+    }
+    for (const auto &dataFile : dataFiles) {
+        QFile::remove(dataFile);
+        QFile::remove(binary_recording_utils::indexFileName(dataFile));
+    }
+    log.eal_info("Deleted " + std::to_string(recIDs.size()) + " recordings");
+    return true;
+}
+
+long long DBMaintenance::storageSize(const QSqlDatabase &db)
+{
+    long long size = (pragmaValue("page_count", db) -
+                      pragmaValue("freelist_count", db)) *
+                     pragmaValue("page_size", db);
+    QSqlQuery fileQuery(db);
+    fileQuery.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_FILE + " FROM " +
+                      dbcon::TBL_RECORDING + " WHERE " +
+                      dbcon::TBL_RECORDING_FILE + " IS NOT NULL");
+    if (fileQuery.exec()) {
+        while (fileQuery.next()) {
+            QString dataFile = fileQuery.value(0).toString();
+            size += QFileInfo(dataFile).size() +
+                    QFileInfo(binary_recording_utils::indexFileName(dataFile))
+                        .size();
+        }
+    }
+    return size;
+}
+
+void DBMaintenance::applyRetention()
+{
+    // a running job holds the write lock, the next run catches up
+    if (!QSqlDatabase::database().isOpen() || this->running)
+        return;
+    QSettings settings;
+    settings.beginGroup(setcon::RECORD_GROUP);
+    RetentionPolicy policy;
+    policy.days = settings
+                      .value(setcon::RECORD_RETENTION_DAYS,
+                             setdef::general_defaults.at(
+                                 setcon::RECORD_RETENTION_DAYS))
+                      .toInt();
+    policy.maxSize =
+        settings
+            .value(setcon::RECORD_RETENTION_SIZE,
+                   setdef::general_defaults.at(setcon::RECORD_RETENTION_SIZE))
+            .toLongLong() *
+        1024 * 1024;
+    policy.maxRecordings =
+        settings
+            .value(setcon::RECORD_RETENTION_RECORDINGS,
+                   setdef::general_defaults.at(
+                       setcon::RECORD_RETENTION_RECORDINGS))
+            .toInt();
+    policy.activeRecording = this->activeRecording;
+    if (policy.days <= 0 && policy.maxSize <= 0 && policy.maxRecordings <= 0) {
+        this->startVacuum();
+        return;
+    }
+    this->startTask(JOB::RETENTION, {}, policy);
+}
+
+void DBMaintenance::startVacuum()
+{
+    // 2 is incremental, other databases have to be compacted first
+    if (!this->running && !this->vacuumTimer.isActive() &&
+        pragmaValue("auto_vacuum", QSqlDatabase::database()) == 2 &&
+        pragmaValue("freelist_count", QSqlDatabase::database()) > 0)
+        this->vacuumTimer.start();
+}
+
+void DBMaintenance::vacuumStep()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    if (!db.isOpen()) {
+        this->vacuumTimer.stop();
+        return;
+    }
+    {
+        ScopedTiming timing("db.vacuum.ms");
+        QSqlQuery vacuum(db);
+        if (!vacuum.exec(QString("PRAGMA incremental_vacuum(%1)")
+                             .arg(maintcon::VACUUM_PAGES))) {
+            LogInstance::get_instance().eal_error(
+                "Incremental vacuum failed: " +
+                vacuum.lastError().text().toStdString());
+            this->vacuumTimer.stop();
+            return;
+        }
+        // sqlite frees one page per step
+        while (vacuum.next()) {
+        }
+    }
+    if (pragmaValue("freelist_count", db) <= 0)
+        this->vacuumTimer.stop();
+}
+
+long long DBMaintenance::pragmaValue(const QString &pragma,
+                                    const QSqlDatabase &db)
+{
+    QSqlQuery query("PRAGMA " + pragma, db);
+    if (query.next())
+        return query.value(0).toLongLong();
+    return 0;
+}
+
+void DBMaintenance::taskFinished(int job, int removed, bool success,
+                                 QString errorString)
+{
+    this->running = false;
+    // recordings before a failed batch are already gone
+    if (removed > 0)
+        emit this->recordingsDeleted();
+    if (static_cast<JOB>(job) == JOB::RETENTION) {
+        // nobody asked for it, the log has to do
+        if (!success)
+            LogInstance::get_instance().eal_error(
+                "Can not apply retention policies: " +
+                errorString.toStdString());
+    } else if (!success) {
+        emit this->maintenanceFailed(errorString);
+    } else if (static_cast<JOB>(job) == JOB::COMPACT) {
+        emit this->databaseCompacted();
+    }
+    this->startVacuum();
+}
+
+DBMaintenanceTask::DBMaintenanceTask(DBMaintenance *maintenance,
+                                     DBMaintenance::JOB job,
+                                     std::vector<long long> recIDs,
+                                     QString dbFile,
+                                     DBMaintenance::RetentionPolicy policy)
+    : maintenance(maintenance),
+      job(job),
+      recIDs(std::move(recIDs)),
+      dbFile(std::move(dbFile)),
+      policy(policy)
+{
+}
+
+void DBMaintenanceTask::run()
+{
+    QString connectionName =
+        QString("dbmaintenance_%1").arg(reinterpret_cast<quintptr>(this), 0, 16);
+    bool success = true;
+    int removed = 0;
+    QString errorString;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(this->dbFile);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            errorString = db.lastError().text();
+            success = false;
+        }
+        // the cascades need foreign keys on this connection as well
+        if (success)
+            QSqlQuery("PRAGMA foreign_keys = ON", db);
+        if (success && this->job == DBMaintenance::JOB::REMOVE) {
+            ScopedTiming timing("db.delete.ms");
+            success = this->remove(db, this->recIDs, removed, errorString);
+        } else if (success && this->job == DBMaintenance::JOB::RETENTION) {
+            ScopedTiming timing("db.retention.ms");
+            success = this->applyRetention(db, removed, errorString);
+        } else if (success) {
+            success = this->compact(db, errorString);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    QMetaObject::invokeMethod(this->maintenance, "taskFinished",
+                              Qt::QueuedConnection,
+                              Q_ARG(int, static_cast<int>(this->job)),
+                              Q_ARG(int, removed), Q_ARG(bool, success),
+                              Q_ARG(QString, errorString));
+}
+
+bool DBMaintenanceTask::remove(QSqlDatabase &db,
+                               const std::vector<long long> &recIDs,
+                               int &removed, QString &errorString)
+{
+    for (size_t i = 0; i < recIDs.size();
+         i += maintcon::RECORDINGS_PER_TRANSACTION) {
+        std::vector<long long> batch(
+            recIDs.begin() + i,
+            recIDs.begin() +
+                std::min(recIDs.size(),
+                         i + maintcon::RECORDINGS_PER_TRANSACTION));
+        if (!DBMaintenance::removeRecordings(db, batch)) {
+            errorString = QString("Can not delete %1 of %2 recordings, see "
+                                  "the log for details")
+                              .arg(recIDs.size() - i)
+                              .arg(recIDs.size());
+            return false;
+        }
+        removed += static_cast<int>(batch.size());
+    }
+    return true;
+}
+
+bool DBMaintenanceTask::applyRetention(QSqlDatabase &db, int &removed,
+                                       QString &errorString)
+{
+    if (this->policy.days > 0 &&
+        !this->remove(db, this->expiredByAge(db), removed, errorString))
+        return false;
+    if (this->policy.maxRecordings > 0 &&
+        !this->remove(db, this->expiredByDevice(db), removed, errorString))
+        return false;
+    if (this->policy.maxSize > 0)
+        return this->applySizeLimit(db, removed, errorString);
+    return true;
+}
+
+bool DBMaintenanceTask::applySizeLimit(QSqlDatabase &db, int &removed,
+                                       QString &errorString)
+{
+    long long size = DBMaintenance::storageSize(db);
+    long long pageSize = DBMaintenance::pragmaValue("page_size", db);
+    // deleted pages are added to the freelist and do not count
+    auto usedPages = [&db]() {
+        return DBMaintenance::pragmaValue("page_count", db) -
+               DBMaintenance::pragmaValue("freelist_count", db);
+    };
+    long long pagesBefore = usedPages();
+    for (int i = 0;
+         i < maintcon::MAX_SIZE_DELETES && size > this->policy.maxSize; i++) {
+        QString dataFile;
+        long long oldest = this->oldestRecording(db, dataFile);
+        if (oldest == -1)
+            break;
+        long long fileSize = 0;
+        if (!dataFile.isEmpty()) {
+            fileSize =
+                QFileInfo(dataFile).size() +
+                QFileInfo(binary_recording_utils::indexFileName(dataFile))
+                    .size();
+        }
+        if (!this->remove(db, {oldest}, removed, errorString))
+            return false;
+        long long pagesAfter = usedPages();
+        size -= (pagesBefore - pagesAfter) * pageSize + fileSize;
+        pagesBefore = pagesAfter;
+    }
+    return true;
+}
+
+bool DBMaintenanceTask::compact(QSqlDatabase &db, QString &errorString)
+{
+    ScopedTiming timing("db.compact.ms");
+    ealogger::Logger &log = LogInstance::get_instance();
+    QSqlQuery vacuum(db);
+    // VACUUM rebuilds the file and switches older databases to incremental
+    // vacuum on the way
+    if (!vacuum.exec("PRAGMA auto_vacuum = INCREMENTAL") ||
+        !vacuum.exec("VACUUM")) {
+        errorString = vacuum.lastError().text();
+        log.eal_error("Can not compact database: " + errorString.toStdString());
+        return false;
+    }
+    log.eal_info("Compacted database " + this->dbFile.toStdString());
+    return true;
+}
+
+std::vector<long long> DBMaintenanceTask::expiredByAge(const QSqlDatabase &db)
+{
+    std::vector<long long> expired;
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_ID + " FROM " +
+                  dbcon::TBL_RECORDING + " WHERE " +
+                  dbcon::TBL_RECORDING_START + " < ? AND " +
+                  dbcon::TBL_RECORDING_ID + " != ?");
+    query.bindValue(0,
+                    QDateTime::currentDateTime().addDays(-this->policy.days));
+    query.bindValue(1, this->policy.activeRecording);
+    if (query.exec()) {
+        while (query.next()) {
+            expired.push_back(query.value(0).toLongLong());
+        }
+    }
+    return expired;
+}
+
+std::vector<long long> DBMaintenanceTask::expiredByDevice(
+    const QSqlDatabase &db)
+{
+    std::vector<long long> expired;
+    QSqlQuery devices(db);
+    devices.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_DEVICE +
+                    " FROM " + dbcon::TBL_RECORDING + " GROUP BY " +
+                    dbcon::TBL_RECORDING_DEVICE + " HAVING COUNT(*) > ?");
+    devices.bindValue(0, this->policy.maxRecordings);
+    if (!devices.exec())
+        return expired;
+    while (devices.next()) {
+        // everything but the newest maxRecordings recordings
+        QSqlQuery query(db);
+        query.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_ID + " FROM " +
+                      dbcon::TBL_RECORDING + " WHERE " +
+                      dbcon::TBL_RECORDING_DEVICE + " = ? ORDER BY " +
+                      dbcon::TBL_RECORDING_START + " DESC LIMIT -1 OFFSET ?");
+        query.bindValue(0, devices.value(0));
+        query.bindValue(1, this->policy.maxRecordings);
+        if (query.exec()) {
+            while (query.next()) {
+                long long recID = query.value(0).toLongLong();
+                if (recID != this->policy.activeRecording)
+                    expired.push_back(recID);
+            }
+        }
+    }
+    return expired;
+}
+
+long long DBMaintenanceTask::oldestRecording(const QSqlDatabase &db,
+                                             QString &dataFile)
+{
+    QSqlQuery query(db);
+    query.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_ID + ", " +
+                  dbcon::TBL_RECORDING_FILE + " FROM " + dbcon::TBL_RECORDING +
+                  " WHERE " + dbcon::TBL_RECORDING_ID + " != ? ORDER BY " +
+                  dbcon::TBL_RECORDING_START + " LIMIT 1");
+    query.bindValue(0, this->policy.activeRecording);
+    if (query.exec() && query.next()) {
+        dataFile = query.value(1).toString();
+        return query.value(0).toLongLong();
+    }
+    return -1;
+}
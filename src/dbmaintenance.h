@@ -0,0 +1,258 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DBMAINTENANCE_H
+#define DBMAINTENANCE_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+
+#include <vector>
+
+#include "binaryrecording.h"
+#include "databasedef.h"
+#include "log_instance.h"
+#include "perfmetrics.h"
+#include "settingsdefault.h"
+#include "settingsdefinitions.h"
+
+namespace db_maintenance_constants
+{
+/**
+ * @brief Interval in ms the retention policies are applied
+ */
+const int RETENTION_INTERVAL = 5 * 60 * 1000;
+/**
+ * @brief Interval in ms between two incremental vacuum steps
+ */
+const int VACUUM_INTERVAL = 1000;
+/**
+ * @brief Pages freed by one incremental vacuum step, 1 MiB with 16 KiB pages
+ */
+const int VACUUM_PAGES = 64;
+/**
+ * @brief Maximum number of ids in one DELETE statement
+ */
+const int DELETE_BATCH = 500;
+/**
+ * @brief Recordings the worker deletes in one transaction
+ *
+ * @details
+ *
+ * Bounds the time the write lock is held so the flushes of a running
+ * recording are not blocked for long.
+ */
+const int RECORDINGS_PER_TRANSACTION = 25;
+/**
+ * @brief Maximum number of recordings the size policy deletes in one run
+ */
+const int MAX_SIZE_DELETES = 50;
+}
+
+/**
+ * @brief Keeps the history database bounded
+ *
+ * @details
+ *
+ * Applies the retention policies (maximum age, maximum storage size and
+ * maximum number of recordings per device) periodically and reclaims the
+ * free pages of the database with small incremental vacuum steps instead of
+ * a blocking VACUUM. The active recording is never deleted.
+ *
+ * The class has to live in the GUI thread, the vacuum steps use the default
+ * database connection. The retention policies, deletions requested by the
+ * user and the compaction of the database run as a DBMaintenanceTask in a
+ * worker thread with their own connection, only one at a time.
+ */
+class DBMaintenance : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Maintenance jobs that run in the worker thread
+     */
+    enum class JOB { REMOVE, COMPACT, RETENTION };
+
+    /**
+     * @brief Retention settings handed to the worker, 0 disables a policy
+     */
+    struct RetentionPolicy {
+        int days = 0;
+        int maxRecordings = 0;
+        long long maxSize = 0; /**< Bytes */
+        long long activeRecording = -1;
+    };
+
+    DBMaintenance();
+    ~DBMaintenance();
+
+    /**
+     * @brief Set the recording that must not be deleted, -1 for none
+     */
+    void setActiveRecording(long long recID);
+
+    /**
+     * @brief Delete recordings in the worker thread
+     *
+     * @details
+     *
+     * The request is refused if it contains the active recording or another
+     * job is running. recordingsDeleted or maintenanceFailed is emitted when
+     * the job has finished.
+     *
+     * @return False if the request was refused
+     */
+    bool deleteRecordings(std::vector<long long> recIDs);
+
+    /**
+     * @brief Compact the database in the worker thread
+     *
+     * @details
+     *
+     * Databases created by older versions do not support incremental vacuum.
+     * Switching needs a full VACUUM that rewrites the whole file and can take
+     * minutes, so it is only done on request and refused while recording.
+     * databaseCompacted or maintenanceFailed is emitted when the job has
+     * finished.
+     *
+     * @return False if the request was refused
+     */
+    bool compactDatabase();
+    bool isRunning() const;
+
+    /**
+     * @brief Delete recordings including their measurements and binary files
+     *
+     * @details
+     *
+     * All recordings are deleted in one transaction with batched statements.
+     * The freed pages are reclaimed by the next vacuum steps. The connection
+     * must have foreign keys enabled.
+     *
+     * @return False if the transaction failed
+     */
+    static bool removeRecordings(QSqlDatabase db,
+                                 const std::vector<long long> &recIDs);
+
+    /**
+     * @brief Storage used by the recordings in bytes
+     *
+     * @details
+     *
+     * Used pages of the database and the size of all binary recording files.
+     */
+    static long long storageSize(const QSqlDatabase &db);
+    static long long pragmaValue(const QString &pragma, const QSqlDatabase &db);
+
+signals:
+    void recordingsDeleted();
+    void databaseCompacted();
+    /**
+     * @brief A job requested by the user failed or was refused
+     */
+    void maintenanceFailed(QString errorString);
+
+public slots:
+    /**
+     * @brief Apply the retention policies in the worker thread
+     *
+     * @details
+     *
+     * Skipped if another job is running, the next run catches up.
+     */
+    void applyRetention();
+    /**
+     * @brief Start incremental vacuum steps if the database has free pages
+     */
+    void startVacuum();
+
+private slots:
+    void vacuumStep();
+    /**
+     * @param removed Number of deleted recordings
+     */
+    void taskFinished(int job, int removed, bool success, QString errorString);
+
+private:
+    QThreadPool pool;
+    QTimer retentionTimer;
+    QTimer vacuumTimer;
+    long long activeRecording;
+    bool running;
+
+    void startTask(JOB job, std::vector<long long> recIDs,
+                   RetentionPolicy policy = RetentionPolicy());
+};
+
+/**
+ * @brief Run a DBMaintenance job with its own database connection
+ */
+class DBMaintenanceTask : public QRunnable
+{
+public:
+    DBMaintenanceTask(DBMaintenance *maintenance, DBMaintenance::JOB job,
+                      std::vector<long long> recIDs, QString dbFile,
+                      DBMaintenance::RetentionPolicy policy);
+
+    void run() override;
+
+private:
+    DBMaintenance *maintenance;
+    DBMaintenance::JOB job;
+    std::vector<long long> recIDs;
+    QString dbFile;
+    DBMaintenance::RetentionPolicy policy;
+
+    /**
+     * @brief Delete recIDs in transactions of RECORDINGS_PER_TRANSACTION
+     *
+     * @param removed Incremented by the number of deleted recordings
+     */
+    bool remove(QSqlDatabase &db, const std::vector<long long> &recIDs,
+                int &removed, QString &errorString);
+    bool applyRetention(QSqlDatabase &db, int &removed, QString &errorString);
+    /**
+     * @brief Delete the oldest recordings until the storage fits maxSize
+     *
+     * @details
+     *
+     * The storage size is computed once, every deletion subtracts the pages
+     * it freed and the size of its binary files.
+     */
+    bool applySizeLimit(QSqlDatabase &db, int &removed, QString &errorString);
+    std::vector<long long> expiredByAge(const QSqlDatabase &db);
+    std::vector<long long> expiredByDevice(const QSqlDatabase &db);
+    /**
+     * @param dataFile Binary file of the recording, empty if there is none
+     */
+    long long oldestRecording(const QSqlDatabase &db, QString &dataFile);
+    bool compact(QSqlDatabase &db, QString &errorString);
+};
+
+#endif  // DBMAINTENANCE_H
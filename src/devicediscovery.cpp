@@ -0,0 +1,138 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "devicediscovery.h"
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <utility>
+
+namespace discon = discovery_constants;
+
+DeviceDiscovery::DeviceDiscovery() : QObject(), running(false) {}
+DeviceDiscovery::~DeviceDiscovery() { this->wait(); }
+std::vector<DiscoveredDevice> DeviceDiscovery::probe(
+    const QStringList &ports, const std::vector<int> &baudRates,
+    const QByteArray &query)
+{
+    ScopedTiming timing("discovery.probe.ms");
+    std::vector<std::future<std::pair<bool, DiscoveredDevice>>> probes;
+    for (const QString &port : ports) {
+        probes.push_back(std::async(std::launch::async, [&, port]() {
+            DiscoveredDevice device;
+            bool found =
+                DeviceDiscovery::probePort(port, baudRates, query, device);
+            return std::make_pair(found, device);
+        }));
+    }
+
+    std::vector<DiscoveredDevice> devices;
+    for (auto &f : probes) {
+        std::pair<bool, DiscoveredDevice> result = f.get();
+        if (result.first)
+            devices.push_back(std::move(result.second));
+    }
+    return devices;
+}
+
+void DeviceDiscovery::start(std::vector<int> baudRates)
+{
+    if (this->running)
+        return;
+    this->wait();
+
+    QStringList ports;
+    for (const QSerialPortInfo &info : QSerialPortInfo::availablePorts())
+        ports.append(info.portName());
+
+    this->running = true;
+    this->discoveryThread = std::thread([this, ports, baudRates]() {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<DiscoveredDevice> devices =
+            DeviceDiscovery::probe(ports, baudRates);
+        qint64 duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+        LogInstance::get_instance().eal_debug(
+            "Discovery found " + std::to_string(devices.size()) +
+            " device(s) on " + std::to_string(ports.size()) + " port(s) in " +
+            std::to_string(duration) + "ms");
+        this->running = false;
+        emit this->finished(std::move(devices), duration);
+    });
+}
+
+void DeviceDiscovery::wait()
+{
+    if (this->discoveryThread.joinable())
+        this->discoveryThread.join();
+}
+
+bool DeviceDiscovery::isRunning() const { return this->running; }
+bool DeviceDiscovery::probePort(const QString &portName,
+                                const std::vector<int> &baudRates,
+                                const QByteArray &query,
+                                DiscoveredDevice &device)
+{
+    // the port object has to live on the thread that uses it
+    QSerialPort port(portName);
+    if (!port.open(QIODevice::ReadWrite)) {
+        LogInstance::get_instance().eal_debug(
+            "Discovery skips port " + portName.toStdString() + ": " +
+            port.errorString().toStdString());
+        return false;
+    }
+    port.setFlowControl(QSerialPort::FlowControl::NoFlowControl);
+    port.setDataBits(QSerialPort::DataBits::Data8);
+    port.setParity(QSerialPort::Parity::NoParity);
+    port.setStopBits(QSerialPort::StopBits::OneStop);
+
+    bool found = false;
+    for (int baudRate : baudRates) {
+        if (!port.setBaudRate(baudRate))
+            continue;
+        port.clear(QSerialPort::Direction::AllDirections);
+        port.write(query);
+        if (!port.waitForBytesWritten(discon::PROBE_TIMEOUT))
+            continue;
+        QByteArray reply;
+        if (port.waitForReadyRead(discon::PROBE_TIMEOUT)) {
+            reply.append(port.readAll());
+            while (port.waitForReadyRead(discon::REPLY_GAP))
+                reply.append(port.readAll());
+        }
+        reply = reply.trimmed();
+        // a wrong baud rate produces garbage instead of silence
+        bool printable = !reply.isEmpty();
+        for (char ch : reply) {
+            if (ch < 0x20 || ch > 0x7e) {
+                printable = false;
+                break;
+            }
+        }
+        if (printable) {
+            device.port = portName;
+            device.description = QSerialPortInfo(port).description();
+            device.baudRate = baudRate;
+            device.identification = QString::fromLatin1(reply);
+            found = true;
+            break;
+        }
+    }
+    port.close();
+    return found;
+}
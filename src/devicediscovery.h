@@ -0,0 +1,134 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef DEVICEDISCOVERY_H
+#define DEVICEDISCOVERY_H
+
+#include <QByteArray>
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <QtSerialPort/QSerialPort>
+#include <QtSerialPort/QSerialPortInfo>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "log_instance.h"
+#include "perfmetrics.h"
+
+namespace discovery_constants
+{
+/**
+ * @brief Baud rates tried on every port, most likely first
+ */
+const std::vector<int> BAUD_RATES = {9600, 115200, 57600, 19200};
+/**
+ * @brief Time in ms a port may need to answer the identification query
+ */
+const int PROBE_TIMEOUT = 150;
+/**
+ * @brief Time in ms without new bytes that ends a reply
+ */
+const int REPLY_GAP = 10;
+}
+
+/**
+ * @brief A device that answered the identification query
+ */
+struct DiscoveredDevice {
+    QString port;
+    QString description;
+    int baudRate = 0;
+    QString identification;
+};
+
+Q_DECLARE_METATYPE(DiscoveredDevice)
+Q_DECLARE_METATYPE(std::vector<DiscoveredDevice>)
+
+/**
+ * @brief Finds power supplies on all serial ports
+ *
+ * @details
+ *
+ * Every port is probed on its own thread, so a discovery takes about as long as
+ * probing a single port no matter how many ports there are. A probe opens the
+ * port with 8N1 and no flow control, sends the identification query and waits
+ * PROBE_TIMEOUT ms for a reply. The baud rates of a port are tried one after
+ * the other until the device answers with a printable string.
+ *
+ * Ports that can not be opened, for example because a device is connected to
+ * them already, are skipped.
+ */
+class DeviceDiscovery : public QObject
+{
+    Q_OBJECT
+
+public:
+    DeviceDiscovery();
+    ~DeviceDiscovery();
+
+    /**
+     * @brief Probe ports and block until all probes have finished
+     *
+     * @param ports Port names as returned by QSerialPortInfo::portName
+     * @param baudRates Baud rates to try on every port
+     * @param query Identification query, Korad uses *IDN? without terminator
+     *
+     * @return One entry for every port a device answered on
+     */
+    static std::vector<DiscoveredDevice> probe(
+        const QStringList &ports,
+        const std::vector<int> &baudRates = discovery_constants::BAUD_RATES,
+        const QByteArray &query = "*IDN?");
+
+    /**
+     * @brief Probe all available ports in the background
+     *
+     * @details
+     *
+     * The result is delivered by the finished signal. Does nothing if a
+     * discovery is still running.
+     */
+    void start(std::vector<int> baudRates = discovery_constants::BAUD_RATES);
+    /**
+     * @brief Block until a running discovery has finished
+     */
+    void wait();
+    bool isRunning() const;
+
+signals:
+    /**
+     * @brief A discovery started with start has finished
+     *
+     * @param devices Devices found on all ports
+     * @param duration ms the discovery took
+     */
+    void finished(std::vector<DiscoveredDevice> devices, qint64 duration);
+
+private:
+    std::thread discoveryThread;
+    std::atomic<bool> running;
+
+    static bool probePort(const QString &portName,
+                          const std::vector<int> &baudRates,
+                          const QByteArray &query, DiscoveredDevice &device);
+};
+
+#endif  // DEVICEDISCOVERY_H
@@ -91,6 +91,9 @@ void DeviceWizard::accept()
     settings.setValue(setcon::DEVICE_CURRENT_ACCURACY,
                       field("currentAcc").toInt());
     hash.addData(settings.value(setcon::DEVICE_CURRENT_ACCURACY).toByteArray());
+    // not part of the hash, only used to find the device on another port
+    settings.setValue(setcon::DEVICE_IDENTIFICATION,
+                      field("deviceIdentification").toString());
     // use a md5 hash to easily determine if the device has changed.
     // TODO: Why don't we use this hash for the active field? Would allow the
     // user to add devices with the same name (if this makes any sense)
@@ -98,6 +101,7 @@ void DeviceWizard::accept()
     settings.endGroup();
     settings.setValue(setcon::DEVICE_ACTIVE, field("deviceName").toString());
     settings.endGroup();
+    SettingsCache::get_instance().reload();
 
     QDialog::accept();
 }
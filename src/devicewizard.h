@@ -27,6 +27,7 @@
 #include "devicewizardoptions.h"
 #include "devicewizardconnection.h"
 #include "devicewizardfinal.h"
+#include "settingscache.h"
 #include "settingsdefinitions.h"
 
 /**
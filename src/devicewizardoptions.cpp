@@ -30,6 +30,9 @@ DeviceWizardOptions::DeviceWizardOptions(QWidget *parent) : QWizardPage(parent)
     this->protocolBox();
     this->specBox();
     this->comBox();
+
+    QObject::connect(&this->discovery, &DeviceDiscovery::finished, this,
+                     &DeviceWizardOptions::discoveryFinished);
 }
 
 void DeviceWizardOptions::initializePage()
@@ -51,6 +54,44 @@ QString DeviceWizardOptions::getProtoName() const
     return this->protoCombo->currentText();
 }
 
+void DeviceWizardOptions::discover()
+{
+    this->discoverButton->setDisabled(true);
+    this->discoverLabel->setText("Searching all ports...");
+    this->discovery.start();
+}
+
+void DeviceWizardOptions::discoveryFinished(
+    std::vector<DiscoveredDevice> devices, qint64 duration)
+{
+    this->discoverButton->setDisabled(false);
+    if (devices.empty()) {
+        this->discoverLabel->setText(
+            QString("No device answered (%1 ms)").arg(duration));
+        return;
+    }
+    for (const DiscoveredDevice &dev : devices) {
+        int index = this->comPort->findText(dev.port);
+        if (index == -1) {
+            this->comPort->addItem(dev.port);
+            index = this->comPort->count() - 1;
+        }
+        this->comPort->setItemData(
+            index, dev.identification + " (" + dev.description + ")",
+            Qt::ToolTipRole);
+    }
+    const DiscoveredDevice &first = devices.front();
+    this->comPort->setCurrentText(first.port);
+    this->baudBox->setCurrentText(QString::number(first.baudRate));
+    this->discoverLabel->setText(QString("Found %1 on %2 at %3 baud, %4 "
+                                         "device(s) in %5 ms")
+                                     .arg(first.identification)
+                                     .arg(first.port)
+                                     .arg(first.baudRate)
+                                     .arg(devices.size())
+                                     .arg(duration));
+}
+
 void DeviceWizardOptions::protocolBox()
 {
     QGroupBox *protoBox = new QGroupBox();
@@ -154,18 +195,28 @@ void DeviceWizardOptions::comBox()
 
     this->comPort->setToolTip(
         "Choose the port to which your device is connected");
-    gbCom->layout()->addWidget(this->comPort);
+    this->discoverButton = new QPushButton("Discover");
+    this->discoverButton->setToolTip(
+        "Search all ports for a power supply that identifies itself");
+    QHBoxLayout *portLayout = new QHBoxLayout();
+    portLayout->addWidget(this->comPort, 1);
+    portLayout->addWidget(this->discoverButton);
+    dynamic_cast<QVBoxLayout *>(gbCom->layout())->addLayout(portLayout);
+    this->discoverLabel = new QLabel();
+    gbCom->layout()->addWidget(this->discoverLabel);
+    QObject::connect(this->discoverButton, &QPushButton::clicked, this,
+                     &DeviceWizardOptions::discover);
 
     QGridLayout *baudFlowDBits = new QGridLayout();
     dynamic_cast<QVBoxLayout *>(gbCom->layout())->addLayout(baudFlowDBits);
 
     QLabel *baudLabel = new QLabel("Baud Rate");
-    QComboBox *baudBox = new QComboBox();
-    baudBox->addItems(
+    this->baudBox = new QComboBox();
+    this->baudBox->addItems(
         {"1200", "2400", "4800", "9600", "19200", "38400", "57600", "115200"});
-    baudBox->setCurrentText("9600");
+    this->baudBox->setCurrentText("9600");
     baudFlowDBits->addWidget(baudLabel, 0, 0);
-    baudFlowDBits->addWidget(baudBox, 1, 0);
+    baudFlowDBits->addWidget(this->baudBox, 1, 0);
 
     QLabel *flowctlLabel = new QLabel("Flow Control");
     QComboBox *flowctlBox = new QComboBox();
@@ -234,7 +285,7 @@ void DeviceWizardOptions::comBox()
 
     // we need the comport string not index
     registerField("comPort", this->comPort, "currentText");
-    registerField("baudBox", baudBox, "currentText");
+    registerField("baudBox", this->baudBox, "currentText");
     registerField("flowctlBox", flowctlBox);
     registerField("dbitsBox", dbitsBox, "currentText");
     registerField("parityBox", parityBox, "currentData");
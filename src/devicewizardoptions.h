@@ -21,7 +21,9 @@
 #include <QDoubleSpinBox>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <QHBoxLayout>
 #include <QLabel>
+#include <QPushButton>
 #include <QVBoxLayout>
 #include <QWidget>
 #include <QWizardPage>
@@ -29,6 +31,7 @@
 #include <QtSerialPort/QSerialPort>
 #include <QtSerialPort/QSerialPortInfo>
 
+#include "devicediscovery.h"
 #include "global.h"
 #include "log_instance.h"
 
@@ -46,9 +49,23 @@ public:
     void initializePage() Q_DECL_OVERRIDE;
     QString getProtoName() const;
 
+private slots:
+
+    void discover();
+    /**
+     * @brief Add the devices found to the port list and select the first one
+     */
+    void discoveryFinished(std::vector<DiscoveredDevice> devices,
+                           qint64 duration);
+
 private:
     QComboBox *protoCombo;
     QComboBox *comPort;
+    QComboBox *baudBox;
+    QPushButton *discoverButton;
+    QLabel *discoverLabel;
+
+    DeviceDiscovery discovery;
 
     /**
      * @brief Builds a groupbox concerning communication protocol
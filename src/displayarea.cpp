@@ -112,6 +112,79 @@ void DisplayArea::dataUpdate(global_constants::LPQ_MODE md, int channel)
     }
 }
 
+void DisplayArea::valueChanged(int channel, global_constants::LPQ_DATATYPE dt,
+                               double value)
+{
+    if (channel < 1 || static_cast<size_t>(channel) > this->chanwVector.size())
+        return;
+    const SettingsSnapshot &snap = SettingsCache::get_instance().snapshot();
+    int precision = 3;
+    switch (dt) {
+    case globcon::LPQ_DATATYPE::SETVOLTAGE:
+    case globcon::LPQ_DATATYPE::VOLTAGE:
+        precision = snap.voltageAccuracy;
+        break;
+    case globcon::LPQ_DATATYPE::SETCURRENT:
+    case globcon::LPQ_DATATYPE::CURRENT:
+        precision = snap.currentAccuracy;
+        break;
+    case globcon::LPQ_DATATYPE::WATTAGE:
+        break;
+    }
+    this->dataUpdate(QVariant(QString::number(value, 'f', precision)), dt,
+                     channel);
+}
+
+void DisplayArea::outputChanged(int channel, bool status)
+{
+    if (channel < 1 || static_cast<size_t>(channel) > this->chanwVector.size())
+        return;
+    this->dataUpdate(QVariant(status ? "On" : "Off"),
+                     globcon::LPQ_CONTROL::OUTPUT, channel);
+}
+
+void DisplayArea::modeChanged(int channel, global_constants::LPQ_MODE mode)
+{
+    if (channel < 1 || static_cast<size_t>(channel) > this->chanwVector.size())
+        return;
+    this->dataUpdate(mode, channel);
+}
+
+void DisplayArea::protectionChanged(global_constants::LPQ_CONTROL ct,
+                                    bool status)
+{
+    this->dataUpdate(QVariant(status ? "On" : "Off"), ct, 0);
+}
+
+void DisplayArea::statisticsUpdate(const ChannelStatistics &stats, int channel)
+{
+    if (static_cast<size_t>(channel) > this->chanwVector.size())
+        return;
+    const SettingsSnapshot &snap = SettingsCache::get_instance().snapshot();
+    std::shared_ptr<ChannelWidgets> chanw = this->chanwVector.at(channel - 1);
+    auto format = [](const RunningStatistics &rs, int accuracy,
+                     const QString &unit) {
+        return QString("%1 %2 / %3 / %4 / %5")
+            .arg(unit)
+            .arg(rs.getMin(), 0, 'f', accuracy)
+            .arg(rs.getMax(), 0, 'f', accuracy)
+            .arg(rs.getMean(), 0, 'f', accuracy)
+            .arg(rs.getRms(), 0, 'f', accuracy);
+    };
+    chanw->voltageStats->setText(
+        format(stats.getVoltage(), snap.voltageAccuracy, "V"));
+    chanw->currentStats->setText(
+        format(stats.getCurrent(), snap.currentAccuracy, "A"));
+    long long seconds = stats.getDuration() / 1000;
+    chanw->energyStats->setText(
+        QString("%1 Wh  %2 Ah  %3:%4:%5")
+            .arg(stats.getEnergy(), 0, 'f', 4)
+            .arg(stats.getCharge(), 0, 'f', 4)
+            .arg(seconds / 3600)
+            .arg((seconds / 60) % 60, 2, 10, QChar('0'))
+            .arg(seconds % 60, 2, 10, QChar('0')));
+}
+
 // The following two functions are very big. Lots of code is necessay for
 // dynamically build guis.
 void DisplayArea::setupChannels()
@@ -325,6 +398,40 @@ void DisplayArea::setupChannels()
             bottomContainer->layout()->addWidget(setContainer);
             bottomContainer->layout()->addWidget(modeOutputContainer);
 
+            // running statistics min / max / mean / rms since the last reset
+            QFrame *statsContainer = new QFrame();
+            statsContainer->setObjectName("ch" + QString::number(i) +
+                                          "statsContainer");
+            QString statsContainerQss =
+                QString("QFrame#%1 {border-top: 1px solid ") +
+                globcon::GREENCOLOR + ";}";
+            statsContainer->setStyleSheet(
+                statsContainerQss.arg(statsContainer->objectName()));
+            QGridLayout *statsLayout = new QGridLayout();
+            statsContainer->setLayout(statsLayout);
+            channelFrameContainer->layout()->addWidget(statsContainer);
+
+            QLabel *statsLabel = new QLabel("Statistics");
+            statsLabel->setToolTip("min / max / mean / rms");
+            ClickableLabel *statsReset = new ClickableLabel("Reset");
+            statsReset->setNoReturnValue(true);
+            statsReset->setToolTip("Double click to reset the statistics");
+            statsReset->setAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            QObject::connect(statsReset, &ClickableLabel::doubleClickNoValue,
+                             [this]() { emit this->statisticsReset(); });
+            chanw->voltageStats = new QLabel("-");
+            chanw->currentStats = new QLabel("-");
+            chanw->energyStats = new QLabel("-");
+            for (QLabel *l : {chanw->voltageStats, chanw->currentStats,
+                              chanw->energyStats}) {
+                l->setFont(bottomUnitFont);
+            }
+            statsLayout->addWidget(statsLabel, 0, 0);
+            statsLayout->addWidget(statsReset, 0, 1);
+            statsLayout->addWidget(chanw->voltageStats, 1, 0, 1, 2);
+            statsLayout->addWidget(chanw->currentStats, 2, 0, 1, 2);
+            statsLayout->addWidget(chanw->energyStats, 3, 0, 1, 2);
+
             this->channelFramesVec.push_back(channelFrameContainer);
             // move semantics are needed here because unique_ptr does not allow
             // copying what push_back actually does.
@@ -31,10 +31,13 @@
 #include <memory>
 #include <vector>
 
+#include "channelstatistics.h"
 #include "clickablelabel.h"
 #include "floatingvaluesdialog.h"
 #include "global.h"
+#include "guiutils.h"
 #include "labpowercontroller.h"
+#include "settingscache.h"
 #include "settingsdefinitions.h"
 
 /**
@@ -52,6 +55,10 @@ public:
     ClickableLabel *currentSet;
     QLabel *modeActual;
     ClickableLabel *outputSet;
+
+    QLabel *voltageStats;
+    QLabel *currentStats;
+    QLabel *energyStats;
 };
 
 /**
@@ -77,15 +84,33 @@ public:
                     int channel);
     void dataUpdate(const QVariant& val, global_constants::LPQ_CONTROL ct, int channel);
     void dataUpdate(global_constants::LPQ_MODE md, int channel);
+    /**
+     * @brief Show the running statistics of a channel
+     */
+    void statisticsUpdate(const ChannelStatistics &stats, int channel);
 
 signals:
 
     void doubleValueChanged(double val, int dt, int channel);
     void deviceControlValueChanged(int vt, int channel);
+    void statisticsReset();
 
 public slots:
 
     void setupChannels();
+    /**
+     * @brief Show a value that has changed, see LabPowerModel::valueChanged
+     *
+     * @details
+     *
+     * Only the label of the value is updated, formatted with the accuracy of
+     * the device.
+     */
+    void valueChanged(int channel, global_constants::LPQ_DATATYPE dt,
+                      double value);
+    void outputChanged(int channel, bool status);
+    void modeChanged(int channel, global_constants::LPQ_MODE mode);
+    void protectionChanged(global_constants::LPQ_CONTROL ct, bool status);
 
 private:
     QFrame *frameHeader;
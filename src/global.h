@@ -18,10 +18,6 @@
 #ifndef GLOBAL
 #define GLOBAL
 
-#include <QLayout>
-#include <QLayoutItem>
-#include <QWidget>
-
 // Suppress attribute unused warnings on gcc
 #ifdef __GNUC__
 #define ATTR_UNUSED __attribute__((unused))
@@ -45,6 +41,7 @@ enum class LPQ_DATATYPE {
     CURRENT,
     WATTAGE
 };
+enum class LPQ_RECORD_BACKEND { SQLITE = 0, BINARY };
 enum class LPQ_CONTROL {
     CONNECT = 0,
     OCP,
@@ -60,23 +57,4 @@ const char *const ORANGECOLOR = "#FF7E00";
 const char *const GREENCOLOR = "#7BCF06";
 }
 
-namespace global_utilities
-{
-/**
- * @brief A method that recursively deletes all Widgets and Items inside a QLayout
- */
-inline void clearLayout(QLayout *layout)
-{
-    while (QLayoutItem *item = layout->takeAt(0)) {
-        if (QWidget *widget = item->widget())
-            delete widget;
-
-        // recursive if the layout has child layouts.
-        if (QLayout *childLayout = item->layout())
-            global_utilities::clearLayout(childLayout);
-        delete item;
-    }
-};
-}
-
 #endif  // GLOBAL
@@ -0,0 +1,44 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GUIUTILS_H
+#define GUIUTILS_H
+
+#include <QLayout>
+#include <QLayoutItem>
+#include <QWidget>
+
+namespace global_utilities
+{
+/**
+ * @brief A method that recursively deletes all Widgets and Items inside a QLayout
+ */
+inline void clearLayout(QLayout *layout)
+{
+    while (QLayoutItem *item = layout->takeAt(0)) {
+        if (QWidget *widget = item->widget())
+            delete widget;
+
+        // recursive if the layout has child layouts.
+        if (QLayout *childLayout = item->layout())
+            global_utilities::clearLayout(childLayout);
+        delete item;
+    }
+};
+}
+
+#endif  // GUIUTILS_H
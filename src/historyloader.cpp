@@ -0,0 +1,338 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "historyloader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace dbcon = database_constants;
+namespace histcon = history_constants;
+namespace rollcon = rollup_constants;
+namespace rollutil = rollup_utils;
+
+HistoryLoader::HistoryLoader(QString dbFile, long long recID,
+                             QString dataFile, int channels)
+    : QObject(),
+      dbFile(std::move(dbFile)),
+      recID(recID),
+      dataFile(std::move(dataFile)),
+      channels(channels),
+      currentRequest(0)
+{
+    this->connectionName =
+        QString("historyloader_%1")
+            .arg(reinterpret_cast<quintptr>(this), 0, 16);
+}
+
+HistoryLoader::~HistoryLoader()
+{
+    if (QSqlDatabase::contains(this->connectionName)) {
+        QSqlDatabase::database(this->connectionName, false).close();
+        QSqlDatabase::removeDatabase(this->connectionName);
+    }
+}
+
+void HistoryLoader::setCurrentRequest(quint64 request)
+{
+    this->currentRequest.store(request);
+}
+
+void HistoryLoader::load(quint64 request, qint64 from, qint64 to,
+                         int maxPoints)
+{
+    if (this->canceled(request))
+        return;
+    if (!this->openDatabase()) {
+        this->loadFailed(request);
+        return;
+    }
+    rollcon::LEVEL level = rollutil::levelForSpan(to - from, maxPoints);
+    if (level != rollcon::LEVEL::RAW &&
+        this->loadRollup(request, level, from, to))
+        return;
+    if (this->dataFile.isEmpty()) {
+        this->loadDatabase(request, from, to, maxPoints);
+    } else {
+        this->loadBinary(request, from, to, maxPoints);
+    }
+}
+
+bool HistoryLoader::openDatabase()
+{
+    QSqlDatabase db;
+    if (QSqlDatabase::contains(this->connectionName)) {
+        db = QSqlDatabase::database(this->connectionName, false);
+        if (db.isOpen())
+            return true;
+    } else {
+        db = QSqlDatabase::addDatabase("QSQLITE", this->connectionName);
+    }
+    db.setDatabaseName(this->dbFile);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        LogInstance::get_instance().eal_error(
+            "Can not open database for reading the recording: " +
+            db.lastError().text().toStdString());
+        return false;
+    }
+    return true;
+}
+
+bool HistoryLoader::canceled(quint64 request) const
+{
+    return this->currentRequest.load() != request;
+}
+
+HistoryChunk HistoryLoader::newChunk(quint64 request) const
+{
+    HistoryChunk chunk;
+    chunk.request = request;
+    chunk.values.resize(static_cast<size_t>(this->channels) * 3);
+    return chunk;
+}
+
+void HistoryLoader::loadFailed(quint64 request)
+{
+    HistoryChunk chunk = this->newChunk(request);
+    chunk.last = true;
+    emit this->chunkLoaded(std::move(chunk));
+}
+
+bool HistoryLoader::loadRollup(quint64 request, rollcon::LEVEL level,
+                               qint64 from, qint64 to)
+{
+    QString columns;
+    for (const auto &quantity : dbcon::TBL_ROLLUP_QUANTITIES) {
+        columns += ", " + quantity + "_min, " + quantity + "_max";
+    }
+    QSqlQuery query(QSqlDatabase::database(this->connectionName));
+    query.setForwardOnly(true);
+    // clang-format off
+    query.prepare(QString("SELECT ") + dbcon::TBL_ROLLUP_BUCKET + ", "
+                  + dbcon::TBL_ROLLUP_CHAN + columns
+                  + " FROM " + dbcon::TBL_ROLLUP + " WHERE "
+                  + dbcon::TBL_ROLLUP_REC + " = ? AND "
+                  + dbcon::TBL_ROLLUP_LEVEL + " = ? AND "
+                  + dbcon::TBL_ROLLUP_BUCKET + " BETWEEN ? AND ? ORDER BY "
+                  + dbcon::TBL_ROLLUP_BUCKET + ", " + dbcon::TBL_ROLLUP_CHAN);
+    // clang-format on
+    query.bindValue(0, this->recID);
+    query.bindValue(1, static_cast<int>(level));
+    query.bindValue(2, rollutil::bucketStart(level, from));
+    query.bindValue(3, to);
+    if (!query.exec()) {
+        LogInstance::get_instance().eal_error(
+            query.lastError().text().toStdString());
+        return false;
+    }
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    HistoryChunk chunk = this->newChunk(request);
+    long long lastBucket = 0;
+    while (query.next()) {
+        long long bucket = query.value(0).toLongLong();
+        if (chunk.keys.isEmpty() || bucket != lastBucket) {
+            // min and max at the start of the bucket
+            chunk.keys.push_back(bucket / 1000.0);
+            chunk.keys.push_back(bucket / 1000.0);
+            for (auto &values : chunk.values) {
+                values.push_back(nan);
+                values.push_back(nan);
+            }
+            lastBucket = bucket;
+        }
+        int channel = query.value(1).toInt();
+        if (channel < 1 || channel > this->channels)
+            continue;
+        int idx = chunk.keys.size() - 2;
+        for (int q = 0; q < 3; q++) {
+            QVector<double> &values = chunk.values.at((channel - 1) * 3 + q);
+            values[idx] = query.value(2 + 2 * q).toDouble();
+            values[idx + 1] = query.value(3 + 2 * q).toDouble();
+        }
+    }
+    if (chunk.keys.isEmpty())
+        return false;
+    chunk.last = true;
+    emit this->chunkLoaded(std::move(chunk));
+    return true;
+}
+
+void HistoryLoader::loadDatabase(quint64 request, qint64 from, qint64 to,
+                                 int maxPoints)
+{
+    QSqlQuery query(QSqlDatabase::database(this->connectionName));
+    query.setForwardOnly(true);
+    // A page are the next PAGE_SIZE measurements after the keyset cursor. The
+    // channels of these measurements are joined afterwards so a page never
+    // ends in the middle of a measurement.
+    // clang-format off
+    query.prepare(QString("SELECT m.") + dbcon::TBL_MEASUREMENT_ID + ", "
+                  + "m." + dbcon::TBL_MEASUREMENT_TIME + ", "
+                  + "c." + dbcon::TBL_CHANNEL_CHAN + ", "
+                  + "c." + dbcon::TBL_CHANNEL_V + ", "
+                  + "c." + dbcon::TBL_CHANNEL_A + ", "
+                  + "c." + dbcon::TBL_CHANNEL_W + " \n"
+                  + "FROM " + dbcon::TBL_MEASUREMENT + " AS m \n"
+                  + "LEFT JOIN " + dbcon::TBL_CHANNEL + " AS c \n"
+                  + "ON c." + dbcon::TBL_CHANNEL_MES + " = m." + dbcon::TBL_MEASUREMENT_ID + "\n"
+                  + "WHERE m." + dbcon::TBL_MEASUREMENT_ID + " IN (SELECT " + dbcon::TBL_MEASUREMENT_ID + " FROM " + dbcon::TBL_MEASUREMENT
+                  + " WHERE " + dbcon::TBL_MEASUREMENT_REC + " = ? AND "
+                  + "(" + dbcon::TBL_MEASUREMENT_TIME + ", " + dbcon::TBL_MEASUREMENT_ID + ") > (?, ?) AND "
+                  + dbcon::TBL_MEASUREMENT_TIME + " <= ? "
+                  + "ORDER BY " + dbcon::TBL_MEASUREMENT_TIME + ", " + dbcon::TBL_MEASUREMENT_ID + " LIMIT ?) \n"
+                  + "ORDER BY m." + dbcon::TBL_MEASUREMENT_TIME + ", m." + dbcon::TBL_MEASUREMENT_ID + ", c." + dbcon::TBL_CHANNEL_CHAN);
+    // clang-format on
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    // every bucket of bucketMs becomes a min and a max point, 0 keeps every
+    // measurement
+    qint64 bucketMs = 0;
+    if (maxPoints > 0)
+        bucketMs = std::max<qint64>(1, ((to - from) * 2 + maxPoints - 1) /
+                                           maxPoints);
+    int points = bucketMs > 0 ? 2 : 1;
+    qint64 bucket = -1;
+    HistoryChunk chunk = this->newChunk(request);
+    // the first page includes measurements at from
+    QVariant cursorTime = QDateTime::fromMSecsSinceEpoch(from);
+    long long cursorID = 0;
+    bool last = false;
+    while (!last) {
+        if (this->canceled(request))
+            return;
+        query.bindValue(0, this->recID);
+        query.bindValue(1, cursorTime);
+        query.bindValue(2, cursorID);
+        query.bindValue(3, QDateTime::fromMSecsSinceEpoch(to));
+        query.bindValue(4, histcon::PAGE_SIZE);
+        if (!query.exec()) {
+            LogInstance::get_instance().eal_error(
+                query.lastError().text().toStdString());
+            this->loadFailed(request);
+            return;
+        }
+        int measurements = 0;
+        while (query.next()) {
+            long long id = query.value(0).toLongLong();
+            if (measurements == 0 || id != cursorID) {
+                measurements++;
+                cursorID = id;
+                cursorTime = query.value(1);
+                qint64 time = QDateTime::fromString(cursorTime.toString(),
+                                                    Qt::ISODateWithMs)
+                                  .toMSecsSinceEpoch();
+                qint64 measurementBucket =
+                    bucketMs > 0 ? (time - from) / bucketMs : id;
+                if (chunk.keys.isEmpty() || measurementBucket != bucket) {
+                    bucket = measurementBucket;
+                    // a bucket is never split between two chunks
+                    if (chunk.keys.size() >= histcon::PAGE_SIZE) {
+                        emit this->chunkLoaded(std::move(chunk));
+                        chunk = this->newChunk(request);
+                    }
+                    for (int p = 0; p < points; p++) {
+                        chunk.keys.push_back(time / 1000.0);
+                        for (auto &values : chunk.values) {
+                            values.push_back(nan);
+                        }
+                    }
+                }
+            }
+            int channel = query.value(2).toInt();
+            if (channel < 1 || channel > this->channels)
+                continue;
+            int idx = chunk.keys.size() - points;
+            for (int q = 0; q < 3; q++) {
+                double v = query.value(3 + q).toDouble();
+                QVector<double> &values =
+                    chunk.values.at((channel - 1) * 3 + q);
+                double &min = values[idx];
+                double &max = values[idx + points - 1];
+                // NaN compares false, the first measurement sets both
+                min = std::isnan(min) ? v : std::min(min, v);
+                max = std::isnan(max) ? v : std::max(max, v);
+            }
+        }
+        query.finish();
+        last = measurements < histcon::PAGE_SIZE;
+    }
+    chunk.last = true;
+    emit this->chunkLoaded(std::move(chunk));
+}
+
+void HistoryLoader::loadBinary(quint64 request, qint64 from, qint64 to,
+                               int maxPoints)
+{
+    BinaryRecordingReader reader(this->dataFile);
+    if (!reader.open()) {
+        LogInstance::get_instance().eal_error("Can not open binary recording " +
+                                              this->dataFile.toStdString());
+        this->loadFailed(request);
+        return;
+    }
+    long long first = reader.findSample(from);
+    long long last = reader.findSample(to + 1);
+    // every group of stride samples becomes a min and a max point
+    long long stride = 1;
+    if (maxPoints > 0 && last - first > maxPoints) {
+        stride = ((last - first) * 2 + maxPoints - 1) / maxPoints;
+    }
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    HistoryChunk chunk = this->newChunk(request);
+    for (long long i = first; i < last; i += stride) {
+        if (this->canceled(request))
+            return;
+        double key = reader.sampleTime(i) / 1000.0;
+        int points = stride == 1 ? 1 : 2;
+        for (int p = 0; p < points; p++) {
+            chunk.keys.push_back(key);
+            for (auto &values : chunk.values) {
+                values.push_back(nan);
+            }
+        }
+        int idx = chunk.keys.size() - points;
+        for (long long j = i; j < std::min(i + stride, last); j++) {
+            std::shared_ptr<PowerSupplyStatus> status = reader.sample(j);
+            for (int c = 1; c <= this->channels; c++) {
+                double v[3];
+                try {
+                    v[0] = status->getVoltage(c);
+                    v[1] = status->getCurrent(c);
+                    v[2] = status->getWattage(c);
+                } catch (const std::out_of_range &) {
+                    continue;
+                }
+                for (int q = 0; q < 3; q++) {
+                    QVector<double> &values = chunk.values.at((c - 1) * 3 + q);
+                    double &min = values[idx];
+                    double &max = values[idx + points - 1];
+                    // NaN compares false, the first sample sets both
+                    min = std::isnan(min) ? v[q] : std::min(min, v[q]);
+                    max = std::isnan(max) ? v[q] : std::max(max, v[q]);
+                }
+            }
+        }
+        if (chunk.keys.size() >= histcon::PAGE_SIZE) {
+            emit this->chunkLoaded(std::move(chunk));
+            chunk = this->newChunk(request);
+        }
+    }
+    chunk.last = true;
+    emit this->chunkLoaded(std::move(chunk));
+}
@@ -0,0 +1,175 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HISTORYLOADER_H
+#define HISTORYLOADER_H
+
+#include <QMetaType>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <QDateTime>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "binaryrecordingreader.h"
+#include "databasedef.h"
+#include "log_instance.h"
+#include "powersupplystatus.h"
+#include "rollupaccumulator.h"
+
+namespace history_constants
+{
+/**
+ * @brief Points per graph of the overview of a whole recording
+ */
+const int OVERVIEW_POINTS = 2000;
+/**
+ * @brief Points per pixel of the x-axis that are requested from the loader
+ */
+const int POINTS_PER_PIXEL = 2;
+/**
+ * @brief Number of measurements read with one keyset page
+ */
+const int PAGE_SIZE = 5000;
+/**
+ * @brief Delay in ms after the last zoom or drag before finer data is loaded
+ */
+const int ZOOM_DELAY = 150;
+}
+
+/**
+ * @brief Part of the data of a load request
+ *
+ * @details
+ *
+ * values holds one vector per graph, voltage, current and wattage of channel 1
+ * followed by the ones of channel 2 and so on. Missing values are NaN.
+ */
+struct HistoryChunk {
+    quint64 request = 0;
+    QVector<double> keys; /**< Seconds since epoch */
+    std::vector<QVector<double>> values;
+    bool last = false; /**< Last chunk of the request */
+};
+
+Q_DECLARE_METATYPE(HistoryChunk)
+
+/**
+ * @brief Streams the measurements of one recording in a worker thread
+ *
+ * @details
+ *
+ * A load request for a time range is answered with one or more HistoryChunk
+ * signals. Long ranges are answered with the min and max values of the
+ * coarsest sufficient rollup level, every bucket becomes two points at the
+ * start of the bucket like the levels of a PlotSeries. Short ranges and
+ * recordings without rollups are read raw.
+ *
+ * Raw measurements of the database are read in pages with keyset pagination
+ * on (measure_time, id). Each page starts after the last row of the previous
+ * one so it is a range scan of the recording/measure_time index, no matter how
+ * deep inside the recording the page is. Binary recordings are located with
+ * the seek index of the data file.
+ *
+ * Only the most recent request is of interest. The GUI thread marks a new
+ * request with setCurrentRequest before it is queued, older requests stop
+ * after their current page.
+ *
+ * The loader uses its own database connection and is meant to be moved to a
+ * QThread.
+ */
+class HistoryLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param dbFile Database file
+     * @param recID Recording
+     * @param dataFile Binary recording file, empty for database recordings
+     * @param channels Channels of the recording
+     */
+    HistoryLoader(QString dbFile, long long recID, QString dataFile,
+                  int channels);
+    ~HistoryLoader();
+
+    /**
+     * @brief Set the request that is still of interest
+     *
+     * @details
+     *
+     * Can be called from any thread.
+     */
+    void setCurrentRequest(quint64 request);
+
+public slots:
+    /**
+     * @brief Load the measurements between from and to
+     *
+     * @param request Id of the request the chunks are tagged with
+     * @param from Start of the range in ms since epoch
+     * @param to End of the range in ms since epoch
+     * @param maxPoints Points per graph before rollups or min/max buckets are
+     * used
+     */
+    void load(quint64 request, qint64 from, qint64 to, int maxPoints);
+
+signals:
+    void chunkLoaded(HistoryChunk chunk);
+
+private:
+    QString dbFile;
+    long long recID;
+    QString dataFile;
+    int channels;
+    QString connectionName;
+    std::atomic<quint64> currentRequest;
+
+    bool openDatabase();
+    bool canceled(quint64 request) const;
+    HistoryChunk newChunk(quint64 request) const;
+    /**
+     * @brief Emit the last chunk of a request that could not be loaded
+     */
+    void loadFailed(quint64 request);
+    /**
+     * @return False if the recording has no buckets of this level
+     */
+    bool loadRollup(quint64 request, rollup_constants::LEVEL level,
+                    qint64 from, qint64 to);
+    /**
+     * @brief Stream the measurements with keyset pages
+     *
+     * @details
+     *
+     * Recordings without rollups end up here for every zoom level. The
+     * measurements are reduced to a min and a max point per time bucket so
+     * that at most about maxPoints points are emitted like loadBinary does.
+     */
+    void loadDatabase(quint64 request, qint64 from, qint64 to, int maxPoints);
+    void loadBinary(quint64 request, qint64 from, qint64 to, int maxPoints);
+};
+
+#endif  // HISTORYLOADER_H
@@ -0,0 +1,216 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "historyviewer.h"
+
+namespace histcon = history_constants;
+
+HistoryViewer::HistoryViewer(long long recID, const QString &recName,
+                             int channels, const QString &dataFile,
+                             qint64 start, qint64 stop, QWidget *parent)
+    : QDialog(parent),
+      channels(channels),
+      start(start),
+      stop(stop),
+      request(0),
+      replaceFrom(0),
+      pointsLoaded(0)
+{
+    this->setWindowTitle(tr("Recording %1").arg(recName));
+    this->resize(900, 600);
+    QVBoxLayout *lay = new QVBoxLayout();
+    this->setLayout(lay);
+    this->plot = new QCustomPlot();
+    lay->addWidget(this->plot);
+    this->labelStatus = new QLabel();
+    lay->addWidget(this->labelStatus);
+    setupPlot(this->plot, channels, start, stop);
+
+    this->loader = new HistoryLoader(QSqlDatabase::database().databaseName(),
+                                     recID, dataFile, channels);
+    this->loader->moveToThread(&this->loaderThread);
+    QObject::connect(&this->loaderThread, &QThread::finished, this->loader,
+                     &QObject::deleteLater);
+    QObject::connect(this, &HistoryViewer::requestRange, this->loader,
+                     &HistoryLoader::load);
+    QObject::connect(this->loader, &HistoryLoader::chunkLoaded, this,
+                     &HistoryViewer::chunkLoaded);
+    this->loaderThread.start();
+
+    this->zoomTimer.setSingleShot(true);
+    this->zoomTimer.setInterval(histcon::ZOOM_DELAY);
+    QObject::connect(&this->zoomTimer, &QTimer::timeout, this,
+                     &HistoryViewer::loadVisibleRange);
+    QObject::connect(
+        this->plot->xAxis,
+        static_cast<void (QCPAxis::*)(const QCPRange &)>(
+            &QCPAxis::rangeChanged),
+        this, &HistoryViewer::xAxisRangeChanged);
+
+    // the overview of the whole recording
+    this->load(this->start, this->stop, histcon::OVERVIEW_POINTS);
+}
+
+HistoryViewer::~HistoryViewer()
+{
+    // request 0 is never used, this cancels the running request
+    this->loader->setCurrentRequest(0);
+    this->loaderThread.quit();
+    this->loaderThread.wait();
+}
+
+void HistoryViewer::xAxisRangeChanged(ATTR_UNUSED const QCPRange &newRange)
+{
+    this->zoomTimer.start();
+}
+
+void HistoryViewer::loadVisibleRange()
+{
+    QCPRange range = this->plot->xAxis->range();
+    this->load(static_cast<qint64>(std::floor(range.lower * 1000)),
+               static_cast<qint64>(std::ceil(range.upper * 1000)),
+               std::max(1, this->plot->axisRect()->width()) *
+                   histcon::POINTS_PER_PIXEL);
+}
+
+void HistoryViewer::chunkLoaded(HistoryChunk chunk)
+{
+    if (chunk.request != this->request)
+        return;
+    // replace the data up to the last key of this chunk or the whole rest of
+    // the requested range
+    double replaceTo = this->requestedRange.upper;
+    double removeFrom = this->replaceFrom;
+    if (!chunk.keys.isEmpty()) {
+        // rollup buckets may start before the requested range
+        removeFrom = std::min(removeFrom, chunk.keys.first());
+        if (!chunk.last)
+            replaceTo = chunk.keys.last();
+    }
+    for (int i = 0; i < this->plot->graphCount(); i++) {
+        QCPGraph *graph = this->plot->graph(i);
+        graph->data()->remove(removeFrom, replaceTo);
+        if (static_cast<size_t>(i) < chunk.values.size())
+            graph->addData(chunk.keys, chunk.values.at(i), true);
+    }
+    this->replaceFrom = std::nextafter(
+        replaceTo, std::numeric_limits<double>::infinity());
+    this->pointsLoaded += chunk.keys.size();
+
+    if (chunk.last) {
+        this->labelStatus->setText(
+            tr("%1 points loaded in %2 ms")
+                .arg(this->pointsLoaded)
+                .arg(this->requestStarted.msecsTo(
+                    QDateTime::currentDateTime())));
+    } else {
+        this->labelStatus->setText(
+            tr("Loading... %1 points").arg(this->pointsLoaded));
+    }
+    rescaleValueAxes(this->plot);
+    this->plot->replot();
+}
+
+void HistoryViewer::setupPlot(QCustomPlot *plot, int channels, qint64 start,
+                              qint64 stop)
+{
+    plot->setInteractions(QCP::Interaction::iRangeDrag |
+                          QCP::Interaction::iRangeZoom |
+                          QCP::Interaction::iSelectLegend);
+    plot->axisRect()->setRangeZoom(Qt::Orientation::Horizontal);
+    plot->axisRect()->setRangeDrag(Qt::Orientation::Horizontal);
+    plot->legend->setVisible(true);
+    plot->axisRect()->insetLayout()->setInsetAlignment(
+        0, Qt::AlignLeft | Qt::AlignTop);
+
+    QCPAxis *voltageAxis = plot->yAxis;
+    QCPAxis *currentAxis = plot->axisRect()->addAxis(QCPAxis::AxisType::atLeft);
+    QCPAxis *wattageAxis = plot->axisRect()->addAxis(QCPAxis::AxisType::atLeft);
+    voltageAxis->setLabel("Voltage V");
+    currentAxis->setLabel("Current A");
+    wattageAxis->setLabel("Wattage W");
+
+    plot->xAxis->setLabel("Time");
+    QSharedPointer<QCPAxisTickerDateTime> dateTicker(new QCPAxisTickerDateTime);
+    dateTicker->setDateTimeFormat("dd.MM. HH:mm:ss");
+    plot->xAxis->setTicker(dateTicker);
+    plot->xAxis->setTickLabelRotation(45);
+    plot->xAxis->setRange(start / 1000.0, stop / 1000.0);
+
+    const std::vector<QColor> voltageColors = {
+        QColor(Qt::GlobalColor::red), QColor(Qt::GlobalColor::red).lighter()};
+    const std::vector<QColor> currentColors = {
+        QColor(Qt::GlobalColor::blue), QColor(Qt::GlobalColor::blue).lighter()};
+    const std::vector<QColor> wattageColors = {
+        QColor(Qt::GlobalColor::green),
+        QColor(Qt::GlobalColor::green).lighter()};
+    // voltage, current and wattage per channel in the order of HistoryChunk
+    for (int i = 0; i < channels; i++) {
+        QString chan = QString::number(i + 1);
+        size_t col = static_cast<size_t>(i) % voltageColors.size();
+        QCPGraph *graph = plot->addGraph(plot->xAxis, voltageAxis);
+        graph->setName("Voltage CH" + chan);
+        graph->setPen(QPen(voltageColors.at(col), 2));
+        graph = plot->addGraph(plot->xAxis, currentAxis);
+        graph->setName("Current CH" + chan);
+        graph->setPen(QPen(currentColors.at(col), 2));
+        graph = plot->addGraph(plot->xAxis, wattageAxis);
+        graph->setName("Wattage CH" + chan);
+        graph->setPen(QPen(wattageColors.at(col), 2));
+    }
+}
+
+void HistoryViewer::rescaleValueAxes(QCustomPlot *plot)
+{
+    QCPRange keyRange = plot->xAxis->range();
+    for (QCPAxis *axis : plot->axisRect()->axes(QCPAxis::AxisType::atLeft)) {
+        bool foundRange = false;
+        QCPRange valueRange;
+        for (QCPGraph *graph : axis->graphs()) {
+            bool found = false;
+            if (!graph->visible())
+                continue;
+            QCPRange range = graph->getValueRange(found, QCP::sdBoth, keyRange);
+            if (!found)
+                continue;
+            if (foundRange) {
+                valueRange.expand(range);
+            } else {
+                valueRange = range;
+                foundRange = true;
+            }
+        }
+        if (foundRange)
+            axis->setRange(valueRange.lower - 0.5, valueRange.upper + 0.5);
+    }
+}
+
+void HistoryViewer::load(qint64 from, qint64 to, int maxPoints)
+{
+    from = std::max(from, this->start);
+    to = std::min(to, this->stop);
+    if (to <= from)
+        return;
+    this->request++;
+    this->loader->setCurrentRequest(this->request);
+    this->requestedRange = QCPRange(from / 1000.0, to / 1000.0);
+    this->replaceFrom = this->requestedRange.lower;
+    this->pointsLoaded = 0;
+    this->requestStarted = QDateTime::currentDateTime();
+    this->labelStatus->setText(tr("Loading..."));
+    emit this->requestRange(this->request, from, to, maxPoints);
+}
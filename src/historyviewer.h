@@ -0,0 +1,126 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HISTORYVIEWER_H
+#define HISTORYVIEWER_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <QSqlDatabase>
+
+#include <QDateTime>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "global.h"
+#include "historyloader.h"
+#include "qcustomplot.h"
+
+/**
+ * @brief Dialog that plots a recording
+ *
+ * @details
+ *
+ * The whole recording is loaded as a coarse overview when the dialog is
+ * opened. Whenever the user zooms or drags the x-axis the visible range is
+ * requested again at the resolution of the plot. The chunks of the
+ * HistoryLoader replace the data of this range from left to right, so the
+ * coarse data stays visible until the finer data has arrived.
+ */
+class HistoryViewer : public QDialog
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param recID Recording
+     * @param recName Name of the recording
+     * @param channels Channels of the recording
+     * @param dataFile Binary recording file, empty for database recordings
+     * @param start Start of the recording in ms since epoch
+     * @param stop End of the recording in ms since epoch
+     */
+    HistoryViewer(long long recID, const QString &recName, int channels,
+                  const QString &dataFile, qint64 start, qint64 stop,
+                  QWidget *parent = 0);
+    ~HistoryViewer();
+
+    /**
+     * @brief Add the axes and the graphs of a recording to plot
+     *
+     * @details
+     *
+     * Voltage, current and wattage graphs are added for every channel in the
+     * order of the values of a HistoryChunk.
+     */
+    static void setupPlot(QCustomPlot *plot, int channels, qint64 start,
+                          qint64 stop);
+    /**
+     * @brief Fit the value axes to the visible graphs in the x-axis range
+     */
+    static void rescaleValueAxes(QCustomPlot *plot);
+
+signals:
+
+    void requestRange(quint64 request, qint64 from, qint64 to,
+                      int maxPoints);
+
+private slots:
+
+    void xAxisRangeChanged(const QCPRange &newRange);
+    void loadVisibleRange();
+    void chunkLoaded(HistoryChunk chunk);
+
+private:
+    QCustomPlot *plot;
+    QLabel *labelStatus;
+
+    QThread loaderThread;
+    HistoryLoader *loader;
+    /**
+     * @brief Waits for the user to stop zooming or dragging
+     */
+    QTimer zoomTimer;
+
+    int channels;
+    qint64 start;
+    qint64 stop;
+
+    quint64 request;
+    QCPRange requestedRange;
+    /**
+     * @brief Key from which on the data of the running request is replaced
+     */
+    double replaceFrom;
+    long long pointsLoaded;
+    QDateTime requestStarted;
+
+    /**
+     * @brief Start a new request, a running one is canceled
+     */
+    void load(qint64 from, qint64 to, int maxPoints);
+};
+
+#endif  // HISTORYVIEWER_H
@@ -66,7 +66,6 @@ void KoradSCPI::getStatus()
 void KoradSCPI::changeChannel(ATTR_UNUSED int channel) {}
 void KoradSCPI::setVoltage(int channel, double value)
 {
-    this->powStatus->setVoltageSet(std::make_pair(channel, value));
     this->serQueue.push(
         static_cast<int>(powcon::COMMANDS::SETVOLTAGESET), channel,
         QVariant(QString::number(value, 'f', this->voltageAccuracy)));
@@ -89,7 +88,6 @@ void KoradSCPI::getActualVoltage(int channel)
 
 void KoradSCPI::setCurrent(int channel, double value)
 {
-    this->powStatus->setCurrentSet(std::make_pair(channel, value));
     this->serQueue.push(
         static_cast<int>(powcon::COMMANDS::SETCURRENTSET), channel,
         QVariant(QString::number(value, 'f', this->currentAccuracy)));
@@ -112,7 +110,6 @@ void KoradSCPI::getActualCurrent(int channel)
 
 void KoradSCPI::setOCP(bool status)
 {
-    this->powStatus->setOcp(status);
     QVariant val = 0;
     if (status) {
         val = 1;
@@ -122,7 +119,6 @@ void KoradSCPI::setOCP(bool status)
 
 void KoradSCPI::setOVP(bool status)
 {
-    this->powStatus->setOvp(status);
     QVariant val = 0;
     if (status) {
         val = 1;
@@ -214,6 +210,40 @@ void KoradSCPI::processCommands(const std::shared_ptr<PowerSupplyStatus> &status
         }
     }
 
+    // setpoints are applied once the command was written to the device
+    if (com->getCommand() == powcon::COMMANDS::SETVOLTAGESET) {
+        if (status)
+            status->setVoltageSet(std::make_pair(com->getPowerSupplyChannel(),
+                                                 com->getValue().toDouble()));
+    }
+
+    if (com->getCommand() == powcon::COMMANDS::SETCURRENTSET) {
+        if (status)
+            status->setCurrentSet(std::make_pair(com->getPowerSupplyChannel(),
+                                                 com->getValue().toDouble()));
+    }
+
+    if (com->getCommand() == powcon::COMMANDS::SETOCP) {
+        if (status)
+            status->setOcp(com->getValue().toInt() == 1);
+    }
+
+    if (com->getCommand() == powcon::COMMANDS::SETOVP) {
+        if (status)
+            status->setOvp(com->getValue().toInt() == 1);
+    }
+
+    // Korad switches all channels at once, this keeps the watchdog from
+    // tripping again on the same status after it switched the output off
+    if (com->getCommand() == powcon::COMMANDS::SETOUT) {
+        if (status) {
+            for (int i = 1; i <= this->noOfChannels; i++) {
+                status->setChannelOutput(
+                    std::make_pair(i, com->getValue().toInt() == 1));
+            }
+        }
+    }
+
     if (com->getCommand() == powcon::COMMANDS::GETIDN) {
         QString val = com->getValue().toString();
     }
@@ -337,3 +367,12 @@ std::vector<std::shared_ptr<SerialCommand>> KoradSCPI::prepareStatusCommands()
     }
     return comVec;
 }
+
+std::shared_ptr<SerialCommand> KoradSCPI::prepareOutputCommand(
+    ATTR_UNUSED int channel, bool status)
+{
+    // channel 0 like in setOutput, there is only one output switch
+    return std::make_shared<SerialCommand>(
+        static_cast<int>(powcon::COMMANDS::SETOUT), 0,
+        QVariant(status ? 1 : 0));
+}
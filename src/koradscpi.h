@@ -127,6 +127,8 @@ private:
     QByteArray prepareCommandByteArray(
         const std::shared_ptr<SerialCommand> &com);
     std::vector<std::shared_ptr<SerialCommand>> prepareStatusCommands();
+    std::shared_ptr<SerialCommand> prepareOutputCommand(int channel,
+                                                        bool status);
     void processCommands(const std::shared_ptr<PowerSupplyStatus> &status,
                          const std::shared_ptr<SerialCommand> &com);
     void updateNewPStatus(const std::shared_ptr<PowerSupplyStatus> &status);
@@ -23,19 +23,76 @@ namespace setdef = settings_default;
 namespace powstatus = PowerSupplyStatus_constants;
 namespace powcon = PowerSupplySCPI_constants;
 namespace globcon = global_constants;
+namespace flushcon = record_flush_constants;
 
 LabPowerController::LabPowerController(std::shared_ptr<LabPowerModel> appModel)
-    : QObject(), applicationModel(std::move(appModel))
+    : QObject(), applicationModel(std::move(appModel)), nextScriptID(1)
 {
     this->powerSupplyConnector = nullptr;
     this->powerSupplyStatusUpdater = nullptr;
     this->dbConnector = std::unique_ptr<DBConnector>(new DBConnector());
+    this->dbMaintenance = std::unique_ptr<DBMaintenance>(new DBMaintenance());
+    QObject::connect(this->dbMaintenance.get(),
+                     &DBMaintenance::recordingsDeleted, this,
+                     &LabPowerController::recordingsDeleted);
+    QObject::connect(this->dbMaintenance.get(),
+                     &DBMaintenance::databaseCompacted, this,
+                     &LabPowerController::databaseCompacted);
+    QObject::connect(this->dbMaintenance.get(),
+                     &DBMaintenance::maintenanceFailed, this,
+                     &LabPowerController::maintenanceFailed);
+    this->binaryRecorder =
+        std::unique_ptr<BinaryRecorder>(new BinaryRecorder());
+    this->recordFlushTimer = std::unique_ptr<QTimer>(new QTimer());
+    this->recordFlushTimer->setInterval(1000);
+    QObject::connect(this->recordFlushTimer.get(), &QTimer::timeout,
+                     [this]() { this->checkRecordBuffer(); });
+    this->setpointSink = [this](int channel, globcon::LPQ_DATATYPE target,
+                                double value) {
+        this->sendSetpoint(channel, target, value);
+    };
+    this->outputSink = [this](int channel, bool status) {
+        this->sendOutput(channel, status);
+    };
+    this->sequenceEngine =
+        std::unique_ptr<SequenceEngine>(new SequenceEngine(this->setpointSink));
+    QObject::connect(this->sequenceEngine.get(),
+                     &SequenceEngine::stepExecuted, this,
+                     &LabPowerController::sequenceStepExecuted);
+    QObject::connect(this->sequenceEngine.get(), &SequenceEngine::finished,
+                     this, &LabPowerController::sequenceFinished);
+    this->recordingReplay = std::unique_ptr<RecordingReplay>(
+        new RecordingReplay(this->setpointSink, this->outputSink));
+    QObject::connect(this->recordingReplay.get(), &RecordingReplay::progress,
+                     this, &LabPowerController::replayProgress);
+    QObject::connect(this->recordingReplay.get(), &RecordingReplay::finished,
+                     this, &LabPowerController::replayFinished);
+    QObject::connect(&this->discovery, &DeviceDiscovery::finished, this,
+                     &LabPowerController::deviceDiscoveryFinished);
+    QObject::connect(&this->reconnectSupervisor, &ReconnectSupervisor::attempt,
+                     [this](int number) {
+                         if (!this->powerSupplyConnector)
+                             return;
+                         LogInstance::get_instance().eal_debug(
+                             "Reconnect attempt " + std::to_string(number));
+                         // reconnect has to run on the worker thread
+                         QMetaObject::invokeMethod(
+                             this->powerSupplyConnector.get(), "reconnect",
+                             Qt::QueuedConnection);
+                     });
     // this->connectDevice();
 }
 
-LabPowerController::~LabPowerController() { this->disconnectDevice(); }
+LabPowerController::~LabPowerController()
+{
+    this->stopTimedControl();
+    this->disconnectDevice();
+}
+
 void LabPowerController::connectDevice()
 {
+    // a running discovery might hold the port open
+    this->discovery.wait();
     QSettings settings;
     settings.beginGroup(setcon::DEVICE_GROUP);
     settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
@@ -56,6 +113,8 @@ void LabPowerController::connectDevice()
         int portTimeOut = settings.value(setcon::DEVICE_PORT_TIMEOUT).toInt();
         if (!this->powerSupplyConnector ||
             this->powerSupplyConnector->getDeviceHash() != deviceHash) {
+            this->stopTimedControl();
+            this->firstReadingTimer.start();
             if (settings.value(setcon::DEVICE_PROTOCOL).toInt() ==
                 static_cast<int>(globcon::LPQ_PROTOCOL::KORADV2)) {
                 this->powerSupplyConnector =
@@ -72,6 +131,12 @@ void LabPowerController::connectDevice()
             QObject::connect(this->powerSupplyConnector.get(),
                              &PowerSupplySCPI::errorReadWrite, this,
                              &LabPowerController::deviceReadWriteError);
+            QObject::connect(this->powerSupplyConnector.get(),
+                             &PowerSupplySCPI::connectionLost, this,
+                             &LabPowerController::deviceLinkLost);
+            QObject::connect(this->powerSupplyConnector.get(),
+                             &PowerSupplySCPI::reconnectFailed, this,
+                             &LabPowerController::deviceReconnectFailed);
             QObject::connect(this->powerSupplyConnector.get(),
                              &PowerSupplySCPI::deviceOpen, this,
                              &LabPowerController::deviceConnected);
@@ -82,6 +147,13 @@ void LabPowerController::connectDevice()
             QObject::connect(this->powerSupplyConnector.get(),
                              &PowerSupplySCPI::statusReady, this,
                              &LabPowerController::receiveStatus);
+            QObject::connect(this->powerSupplyConnector.get(),
+                             &PowerSupplySCPI::controlLoopFinished, this,
+                             &LabPowerController::controlLoopFinished);
+            QObject::connect(this->powerSupplyConnector.get(),
+                             &PowerSupplySCPI::watchdogTripped, this,
+                             &LabPowerController::receiveWatchdogTrip);
+            this->powerSupplyConnector->setWatchdogRules(this->watchdogRules);
 
             this->powerSupplyWorkerThread =
                 std::unique_ptr<QThread>(new QThread());
@@ -93,10 +165,10 @@ void LabPowerController::connectDevice()
                                  LogInstance::get_instance().eal_debug(
                                      "Background Thread Finished Signal");
                              });
-            QObject::connect(
-                this->powerSupplyConnector.get(),
-                &PowerSupplySCPI::backgroundThreadStopped,
-                [this]() { this->powerSupplyWorkerThread->quit(); });
+            QObject::connect(this->powerSupplyConnector.get(),
+                             &PowerSupplySCPI::backgroundThreadStopped,
+                             this->powerSupplyWorkerThread.get(),
+                             &QThread::quit, Qt::DirectConnection);
             QObject::connect(this->powerSupplyWorkerThread.get(),
                              &QThread::started, this->powerSupplyConnector.get(),
                              &PowerSupplySCPI::startPowerSupplyBackgroundThread);
@@ -112,29 +184,55 @@ void LabPowerController::disconnectDevice()
     if (this->powerSupplyStatusUpdater)
         this->powerSupplyStatusUpdater->stop();
     if (this->powerSupplyConnector) {
+        this->stopTimedControl();
         this->powerSupplyConnector->stopPowerSupplyBackgroundThread();
+        this->reconnectSupervisor.stop();
+        // A worker that already left its loop (link lost, port not opened)
+        // idles in the thread's event loop and never sees the stop command.
+        // The queued reconnect sees the stop request and ends the thread
+        // there. A worker still in its loop ends the thread before that.
+        QMetaObject::invokeMethod(this->powerSupplyConnector.get(),
+                                  "reconnect", Qt::QueuedConnection);
         if (!this->powerSupplyWorkerThread->wait(3000)) {
+            // the worker still uses the connector, both are released once
+            // the thread has finished
             LogInstance::get_instance().eal_warn(
-                "Thread Timeout. Will terminate.");
-            // TODO: Maybe we should connect a signal to this to notify the user
-            // TODO: Why is terminating the thread commented out?
-            // this->powerSupplyWorkerThread->terminate();
+                "Thread Timeout. Worker is released when it finishes.");
+            QObject::disconnect(this->powerSupplyConnector.get(), nullptr,
+                                this, nullptr);
+            QThread *thread = this->powerSupplyWorkerThread.release();
+            QObject::connect(thread, &QThread::finished,
+                             this->powerSupplyConnector.release(),
+                             &QObject::deleteLater);
+            QObject::connect(thread, &QThread::finished, thread,
+                             &QObject::deleteLater);
         }
         this->powerSupplyConnector.reset(nullptr);
+        this->powerSupplyWorkerThread.reset(nullptr);
         this->applicationModel->setDeviceConnected(false);
     }
 }
 
+void LabPowerController::reattachDevice()
+{
+    if (this->powerSupplyConnector || this->discovery.isRunning())
+        return;
+    QSettings settings;
+    settings.beginGroup(setcon::DEVICE_GROUP);
+    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
+    // devices added with older versions have no identification
+    if (!settings.contains(setcon::DEVICE_PORT) ||
+        settings.value(setcon::DEVICE_IDENTIFICATION).toString().isEmpty())
+        return;
+    this->discovery.start({settings.value(setcon::DEVICE_PORT_BRATE).toInt()});
+}
+
 void LabPowerController::deviceError(const QString &errorString)
 {
     LogInstance::get_instance().eal_error("Could not open device: " +
                                           errorString.toStdString());
     this->disconnectDevice();
-    QMessageBox box;
-    box.setIcon(QMessageBox::Icon::Critical);
-    box.setText("Could not open Device");
-    box.setInformativeText("Error: " + errorString);
-    box.exec();
+    emit this->deviceOpenFailed(errorString);
 }
 
 void LabPowerController::deviceConnected()
@@ -142,6 +240,17 @@ void LabPowerController::deviceConnected()
     // Tell the model we are connected
     this->applicationModel->setDeviceConnected(true);
 
+    if (this->reconnectSupervisor.isActive()) {
+        int attempts = this->reconnectSupervisor.getAttempts();
+        qint64 downtime = this->reconnectSupervisor.reconnected();
+        PerfMetrics::get_instance().sample("device.downtime.ms",
+                                           static_cast<double>(downtime));
+        LogInstance::get_instance().eal_warn(
+            "Reconnected to device after " + std::to_string(downtime) +
+            "ms and " + std::to_string(attempts) + " attempt(s)");
+        emit this->connectionRestored(downtime, attempts);
+    }
+
     // Check identification
     this->getIdentification();
 
@@ -168,7 +277,28 @@ void LabPowerController::deviceConnected()
 void LabPowerController::deviceReadWriteError(
     ATTR_UNUSED const QString &errorString)
 {
-    // TODO: This must be propagated to the GUI and the Model
+    // the connector logs the error and reports a lost connection on its own
+    PerfMetrics::get_instance().count("device.readwrite.errors");
+}
+
+void LabPowerController::deviceLinkLost(const QString &errorString)
+{
+    if (this->powerSupplyStatusUpdater)
+        this->powerSupplyStatusUpdater->stop();
+    // setpoints queued while the link is down would hit the device in one
+    // burst after the reconnect
+    this->stopTimedControl();
+    this->applicationModel->setDeviceConnected(false);
+    PerfMetrics::get_instance().count("device.connection.lost");
+    this->reconnectSupervisor.connectionLost();
+    emit this->connectionLost(errorString);
+}
+
+void LabPowerController::deviceReconnectFailed(const QString &errorString)
+{
+    LogInstance::get_instance().eal_debug("Reconnect failed: " +
+                                          errorString.toStdString());
+    this->reconnectSupervisor.attemptFailed();
 }
 
 void LabPowerController::setVoltage(int channel, double value)
@@ -256,39 +386,308 @@ void LabPowerController::receiveData(std::shared_ptr<SerialCommand> com)
 
 void LabPowerController::receiveStatus(std::shared_ptr<PowerSupplyStatus> status)
 {
+    if (this->firstReadingTimer.isValid()) {
+        PerfMetrics::get_instance().sample(
+            "device.first.reading.ms",
+            static_cast<double>(this->firstReadingTimer.elapsed()));
+        this->firstReadingTimer.invalidate();
+    }
     this->applicationModel->updatePowerSupplyStatus(status);
+    this->scriptHub.publish(status);
 
     // TODO: Wouldn't it be better to let the model signal the DBConnector to
     // fetch the buffer and write them to the database? Why has the controlller
     // to do this?
     if (this->applicationModel->getRecord()) {
-        QSettings settings;
-        settings.beginGroup(setcon::RECORD_GROUP);
-        if (this->applicationModel->getBufferSize() >=
-            settings
-                .value(setcon::RECORD_BUFFER,
-                       setdef::general_defaults.at(setcon::RECORD_BUFFER))
-                .toInt()) {
-            this->dbConnector->insertMeasurement(
-                this->applicationModel->getBuffer());
-            this->applicationModel->clearBuffer();
-        }
+        this->checkRecordBuffer();
     }
     std::stringstream ss;
     ss << status;
     LogInstance::get_instance().eal_debug(ss.str());
 }
 
+void LabPowerController::receiveWatchdogTrip(WatchdogTrip trip)
+{
+    // neither of them must switch the output on again
+    this->stopTimedControl();
+    this->dbConnector->insertWatchdogEvent(trip);
+    emit this->watchdogTripped(trip);
+}
+
 void LabPowerController::toggleRecording(bool status, QString rname)
 {
     this->applicationModel->setRecord(status);
     if (status) {
-        this->dbConnector->startRecording(std::move(rname));
+        QSettings settings;
+        settings.beginGroup(setcon::RECORD_GROUP);
+        this->flushPolicy.setMaxSamples(
+            settings
+                .value(setcon::RECORD_BUFFER,
+                       setdef::general_defaults.at(setcon::RECORD_BUFFER))
+                .toInt());
+        this->flushPolicy.setMaxAge(std::chrono::seconds(
+            settings
+                .value(setcon::RECORD_BUFFER_AGE,
+                       setdef::general_defaults.at(setcon::RECORD_BUFFER_AGE))
+                .toInt()));
+        this->recordFlushTimer->start();
+        if (settings
+                .value(setcon::RECORD_BACKEND,
+                       setdef::general_defaults.at(setcon::RECORD_BACKEND))
+                .toInt() ==
+            static_cast<int>(globcon::LPQ_RECORD_BACKEND::BINARY)) {
+            this->startBinaryRecording(std::move(rname));
+        } else {
+            this->dbConnector->startRecording(std::move(rname));
+        }
+        // the retention policies must not delete the active recording
+        this->dbMaintenance->setActiveRecording(
+            this->dbConnector->getRecordingID());
     } else {
         // make sure to write all remaining measurements to the database
-        this->dbConnector->insertMeasurement(
-            this->applicationModel->getBuffer());
-        this->applicationModel->clearBuffer();
+        this->recordFlushTimer->stop();
+        this->flushRecordBuffer(flushcon::FLUSH_REASON::STOP);
+        this->binaryRecorder->close();
         this->dbConnector->stopRecording();
+        this->dbMaintenance->setActiveRecording(-1);
+    }
+}
+
+void LabPowerController::startSequence(std::vector<SequenceStep> steps)
+{
+    if (!this->powerSupplyConnector) {
+        LogInstance::get_instance().eal_warn(
+            "Can not start sequence without a connected device");
+        emit this->sequenceFinished(true);
+        return;
+    }
+    this->recordingReplay->stop();
+    this->sequenceEngine->start(std::move(steps));
+}
+
+void LabPowerController::stopSequence() { this->sequenceEngine->stop(); }
+void LabPowerController::startReplay(long long recID, QString dataFile,
+                                     int channels, double timeScale)
+{
+    if (!this->powerSupplyConnector) {
+        LogInstance::get_instance().eal_warn(
+            "Can not replay a recording without a connected device");
+        emit this->replayFinished(true);
+        return;
+    }
+    this->sequenceEngine->stop();
+    this->recordingReplay->start(QSqlDatabase::database().databaseName(),
+                                 recID, std::move(dataFile), channels,
+                                 timeScale);
+}
+
+void LabPowerController::stopReplay() { this->recordingReplay->stop(); }
+
+void LabPowerController::deleteRecordings(std::vector<long long> recIDs)
+{
+    this->dbMaintenance->deleteRecordings(std::move(recIDs));
+}
+
+void LabPowerController::compactDatabase()
+{
+    this->dbMaintenance->compactDatabase();
+}
+
+void LabPowerController::setControlMode(int channel, ControlConfig config)
+{
+    if (!this->powerSupplyConnector) {
+        LogInstance::get_instance().eal_warn(
+            "Can not start a control mode without a connected device");
+        if (config.mode != control_constants::CONTROL_MODE::OFF)
+            emit this->controlLoopFinished(channel);
+        return;
+    }
+    if (config.mode != control_constants::CONTROL_MODE::OFF)
+        this->stopTimedControl();
+    this->powerSupplyConnector->setControlMode(channel, config);
+}
+
+void LabPowerController::setWatchdogRules(std::vector<WatchdogRule> rules)
+{
+    this->watchdogRules = std::move(rules);
+    if (this->powerSupplyConnector)
+        this->powerSupplyConnector->setWatchdogRules(this->watchdogRules);
+}
+
+int LabPowerController::runScript(QString name, QString program)
+{
+    int id = this->nextScriptID++;
+    std::unique_ptr<ScriptRunner> runner(new ScriptRunner(
+        id, this->scriptHub, this->setpointSink, this->outputSink));
+    QObject::connect(runner.get(), &ScriptRunner::output, this,
+                     &LabPowerController::scriptOutput);
+    QObject::connect(runner.get(), &ScriptRunner::recordingRequested, this,
+                     &LabPowerController::scriptRecordingRequested);
+    QObject::connect(runner.get(), &ScriptRunner::finished, this,
+                     [this](int id, bool success, QString message) {
+                         // joins the finished thread
+                         this->scriptRunners.erase(id);
+                         emit this->scriptFinished(id, success,
+                                                   std::move(message));
+                     });
+    runner->start(std::move(name), std::move(program));
+    this->scriptRunners[id] = std::move(runner);
+    return id;
+}
+
+void LabPowerController::stopScripts()
+{
+    // ask all first so they end in parallel and not one after another
+    for (auto &runner : this->scriptRunners) {
+        runner.second->requestStop();
+    }
+    this->scriptRunners.clear();
+}
+
+void LabPowerController::sendSetpoint(int channel,
+                                      globcon::LPQ_DATATYPE target,
+                                      double value)
+{
+    if (!this->powerSupplyConnector)
+        return;
+    if (target == globcon::LPQ_DATATYPE::SETCURRENT) {
+        this->powerSupplyConnector->setCurrent(channel, value);
+    } else {
+        this->powerSupplyConnector->setVoltage(channel, value);
+    }
+}
+
+void LabPowerController::sendOutput(int channel, bool status)
+{
+    if (this->powerSupplyConnector)
+        this->powerSupplyConnector->setOutput(channel, status);
+}
+
+void LabPowerController::stopTimedControl()
+{
+    this->sequenceEngine->stop();
+    this->recordingReplay->stop();
+    this->stopScripts();
+}
+
+void LabPowerController::startBinaryRecording(QString rname)
+{
+    QSettings settings;
+    settings.beginGroup(setcon::DEVICE_GROUP);
+    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
+    // binary recordings are stored in a sub directory next to the database
+    QString dataFile = BinaryRecorder::newRecordingFile(
+        QFileInfo(QSqlDatabase::database().databaseName()).absolutePath());
+    if (this->binaryRecorder->open(
+            dataFile, settings.value(setcon::DEVICE_CHANNELS).toInt(),
+            settings.value(setcon::DEVICE_VOLTAGE_ACCURACY).toInt(),
+            settings.value(setcon::DEVICE_CURRENT_ACCURACY).toInt())) {
+        this->dbConnector->startRecording(std::move(rname), dataFile);
+    } else {
+        LogInstance::get_instance().eal_warn(
+            "Can not create binary recording, using the database instead");
+        this->dbConnector->startRecording(std::move(rname));
+    }
+}
+
+void LabPowerController::checkRecordBuffer()
+{
+    flushcon::FLUSH_REASON reason =
+        this->flushPolicy.check(this->applicationModel->getBufferSize(),
+                                this->applicationModel->getBufferAge());
+    if (reason != flushcon::FLUSH_REASON::NONE)
+        this->flushRecordBuffer(reason);
+}
+
+void LabPowerController::flushRecordBuffer(flushcon::FLUSH_REASON reason)
+{
+    std::chrono::milliseconds age = this->applicationModel->getBufferAge();
+    std::vector<std::shared_ptr<PowerSupplyStatus>> buffer =
+        this->applicationModel->takeBuffer();
+    if (buffer.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    // one transaction and therefore one commit per flush
+    this->dbConnector->beginTransaction();
+    if (this->binaryRecorder->isOpen()) {
+        this->binaryRecorder->append(buffer);
+    } else {
+        this->dbConnector->insertMeasurement(buffer);
+    }
+    // a failed rollup does not keep the statistics from being stored
+    this->dbConnector->updateRollups(buffer);
+    this->dbConnector->updateStatistics(buffer);
+    this->dbConnector->storeStatistics();
+    this->dbConnector->commitTransaction();
+    double durationMs = std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    this->flushPolicy.flushed(static_cast<int>(buffer.size()), durationMs);
+
+    PerfMetrics &metrics = PerfMetrics::get_instance();
+    metrics.sample("record.flush.ms", durationMs);
+    metrics.sample("record.flush.samples", static_cast<double>(buffer.size()));
+    metrics.sample("record.flush.age_ms", static_cast<double>(age.count()));
+    metrics.sample("record.buffer.limit", this->flushPolicy.getSampleLimit());
+    std::string reasonName;
+    switch (reason) {
+    case flushcon::FLUSH_REASON::COUNT:
+        reasonName = "count";
+        break;
+    case flushcon::FLUSH_REASON::AGE:
+        reasonName = "age";
+        break;
+    case flushcon::FLUSH_REASON::STOP:
+        reasonName = "stop";
+        break;
+    default:
+        reasonName = "none";
+        break;
+    }
+    metrics.count("record.flush.reason." + reasonName);
+    LogInstance::get_instance().eal_debug(
+        "Flushed " + std::to_string(buffer.size()) + " measurements (" +
+        reasonName + ") in " + std::to_string(durationMs) +
+        "ms, new buffer limit " +
+        std::to_string(this->flushPolicy.getSampleLimit()));
+}
+
+void LabPowerController::deviceDiscoveryFinished(
+    std::vector<DiscoveredDevice> devices, qint64 duration)
+{
+    ealogger::Logger &log = LogInstance::get_instance();
+    QSettings settings;
+    settings.beginGroup(setcon::DEVICE_GROUP);
+    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
+    QString port = settings.value(setcon::DEVICE_PORT).toString();
+    QString identification =
+        settings.value(setcon::DEVICE_IDENTIFICATION).toString();
+    std::vector<DiscoveredDevice> candidates;
+    for (const DiscoveredDevice &dev : devices) {
+        if (dev.identification != identification)
+            continue;
+        // still where we left it
+        if (dev.port == port)
+            return;
+        candidates.push_back(dev);
+    }
+    if (candidates.empty()) {
+        log.eal_warn("Device " + identification.toStdString() +
+                     " not found on any port (" + std::to_string(duration) +
+                     "ms)");
+        return;
+    }
+    if (candidates.size() > 1) {
+        // several devices of the same model, we can not tell which one it is
+        log.eal_warn("Device " + identification.toStdString() + " found on " +
+                     std::to_string(candidates.size()) +
+                     " ports, keeping port " + port.toStdString());
+        return;
     }
+    settings.setValue(setcon::DEVICE_PORT, candidates.front().port);
+    log.eal_info("Device " + identification.toStdString() + " moved from " +
+                 port.toStdString() + " to " +
+                 candidates.front().port.toStdString());
+    emit this->deviceReattached(port, candidates.front().port);
 }
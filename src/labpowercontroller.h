@@ -1,11 +1,12 @@
 #ifndef LABPOWERCONTROLLER_H
 #define LABPOWERCONTROLLER_H
 
+#include <map>
 #include <memory>
 #include <sstream>
 
 #include <QByteArray>
-#include <QMessageBox>
+#include <QElapsedTimer>
 #include <QObject>
 #include <QSettings>
 #include <QString>
@@ -21,8 +22,19 @@
 #include "powersupplystatus.h"
 #include "serialcommand.h"
 
+#include "binaryrecorder.h"
+#include "controlloop.h"
 #include "dbconnector.h"
+#include "dbmaintenance.h"
+#include "devicediscovery.h"
 #include "labpowermodel.h"
+#include "perfmetrics.h"
+#include "reconnectsupervisor.h"
+#include "recordflushpolicy.h"
+#include "recordingreplay.h"
+#include "safetywatchdog.h"
+#include "scriptrunner.h"
+#include "sequenceengine.h"
 
 /**
  * @brief The controller class of labpowerqt
@@ -33,7 +45,8 @@
  * Object of type PowerSupplySCPI. The status is send to the model which will
  * in turn notify the GUI so the GUI can be updated. If the record option is on
  * the controller will also use a Database connector object to write the
- * Measurement Buffer to a SQLite Database
+ * Measurement Buffer to a SQLite Database or a BinaryRecorder to write them to
+ * a binary recording file.
  */
 class LabPowerController : public QObject
 {
@@ -47,16 +60,100 @@ public:
     ~LabPowerController();
 
 signals:
+    /**
+     * @brief Recordings have been deleted by the user or the retention
+     * policies
+     */
+    void recordingsDeleted();
+    void databaseCompacted();
+    /**
+     * @brief A delete or compaction requested by the user failed
+     */
+    void maintenanceFailed(QString errorString);
+    /**
+     * @brief A step of the running sequence was executed, see SequenceEngine
+     */
+    void sequenceStepExecuted(int step, qint64 elapsed, qint64 jitter);
+    void sequenceFinished(bool aborted);
+    /**
+     * @brief Replay position, see RecordingReplay
+     */
+    void replayProgress(qint64 position, qint64 jitter);
+    void replayFinished(bool aborted);
+    /**
+     * @brief The control loop of channel has ended, see ControlLoop
+     */
+    void controlLoopFinished(int channel);
+    /**
+     * @brief A watchdog rule tripped, the event has been stored already
+     */
+    void watchdogTripped(WatchdogTrip trip);
+    /**
+     * @brief Output of a script, see ScriptRunner
+     */
+    void scriptOutput(int id, QString message);
+    void scriptFinished(int id, bool success, QString message);
+    /**
+     * @brief A script wants to start or stop a recording
+     */
+    void scriptRecordingRequested(bool status, QString name);
+    /**
+     * @brief The active device was found on another port
+     *
+     * @details
+     *
+     * The port of the device settings has been updated already.
+     */
+    void deviceReattached(QString oldPort, QString newPort);
+    /**
+     * @brief The device stopped answering, reconnect attempts have started
+     */
+    void connectionLost(QString errorString);
+    /**
+     * @brief The device answers again after connectionLost
+     *
+     * @param downtime ms without connection
+     * @param attempts Number of reconnect attempts
+     */
+    void connectionRestored(qint64 downtime, int attempts);
+    /**
+     * @brief The port of the device could not be opened
+     */
+    void deviceOpenFailed(QString errorString);
 
 public slots:
     // Device connection
     void connectDevice();
     void disconnectDevice();
+    /**
+     * @brief Look for the active device if its port has changed
+     *
+     * @details
+     *
+     * Serial port names depend on the order in which adapters are plugged in.
+     * All ports are probed in the background with the baud rate of the
+     * device. If the configured port does not answer with the identification
+     * stored by the device wizard but exactly one other port does, the port
+     * of the device is changed. Must be called while no device is connected.
+     */
+    void reattachDevice();
 
     // Implement the Power Supply Interface
     void deviceError(const QString &errorString);
     void deviceConnected();
     void deviceReadWriteError(const QString &errorString);
+    /**
+     * @brief The connector closed the port after repeated errors
+     *
+     * @details
+     *
+     * Polling is paused and the ReconnectSupervisor reopens the port with
+     * exponential backoff. A recording keeps running, once the device is back
+     * the setpoints are read again and the measurements continue in the same
+     * recording.
+     */
+    void deviceLinkLost(const QString &errorString);
+    void deviceReconnectFailed(const QString &errorString);
     void setVoltage(int channel, double value);
     void setCurrent(int channel, double value);
     void setOutput(int channel, bool status);
@@ -78,6 +175,15 @@ public slots:
      * @param status
      */
     void receiveStatus(std::shared_ptr<PowerSupplyStatus> status);
+    /**
+     * @brief Receive a trip of the watchdog running on the device thread
+     *
+     * @details
+     *
+     * The output is already off. Sequence and replay are stopped and the
+     * event is stored in the database.
+     */
+    void receiveWatchdogTrip(WatchdogTrip trip);
 
     /**
      * @brief Star stop recording of Measurements
@@ -87,13 +193,138 @@ public slots:
      */
     void toggleRecording(bool status, QString rname);
 
+    /**
+     * @brief Run a sequence of setpoints on the timing thread
+     */
+    void startSequence(std::vector<SequenceStep> steps);
+    void stopSequence();
+    /**
+     * @brief Replay the setpoints of a recording onto the device
+     *
+     * @details
+     *
+     * A running sequence is stopped, both would fight over the setpoints.
+     */
+    void startReplay(long long recID, QString dataFile, int channels,
+                     double timeScale);
+    void stopReplay();
+    /**
+     * @brief Delete recordings in the background, see DBMaintenance
+     *
+     * @details
+     *
+     * The active recording is refused.
+     */
+    void deleteRecordings(std::vector<long long> recIDs);
+    /**
+     * @brief Compact the database in the background, refused while recording
+     */
+    void compactDatabase();
+    /**
+     * @brief Run a closed loop control mode on the device worker
+     *
+     * @details
+     *
+     * Sequence and replay are stopped when a control mode is started.
+     */
+    void setControlMode(int channel, ControlConfig config);
+    /**
+     * @brief Set the watchdog rules, also used for devices connected later
+     */
+    void setWatchdogRules(std::vector<WatchdogRule> rules);
+    /**
+     * @brief Run a script on its own thread
+     *
+     * @details
+     *
+     * Any number of scripts can run at the same time.
+     *
+     * @return ID of the script used in scriptOutput and scriptFinished
+     */
+    int runScript(QString name, QString program);
+    void stopScripts();
+
 private:
     std::unique_ptr<PowerSupplySCPI> powerSupplyConnector;
     std::shared_ptr<LabPowerModel> applicationModel;
     std::unique_ptr<DBConnector> dbConnector;
+    std::unique_ptr<DBMaintenance> dbMaintenance;
+    std::unique_ptr<BinaryRecorder> binaryRecorder;
+    /**
+     * @brief Shared by sequence, replay and scripts, see sendSetpoint
+     */
+    SequenceEngine::SetpointSink setpointSink;
+    RecordingReplay::OutputSink outputSink;
+    std::unique_ptr<SequenceEngine> sequenceEngine;
+    std::unique_ptr<RecordingReplay> recordingReplay;
+    ScriptStatusHub scriptHub;
+    std::map<int, std::unique_ptr<ScriptRunner>> scriptRunners;
+    int nextScriptID;
+    RecordFlushPolicy flushPolicy;
+    std::vector<WatchdogRule> watchdogRules;
+    DeviceDiscovery discovery;
+    ReconnectSupervisor reconnectSupervisor;
+    /**
+     * @brief Time from connectDevice to the first status of the device
+     */
+    QElapsedTimer firstReadingTimer;
+    /**
+     * @brief Checks the buffer age if no status objects arrive
+     */
+    std::unique_ptr<QTimer> recordFlushTimer;
 
     std::unique_ptr<QTimer> powerSupplyStatusUpdater;
     std::unique_ptr<QThread> powerSupplyWorkerThread;
+
+    /**
+     * @brief Start a recording using the binary recording backend
+     *
+     * @param rname Recording name
+     *
+     * @details
+     *
+     * Falls back to the database if the binary file can not be created.
+     */
+    void startBinaryRecording(QString rname);
+    /**
+     * @brief Hand a setpoint to the device from any thread
+     *
+     * @details
+     *
+     * Used by SequenceEngine, RecordingReplay and scripts on their threads. The
+     * connector only queues the command, the device worker applies the
+     * setpoint to its status when it is sent. The connector is only replaced
+     * or destroyed after all of them were stopped.
+     */
+    void sendSetpoint(int channel, global_constants::LPQ_DATATYPE target,
+                      double value);
+    /**
+     * @brief Hand an output change to the device from any thread
+     *
+     * @details
+     *
+     * Queued like sendSetpoint, used by RecordingReplay and scripts.
+     */
+    void sendOutput(int channel, bool status);
+    /**
+     * @brief Stop sequence, replay and scripts
+     */
+    void stopTimedControl();
+    /**
+     * @brief Flush the measurement buffer if the flush policy demands it
+     */
+    void checkRecordBuffer();
+    /**
+     * @brief Write the measurement buffer of the model to the active backend
+     *
+     * @param reason Why the buffer is flushed, used for the metrics
+     */
+    void flushRecordBuffer(record_flush_constants::FLUSH_REASON reason);
+    /**
+     * @brief Update the port of the active device, see reattachDevice
+     */
+    void deviceDiscoveryFinished(std::vector<DiscoveredDevice> devices,
+                                 qint64 duration);
 };
 
 #endif  // LABPOWERCONTROLLER_H
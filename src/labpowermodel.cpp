@@ -16,8 +16,11 @@
 
 #include "labpowermodel.h"
 
+#include <stdexcept>
 #include <utility>
 
+namespace globcon = global_constants;
+
 LabPowerModel::LabPowerModel() : QObject()
 {
     this->status = std::make_shared<PowerSupplyStatus>();
@@ -68,6 +71,11 @@ std::chrono::system_clock::time_point LabPowerModel::getTime()
     return this->status->getTime();
 }
 
+std::shared_ptr<PowerSupplyStatus> LabPowerModel::getStatus()
+{
+    return this->status;
+}
+
 void LabPowerModel::setVoltageSet(global_constants::LPQ_CHANNEL c, double val)
 {
     this->status->setVoltageSet(std::make_pair(static_cast<int>(c), val));
@@ -110,9 +118,13 @@ bool LabPowerModel::getOCP() { return this->status->getOcp(); }
 void LabPowerModel::setOTP(bool status) { this->status->setOtp(status); }
 bool LabPowerModel::getOTP() { return this->status->getOtp(); }
 long long LabPowerModel::getDuration() { return this->status->getDuration(); }
-std::vector<std::shared_ptr<PowerSupplyStatus>> LabPowerModel::getBuffer()
+std::vector<std::shared_ptr<PowerSupplyStatus>> LabPowerModel::takeBuffer()
 {
-    return this->statusBuffer;
+    std::vector<std::shared_ptr<PowerSupplyStatus>> buffer;
+    buffer.swap(this->statusBuffer);
+    // the next buffer will most likely need the same capacity
+    this->statusBuffer.reserve(buffer.size());
+    return buffer;
 }
 
 int LabPowerModel::getBufferSize()
@@ -120,15 +132,119 @@ int LabPowerModel::getBufferSize()
     return static_cast<int>(this->statusBuffer.size());
 }
 
+std::chrono::milliseconds LabPowerModel::getBufferAge()
+{
+    if (this->statusBuffer.empty())
+        return std::chrono::milliseconds(0);
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - this->bufferStart);
+}
+
 bool LabPowerModel::getRecord() { return this->record; }
-void LabPowerModel::setRecord(bool status) { this->record = status; }
+void LabPowerModel::setRecord(bool status)
+{
+    if (status && !this->record)
+        this->resetStatistics();
+    this->record = status;
+}
+
+const ChannelStatistics &
+LabPowerModel::getStatistics(global_constants::LPQ_CHANNEL c)
+{
+    return this->statistics.at(static_cast<size_t>(c) - 1);
+}
+
+void LabPowerModel::resetStatistics()
+{
+    for (auto &stats : this->statistics) {
+        stats.reset();
+    }
+}
+
 void LabPowerModel::updatePowerSupplyStatus(
     std::shared_ptr<PowerSupplyStatus> status)
 {
     this->status = std::move(status);
-    if (this->record)
+    int channels = SettingsCache::get_instance().snapshot().deviceChannels;
+    if (this->statistics.size() != static_cast<size_t>(channels))
+        this->statistics.assign(static_cast<size_t>(channels),
+                                ChannelStatistics());
+    for (int i = 1; i <= channels; i++) {
+        this->statistics[static_cast<size_t>(i) - 1].add(this->status, i);
+    }
+    if (this->record) {
+        if (this->statusBuffer.empty())
+            this->bufferStart = std::chrono::steady_clock::now();
         this->statusBuffer.push_back(this->status);
+    }
+    this->emitChanges(channels);
     emit this->statusUpdate();
 }
 
 void LabPowerModel::clearBuffer() { this->statusBuffer.clear(); }
+void LabPowerModel::resetChanges()
+{
+    this->snapshots.clear();
+    this->protections.clear();
+}
+
+void LabPowerModel::emitChanges(int channels)
+{
+    using Getter = double (PowerSupplyStatus::*)(int);
+    static const std::vector<std::pair<globcon::LPQ_DATATYPE, Getter>> getters =
+        {{globcon::LPQ_DATATYPE::SETVOLTAGE, &PowerSupplyStatus::getVoltageSet},
+         {globcon::LPQ_DATATYPE::VOLTAGE, &PowerSupplyStatus::getVoltage},
+         {globcon::LPQ_DATATYPE::SETCURRENT, &PowerSupplyStatus::getCurrentSet},
+         {globcon::LPQ_DATATYPE::CURRENT, &PowerSupplyStatus::getCurrent},
+         {globcon::LPQ_DATATYPE::WATTAGE, &PowerSupplyStatus::getWattage}};
+
+    if (this->snapshots.size() != static_cast<size_t>(channels))
+        this->snapshots.assign(static_cast<size_t>(channels),
+                               ChannelSnapshot());
+    PowerSupplyStatus &current = *this->status;
+    for (int i = 1; i <= channels; i++) {
+        ChannelSnapshot &snap = this->snapshots[static_cast<size_t>(i) - 1];
+        for (const auto &getter : getters) {
+            double value = 0;
+            try {
+                value = (current.*getter.second)(i);
+            } catch (const std::out_of_range &) {
+                // not part of this status
+                continue;
+            }
+            auto it = snap.values.find(getter.first);
+            if (it != snap.values.end() && it->second == value)
+                continue;
+            snap.values[getter.first] = value;
+            emit this->valueChanged(i, getter.first, value);
+        }
+        try {
+            int output = current.getChannelOutput(i) ? 1 : 0;
+            if (output != snap.output) {
+                snap.output = output;
+                emit this->outputChanged(i, output == 1);
+            }
+        } catch (const std::out_of_range &) {
+        }
+        try {
+            int mode = static_cast<int>(current.getChannelMode(i));
+            if (mode != snap.mode) {
+                snap.mode = mode;
+                emit this->modeChanged(i, static_cast<globcon::LPQ_MODE>(mode));
+            }
+        } catch (const std::out_of_range &) {
+        }
+    }
+
+    const std::vector<std::pair<globcon::LPQ_CONTROL, bool>> protectionStates =
+        {{globcon::LPQ_CONTROL::OVP, current.getOvp()},
+         {globcon::LPQ_CONTROL::OCP, current.getOcp()},
+         {globcon::LPQ_CONTROL::OTP, current.getOtp()}};
+    for (const auto &state : protectionStates) {
+        auto it = this->protections.find(state.first);
+        if (it != this->protections.end() && it->second == state.second)
+            continue;
+        this->protections[state.first] = state.second;
+        emit this->protectionChanged(state.first, state.second);
+    }
+}
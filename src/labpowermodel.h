@@ -21,12 +21,15 @@
 #include <QString>
 
 #include <chrono>
+#include <map>
 #include <memory>
 #include <vector>
 
+#include "channelstatistics.h"
 #include "global.h"
 #include "log_instance.h"
 #include "powersupplystatus.h"
+#include "settingscache.h"
 
 /**
  * @brief Class that models the state of a lab power supply
@@ -57,6 +60,10 @@ public:
     global_constants::LPQ_MODE getChannelMode(global_constants::LPQ_CHANNEL c);
 
     std::chrono::system_clock::time_point getTime();
+    /**
+     * @brief The most recent status object of the device
+     */
+    std::shared_ptr<PowerSupplyStatus> getStatus();
 
     void setVoltageSet(global_constants::LPQ_CHANNEL c, double val);
     double getVoltageSet(global_constants::LPQ_CHANNEL c);
@@ -75,15 +82,62 @@ public:
 
     long long getDuration();
 
-    std::vector<std::shared_ptr<PowerSupplyStatus>> getBuffer();
+    /**
+     * @brief Hand over the buffered status objects
+     *
+     * @return The buffer, the internal buffer is empty afterwards.
+     *
+     * @details
+     *
+     * The buffer is swapped out so no status objects are copied.
+     */
+    std::vector<std::shared_ptr<PowerSupplyStatus>> takeBuffer();
     int getBufferSize();
+    /**
+     * @brief Time since the oldest status object was added to the buffer
+     */
+    std::chrono::milliseconds getBufferAge();
 
     bool getRecord();
+    /**
+     * @brief Set the record status
+     *
+     * @details
+     *
+     * Starting a recording starts a new run and resets the statistics.
+     */
     void setRecord(bool status);
 
+    /**
+     * @brief Running statistics of a channel since the last reset
+     */
+    const ChannelStatistics &getStatistics(global_constants::LPQ_CHANNEL c);
+    void resetStatistics();
+
 signals:
 
+    /**
+     * @brief Emitted for every status, even if nothing changed
+     */
     void statusUpdate();
+    /**
+     * @brief A set or measured value of channel differs from the one reported
+     * before
+     *
+     * @details
+     *
+     * The change signals are emitted before statusUpdate and only for values
+     * that changed since they were reported the last time. Values the status
+     * does not contain are not reported.
+     */
+    void valueChanged(int channel, global_constants::LPQ_DATATYPE dt,
+                      double value);
+    void outputChanged(int channel, bool status);
+    void modeChanged(int channel, global_constants::LPQ_MODE mode);
+    /**
+     * @brief OVP, OCP or OTP changed
+     */
+    void protectionChanged(global_constants::LPQ_CONTROL ct, bool status);
     void deviceConnectionStatus(bool connected);
     void deviceID();
 
@@ -94,14 +148,41 @@ public slots:
      * @brief Clear interal buffer of PowerSupplyStatus objects
      */
     void clearBuffer();
+    /**
+     * @brief Forget the reported values, the next status reports all of them
+     *
+     * @details
+     *
+     * Needed when the widgets that show the values have been recreated.
+     */
+    void resetChanges();
 
 private:
+    /**
+     * @brief Values of a channel last reported by the change signals
+     */
+    struct ChannelSnapshot {
+        std::map<global_constants::LPQ_DATATYPE, double> values;
+        int output = -1; /**< -1 if not reported yet */
+        int mode = -1;
+    };
+
     std::vector<std::shared_ptr<PowerSupplyStatus>> statusBuffer;
+    std::chrono::steady_clock::time_point bufferStart;
     std::shared_ptr<PowerSupplyStatus> status;
+    std::vector<ChannelStatistics> statistics;
+    std::vector<ChannelSnapshot> snapshots;
+    std::map<global_constants::LPQ_CONTROL, bool> protections;
 
     bool deviceConnected;
     QString deviceIdentification;
     bool record;
+
+    /**
+     * @brief Compare the current status with the snapshots and emit the
+     * change signals
+     */
+    void emitChanges(int channels);
 };
 
 #endif  // LABPOWERMODEL_H
@@ -15,6 +15,8 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
 #include <QDir>
 #include <QFileInfoList>
 #include <QStandardPaths>
@@ -22,15 +24,58 @@
 #include <QTextStream>
 #include <QMessageBox>
 
+#include <algorithm>
+#include <vector>
+
+#include "batchrenderer.h"
+#include "databasedef.h"
 #include "log_instance.h"
 #include "settingsdefinitions.h"
 
 #include "mainwindow.h"
 
+/**
+ * @brief Render recordings to image files and wait until all are done
+ *
+ * @return Exit code of the application
+ */
+static int renderRecordings(QApplication &app, const BatchRenderOptions &opts,
+                            const std::vector<long long> &recIds)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    BatchRenderer renderer(opts);
+    QObject::connect(&renderer, &BatchRenderer::rendered,
+                     [&out, &err](QString outputFile, bool success) {
+                         if (success) {
+                             out << outputFile << endl;
+                         } else {
+                             err << "Could not render " << outputFile << endl;
+                         }
+                     });
+    QObject::connect(&renderer, &BatchRenderer::finished,
+                     [&app](int failed) { app.exit(failed > 0 ? 1 : 0); });
+    if (!renderer.start(recIds)) {
+        err << "No recordings to render" << endl;
+        return 1;
+    }
+    return app.exec();
+}
+
 int main(int argc, char *argv[])
 {
     namespace setcon = settings_constants;
     namespace setdef = settings_default;
+    // The batch rendering mode must work without a display. The platform has
+    // to be chosen before the application object is created.
+    bool renderMode = false;
+    for (int i = 1; i < argc; i++) {
+        if (QString(argv[i]) == "--render")
+            renderMode = true;
+    }
+    if (renderMode && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     QApplication labpowerqt(argc, argv);
 
     // set some informations for this application, especially usefull for
@@ -38,6 +83,45 @@ int main(int argc, char *argv[])
     QCoreApplication::setOrganizationName("crappbytes");
     QCoreApplication::setOrganizationDomain("crappbytes.org");
     QCoreApplication::setApplicationName("labpowerqt");
+    QCoreApplication::setApplicationVersion(
+        QString(LABPOWERQT_VERSION_MAJOR) + "." + LABPOWERQT_VERSION_MINOR +
+        "." + LABPOWERQT_VERSION_PATCH);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        "Control programmable lab power supplies");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption renderOption(
+        "render", "Render recordings to image files without a window and exit");
+    QCommandLineOption recordingOption(
+        {"r", "recording"}, "Recording to render, can be given multiple "
+                            "times. All recordings if omitted.",
+        "id");
+    QCommandLineOption outputOption({"o", "output"},
+                                    "Directory of the image files", "dir",
+                                    QDir::currentPath());
+    QCommandLineOption formatOption({"f", "format"}, "png or pdf", "format",
+                                    "png");
+    QCommandLineOption sizeOption({"s", "size"}, "Image size", "WxH",
+                                  "1200x800");
+    QCommandLineOption graphsOption(
+        {"g", "graphs"}, "Comma separated list of voltage, current, wattage",
+        "graphs", "voltage,current,wattage");
+    QCommandLineOption fromOption("from", "Start of the time range (ISO 8601)",
+                                  "datetime");
+    QCommandLineOption toOption("to", "End of the time range (ISO 8601)",
+                                "datetime");
+    QCommandLineOption jobsOption({"j", "jobs"},
+                                  "Recordings that are loaded in parallel",
+                                  "n", "0");
+    QCommandLineOption databaseOption(
+        "database", "Database file instead of the one from the settings",
+        "file");
+    parser.addOptions({renderOption, recordingOption, outputOption,
+                       formatOption, sizeOption, graphsOption, fromOption,
+                       toOption, jobsOption, databaseOption});
+    parser.process(labpowerqt);
 
     ealogger::Logger &log = LogInstance::get_instance();
 #ifdef WIN32
@@ -104,6 +188,45 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (parser.isSet(renderOption)) {
+        BatchRenderOptions opts;
+        opts.outputDir = parser.value(outputOption);
+        opts.format = parser.value(formatOption).toLower();
+        QStringList size = parser.value(sizeOption).split('x');
+        if (size.size() == 2) {
+            opts.width = std::max(1, size.at(0).toInt());
+            opts.height = std::max(1, size.at(1).toInt());
+        }
+        QStringList graphs = parser.value(graphsOption).split(',');
+        opts.voltage = graphs.contains("voltage");
+        opts.current = graphs.contains("current");
+        opts.wattage = graphs.contains("wattage");
+        opts.from =
+            QDateTime::fromString(parser.value(fromOption), Qt::ISODate);
+        opts.to = QDateTime::fromString(parser.value(toOption), Qt::ISODate);
+        opts.threads = parser.value(jobsOption).toInt();
+        if (opts.format != "png" && opts.format != "pdf")
+            parser.showHelp(1);
+        std::vector<long long> recIds;
+        for (const auto &id : parser.values(recordingOption)) {
+            recIds.push_back(id.toLongLong());
+        }
+        QSettings recordSettings;
+        recordSettings.beginGroup(setcon::RECORD_GROUP);
+        database_utils::initDatabase(
+            "QSQLITE",
+            parser.isSet(databaseOption)
+                ? parser.value(databaseOption)
+                : recordSettings
+                      .value(setcon::RECORD_SQLPATH,
+                             QStandardPaths::writableLocation(
+                                 QStandardPaths::DataLocation) +
+                                 QDir::separator() +
+                                 QString("labpowerqt.sqlite"))
+                      .toString());
+        return renderRecordings(labpowerqt, opts, recIds);
+    }
+
     MainWindow mw;
     mw.show();
 
@@ -24,10 +24,19 @@ namespace setdef = settings_default;
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), ui(new Ui::MainWindow)
 {
-    ui->setupUi(this);
+    this->startupTimer.start();
+    ScopedTiming timing("startup.mainwindow.ms");
+    {
+        ScopedTiming uiTiming("startup.ui.ms");
+        ui->setupUi(this);
+    }
 
     qRegisterMetaType<std::shared_ptr<SerialCommand>>();
     qRegisterMetaType<std::shared_ptr<PowerSupplyStatus>>();
+    qRegisterMetaType<std::vector<std::shared_ptr<PowerSupplyStatus>>>();
+    qRegisterMetaType<HistoryChunk>();
+    qRegisterMetaType<WatchdogTrip>();
+    qRegisterMetaType<std::vector<DiscoveredDevice>>();
 
     QString titleString;
     QTextStream titleStream(&titleString, QIODevice::WriteOnly);
@@ -48,12 +57,118 @@ MainWindow::MainWindow(QWidget *parent)
     settings.endGroup();
 
     // create model and controller
-    this->applicationModel = std::make_shared<LabPowerModel>();
-    this->controller = std::unique_ptr<LabPowerController>(
-        new LabPowerController(this->applicationModel));
+    {
+        ScopedTiming controllerTiming("startup.controller.ms");
+        this->applicationModel = std::make_shared<LabPowerModel>();
+        this->controller = std::unique_ptr<LabPowerController>(
+            new LabPowerController(this->applicationModel));
+    }
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::recordingsDeleted, ui->tabHistory,
+                     &TabHistory::updateModel);
+    QObject::connect(ui->tabHistory, &TabHistory::replayRecording,
+                     this->controller.get(), &LabPowerController::startReplay);
+    QObject::connect(ui->tabHistory, &TabHistory::stopReplay,
+                     this->controller.get(), &LabPowerController::stopReplay);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::replayProgress, ui->tabHistory,
+                     &TabHistory::replayProgress);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::replayFinished, ui->tabHistory,
+                     &TabHistory::replayFinished);
+    QObject::connect(ui->tabHistory, &TabHistory::deleteRequested,
+                     this->controller.get(),
+                     &LabPowerController::deleteRecordings);
+    QObject::connect(ui->tabHistory, &TabHistory::compactRequested,
+                     this->controller.get(),
+                     &LabPowerController::compactDatabase);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::databaseCompacted, ui->tabHistory,
+                     &TabHistory::databaseCompacted);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::maintenanceFailed, ui->tabHistory,
+                     &TabHistory::maintenanceFailed);
+    QObject::connect(ui->tabProgram, &TabProgram::startSequence,
+                     this->controller.get(),
+                     &LabPowerController::startSequence);
+    QObject::connect(ui->tabProgram, &TabProgram::stopSequence,
+                     this->controller.get(),
+                     &LabPowerController::stopSequence);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::sequenceStepExecuted, ui->tabProgram,
+                     &TabProgram::stepExecuted);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::sequenceFinished, ui->tabProgram,
+                     &TabProgram::sequenceFinished);
+    QObject::connect(ui->tabProgram, &TabProgram::setControlMode,
+                     this->controller.get(),
+                     &LabPowerController::setControlMode);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::controlLoopFinished, ui->tabProgram,
+                     &TabProgram::controlLoopFinished);
+    QObject::connect(ui->tabSafety, &TabSafety::rulesChanged,
+                     this->controller.get(),
+                     &LabPowerController::setWatchdogRules);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::watchdogTripped, ui->tabSafety,
+                     &TabSafety::watchdogTripped);
+    this->controller->setWatchdogRules(ui->tabSafety->rules());
+    QObject::connect(ui->tabScript, &TabScript::runScript, this,
+                     [this](QString name, QString program) {
+                         int id = this->controller->runScript(name, program);
+                         ui->tabScript->scriptStarted(id, name);
+                     });
+    QObject::connect(ui->tabScript, &TabScript::stopScripts,
+                     this->controller.get(), &LabPowerController::stopScripts);
+    QObject::connect(this->controller.get(), &LabPowerController::scriptOutput,
+                     ui->tabScript, &TabScript::scriptOutput);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::scriptFinished, ui->tabScript,
+                     &TabScript::scriptFinished);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::scriptRecordingRequested, this,
+                     [this](bool status, QString name) {
+                         if (status == this->applicationModel->getRecord())
+                             return;
+                         ui->widgetRecord->recordExternal(status, name);
+                         this->recordToggle(status, name);
+                     });
 
     QObject::connect(ui->tabWidgetMainWindow, &QTabWidget::currentChanged, this,
                      &MainWindow::tabWidgetChangedIndex);
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::deviceReattached, this,
+                     [this](QString oldPort, QString newPort) {
+                         this->statusBar()->showMessage(
+                             "Device moved from " + oldPort + " to " +
+                             newPort);
+                     });
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::deviceOpenFailed, this,
+                     [this](QString errorString) {
+                         QMessageBox box(this);
+                         box.setIcon(QMessageBox::Icon::Critical);
+                         box.setText("Could not open Device");
+                         box.setInformativeText("Error: " + errorString);
+                         box.exec();
+                     });
+    QObject::connect(this->controller.get(),
+                     &LabPowerController::connectionLost, this,
+                     [this](QString errorString) {
+                         this->statusBar()->showMessage(
+                             "Connection lost (" + errorString +
+                             "), reconnecting...");
+                     });
+    QObject::connect(
+        this->controller.get(), &LabPowerController::connectionRestored, this,
+        [this](qint64 downtime, int attempts) {
+            this->statusBar()->showMessage(
+                QString("Reconnected after %1 s and %2 attempt(s)")
+                    .arg(downtime / 1000.0, 0, 'f', 1)
+                    .arg(attempts));
+        });
+    // find the device if the adapter got another port name since the last run
+    this->controller->reattachDevice();
 
     this->setupMenuBarActions();
     this->setupModelConnections();
@@ -106,93 +221,17 @@ MainWindow::MainWindow(QWidget *parent)
 MainWindow::~MainWindow() { delete ui; }
 void MainWindow::dataUpdated()
 {
-    QSettings settings;
-    settings.beginGroup(setcon::DEVICE_GROUP);
-    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
-    for (int i = 1; i <= settings.value(setcon::DEVICE_CHANNELS).toInt(); i++) {
-        double voltage = this->applicationModel->getVoltageSet(
-            static_cast<globcon::LPQ_CHANNEL>(i));
-        double actualVoltage = this->applicationModel->getVoltage(
-            static_cast<globcon::LPQ_CHANNEL>(i));
-        double current = this->applicationModel->getCurrentSet(
-            static_cast<globcon::LPQ_CHANNEL>(i));
-        double actualCurrent = this->applicationModel->getCurrent(
-            static_cast<globcon::LPQ_CHANNEL>(i));
-        double wattage = this->applicationModel->getWattage(
-            static_cast<globcon::LPQ_CHANNEL>(i));
-
-        this->ui->widgetGraph->addData(i, voltage,
-                                       this->applicationModel->getTime(),
-                                       globcon::LPQ_DATATYPE::SETVOLTAGE);
-        this->ui->widgetGraph->addData(i, actualVoltage,
-                                       this->applicationModel->getTime(),
-                                       globcon::LPQ_DATATYPE::VOLTAGE);
-        this->ui->widgetGraph->addData(i, current,
-                                       this->applicationModel->getTime(),
-                                       globcon::LPQ_DATATYPE::SETCURRENT);
-        this->ui->widgetGraph->addData(i, actualCurrent,
-                                       this->applicationModel->getTime(),
-                                       globcon::LPQ_DATATYPE::CURRENT);
-        this->ui->widgetGraph->addData(i, wattage,
-                                       this->applicationModel->getTime(),
-                                       globcon::LPQ_DATATYPE::WATTAGE);
-
-        ui->widgetDisplay->dataUpdate(
-            QVariant(QString::number(
-                voltage, 'f',
-                settings.value(setcon::DEVICE_VOLTAGE_ACCURACY).toInt())),
-            globcon::LPQ_DATATYPE::SETVOLTAGE, i);
-        ui->widgetDisplay->dataUpdate(
-            QVariant(QString::number(
-                actualVoltage, 'f',
-                settings.value(setcon::DEVICE_VOLTAGE_ACCURACY).toInt())),
-            globcon::LPQ_DATATYPE::VOLTAGE, i);
-
-        ui->widgetDisplay->dataUpdate(
-            QVariant(QString::number(
-                current, 'f',
-                settings.value(setcon::DEVICE_CURRENT_ACCURACY).toInt())),
-            globcon::LPQ_DATATYPE::SETCURRENT, i);
-        ui->widgetDisplay->dataUpdate(
-            QVariant(QString::number(
-                actualCurrent, 'f',
-                settings.value(setcon::DEVICE_CURRENT_ACCURACY).toInt())),
-            globcon::LPQ_DATATYPE::CURRENT, i);
-
-        ui->widgetDisplay->dataUpdate(QVariant(QString::number(wattage, 'f', 3)),
-                                      globcon::LPQ_DATATYPE::WATTAGE, i);
-
-        this->applicationModel->getOutput(static_cast<globcon::LPQ_CHANNEL>(i))
-            ? ui->widgetDisplay->dataUpdate(QVariant("On"),
-                                            globcon::LPQ_CONTROL::OUTPUT, i)
-            : ui->widgetDisplay->dataUpdate(QVariant("Off"),
-                                            globcon::LPQ_CONTROL::OUTPUT, i);
-
-        this->applicationModel->getChannelMode(static_cast<globcon::LPQ_CHANNEL>(
-            i)) == globcon::LPQ_MODE::CONSTANT_CURRENT
-            ? ui->widgetDisplay->dataUpdate(globcon::LPQ_MODE::CONSTANT_CURRENT,
-                                            i)
-            : ui->widgetDisplay->dataUpdate(globcon::LPQ_MODE::CONSTANT_VOLTAGE,
-                                            i);
+    const SettingsSnapshot &settings = SettingsCache::get_instance().snapshot();
+    // all graphs of all channels at once
+    this->ui->widgetGraph->addStatus(this->applicationModel->getStatus());
+    // the value labels are updated by the change signals of the model, only
+    // the statistics change with every status
+    for (int i = 1; i <= settings.deviceChannels; i++) {
+        ui->widgetDisplay->statisticsUpdate(
+            this->applicationModel->getStatistics(
+                static_cast<globcon::LPQ_CHANNEL>(i)),
+            i);
     }
-
-    this->applicationModel->getOVP()
-        ? ui->widgetDisplay->dataUpdate(QVariant("On"),
-                                        globcon::LPQ_CONTROL::OVP, 0)
-        : ui->widgetDisplay->dataUpdate(QVariant("Off"),
-                                        globcon::LPQ_CONTROL::OVP, 0);
-    this->applicationModel->getOCP()
-        ? ui->widgetDisplay->dataUpdate(QVariant("On"),
-                                        globcon::LPQ_CONTROL::OCP, 0)
-        : ui->widgetDisplay->dataUpdate(QVariant("Off"),
-                                        globcon::LPQ_CONTROL::OCP, 0);
-    this->applicationModel->getOTP()
-        ? ui->widgetDisplay->dataUpdate(QVariant("On"),
-                                        globcon::LPQ_CONTROL::OTP, 0)
-        : ui->widgetDisplay->dataUpdate(QVariant("Off"),
-                                        globcon::LPQ_CONTROL::OTP, 0);
-    // this->statusBar()->showMessage(
-    // QString::number(this->applicationModel->getDuration()) + "ms");
 }
 
 void MainWindow::deviceConnectionUpdated(bool connected)
@@ -225,6 +264,8 @@ void MainWindow::setupMenuBarActions()
     // Help menu
     QObject::connect(ui->actionReport_Bug, SIGNAL(triggered()), this,
                      SLOT(fileBugReport()));
+    QObject::connect(ui->actionMetrics, SIGNAL(triggered()), this,
+                     SLOT(showMetrics()));
     QObject::connect(ui->actionAbout_LabPowerQt, SIGNAL(triggered()), this,
                      SLOT(showAbout()));
     QObject::connect(ui->actionAbout_Qt, SIGNAL(triggered()), this,
@@ -248,6 +289,31 @@ void MainWindow::setupModelConnections()
         &MainWindow::dataUpdated,
         static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
                                         Qt::ConnectionType::UniqueConnection));
+    QObject::connect(
+        this->applicationModel.get(), &LabPowerModel::valueChanged,
+        ui->widgetDisplay, &DisplayArea::valueChanged,
+        static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
+                                        Qt::ConnectionType::UniqueConnection));
+    QObject::connect(
+        this->applicationModel.get(), &LabPowerModel::outputChanged,
+        ui->widgetDisplay, &DisplayArea::outputChanged,
+        static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
+                                        Qt::ConnectionType::UniqueConnection));
+    QObject::connect(
+        this->applicationModel.get(), &LabPowerModel::modeChanged,
+        ui->widgetDisplay, &DisplayArea::modeChanged,
+        static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
+                                        Qt::ConnectionType::UniqueConnection));
+    QObject::connect(
+        this->applicationModel.get(), &LabPowerModel::protectionChanged,
+        ui->widgetDisplay, &DisplayArea::protectionChanged,
+        static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
+                                        Qt::ConnectionType::UniqueConnection));
+    QObject::connect(
+        ui->widgetDisplay, &DisplayArea::statisticsReset,
+        this->applicationModel.get(), &LabPowerModel::resetStatistics,
+        static_cast<Qt::ConnectionType>(Qt::ConnectionType::AutoConnection |
+                                        Qt::ConnectionType::UniqueConnection));
 }
 
 void MainWindow::setupValuesDialog()
@@ -319,6 +385,18 @@ void MainWindow::showAbout()
 }
 
 void MainWindow::showAboutQt() { QMessageBox::aboutQt(this, tr("About Qt")); }
+void MainWindow::showMetrics()
+{
+    QMessageBox box(this);
+    box.setIcon(QMessageBox::Icon::Information);
+    box.setWindowTitle("Performance Metrics");
+    box.setText("Performance metrics collected since application start");
+    QString metrics = PerfMetrics::get_instance().toString();
+    box.setInformativeText(metrics.isEmpty() ? "No metrics collected yet"
+                                             : "See details");
+    box.setDetailedText(metrics);
+    box.exec();
+}
 void MainWindow::showSettings()
 {
     QSettings settings;
@@ -328,6 +406,7 @@ void MainWindow::showSettings()
     settings.endGroup();
     SettingsDialog sd;
     sd.exec();
+    ui->widgetGraph->applyPlotSettings();
 
     settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
     QByteArray newHash = settings.value(setcon::DEVICE_HASH).toByteArray();
@@ -356,6 +435,8 @@ void MainWindow::showSettings()
         this->controller->disconnectDevice();
         // refresh the ui in case number of channels changed.
         ui->widgetDisplay->setupChannels();
+        // the new labels need all values again
+        this->applicationModel->resetChanges();
         ui->widgetGraph->setupGraph();
         QObject::connect(
             this->applicationModel.get(), &LabPowerModel::statusUpdate, this,
@@ -488,4 +569,16 @@ void MainWindow::closeEvent(QCloseEvent *event)
     QWidget::closeEvent(event);
 }
 
-void MainWindow::showEvent(QShowEvent *ev) { QMainWindow::showEvent(ev); }
+void MainWindow::showEvent(QShowEvent *ev)
+{
+    QMainWindow::showEvent(ev);
+    // the event loop processes the timer after the window was painted
+    QTimer::singleShot(0, this, [this]() {
+        if (!this->startupTimer.isValid())
+            return;
+        PerfMetrics::get_instance().sample(
+            "startup.window.shown.ms",
+            static_cast<double>(this->startupTimer.elapsed()));
+        this->startupTimer.invalidate();
+    });
+}
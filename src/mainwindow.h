@@ -17,6 +17,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QElapsedTimer>
 #include <QMainWindow>
 #include <QSettings>
 #include <QString>
@@ -39,9 +40,12 @@
 
 #include <config.h>
 #include "global.h"
+#include "historyloader.h"
 #include "labpowercontroller.h"
 #include "labpowermodel.h"
 #include "log_instance.h"
+#include "perfmetrics.h"
+#include "settingscache.h"
 #include "settingsdefault.h"
 #include "settingsdefinitions.h"
 
@@ -73,8 +77,13 @@ public:
 
 public slots:
     /**
-     * @brief Connected to the application model, distributes new data to display
-     * and plot area
+     * @brief Connected to the application model, distributes new data to the
+     * plot area and the statistics of the display area
+     *
+     * @details
+     *
+     * The values of the display area are updated by the change signals of the
+     * model.
      */
     void dataUpdated();
     /**
@@ -101,6 +110,11 @@ private:
     std::shared_ptr<FloatingValuesDialogData> valuesDialogData;
     std::shared_ptr<FloatingValuesDialog> valuesDialog;
 
+    /**
+     * @brief Time from the construction until the window was shown
+     */
+    QElapsedTimer startupTimer;
+
     /**
      * @brief setupMenuBarActions
      *
@@ -119,6 +133,10 @@ private slots:
     void fileBugReport();
     void showAbout();
     void showAboutQt();
+    /**
+     * @brief Show the performance metrics collected so far
+     */
+    void showMetrics();
     /**
      * @brief Open settings dialog
      */
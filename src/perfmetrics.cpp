@@ -0,0 +1,73 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "perfmetrics.h"
+
+#include <algorithm>
+
+void PerfMetrics::count(const std::string &name)
+{
+    QMutexLocker lock(&this->mtx);
+    Metric &m = this->metrics[name];
+    m.count++;
+    m.last = static_cast<double>(m.count);
+    m.sum = m.last;
+}
+
+void PerfMetrics::sample(const std::string &name, double value)
+{
+    QMutexLocker lock(&this->mtx);
+    Metric &m = this->metrics[name];
+    if (m.count == 0) {
+        m.min = value;
+        m.max = value;
+    } else {
+        m.min = std::min(m.min, value);
+        m.max = std::max(m.max, value);
+    }
+    m.count++;
+    m.last = value;
+    m.sum += value;
+}
+
+std::map<std::string, PerfMetrics::Metric> PerfMetrics::snapshot() const
+{
+    QMutexLocker lock(&this->mtx);
+    return this->metrics;
+}
+
+QString PerfMetrics::toString() const
+{
+    QString text;
+    for (const auto &entry : this->snapshot()) {
+        const Metric &m = entry.second;
+        text += QString("%1: n=%2 last=%3 min=%4 max=%5 mean=%6\n")
+                    .arg(QString::fromStdString(entry.first))
+                    .arg(m.count)
+                    .arg(m.last, 0, 'f', 2)
+                    .arg(m.min, 0, 'f', 2)
+                    .arg(m.max, 0, 'f', 2)
+                    .arg(m.mean(), 0, 'f', 2);
+    }
+    return text;
+}
+
+void PerfMetrics::reset()
+{
+    QMutexLocker lock(&this->mtx);
+    this->metrics.clear();
+}
@@ -0,0 +1,117 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PERFMETRICS_H
+#define PERFMETRICS_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <utility>
+
+/**
+ * @brief Performance metrics collected while the application is running
+ *
+ * @details
+ *
+ * Implementation of Meyers' Singleton pattern like LogInstance. Every metric
+ * is identified by a name like "record.flush.ms" and keeps the number of
+ * samples, the last value and min, max and mean of all values. Counters are
+ * metrics where only the number of samples is of interest.
+ *
+ * All methods are thread safe.
+ */
+class PerfMetrics
+{
+public:
+    PerfMetrics(PerfMetrics const &) = delete;
+    void operator=(PerfMetrics const &) = delete;
+
+    /**
+     * @brief Statistics of one metric
+     */
+    struct Metric {
+        long long count = 0;
+        double last = 0;
+        double min = 0;
+        double max = 0;
+        double sum = 0;
+
+        double mean() const
+        {
+            return this->count > 0 ? this->sum / this->count : 0;
+        }
+    };
+
+    static PerfMetrics &get_instance()
+    {
+        static PerfMetrics metrics;
+        return metrics;
+    }
+
+    /**
+     * @brief Increase counter name by one
+     */
+    void count(const std::string &name);
+    /**
+     * @brief Add a value (duration, size...) to metric name
+     */
+    void sample(const std::string &name, double value);
+    /**
+     * @brief Get a copy of all metrics
+     */
+    std::map<std::string, Metric> snapshot() const;
+    /**
+     * @brief Human readable representation of all metrics, one per line
+     */
+    QString toString() const;
+    void reset();
+
+private:
+    PerfMetrics() {}
+    mutable QMutex mtx;
+    std::map<std::string, Metric> metrics;
+};
+
+/**
+ * @brief Measure the lifetime of an object and add it to a metric in ms
+ */
+class ScopedTiming
+{
+public:
+    explicit ScopedTiming(std::string name)
+        : name(std::move(name)), start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ScopedTiming()
+    {
+        PerfMetrics::get_instance().sample(
+            this->name, std::chrono::duration<double, std::milli>(
+                            std::chrono::steady_clock::now() - this->start)
+                            .count());
+    }
+
+private:
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif  // PERFMETRICS_H
@@ -0,0 +1,243 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "plotseries.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace seriescon = plot_series_constants;
+
+PlotSeries::PlotSeries() : raw(new QCPGraphDataContainer())
+{
+    for (int i = 0; i < seriescon::LEVELS; i++) {
+        this->levels.emplace_back(new QCPGraphDataContainer());
+    }
+    this->rebuildIndex();
+}
+
+QSharedPointer<QCPGraphDataContainer> PlotSeries::data() const
+{
+    return this->raw;
+}
+
+QSharedPointer<QCPGraphDataContainer>
+PlotSeries::dataForResolution(double keysPerPixel) const
+{
+    int level = -1;
+    while (level + 1 < seriescon::LEVELS &&
+           bucketWidth(level + 1) <= keysPerPixel) {
+        level++;
+    }
+    if (level == -1 || this->raw->size() < 2)
+        return this->raw;
+    // sparse data has less points than the buckets of this level
+    double rawInterval =
+        ((this->raw->constEnd() - 1)->key - this->raw->constBegin()->key) /
+        (this->raw->size() - 1);
+    if (rawInterval >= bucketWidth(level))
+        return this->raw;
+    return this->levels[level];
+}
+
+QCPRange PlotSeries::valueRange(const QCPRange &keyRange,
+                                bool &foundRange) const
+{
+    QCPGraphDataContainer::const_iterator begin =
+        this->raw->findBegin(keyRange.lower, false);
+    QCPGraphDataContainer::const_iterator end =
+        this->raw->findEnd(keyRange.upper, false);
+    double low = std::numeric_limits<double>::infinity();
+    double high = -std::numeric_limits<double>::infinity();
+    size_t l = this->indexCapacity + this->indexOffset +
+               static_cast<size_t>(begin - this->raw->constBegin());
+    size_t r = this->indexCapacity + this->indexOffset +
+               static_cast<size_t>(end - this->raw->constBegin());
+    // bottom up query of the half open leaf interval [l, r)
+    while (l < r) {
+        if (l & 1) {
+            low = std::min(low, this->indexMin[l]);
+            high = std::max(high, this->indexMax[l]);
+            l++;
+        }
+        if (r & 1) {
+            r--;
+            low = std::min(low, this->indexMin[r]);
+            high = std::max(high, this->indexMax[r]);
+        }
+        l >>= 1;
+        r >>= 1;
+    }
+    foundRange = low <= high;
+    if (!foundRange)
+        return QCPRange();
+    return QCPRange(low, high);
+}
+
+void PlotSeries::add(double key, double value)
+{
+    if (!this->raw->isEmpty() && key < (this->raw->constEnd() - 1)->key) {
+        this->raw->add(QCPGraphData(key, value));
+        this->rebuild();
+        return;
+    }
+    this->raw->add(QCPGraphData(key, value));
+    this->addToLevels(key, value);
+    this->addToIndex(value);
+}
+
+void PlotSeries::add(const QVector<double> &keys, const QVector<double> &values)
+{
+    int n = std::min(keys.size(), values.size());
+    if (n == 0)
+        return;
+    QVector<QCPGraphData> data(n);
+    for (int i = 0; i < n; i++) {
+        data[i].key = keys[i];
+        data[i].value = values[i];
+    }
+    bool append =
+        this->raw->isEmpty() || keys[0] >= (this->raw->constEnd() - 1)->key;
+    if (!append) {
+        this->raw->add(data, true);
+        this->rebuild();
+        return;
+    }
+    // the index needs the raw size of every point
+    for (int i = 0; i < n; i++) {
+        this->raw->add(data[i]);
+        this->addToLevels(keys[i], values[i]);
+        this->addToIndex(values[i]);
+    }
+}
+
+void PlotSeries::removeBefore(double key)
+{
+    int size = this->raw->size();
+    this->raw->removeBefore(key);
+    for (int i = 0; i < seriescon::LEVELS; i++) {
+        double width = bucketWidth(i);
+        this->levels[i]->removeBefore(std::floor(key / width) * width);
+    }
+    // the leaves of removed points are never queried again
+    this->indexOffset += static_cast<size_t>(size - this->raw->size());
+    if (this->indexOffset > this->indexCapacity / 2)
+        this->rebuildIndex();
+}
+
+void PlotSeries::clear()
+{
+    this->raw->clear();
+    for (auto &level : this->levels) {
+        level->clear();
+    }
+    this->rebuildIndex();
+}
+
+double PlotSeries::bucketWidth(int level)
+{
+    return seriescon::BASE_BUCKET * std::pow(seriescon::FANOUT, level);
+}
+
+void PlotSeries::addToLevels(double key, double value)
+{
+    for (int i = 0; i < seriescon::LEVELS; i++) {
+        QSharedPointer<QCPGraphDataContainer> &level = this->levels[i];
+        double width = bucketWidth(i);
+        double start = std::floor(key / width) * width;
+        if (level->isEmpty() || (level->constEnd() - 1)->key != start) {
+            level->add(QCPGraphData(start, value));
+            level->add(QCPGraphData(start, value));
+            continue;
+        }
+        // NaN values leave a gap in the graph and do not count
+        if (std::isnan(value))
+            continue;
+        QCPGraphDataContainer::iterator max = level->end() - 1;
+        QCPGraphDataContainer::iterator min = max - 1;
+        if (std::isnan(min->value)) {
+            min->value = value;
+            max->value = value;
+        } else {
+            min->value = std::min(min->value, value);
+            max->value = std::max(max->value, value);
+        }
+    }
+}
+
+void PlotSeries::addToIndex(double value)
+{
+    size_t leaf = this->indexOffset + static_cast<size_t>(this->raw->size()) -
+                  1;
+    if (leaf >= this->indexCapacity) {
+        this->rebuildIndex();
+        return;
+    }
+    size_t node = this->indexCapacity + leaf;
+    this->indexMin[node] =
+        std::isnan(value) ? std::numeric_limits<double>::infinity() : value;
+    this->indexMax[node] =
+        std::isnan(value) ? -std::numeric_limits<double>::infinity() : value;
+    for (node >>= 1; node > 0; node >>= 1) {
+        this->indexMin[node] =
+            std::min(this->indexMin[2 * node], this->indexMin[2 * node + 1]);
+        this->indexMax[node] =
+            std::max(this->indexMax[2 * node], this->indexMax[2 * node + 1]);
+    }
+}
+
+void PlotSeries::rebuild()
+{
+    for (auto &level : this->levels) {
+        level->clear();
+    }
+    for (auto it = this->raw->constBegin(); it != this->raw->constEnd();
+         ++it) {
+        this->addToLevels(it->key, it->value);
+    }
+    this->rebuildIndex();
+}
+
+void PlotSeries::rebuildIndex()
+{
+    // room for as many appends as there are points
+    size_t size = static_cast<size_t>(this->raw->size());
+    this->indexCapacity = seriescon::MIN_INDEX_CAPACITY;
+    while (this->indexCapacity < 2 * size) {
+        this->indexCapacity *= 2;
+    }
+    this->indexOffset = 0;
+    this->indexMin.assign(2 * this->indexCapacity,
+                          std::numeric_limits<double>::infinity());
+    this->indexMax.assign(2 * this->indexCapacity,
+                          -std::numeric_limits<double>::infinity());
+    size_t leaf = this->indexCapacity;
+    for (auto it = this->raw->constBegin(); it != this->raw->constEnd();
+         ++it, ++leaf) {
+        if (std::isnan(it->value))
+            continue;
+        this->indexMin[leaf] = it->value;
+        this->indexMax[leaf] = it->value;
+    }
+    for (size_t node = this->indexCapacity - 1; node > 0; node--) {
+        this->indexMin[node] =
+            std::min(this->indexMin[2 * node], this->indexMin[2 * node + 1]);
+        this->indexMax[node] =
+            std::max(this->indexMax[2 * node], this->indexMax[2 * node + 1]);
+    }
+}
@@ -0,0 +1,141 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PLOTSERIES_H
+#define PLOTSERIES_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+#include <vector>
+
+#include "qcustomplot.h"
+
+namespace plot_series_constants
+{
+/**
+ * @brief Bucket width of the finest level of detail in seconds
+ */
+const double BASE_BUCKET = 1.0;
+/**
+ * @brief Number of buckets of a level that make up one bucket of the next
+ * level
+ */
+const int FANOUT = 4;
+/**
+ * @brief Number of levels of detail, the coarsest has buckets of about 3 days
+ */
+const int LEVELS = 10;
+/**
+ * @brief Minimum number of leaves of the min/max index
+ */
+const int MIN_INDEX_CAPACITY = 1024;
+}
+
+/**
+ * @brief Data of one graph with a min/max level of detail pyramid
+ *
+ * @details
+ *
+ * Level n divides the time axis into buckets of BASE_BUCKET * FANOUT^n
+ * seconds. Every bucket is stored as two data points at the start of the
+ * bucket, the minimum followed by the maximum of all values in the bucket.
+ * Drawn as a line this looks like the raw data at a resolution of one bucket
+ * per pixel, but the number of points only depends on the visible time span.
+ *
+ * Appending data updates the last bucket of every level. Data inserted in
+ * front of the existing data rebuilds the levels.
+ *
+ * The raw data is also indexed by a min/max segment tree that answers
+ * valueRange queries for any key range in O(log n). Appending a point updates
+ * one path of the tree, points removed from the front are skipped by an
+ * offset until the tree is rebuilt.
+ */
+class PlotSeries
+{
+public:
+    PlotSeries();
+
+    /**
+     * @brief The raw data
+     */
+    QSharedPointer<QCPGraphDataContainer> data() const;
+    /**
+     * @brief Container that should be plotted at a resolution
+     *
+     * @param keysPerPixel Seconds one pixel of the x-axis covers
+     *
+     * @return The coarsest level whose buckets are not wider than a pixel or
+     * the raw data if it is not more dense than this level
+     */
+    QSharedPointer<QCPGraphDataContainer>
+    dataForResolution(double keysPerPixel) const;
+    /**
+     * @brief Minimum and maximum of the raw values within keyRange
+     *
+     * @param keyRange Range of keys including the bounds
+     * @param foundRange False if there are no values in keyRange
+     *
+     * @details
+     *
+     * NaN values are ignored.
+     */
+    QCPRange valueRange(const QCPRange &keyRange, bool &foundRange) const;
+
+    void add(double key, double value);
+    /**
+     * @brief Add sorted data
+     */
+    void add(const QVector<double> &keys, const QVector<double> &values);
+    /**
+     * @brief Remove data before key
+     *
+     * @details
+     *
+     * The bucket that contains key is kept in all levels.
+     */
+    void removeBefore(double key);
+    void clear();
+
+    /**
+     * @brief Width of a bucket of level in seconds
+     */
+    static double bucketWidth(int level);
+
+private:
+    QSharedPointer<QCPGraphDataContainer> raw;
+    std::vector<QSharedPointer<QCPGraphDataContainer>> levels;
+
+    // segment tree, the leaves start at indexCapacity
+    std::vector<double> indexMin;
+    std::vector<double> indexMax;
+    size_t indexCapacity;
+    /**
+     * @brief Leaf of the first raw data point
+     */
+    size_t indexOffset;
+
+    void addToLevels(double key, double value);
+    void addToIndex(double value);
+    /**
+     * @brief Rebuild levels and index from the raw data
+     */
+    void rebuild();
+    void rebuildIndex();
+};
+
+#endif  // PLOTSERIES_H
@@ -23,6 +23,7 @@ namespace setcon = settings_constants;
 namespace setdef = settings_default;
 namespace globcon = global_constants;
 namespace utils = global_utilities;
+namespace plotcon = plot_constants;
 
 PlottingArea::PlottingArea(QWidget *parent) : QWidget(parent)
 {
@@ -32,9 +33,42 @@ PlottingArea::PlottingArea(QWidget *parent) : QWidget(parent)
     this->lastAction = nullptr;
     this->dataDisplayFrameHeight = -1;
     this->plot = 0;
+    this->replotPending = false;
+    this->framesRendered = 0;
+    this->frameTime = 0;
+    this->graphLayer = nullptr;
+    this->retentionTime = 0;
+    this->retentionPoints = 0;
+    this->dataEvicted = false;
+    this->emptyHistory = QCPRange(0, 0);
+    this->historyPending = false;
+    this->graphControlsReady = false;
 
     this->setupUI();
     this->setupGraph();
+
+    // evicted data is read from the recordings in a worker thread
+    this->recordingReader = new RecordingReader();
+    this->recordingReader->moveToThread(&this->readerThread);
+    QObject::connect(&this->readerThread, &QThread::finished,
+                     this->recordingReader, &QObject::deleteLater);
+    QObject::connect(this, &PlottingArea::requestHistory,
+                     this->recordingReader, &RecordingReader::readRange);
+    QObject::connect(this->recordingReader, &RecordingReader::rangeRead, this,
+                     &PlottingArea::insertHistory);
+    this->readerThread.start();
+
+    QObject::connect(&this->replotTimer, &QTimer::timeout, this,
+                     &PlottingArea::renderFrame);
+    this->applyPlotSettings();
+    this->fpsTimer.start();
+    this->replotTimer.start();
+}
+
+PlottingArea::~PlottingArea()
+{
+    this->readerThread.quit();
+    this->readerThread.wait();
 }
 
 void PlottingArea::addData(const int &channel, const double &data,
@@ -57,306 +91,417 @@ void PlottingArea::addData(const int &channel, const double &data,
 
         this->currentDataPointKey = t;
 
-        this->plot->graph(index)->addData(key, data);
+        this->series.at(index)->add(key, data);
+        this->dataAppended(key);
+    }
+}
+
+void PlottingArea::addStatus(const std::shared_ptr<PowerSupplyStatus> &status)
+{
+    if (!this->cbGeneralPlot->isChecked() || !status)
+        return;
+    this->dataAppended(this->appendStatus(status));
+}
+
+void PlottingArea::addStatuses(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statuses)
+{
+    if (!this->cbGeneralPlot->isChecked() || statuses.empty())
+        return;
+    double key = this->appendStatuses(statuses);
+    this->currentDataPointKey = statuses.back()->getTime();
+    this->dataAppended(key);
+}
+
+double PlottingArea::appendStatus(
+    const std::shared_ptr<PowerSupplyStatus> &status)
+{
+    std::chrono::system_clock::time_point t = status->getTime();
+    double key = std::chrono::duration<double>(t.time_since_epoch()).count();
+    this->currentDataPointKey = t;
+    // five graphs per channel in the order of LPQ_DATATYPE
+    const int types = 5;
+    int channels = static_cast<int>(this->series.size()) / types;
+    for (int channel = 1; channel <= channels; channel++) {
+        double channelValues[types];
+        try {
+            channelValues[static_cast<int>(
+                globcon::LPQ_DATATYPE::SETVOLTAGE)] =
+                status->getVoltageSet(channel);
+            channelValues[static_cast<int>(globcon::LPQ_DATATYPE::VOLTAGE)] =
+                status->getVoltage(channel);
+            channelValues[static_cast<int>(
+                globcon::LPQ_DATATYPE::SETCURRENT)] =
+                status->getCurrentSet(channel);
+            channelValues[static_cast<int>(globcon::LPQ_DATATYPE::CURRENT)] =
+                status->getCurrent(channel);
+            channelValues[static_cast<int>(globcon::LPQ_DATATYPE::WATTAGE)] =
+                status->getWattage(channel);
+        } catch (const std::out_of_range &) {
+            continue;
+        }
+        int index = (channel - 1) * types;
+        for (int type = 0; type < types; type++) {
+            this->series[index + type]->add(key, channelValues[type]);
+        }
+    }
+    return key;
+}
 
-        if (this->autoScroll) {
-            this->plot->xAxis->setRange(key, this->plot->xAxis->range().size(),
-                                        Qt::AlignRight);
+double PlottingArea::appendStatuses(
+    const std::vector<std::shared_ptr<PowerSupplyStatus>> &statuses)
+{
+    const int types = 5;
+    int channels = static_cast<int>(this->series.size()) / types;
+    std::vector<QVector<double>> keys(channels);
+    std::vector<QVector<double>> values(channels * types);
+    double key = 0;
+    for (const auto &status : statuses) {
+        key = std::chrono::duration<double>(
+                  status->getTime().time_since_epoch())
+                  .count();
+        for (int channel = 1; channel <= channels; channel++) {
+            double channelValues[types];
+            try {
+                channelValues[static_cast<int>(
+                    globcon::LPQ_DATATYPE::SETVOLTAGE)] =
+                    status->getVoltageSet(channel);
+                channelValues[static_cast<int>(
+                    globcon::LPQ_DATATYPE::VOLTAGE)] =
+                    status->getVoltage(channel);
+                channelValues[static_cast<int>(
+                    globcon::LPQ_DATATYPE::SETCURRENT)] =
+                    status->getCurrentSet(channel);
+                channelValues[static_cast<int>(
+                    globcon::LPQ_DATATYPE::CURRENT)] =
+                    status->getCurrent(channel);
+                channelValues[static_cast<int>(
+                    globcon::LPQ_DATATYPE::WATTAGE)] =
+                    status->getWattage(channel);
+            } catch (const std::out_of_range &) {
+                continue;
+            }
+            keys[channel - 1].push_back(key);
+            for (int type = 0; type < types; type++) {
+                values[(channel - 1) * types + type].push_back(
+                    channelValues[type]);
+            }
         }
+    }
+    for (size_t i = 0; i < this->series.size(); i++) {
+        this->series[i]->add(keys[i / types], values[i]);
+    }
+    return key;
+}
 
-        this->plot->replot();
+void PlottingArea::dataAppended(double key)
+{
+    if (this->autoScroll) {
+        this->plot->xAxis->setRange(key, this->plot->xAxis->range().size(),
+                                    Qt::AlignRight);
     }
+    this->replotPending = true;
+}
+
+void PlottingArea::applyPlotSettings()
+{
+    const SettingsSnapshot &settings = SettingsCache::get_instance().snapshot();
+    this->replotTimer.setInterval(1000 / std::max(1, settings.plotFps));
+    this->retentionTime = settings.plotRetentionTime;
+    this->retentionPoints = settings.plotRetentionPoints;
 }
 
-// to be honest this method has mutated in an unmaintainable monster :(
 void PlottingArea::setupGraph()
 {
+    ScopedTiming timing("plot.setup.ms");
     if (this->checkPlot()) {
         this->resetGraph();
     }
+    this->graphControlsReady = false;
 
     QSettings settings;
     settings.beginGroup(setcon::DEVICE_GROUP);
     settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
-    if (settings.contains(setcon::DEVICE_PORT)) {
-        this->setupGraphPlot(settings);
-
-        int graphIndex = 0;
-
-        // Every channel of a device will get its own subsets of graphs and
-        // control widgets.
-        for (int i = 1; i <= settings.value(setcon::DEVICE_CHANNELS).toInt();
-             i++) {
-            // the box that controls the visibility of the graphs
-            QGroupBox *graphVisibilityBox =
-                new QGroupBox("Channel " + QString::number(i));
-            graphVisibilityBox->setLayout(new QHBoxLayout());
-            this->controlData->layout()->addWidget(graphVisibilityBox);
-            // the box that controls color, line thickness and style
-            QGroupBox *appearanceBox =
-                new QGroupBox("Channel " + QString::number(i));
-            appearanceBox->setLayout(new QVBoxLayout());
-            this->controlAppearance->layout()->addWidget(appearanceBox);
-            QGroupBox *dataDisplayBox =
-                new QGroupBox("Channel " + QString::number(i));
-            dataDisplayBox->setLayout(new QHBoxLayout());
-            dataDisplayBox->layout()->setSpacing(20);
-            this->dataDisplayChannels->layout()->addWidget(dataDisplayBox);
-            std::map<globcon::LPQ_DATATYPE, QLabel *> chanDisplayLabels;
-            QGridLayout *dataDisplayVoltageGrid = new QGridLayout();
-            QGridLayout *dataDisplayCurrentGrid = new QGridLayout();
-            QGridLayout *dataDisplayWattageGrid = new QGridLayout();
-            dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
-                ->addLayout(dataDisplayVoltageGrid);
-            dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
-                ->addLayout(dataDisplayCurrentGrid);
-            dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
-                ->addLayout(dataDisplayWattageGrid);
-
-            for (int j = 0; j < 5; j++) {
-                globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(j);
-
-                /*
-                 * For every graph we add:
-                 * A Switch to turn visibility on or off
-                 * A ComboBox to set LineStyle
-                 * A SpinBox to set the Line Thickness
-                 * A Button to choose the graph color
-                 * Two labels to display the data below the plot on mouseover
-                 */
-                QCheckBox *cbVisibilitySwitch = new QCheckBox();
-                cbVisibilitySwitch->setText(this->datatypeStrings.at(dt));
-                QLabel *labelGraphProps =
-                    new QLabel(this->datatypeStrings.at(dt));
-                labelGraphProps->setMinimumWidth(120);
-                QComboBox *graphLineStyle = new QComboBox();
-                graphLineStyle->addItem("Solid", QVariant(0));
-                graphLineStyle->addItem("Dotted", QVariant(0));
-
-                QSpinBox *graphLineThickness = new QSpinBox();
-                graphLineThickness->setMinimum(1);
-                graphLineThickness->setMaximum(5);
-                graphLineThickness->setValue(1);
-
-                QPushButton *graphColor = new QPushButton();
-                graphColor->setToolTip("Choose graph color");
-                graphColor->setIconSize(QSize(64, 16));
-                // the image that is displayed in the color choose button
-                QPixmap pic(64, 16);
-
-                QLabel *dataDisplayLabel =
-                    new QLabel(this->datatypeStrings.at(dt));
-                QLabel *dataDisplayLabelValue = new QLabel("--");
-                chanDisplayLabels.insert({dt, dataDisplayLabelValue});
-                dataDisplayLabelValue->setMinimumWidth(40);
-                dataDisplayLabelValue->setAlignment(
-                    Qt::AlignmentFlag::AlignRight);
-
-                dataDisplayBox->layout()->addWidget(dataDisplayLabel);
-                dataDisplayBox->layout()->addWidget(dataDisplayLabelValue);
-
-                if (dt == globcon::LPQ_DATATYPE::SETCURRENT ||
-                    dt == globcon::LPQ_DATATYPE::CURRENT) {
-                    this->plot->addGraph(this->plot->xAxis, this->currentAxis);
-                    if (dt == globcon::LPQ_DATATYPE::CURRENT) {
-                        dataDisplayCurrentGrid->addWidget(dataDisplayLabel, 0,
-                                                          0);
-                        dataDisplayCurrentGrid->addWidget(dataDisplayLabelValue,
-                                                          0, 1);
-                    }
-                    if (dt == globcon::LPQ_DATATYPE::SETCURRENT) {
-                        dataDisplayCurrentGrid->addWidget(dataDisplayLabel, 1,
-                                                          0);
-                        dataDisplayCurrentGrid->addWidget(dataDisplayLabelValue,
-                                                          1, 1);
-                    }
-                } else if (dt == globcon::LPQ_DATATYPE::WATTAGE) {
-                    this->plot->addGraph(this->plot->xAxis, this->wattageAxis);
-                    dataDisplayWattageGrid->addWidget(dataDisplayLabel, 0, 0);
-                    dataDisplayLabel->setAlignment(Qt::AlignmentFlag::AlignTop |
-                                                   Qt::AlignmentFlag::AlignLeft);
-                    dataDisplayWattageGrid->addWidget(dataDisplayLabelValue, 0,
+    if (!settings.contains(setcon::DEVICE_PORT)) {
+        this->plot->replot();
+        return;
+    }
+    this->setupGraphPlot(settings);
+
+    QSettings plotSettings;
+    plotSettings.beginGroup(setcon::PLOT_GROUP);
+    int graphIndex = 0;
+    // Every channel of a device gets its own subset of graphs and data display
+    // labels. The control widgets are created by setupGraphControls.
+    for (int i = 1; i <= settings.value(setcon::DEVICE_CHANNELS).toInt();
+         i++) {
+        QGroupBox *dataDisplayBox =
+            new QGroupBox("Channel " + QString::number(i));
+        dataDisplayBox->setLayout(new QHBoxLayout());
+        dataDisplayBox->layout()->setSpacing(20);
+        this->dataDisplayChannels->layout()->addWidget(dataDisplayBox);
+        std::map<globcon::LPQ_DATATYPE, QLabel *> chanDisplayLabels;
+        QGridLayout *dataDisplayVoltageGrid = new QGridLayout();
+        QGridLayout *dataDisplayCurrentGrid = new QGridLayout();
+        QGridLayout *dataDisplayWattageGrid = new QGridLayout();
+        dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
+            ->addLayout(dataDisplayVoltageGrid);
+        dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
+            ->addLayout(dataDisplayCurrentGrid);
+        dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())
+            ->addLayout(dataDisplayWattageGrid);
+
+        for (int j = 0; j < 5; j++) {
+            globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(j);
+
+            // Two labels to display the data below the plot on mouseover
+            QLabel *dataDisplayLabel = new QLabel(this->datatypeStrings.at(dt));
+            QLabel *dataDisplayLabelValue = new QLabel("--");
+            chanDisplayLabels.insert({dt, dataDisplayLabelValue});
+            dataDisplayLabelValue->setMinimumWidth(40);
+            dataDisplayLabelValue->setAlignment(Qt::AlignmentFlag::AlignRight);
+
+            dataDisplayBox->layout()->addWidget(dataDisplayLabel);
+            dataDisplayBox->layout()->addWidget(dataDisplayLabelValue);
+
+            QColor graphCol;
+            if (dt == globcon::LPQ_DATATYPE::SETCURRENT ||
+                dt == globcon::LPQ_DATATYPE::CURRENT) {
+                this->plot->addGraph(this->plot->xAxis, this->currentAxis);
+                graphCol = this->currentGraphColors.at(i - 1);
+                if (dt == globcon::LPQ_DATATYPE::CURRENT) {
+                    dataDisplayCurrentGrid->addWidget(dataDisplayLabel, 0, 0);
+                    dataDisplayCurrentGrid->addWidget(dataDisplayLabelValue, 0,
                                                       1);
-                } else {
-                    this->plot->addGraph();
-                    if (dt == globcon::LPQ_DATATYPE::VOLTAGE) {
-                        dataDisplayVoltageGrid->addWidget(dataDisplayLabel, 0,
-                                                          0);
-                        dataDisplayVoltageGrid->addWidget(dataDisplayLabelValue,
-                                                          0, 1);
-                    }
-                    if (dt == globcon::LPQ_DATATYPE::SETVOLTAGE) {
-                        dataDisplayVoltageGrid->addWidget(dataDisplayLabel, 1,
-                                                          0);
-                        dataDisplayVoltageGrid->addWidget(dataDisplayLabelValue,
-                                                          1, 1);
-                    }
                 }
-
-                graphVisibilityBox->layout()->addWidget(cbVisibilitySwitch);
-                QHBoxLayout *appearanceElemLayout = new QHBoxLayout();
-                appearanceElemLayout->addWidget(labelGraphProps);
-                appearanceElemLayout->addWidget(graphLineStyle);
-                appearanceElemLayout->addWidget(graphLineThickness);
-                appearanceElemLayout->addWidget(graphColor);
-                appearanceElemLayout->addStretch();
-                dynamic_cast<QVBoxLayout *>(appearanceBox->layout())
-                    ->addLayout(appearanceElemLayout);
-
-                // connect visibility checkbox with a lambda
-                QObject::connect(
-                    cbVisibilitySwitch, &QCheckBox::toggled,
-                    [this, graphIndex](bool checked) {
-                        QSettings settings;
-                        settings.beginGroup(setcon::PLOT_GROUP);
-                        QString key =
-                            QString(setcon::PLOT_GRAPH_VISIBLE).arg(graphIndex);
-                        if (checked) {
-                            this->plot->graph(graphIndex)->setVisible(true);
-                            this->plot->graph(graphIndex)->addToLegend();
-                        } else {
-                            this->plot->graph(graphIndex)->setVisible(false);
-                            this->plot->graph(graphIndex)->removeFromLegend();
-                        }
-                        settings.setValue(key, checked);
-                        this->yAxisVisibility();
-                    });
-                // connect linestyle
-                QObject::connect(
-                    graphLineStyle, static_cast<void (QComboBox::*)(int)>(
-                                        &QComboBox::currentIndexChanged),
-                    [this, graphLineStyle, graphIndex](int idx) {
-                        QSettings settings;
-                        settings.beginGroup(setcon::PLOT_GROUP);
-                        QString key =
-                            QString(setcon::PLOT_GRAPH_LS).arg(graphIndex);
-                        QPen graphPen = this->plot->graph(graphIndex)->pen();
-                        if (idx == 0) {
-                            graphPen.setStyle(Qt::PenStyle::SolidLine);
-                        } else {
-                            graphPen.setStyle(Qt::PenStyle::DotLine);
-                        }
-                        settings.setValue(key, idx);
-                        this->plot->graph(graphIndex)->setPen(graphPen);
-                        this->plot->replot();
-                    });
-                // connect line thickness
-                QObject::connect(
-                    graphLineThickness, static_cast<void (QSpinBox::*)(int)>(
-                                            &QSpinBox::valueChanged),
-                    [this, graphIndex, graphLineThickness](int value) {
-                        QSettings settings;
-                        settings.beginGroup(setcon::PLOT_GROUP);
-                        QString key =
-                            QString(setcon::PLOT_GRAPH_LINE).arg(graphIndex);
-                        QPen graphPen = this->plot->graph(graphIndex)->pen();
-                        graphPen.setWidth(value);
-                        settings.setValue(key, value);
-                        this->plot->graph(graphIndex)->setPen(graphPen);
-                        this->plot->replot();
-                    });
-                // connect color button
-                QObject::connect(
-                    graphColor, &QPushButton::clicked,
-                    [this, graphColor, graphIndex]() {
-                        QSettings settings;
-                        settings.beginGroup(setcon::PLOT_GROUP);
-                        QString key =
-                            QString(setcon::PLOT_GRAPH_COLOR).arg(graphIndex);
-                        QPen graphPen = this->plot->graph(graphIndex)->pen();
-                        QColor col = QColorDialog::getColor(
-                            graphPen.color(), this, "Choose a color");
-                        if (col.isValid()) {
-                            graphPen.setColor(col);
-                            this->plot->graph(graphIndex)->setPen(graphPen);
-                            QPixmap pic = graphColor->icon().pixmap(64, 16);
-                            pic.fill(col);
-                            graphColor->setIcon(pic);
-                            settings.setValue(key, col);
-                            this->plot->replot();
-                        }
-                    });
-
-                settings.endGroup();
-                settings.endGroup();
-                settings.beginGroup(setcon::PLOT_GROUP);
-                QString colkey =
-                    QString(setcon::PLOT_GRAPH_COLOR).arg(graphIndex);
-                QColor graphCol;
-                if (dt == globcon::LPQ_DATATYPE::SETCURRENT ||
-                    dt == globcon::LPQ_DATATYPE::CURRENT) {
-                    graphCol = QColor(
-                        settings
-                            .value(colkey, this->currentGraphColors.at(i - 1))
-                            .toString());
-                } else if (dt == globcon::LPQ_DATATYPE::VOLTAGE ||
-                           dt == globcon::LPQ_DATATYPE::SETVOLTAGE) {
-                    graphCol = QColor(
-                        settings
-                            .value(colkey, this->voltageGraphColors.at(i - 1))
-                            .toString());
-
-                } else {
-                    graphCol = QColor(
-                        settings
-                            .value(colkey, this->wattageGraphColors.at(i - 1))
-                            .toString());
+                if (dt == globcon::LPQ_DATATYPE::SETCURRENT) {
+                    dataDisplayCurrentGrid->addWidget(dataDisplayLabel, 1, 0);
+                    dataDisplayCurrentGrid->addWidget(dataDisplayLabelValue, 1,
+                                                      1);
                 }
-                pic.fill(graphCol);
-                graphColor->setIcon(pic);
-                // init a QPen for our graph
-                QPen graphPen;
-                graphPen.setColor(graphCol);
-
-                this->plot->graph(graphIndex)->setPen(graphPen);
-                // set graph name
-                this->plot->graph(graphIndex)
-                    ->setName(this->graphNames.at(dt).arg(QString::number(i)));
-
-                QString viskey =
-                    QString(setcon::PLOT_GRAPH_VISIBLE).arg(graphIndex);
-                QString linekey =
-                    QString(setcon::PLOT_GRAPH_LINE).arg(graphIndex);
-                QString lskey = QString(setcon::PLOT_GRAPH_LS).arg(graphIndex);
-                if (settings.value(viskey, true).toBool()) {
-                    LogInstance::get_instance().eal_debug(
-                        "Visibility is true for " +
-                        labelGraphProps->text().toStdString());
+            } else if (dt == globcon::LPQ_DATATYPE::WATTAGE) {
+                this->plot->addGraph(this->plot->xAxis, this->wattageAxis);
+                graphCol = this->wattageGraphColors.at(i - 1);
+                dataDisplayWattageGrid->addWidget(dataDisplayLabel, 0, 0);
+                dataDisplayLabel->setAlignment(Qt::AlignmentFlag::AlignTop |
+                                               Qt::AlignmentFlag::AlignLeft);
+                dataDisplayWattageGrid->addWidget(dataDisplayLabelValue, 0, 1);
+            } else {
+                this->plot->addGraph();
+                graphCol = this->voltageGraphColors.at(i - 1);
+                if (dt == globcon::LPQ_DATATYPE::VOLTAGE) {
+                    dataDisplayVoltageGrid->addWidget(dataDisplayLabel, 0, 0);
+                    dataDisplayVoltageGrid->addWidget(dataDisplayLabelValue, 0,
+                                                      1);
                 }
-                if (dt == globcon::LPQ_DATATYPE::VOLTAGE ||
-                    dt == globcon::LPQ_DATATYPE::CURRENT ||
-                    dt == globcon::LPQ_DATATYPE::WATTAGE) {
-                    // these are by default visible and have a solid linestyle
-                    cbVisibilitySwitch->setChecked(
-                        settings.value(viskey, true).toBool());
-                    graphLineStyle->setCurrentIndex(
-                        settings.value(lskey, 0).toInt());
-                } else {
-                    // these ones are by default invisible and have a dotted
-                    // line.
-                    cbVisibilitySwitch->setChecked(
-                        settings.value(viskey, false).toBool());
-                    graphLineStyle->setCurrentIndex(
-                        settings.value(lskey, 1).toInt());
+                if (dt == globcon::LPQ_DATATYPE::SETVOLTAGE) {
+                    dataDisplayVoltageGrid->addWidget(dataDisplayLabel, 1, 0);
+                    dataDisplayVoltageGrid->addWidget(dataDisplayLabelValue, 1,
+                                                      1);
                 }
-                // by default all lines have a width of two
-                graphLineThickness->setValue(settings.value(linekey, 2).toInt());
-
-                settings.endGroup();
-                settings.beginGroup(setcon::DEVICE_GROUP);
-                settings.beginGroup(
-                    settings.value(setcon::DEVICE_ACTIVE).toString());
+            }
 
-                graphIndex++;
+            this->series.push_back(std::make_unique<PlotSeries>());
+            QCPGraph *graph = this->plot->graph(graphIndex);
+            graph->setData(this->series.back()->data());
+            graph->setLayer(this->graphLayer);
+            graph->setName(this->graphNames.at(dt).arg(QString::number(i)));
+
+            // measured values are by default visible and have a solid
+            // linestyle, set values are invisible and have a dotted line.
+            bool measured = dt == globcon::LPQ_DATATYPE::VOLTAGE ||
+                            dt == globcon::LPQ_DATATYPE::CURRENT ||
+                            dt == globcon::LPQ_DATATYPE::WATTAGE;
+            QPen graphPen;
+            graphPen.setColor(QColor(
+                plotSettings
+                    .value(QString(setcon::PLOT_GRAPH_COLOR).arg(graphIndex),
+                           graphCol)
+                    .toString()));
+            int lineStyle =
+                plotSettings
+                    .value(QString(setcon::PLOT_GRAPH_LS).arg(graphIndex),
+                           measured ? 0 : 1)
+                    .toInt();
+            graphPen.setStyle(lineStyle == 0 ? Qt::PenStyle::SolidLine
+                                             : Qt::PenStyle::DotLine);
+            // by default all lines have a width of two
+            graphPen.setWidth(
+                plotSettings
+                    .value(QString(setcon::PLOT_GRAPH_LINE).arg(graphIndex), 2)
+                    .toInt());
+            graph->setPen(graphPen);
+            if (plotSettings
+                    .value(QString(setcon::PLOT_GRAPH_VISIBLE).arg(graphIndex),
+                           measured)
+                    .toBool()) {
+                graph->addToLegend();
+            } else {
+                graph->setVisible(false);
             }
-            dynamic_cast<QHBoxLayout *>(graphVisibilityBox->layout())
-                ->addStretch();
-            dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())->addStretch();
-            this->dataDisplayLabels.insert(
-                {static_cast<globcon::LPQ_CHANNEL>(i), chanDisplayLabels});
+
+            graphIndex++;
         }
+        dynamic_cast<QHBoxLayout *>(dataDisplayBox->layout())->addStretch();
+        this->dataDisplayLabels.insert(
+            {static_cast<globcon::LPQ_CHANNEL>(i), chanDisplayLabels});
+    }
+
+    // rebuild the controls right away if they are currently visible
+    if (this->controlStack->maximumHeight() > 0 &&
+        this->controlStack->currentWidget() != this->controlGeneralScroll) {
+        this->setupGraphControls();
+    }
+    // replots the graphs
+    this->yAxisVisibility();
+}
+
+void PlottingArea::setupGraphControls()
+{
+    if (this->graphControlsReady)
+        return;
+    this->graphControlsReady = true;
+    ScopedTiming timing("plot.controls.ms");
+
+    int channels = static_cast<int>(this->series.size()) / 5;
+    for (int i = 1; i <= channels; i++) {
+        // the box that controls the visibility of the graphs
+        QGroupBox *graphVisibilityBox =
+            new QGroupBox("Channel " + QString::number(i));
+        graphVisibilityBox->setLayout(new QHBoxLayout());
+        this->controlData->layout()->addWidget(graphVisibilityBox);
+        // the box that controls color, line thickness and style
+        QGroupBox *appearanceBox =
+            new QGroupBox("Channel " + QString::number(i));
+        appearanceBox->setLayout(new QVBoxLayout());
+        this->controlAppearance->layout()->addWidget(appearanceBox);
+
+        for (int j = 0; j < 5; j++) {
+            globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(j);
+            int graphIndex = (i - 1) * 5 + j;
+            QPen currentPen = this->plot->graph(graphIndex)->pen();
+
+            /*
+             * For every graph we add:
+             * A Switch to turn visibility on or off
+             * A ComboBox to set LineStyle
+             * A SpinBox to set the Line Thickness
+             * A Button to choose the graph color
+             *
+             * The widgets show the current state of the graph and are
+             * connected afterwards, so creating them does not touch the plot.
+             */
+            QCheckBox *cbVisibilitySwitch = new QCheckBox();
+            cbVisibilitySwitch->setText(this->datatypeStrings.at(dt));
+            cbVisibilitySwitch->setChecked(
+                this->plot->graph(graphIndex)->visible());
+            QLabel *labelGraphProps = new QLabel(this->datatypeStrings.at(dt));
+            labelGraphProps->setMinimumWidth(120);
+            QComboBox *graphLineStyle = new QComboBox();
+            graphLineStyle->addItem("Solid", QVariant(0));
+            graphLineStyle->addItem("Dotted", QVariant(0));
+            graphLineStyle->setCurrentIndex(
+                currentPen.style() == Qt::PenStyle::DotLine ? 1 : 0);
+
+            QSpinBox *graphLineThickness = new QSpinBox();
+            graphLineThickness->setMinimum(1);
+            graphLineThickness->setMaximum(5);
+            graphLineThickness->setValue(currentPen.width());
+
+            QPushButton *graphColor = new QPushButton();
+            graphColor->setToolTip("Choose graph color");
+            graphColor->setIconSize(QSize(64, 16));
+            // the image that is displayed in the color choose button
+            QPixmap pic(64, 16);
+            pic.fill(currentPen.color());
+            graphColor->setIcon(pic);
+
+            graphVisibilityBox->layout()->addWidget(cbVisibilitySwitch);
+            QHBoxLayout *appearanceElemLayout = new QHBoxLayout();
+            appearanceElemLayout->addWidget(labelGraphProps);
+            appearanceElemLayout->addWidget(graphLineStyle);
+            appearanceElemLayout->addWidget(graphLineThickness);
+            appearanceElemLayout->addWidget(graphColor);
+            appearanceElemLayout->addStretch();
+            dynamic_cast<QVBoxLayout *>(appearanceBox->layout())
+                ->addLayout(appearanceElemLayout);
+
+            // connect visibility checkbox with a lambda
+            QObject::connect(
+                cbVisibilitySwitch, &QCheckBox::toggled,
+                [this, graphIndex](bool checked) {
+                    QSettings settings;
+                    settings.beginGroup(setcon::PLOT_GROUP);
+                    QString key =
+                        QString(setcon::PLOT_GRAPH_VISIBLE).arg(graphIndex);
+                    if (checked) {
+                        this->plot->graph(graphIndex)->setVisible(true);
+                        this->plot->graph(graphIndex)->addToLegend();
+                    } else {
+                        this->plot->graph(graphIndex)->setVisible(false);
+                        this->plot->graph(graphIndex)->removeFromLegend();
+                    }
+                    settings.setValue(key, checked);
+                    this->yAxisVisibility();
+                });
+            // connect linestyle
+            QObject::connect(
+                graphLineStyle, static_cast<void (QComboBox::*)(int)>(
+                                    &QComboBox::currentIndexChanged),
+                [this, graphLineStyle, graphIndex](int idx) {
+                    QSettings settings;
+                    settings.beginGroup(setcon::PLOT_GROUP);
+                    QString key =
+                        QString(setcon::PLOT_GRAPH_LS).arg(graphIndex);
+                    QPen graphPen = this->plot->graph(graphIndex)->pen();
+                    if (idx == 0) {
+                        graphPen.setStyle(Qt::PenStyle::SolidLine);
+                    } else {
+                        graphPen.setStyle(Qt::PenStyle::DotLine);
+                    }
+                    settings.setValue(key, idx);
+                    this->plot->graph(graphIndex)->setPen(graphPen);
+                    this->plot->replot();
+                });
+            // connect line thickness
+            QObject::connect(
+                graphLineThickness, static_cast<void (QSpinBox::*)(int)>(
+                                        &QSpinBox::valueChanged),
+                [this, graphIndex, graphLineThickness](int value) {
+                    QSettings settings;
+                    settings.beginGroup(setcon::PLOT_GROUP);
+                    QString key =
+                        QString(setcon::PLOT_GRAPH_LINE).arg(graphIndex);
+                    QPen graphPen = this->plot->graph(graphIndex)->pen();
+                    graphPen.setWidth(value);
+                    settings.setValue(key, value);
+                    this->plot->graph(graphIndex)->setPen(graphPen);
+                    this->plot->replot();
+                });
+            // connect color button
+            QObject::connect(
+                graphColor, &QPushButton::clicked,
+                [this, graphColor, graphIndex]() {
+                    QSettings settings;
+                    settings.beginGroup(setcon::PLOT_GROUP);
+                    QString key =
+                        QString(setcon::PLOT_GRAPH_COLOR).arg(graphIndex);
+                    QPen graphPen = this->plot->graph(graphIndex)->pen();
+                    QColor col = QColorDialog::getColor(
+                        graphPen.color(), this, "Choose a color");
+                    if (col.isValid()) {
+                        graphPen.setColor(col);
+                        this->plot->graph(graphIndex)->setPen(graphPen);
+                        QPixmap pic = graphColor->icon().pixmap(64, 16);
+                        pic.fill(col);
+                        graphColor->setIcon(pic);
+                        settings.setValue(key, col);
+                        this->plot->replot();
+                    }
+                });
+        }
+        dynamic_cast<QHBoxLayout *>(graphVisibilityBox->layout())->addStretch();
     }
-    this->plot->replot();
 }
 
 void PlottingArea::setupUI()
@@ -444,6 +589,10 @@ void PlottingArea::setupUI()
     generalExportLayout->addWidget(generalExport);
     generalExportLayout->addWidget(generalImageFormat);
     generalExportLayout->addStretch();
+    this->labelRenderStats = new QLabel();
+    this->labelRenderStats->setToolTip(
+        "Frames rendered per second and average render time of a frame");
+    controlGeneralLay->addWidget(this->labelRenderStats);
     controlGeneralLay->addStretch();
 
     this->animationGroupDataDisplay =
@@ -504,8 +653,8 @@ void PlottingArea::setupUI()
                 this, "Discard Data",
                 "Do you really want to discard the data in the "
                 "plot? This will not affect Recordings") == QMessageBox::Yes) {
-            for (int i = 0; i < this->plot->graphCount(); i++) {
-                this->plot->graph(i)->data()->clear();
+            for (auto &graphSeries : this->series) {
+                graphSeries->clear();
             }
             this->startPoint = std::chrono::system_clock::now();
             this->plot->replot();
@@ -669,6 +818,11 @@ void PlottingArea::resetGraph()
     dynamic_cast<QGridLayout *>(this->layout())->addWidget(this->plot, 2, 0);
 
     utils::clearLayout(this->dataDisplayChannels->layout());
+    this->series.clear();
+    this->dataEvicted = false;
+    this->emptyHistory = QCPRange(0, 0);
+    this->graphLayer = nullptr;
+    this->renderedRanges.clear();
 }
 
 void PlottingArea::setupGraphPlot(const QSettings &settings)
@@ -689,6 +843,15 @@ void PlottingArea::setupGraphPlot(const QSettings &settings)
     this->plot->axisRect()->setRangeZoom(Qt::Orientation::Horizontal);
     this->plot->axisRect()->setRangeDrag(Qt::Orientation::Horizontal);
 
+    // The graphs get their own paint buffer between the grid and the axes. New
+    // samples only repaint this buffer as long as the axes did not change,
+    // which excludes auto scroll as it moves the x-axis with every sample.
+    this->plot->addLayer(plotcon::LAYER_GRAPHS, this->plot->layer("main"),
+                         QCustomPlot::LayerInsertMode::limAbove);
+    this->graphLayer = this->plot->layer(plotcon::LAYER_GRAPHS);
+    this->graphLayer->setMode(QCPLayer::LayerMode::lmBuffered);
+    this->renderedRanges.clear();
+
     this->voltageAxis = this->plot->yAxis;
     this->currentAxis =
         this->plot->axisRect()->addAxis(QCPAxis::AxisType::atLeft);
@@ -745,6 +908,9 @@ void PlottingArea::setupGraphPlot(const QSettings &settings)
     this->zoomLevel->position->setCoords(45, 0);
     this->zoomLevel->setClipToAxisRect(false);
     // this->zoomLevel->setVisible(false);
+    // the zoom items only change with the x-axis range
+    this->zoomMagPic->setLayer("legend");
+    this->zoomLevel->setLayer("legend");
 
     // TODO: Tooltips are not supported at the moment. But in the forums are some
     // good examples on how to make this work on your own.
@@ -771,15 +937,17 @@ void PlottingArea::setupGraphPlot(const QSettings &settings)
 
     QObject::connect(this->plot, &QCustomPlot::mouseMove, this,
                      &PlottingArea::mouseMoveHandler);
+
+    // a full replot refreshes the paint buffers of all layers
+    QObject::connect(this->plot, &QCustomPlot::afterReplot, this,
+                     [this]() { this->renderedRanges = this->axisRanges(); });
 }
 
-void PlottingArea::yAxisRange(const QCPRange &currentXRange,
-                              const QSettings &settings)
+void PlottingArea::yAxisRange(const QCPRange &currentXRange)
 {
     YAxisHelper yax;
     YAxisBounds yaxb =
-        yax.getyAxisBounds(currentXRange, this->plot,
-                           settings.value(setcon::DEVICE_CHANNELS).toInt());
+        yax.getyAxisBounds(currentXRange, this->plot, this->series);
 
     this->voltageAxis->setRange(
         QCPRange(yaxb.voltageLower - 0.5, yaxb.voltageUpper + 0.5));
@@ -849,13 +1017,155 @@ void PlottingArea::yAxisVisibility()
 }
 
 void PlottingArea::beforeReplotHandle() {}
+void PlottingArea::renderFrame()
+{
+    // a hidden plot is rendered as soon as it becomes visible again
+    if (this->replotPending && this->plot->isVisible()) {
+        this->replotPending = false;
+        this->evictData();
+        this->selectLevelOfDetail();
+        QElapsedTimer frameTimer;
+        frameTimer.start();
+        if (this->graphLayer && this->axisRanges() == this->renderedRanges) {
+            // layout, grid, axes, legend and items are unchanged
+            this->graphLayer->replot();
+            PerfMetrics::get_instance().sample(
+                "plot.replot.layer.ms", frameTimer.nsecsElapsed() / 1000000.0);
+            PerfMetrics::get_instance().count("plot.frames.layer");
+        } else {
+            this->plot->replot();
+            PerfMetrics::get_instance().sample("plot.replot.ms",
+                                               this->plot->replotTime());
+            PerfMetrics::get_instance().count("plot.frames.full");
+        }
+        this->frameTime += frameTimer.nsecsElapsed() / 1000000.0;
+        this->framesRendered++;
+    }
+    qint64 elapsed = this->fpsTimer.elapsed();
+    if (elapsed >= 1000) {
+        double fps = this->framesRendered * 1000.0 / elapsed;
+        PerfMetrics::get_instance().sample("plot.fps", fps);
+        this->labelRenderStats->setText(
+            QString("%1 fps, %2 ms per frame")
+                .arg(fps, 0, 'f', 1)
+                .arg(this->framesRendered > 0
+                         ? this->frameTime / this->framesRendered
+                         : 0.0,
+                     0, 'f', 1));
+        this->framesRendered = 0;
+        this->frameTime = 0;
+        this->fpsTimer.restart();
+    }
+}
+
+void PlottingArea::evictData()
+{
+    double cutoff = std::numeric_limits<double>::lowest();
+    if (this->retentionTime > 0) {
+        cutoff = std::chrono::duration<double>(
+                     this->currentDataPointKey.time_since_epoch())
+                     .count() -
+                 this->retentionTime * 60.0;
+    }
+    // keep the prefetched range width in front of the visible range
+    QCPRange visible = this->plot->xAxis->range();
+    double keepLower = visible.lower - visible.size();
+    for (auto &graphSeries : this->series) {
+        QSharedPointer<QCPGraphDataContainer> data = graphSeries->data();
+        double graphCutoff = cutoff;
+        if (this->retentionPoints > 0 && data->size() > this->retentionPoints)
+            graphCutoff = std::max(
+                graphCutoff, (data->constEnd() - this->retentionPoints)->key);
+        graphCutoff = std::min(graphCutoff, keepLower);
+        if (data->isEmpty() || data->constBegin()->key >= graphCutoff)
+            continue;
+        graphSeries->removeBefore(graphCutoff);
+        this->dataEvicted = true;
+    }
+}
+
+void PlottingArea::selectLevelOfDetail()
+{
+    int width = this->plot->axisRect()->width();
+    if (width <= 0)
+        return;
+    double keysPerPixel = this->plot->xAxis->range().size() / width;
+    for (size_t i = 0; i < this->series.size(); i++) {
+        QSharedPointer<QCPGraphDataContainer> data =
+            this->series[i]->dataForResolution(keysPerPixel);
+        QCPGraph *graph = this->plot->graph(static_cast<int>(i));
+        if (graph->data() != data)
+            graph->setData(data);
+    }
+}
+
+std::vector<QCPRange> PlottingArea::axisRanges() const
+{
+    return {this->plot->xAxis->range(), this->voltageAxis->range(),
+            this->currentAxis->range(), this->wattageAxis->range()};
+}
+
+void PlottingArea::requestEvictedData(const QCPRange &range)
+{
+    if (!this->dataEvicted || this->historyPending || this->series.empty())
+        return;
+    QSharedPointer<QCPGraphDataContainer> data = this->series[0]->data();
+    double oldest = data->isEmpty()
+                        ? std::chrono::duration<double>(
+                              this->currentDataPointKey.time_since_epoch())
+                              .count()
+                        : data->constBegin()->key;
+    if (range.lower >= oldest)
+        return;
+    // read one more range width so the next pan steps are already covered
+    double from = std::max(
+        range.lower - range.size(),
+        std::chrono::duration<double>(this->startPoint.time_since_epoch())
+            .count());
+    if (from >= oldest)
+        return;
+    // the keys are truncated to ms for the request
+    if (from >= this->emptyHistory.lower &&
+        oldest <= this->emptyHistory.upper + 0.001)
+        return;
+    int maxPoints = static_cast<int>(
+        this->plot->axisRect()->width() * plotcon::HISTORY_POINTS_PER_PIXEL *
+        (oldest - from) / range.size());
+
+    const SettingsSnapshot &settings = SettingsCache::get_instance().snapshot();
+    this->historyPending = true;
+    emit this->requestHistory(QSqlDatabase::database().databaseName(),
+                              settings.deviceName,
+                              static_cast<qint64>(from * 1000),
+                              static_cast<qint64>(oldest * 1000) - 1,
+                              std::max(1, maxPoints));
+}
+
+void PlottingArea::insertHistory(
+    qint64 from, qint64 to,
+    std::vector<std::shared_ptr<PowerSupplyStatus>> statuses)
+{
+    this->historyPending = false;
+    if (this->series.empty())
+        return;
+    // the live data may have been evicted up to a later point meanwhile
+    QSharedPointer<QCPGraphDataContainer> data = this->series[0]->data();
+    if (!data->isEmpty() && data->constBegin()->key * 1000 < to)
+        return;
+    if (statuses.empty()) {
+        // nothing was recorded, do not ask again for this range but still for
+        // older or newly evicted data
+        this->emptyHistory = QCPRange(from / 1000.0, (to + 1) / 1000.0);
+        return;
+    }
+    this->appendStatuses(statuses);
+    this->yAxisRange(this->plot->xAxis->range());
+    this->replotPending = true;
+}
+
 void PlottingArea::xAxisRangeChanged(const QCPRange &newRange,
                                      const QCPRange &oldRange)
 {
-    QSettings settings;
-    settings.beginGroup(setcon::DEVICE_GROUP);
-    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
-
     long long newRangeUpperMS = static_cast<long long>(newRange.upper * 1000);
     std::chrono::milliseconds newRangeUpperMSDuration(newRangeUpperMS);
     long long newRangeLowerMS = static_cast<long long>(newRange.lower * 1000);
@@ -999,18 +1309,9 @@ void PlottingArea::xAxisRangeChanged(const QCPRange &newRange,
         return;
     }
 
-    QSettings zoomSets;
-    zoomSets.beginGroup(setcon::PLOT_GROUP);
-    double zoomMin =
-        zoomSets
-            .value(setcon::PLOT_ZOOM_MIN,
-                   setdef::general_defaults.at(setcon::PLOT_ZOOM_MIN))
-            .toDouble();
-    double zoomMax =
-        zoomSets
-            .value(setcon::PLOT_ZOOM_MAX,
-                   setdef::general_defaults.at(setcon::PLOT_ZOOM_MAX))
-            .toDouble();
+    const SettingsSnapshot &settings = SettingsCache::get_instance().snapshot();
+    double zoomMin = settings.plotZoomMin;
+    double zoomMax = settings.plotZoomMax;
     // limit zoom
     if (deltaSecsUpperLower < std::chrono::duration<double>(zoomMin) ||
         deltaSecsUpperLower > std::chrono::duration<double>(zoomMax)) {
@@ -1039,8 +1340,10 @@ void PlottingArea::xAxisRangeChanged(const QCPRange &newRange,
         return;
     }
 
+    this->requestEvictedData(newRange);
+
     // set y axis range
-    this->yAxisRange(newRange, settings);
+    this->yAxisRange(newRange);
 }
 
 void PlottingArea::mouseMoveHandler(QMouseEvent *event)
@@ -1049,9 +1352,7 @@ void PlottingArea::mouseMoveHandler(QMouseEvent *event)
     if (!this->checkPlot())
         return;
 
-    QSettings settings;
-    settings.beginGroup(setcon::DEVICE_GROUP);
-    settings.beginGroup(settings.value(setcon::DEVICE_ACTIVE).toString());
+    const SettingsSnapshot &settings = SettingsCache::get_instance().snapshot();
     if (this->cbGeneralPlot->isChecked() &&
         this->cbGeneralShowData->isChecked()) {
         // get the coordinate on the x axis from the event position
@@ -1061,28 +1362,25 @@ void PlottingArea::mouseMoveHandler(QMouseEvent *event)
             QDateTime::fromMSecsSinceEpoch(static_cast<qint64>(x * 1000));
         this->dataDisplayDT->setText(
             dateTime.toString("yyyy-MM-dd HH:mm:ss.zzz"));
-        for (int i = 1; i <= settings.value(setcon::DEVICE_CHANNELS).toInt();
-             i++) {
+        for (int i = 1; i <= settings.deviceChannels; i++) {
             for (int c = 0; c < 5; c++) {
                 // which datatype is this
                 globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(c);
                 // if the graph is visible get the data
-                if (this->plot->graph(c)->visible()) {
-                    auto setVit =
-                        this->plot->graph(c)->data()->findBegin(x, false);
-                    if (setVit != this->plot->graph(c)->data()->end()) {
+                int index = (i - 1) * 5 + c;
+                if (this->plot->graph(index)->visible()) {
+                    QSharedPointer<QCPGraphDataContainer> data =
+                        this->series.at(index)->data();
+                    auto setVit = data->findBegin(x, false);
+                    if (setVit != data->end()) {
                         int accuracy = 3;
                         if (dt == globcon::LPQ_DATATYPE::VOLTAGE ||
                             dt == globcon::LPQ_DATATYPE::SETVOLTAGE) {
-                            accuracy =
-                                settings.value(setcon::DEVICE_VOLTAGE_ACCURACY)
-                                    .toInt();
+                            accuracy = settings.voltageAccuracy;
                         }
                         if (dt == globcon::LPQ_DATATYPE::CURRENT ||
                             dt == globcon::LPQ_DATATYPE::SETCURRENT) {
-                            accuracy =
-                                settings.value(setcon::DEVICE_CURRENT_ACCURACY)
-                                    .toInt();
+                            accuracy = settings.currentAccuracy;
                         }
                         this->dataDisplayLabels
                             .at(static_cast<globcon::LPQ_CHANNEL>(i))
@@ -1111,6 +1409,9 @@ bool PlottingArea::checkPlot() const
 
 void PlottingArea::toolbarActionTriggered(QAction *action)
 {
+    if (action == this->actionData || action == this->actionAppearance) {
+        this->setupGraphControls();
+    }
     // set stackedControl to a widget according to action
     if (action == this->actionGeneral) {
         this->controlStack->setCurrentWidget(this->controlGeneralScroll);
@@ -21,25 +21,50 @@
 #include <QColor>
 #include <QColorDialog>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QPushButton>
 #include <QScrollArea>
+#include <QThread>
+#include <QTimer>
 #include <QWidget>
 
 #include <QFileDialog>
+#include <QSqlDatabase>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "global.h"
+#include "guiutils.h"
 #include "log_instance.h"
+#include "perfmetrics.h"
+#include "plotseries.h"
+#include "powersupplystatus.h"
 #include "qcustomplot.h"
+#include "recordingreader.h"
+#include "settingscache.h"
 #include "settingsdefault.h"
 #include "settingsdefinitions.h"
 #include "yaxishelper.h"
 
+namespace plot_constants
+{
+/**
+ * @brief Points per pixel of the plot reloaded from the recordings
+ */
+const int HISTORY_POINTS_PER_PIXEL = 2;
+/**
+ * @brief Name of the buffered layer that holds all graphs
+ */
+const char *const LAYER_GRAPHS = "graphs";
+}
+
 /**
  * @brief The PlottingArea with the QCustomPlot and other widgets to control it
  */
@@ -48,9 +73,16 @@ class PlottingArea : public QWidget
     Q_OBJECT
 public:
     explicit PlottingArea(QWidget *parent = 0);
+    ~PlottingArea();
 
 signals:
 
+    /**
+     * @brief Ask the RecordingReader for evicted data
+     */
+    void requestHistory(QString dbFile, QString device, qint64 from, qint64 to,
+                        int maxPoints);
+
 public slots:
 
     /**
@@ -60,14 +92,49 @@ public slots:
      * @param data
      * @param t Measurement Time Point
      * @param type Type of data
+     *
+     * @details
+     *
+     * The data is only appended to the graph. The plot is rendered by
+     * renderFrame at the configured frame rate.
      */
     void addData(const int &channel, const double &data,
                  const std::chrono::system_clock::time_point &t,
                  const global_constants::LPQ_DATATYPE &type);
+    /**
+     * @brief Add all values of a status snapshot to the plot
+     *
+     * @param status Status of the device
+     *
+     * @details
+     *
+     * Appends one data point to every graph of every channel and scrolls the
+     * plot once.
+     */
+    void addStatus(const std::shared_ptr<PowerSupplyStatus> &status);
+    /**
+     * @brief Add a series of status snapshots in chronological order
+     *
+     * @details
+     *
+     * Used to catch up after the GUI was blocked or to replay recorded data.
+     */
+    void addStatuses(
+        const std::vector<std::shared_ptr<PowerSupplyStatus>> &statuses);
     /**
      * @brief This slot is invoked whenever the settings or the device changes
+     *
+     * @details
+     *
+     * Creates the graphs with the appearance stored in the settings. The
+     * visibility and appearance controls are created when they are shown for
+     * the first time, see setupGraphControls.
      */
     void setupGraph();
+    /**
+     * @brief Apply frame rate and live window retention from the settings
+     */
+    void applyPlotSettings();
 
 private:
     std::vector<QColor> voltageGraphColors = {
@@ -96,6 +163,15 @@ private:
      * @brief The plot widget
      */
     QCustomPlot *plot;
+    /**
+     * @brief Data of every graph, same index as the graph
+     *
+     * @details
+     *
+     * The graphs share the containers of their series. Depending on the zoom
+     * level a graph shows the raw data or a level of detail.
+     */
+    std::vector<std::unique_ptr<PlotSeries>> series;
     QCPAxis *voltageAxis;
     QCPAxis *currentAxis;
     QCPAxis *wattageAxis;
@@ -139,6 +215,7 @@ private:
         cbGeneralShowData; /**< Show data at mouse cursor position in own area under plot */
     QCheckBox *cbGeneralShowTimescale; /**< Show x-axis timescale */
     QCheckBox *cbGeneralAutoscrl;      /**< need to keep a pointer to this one*/
+    bool graphControlsReady; /**< Controls of the current graphs exist */
 
     // TODO: Why do we have a separate boolean for auto scroll if there is
     // pointer to the checkbutton that controls this behaviour?
@@ -146,6 +223,51 @@ private:
     std::chrono::system_clock::time_point startPoint;
     std::chrono::system_clock::time_point currentDataPointKey;
 
+    /**
+     * @brief Renders at most one frame per interval if new data arrived
+     */
+    QTimer replotTimer;
+    bool replotPending;
+    QElapsedTimer fpsTimer;
+    int framesRendered;
+    double frameTime; /**< Render time of the frames in ms since fpsTimer */
+    QLabel *labelRenderStats; /**< Shows frame rate and render time */
+    /**
+     * @brief Buffered layer of the graphs
+     *
+     * @details
+     *
+     * Grid, axes, legend and the zoom items are on other layers and keep their
+     * paint buffers as long as no axis range changed. Auto scroll changes the
+     * x-axis range with every sample, the live view with auto scroll is always
+     * fully replotted.
+     */
+    QCPLayer *graphLayer;
+    /**
+     * @brief Ranges of x-axis and value axes at the last full replot
+     */
+    std::vector<QCPRange> renderedRanges;
+
+    /**
+     * @brief Minutes of data kept in the graphs, 0 keeps everything
+     */
+    int retentionTime;
+    /**
+     * @brief Points kept in each graph, 0 keeps everything
+     */
+    int retentionPoints;
+    /**
+     * @brief True if data was evicted and may be reloaded from the recordings
+     */
+    bool dataEvicted;
+    /**
+     * @brief Range in seconds the recordings have no data for
+     */
+    QCPRange emptyHistory;
+    bool historyPending;
+    QThread readerThread;
+    RecordingReader *recordingReader;
+
     /**
      * @brief Setup the basic UI, this is only called once.
      */
@@ -163,12 +285,21 @@ private:
      * @brief Set the default values and connections for the plot
      */
     void setupGraphPlot(const QSettings &settings);
+    /**
+     * @brief Create the visibility and appearance controls of all graphs
+     *
+     * @details
+     *
+     * Only done once after every setupGraph, the controls reflect the current
+     * state of the graphs.
+     */
+    void setupGraphControls();
 
     /**
      * @brief Update the y-axis range
      * @param currentXRange
      */
-    void yAxisRange(const QCPRange &currentXRange, const QSettings &settings);
+    void yAxisRange(const QCPRange &currentXRange);
 
     /**
      * @brief Controls the visibility of y-axes
@@ -179,11 +310,66 @@ private:
      */
     void yAxisVisibility();
 
+    /**
+     * @brief Append the values of status to the graphs
+     *
+     * @return Key of the status in seconds since epoch
+     */
+    double appendStatus(const std::shared_ptr<PowerSupplyStatus> &status);
+    /**
+     * @brief Add statuses in chronological order with one sorted insert per
+     * graph
+     *
+     * @details
+     *
+     * Channels missing in a status, e.g. in an older recording, are skipped.
+     *
+     * @return Key of the last status in seconds since epoch
+     */
+    double appendStatuses(
+        const std::vector<std::shared_ptr<PowerSupplyStatus>> &statuses);
+    /**
+     * @brief Remove data older than the live window from all graphs
+     *
+     * @details
+     *
+     * Data inside the visible x-axis range and one range width before it,
+     * the margin requestEvictedData reads ahead, is never removed.
+     */
+    void evictData();
+    /**
+     * @brief Let every graph show the level of detail matching the x-axis
+     * resolution
+     */
+    void selectLevelOfDetail();
+    /**
+     * @brief Ranges of x-axis, voltage, current and wattage axis
+     */
+    std::vector<QCPRange> axisRanges() const;
+    /**
+     * @brief Request the evicted data of range from the recordings
+     */
+    void requestEvictedData(const QCPRange &range);
+    /**
+     * @brief Scroll to key if auto scroll is on and schedule a replot
+     */
+    void dataAppended(double key);
+
 private slots:
 
     // plot slots
     // TODO: Currently beforeReplotHandle is unused
     void beforeReplotHandle();
+    /**
+     * @brief Replot if data was added since the last frame
+     */
+    void renderFrame();
+    /**
+     * @brief Insert data read by the RecordingReader in front of the graphs
+     */
+    void insertHistory(
+        qint64 from, qint64 to,
+        std::vector<std::shared_ptr<PowerSupplyStatus>> statuses);
     void xAxisRangeChanged(const QCPRange &newRange, const QCPRange &oldRange);
     /**
      * @brief Registers all mouse moves inside the plot
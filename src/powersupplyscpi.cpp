@@ -16,6 +16,8 @@
 
 #include "powersupplyscpi.h"
 
+#include <stdexcept>
+
 namespace powcon = PowerSupplySCPI_constants;
 
 PowerSupplySCPI::PowerSupplySCPI(
@@ -38,6 +40,9 @@ PowerSupplySCPI::PowerSupplySCPI(
 {
     this->serialPort = nullptr;
     this->canCalculateWattage = false;
+    this->backgroundWorkerThreadRun = false;
+    this->linkErrors = 0;
+    this->linkLost = false;
 
     this->powStatus = std::make_shared<PowerSupplyStatus>();
 }
@@ -55,16 +60,58 @@ void PowerSupplySCPI::stopPowerSupplyBackgroundThread()
     this->serQueue.push(static_cast<int>(powcon::COMMANDS::SETDUMMY));
 }
 
+void PowerSupplySCPI::setControlMode(int channel, const ControlConfig &config)
+{
+    this->controlLoop.configure(channel, config);
+    // wake up the worker if it is waiting for commands
+    this->serQueue.push(static_cast<int>(powcon::COMMANDS::SETDUMMY));
+}
+
+void PowerSupplySCPI::setWatchdogRules(std::vector<WatchdogRule> rules)
+{
+    this->watchdog.setRules(std::move(rules));
+}
+
 QString PowerSupplySCPI::getserialPortName() { return this->serialPortName; }
 QByteArray PowerSupplySCPI::getDeviceHash() { return this->deviceHash; }
+void PowerSupplySCPI::reconnect()
+{
+    if (!this->backgroundWorkerThreadRun) {
+        emit backgroundThreadStopped();
+        return;
+    }
+    QString errorString;
+    if (!this->openPort(errorString)) {
+        emit reconnectFailed(errorString);
+        return;
+    }
+    emit deviceOpen();
+    this->workerLoop();
+}
+
 void PowerSupplySCPI::threadFunc()
 {
+    QString errorString;
+    if (!this->openPort(errorString)) {
+        emit errorOpen(errorString);
+        return;
+    }
+
+    emit deviceOpen();
+
+    this->workerLoop();
+}
+
+bool PowerSupplySCPI::openPort(QString &errorString)
+{
+    QMutexLocker qlock(&this->qserialPortGuard);
     this->serialPort = new QSerialPort(this->serialPortName);
 
-    // this->serialPort = new QSerialPort(this->serialPortName);
     if (!this->serialPort->open(QIODevice::ReadWrite)) {
-        emit errorOpen(this->serialPort->errorString());
-        return;
+        errorString = this->serialPort->errorString();
+        delete this->serialPort;
+        this->serialPort = nullptr;
+        return false;
     }
 
     this->serialPort->setBaudRate(this->port_baudraute);
@@ -72,21 +119,49 @@ void PowerSupplySCPI::threadFunc()
     this->serialPort->setDataBits(this->port_databits);
     this->serialPort->setParity(this->port_parity);
     this->serialPort->setStopBits(this->port_stopbits);
+    return true;
+}
 
-    emit deviceOpen();
-
-    while (this->backgroundWorkerThreadRun) {
+void PowerSupplySCPI::workerLoop()
+{
+    this->linkErrors = 0;
+    this->linkLost = false;
+    while (this->backgroundWorkerThreadRun && !this->linkLost) {
+        // queued commands always come first, the control loops use the time
+        // the port would be idle otherwise
+        if (this->controlLoop.isActive() && this->serQueue.empty()) {
+            this->controlCycle();
+            continue;
+        }
         this->readWriteData(this->serQueue.pop());
     }
 
-    LogInstance::get_instance().eal_debug("Stopping SCPI worker thread");
-
     QMutexLocker qlock(&this->qserialPortGuard);
-    if (this->serialPort && this->serialPort->isOpen()) {
-        this->serialPort->close();
+    if (this->serialPort) {
+        if (this->serialPort->isOpen())
+            this->serialPort->close();
         delete this->serialPort;
+        this->serialPort = nullptr;
     }
 
+    if (this->backgroundWorkerThreadRun) {
+        // the status that was collected when the link broke is incomplete
+        std::shared_ptr<PowerSupplyStatus> newStatus =
+            std::make_shared<PowerSupplyStatus>();
+        this->updateNewPStatus(newStatus);
+        this->powStatus = newStatus;
+        // the outputs may change while the device is gone
+        this->lastStatus = nullptr;
+        LogInstance::get_instance().eal_error(
+            "Lost connection to device on port " +
+            this->serialPortName.toStdString() + ": " +
+            this->linkErrorString.toStdString());
+        emit connectionLost(this->linkErrorString);
+        return;
+    }
+
+    LogInstance::get_instance().eal_debug("Stopping SCPI worker thread");
+
     emit backgroundThreadStopped();
 }
 
@@ -114,90 +189,18 @@ void PowerSupplySCPI::readWriteData(std::shared_ptr<SerialCommand> com)
         commands = this->prepareStatusCommands();
     }
 
-    ealogger::Logger &log = LogInstance::get_instance();
-
     bool serial_error = false;
 
     for (auto &c : commands) {
-        // QThread::currentThread()->msleep(80);
-        QByteArray commandByte = this->prepareCommandByteArray(c);
-        bool waitForBytes = false;
-        // Could this be a problem here because there are pending commands?
-        if (!this->serialPort->clear(QSerialPort::Direction::AllDirections)) {
-            ;
-            log.eal_error("Could not clear serial port buffers");
-            log.eal_error(
-                "Error: " +
-                static_cast<QString>(this->serialPort->error()).toStdString());
-            this->serialPort->clearError();
-        }
-        qint64 bytesWritten =
-            this->serialPort->write(commandByte, commandByte.length());
-        if (bytesWritten != -1) {
-            log.eal_debug("Bytes written: " +
-                          QString::number(bytesWritten).toStdString() + "\n" +
-                          "command length: " +
-                          QString::number(commandByte.length()).toStdString());
-            // wait for for bytes to be written
-            if (commandByte != "") {
-                waitForBytes =
-                    this->serialPort->waitForBytesWritten(this->portTimeOut);
-                // waitForBytes = this->serialPort->waitForBytesWritten(1000);
-            }
-        } else {
-            log.eal_error(
-                "Could not write command " +
-                std::string(commandByte.constData(), commandByte.length()));
-            log.eal_error(
-                "Error: " +
-                static_cast<QString>(this->serialPort->error()).toStdString());
-            this->serialPort->clearError();
+        if (this->linkLost) {
             serial_error = true;
+            break;
         }
-
-        if (waitForBytes) {
-            // is this a command with feedback?
-            if (c->getCommandWithReply()) {
-                QByteArray reply = "0";
-                if (commandByte != "") {
-                    // wait until port is ready to read
-                    if (this->serialPort->waitForReadyRead(1000)) {
-                        if (serialPort->bytesAvailable())
-                            reply.clear();
-                        while (serialPort->bytesAvailable()) {
-                            reply.append(this->serialPort->readAll());
-                            this->serialPort->waitForReadyRead(
-                                this->portTimeOut);
-                        }
-                    } else {
-                        log.eal_error("Wait for ready read for command " +
-                                      std::string(commandByte.constData(),
-                                                  commandByte.length()) +
-                                      " timed out");
-                        log.eal_error(
-                            "Error: " +
-                            static_cast<QString>(this->serialPort->error())
-                                .toStdString());
-                        this->serialPort->clearError();
-                        serial_error = true;
-                    }
-                    //                    while
-                    //                    (this->serialPort->waitForReadyRead(1))
-                    //                    {
-                    //                        reply +=
-                    //                        this->serialPort->readAll();
-                    //                    }
-                }
-                c->setValue(reply);
-                this->processCommands(this->powStatus, c);
-            }
-        } else {
-            emit this->errorReadWrite(QString(this->serialPort->error()));
-            log.eal_error("Could not read from or write to device: " +
-                          QString(this->serialPort->error()).toStdString());
-            this->serialPort->clearError();
+        if (!this->transferCommand(c, this->powStatus)) {
             serial_error = true;
+            continue;
         }
+        this->checkWatchdog(c, this->powStatus);
     }
 
     if (serial_error) {
@@ -220,6 +223,7 @@ void PowerSupplySCPI::readWriteData(std::shared_ptr<SerialCommand> com)
         // seems like we have to emit first, but why?
         emit this->statusReady(this->powStatus);
 
+        this->lastStatus = this->powStatus;
         std::shared_ptr<PowerSupplyStatus> newStatus =
             std::make_shared<PowerSupplyStatus>();
         this->updateNewPStatus(newStatus);
@@ -228,3 +232,264 @@ void PowerSupplySCPI::readWriteData(std::shared_ptr<SerialCommand> com)
         emit this->requestFinished(com);
     }
 }
+
+bool PowerSupplySCPI::transferCommand(
+    const std::shared_ptr<SerialCommand> &c,
+    const std::shared_ptr<PowerSupplyStatus> &status)
+{
+    ealogger::Logger &log = LogInstance::get_instance();
+    bool success = true;
+    bool resourceError = false;
+    // remember why the link might be lost before the error is cleared
+    auto linkError = [this, &resourceError]() {
+        if (this->serialPort->error() ==
+            QSerialPort::SerialPortError::ResourceError)
+            resourceError = true;
+        this->linkErrorString = this->serialPort->errorString();
+    };
+    // QThread::currentThread()->msleep(80);
+    QByteArray commandByte = this->prepareCommandByteArray(c);
+    bool waitForBytes = false;
+    // Could this be a problem here because there are pending commands?
+    if (!this->serialPort->clear(QSerialPort::Direction::AllDirections)) {
+        ;
+        log.eal_error("Could not clear serial port buffers");
+        log.eal_error(
+            "Error: " +
+            static_cast<QString>(this->serialPort->error()).toStdString());
+        this->serialPort->clearError();
+    }
+    qint64 bytesWritten =
+        this->serialPort->write(commandByte, commandByte.length());
+    if (bytesWritten != -1) {
+        log.eal_debug("Bytes written: " +
+                      QString::number(bytesWritten).toStdString() + "\n" +
+                      "command length: " +
+                      QString::number(commandByte.length()).toStdString());
+        // wait for for bytes to be written
+        if (commandByte != "") {
+            waitForBytes =
+                this->serialPort->waitForBytesWritten(this->portTimeOut);
+            // waitForBytes = this->serialPort->waitForBytesWritten(1000);
+        }
+    } else {
+        log.eal_error(
+            "Could not write command " +
+            std::string(commandByte.constData(), commandByte.length()));
+        log.eal_error(
+            "Error: " +
+            static_cast<QString>(this->serialPort->error()).toStdString());
+        linkError();
+        this->serialPort->clearError();
+        success = false;
+    }
+
+    if (waitForBytes) {
+        // is this a command with feedback?
+        if (c->getCommandWithReply()) {
+            QByteArray reply = "0";
+            if (commandByte != "") {
+                // wait until port is ready to read
+                if (this->serialPort->waitForReadyRead(1000)) {
+                    if (serialPort->bytesAvailable())
+                        reply.clear();
+                    while (serialPort->bytesAvailable()) {
+                        reply.append(this->serialPort->readAll());
+                        this->serialPort->waitForReadyRead(this->portTimeOut);
+                    }
+                } else {
+                    log.eal_error("Wait for ready read for command " +
+                                  std::string(commandByte.constData(),
+                                              commandByte.length()) +
+                                  " timed out");
+                    log.eal_error(
+                        "Error: " +
+                        static_cast<QString>(this->serialPort->error())
+                            .toStdString());
+                    linkError();
+                    this->serialPort->clearError();
+                    success = false;
+                }
+                //                    while
+                //                    (this->serialPort->waitForReadyRead(1))
+                //                    {
+                //                        reply +=
+                //                        this->serialPort->readAll();
+                //                    }
+            }
+            c->setValue(reply);
+            this->processCommands(status, c);
+        } else {
+            this->processCommands(status, c);
+        }
+    } else {
+        emit this->errorReadWrite(QString(this->serialPort->error()));
+        log.eal_error("Could not read from or write to device: " +
+                      QString(this->serialPort->error()).toStdString());
+        linkError();
+        this->serialPort->clearError();
+        success = false;
+    }
+    if (success) {
+        this->linkErrors = 0;
+    } else if (resourceError ||
+               ++this->linkErrors >= powcon::LINK_LOST_ERRORS) {
+        this->linkLost = true;
+    }
+    return success;
+}
+
+void PowerSupplySCPI::controlCycle()
+{
+    namespace ctrlcon = control_constants;
+    namespace globcon = global_constants;
+
+    std::chrono::steady_clock::time_point cycleStart =
+        std::chrono::steady_clock::now();
+    {
+        QMutexLocker qlock(&this->qserialPortGuard);
+        for (int channel : this->controlLoop.getChannels()) {
+            // measurements go into a scratch status, the values of powStatus
+            // can not be overwritten until the next status update
+            std::shared_ptr<PowerSupplyStatus> measured =
+                std::make_shared<PowerSupplyStatus>();
+            auto voltageCom = std::make_shared<SerialCommand>(
+                static_cast<int>(powcon::COMMANDS::GETVOLTAGE), channel,
+                QVariant(), true);
+            auto currentCom = std::make_shared<SerialCommand>(
+                static_cast<int>(powcon::COMMANDS::GETCURRENT), channel,
+                QVariant(), true);
+            if (!this->transferCommand(voltageCom, measured) ||
+                !this->transferCommand(currentCom, measured))
+                break;
+            // the control loop may measure more often than the status update
+            this->checkWatchdog(currentCom, measured);
+            double voltageSet = 0;
+            try {
+                voltageSet = this->powStatus->getVoltageSet(channel);
+            } catch (const std::out_of_range &) {
+            }
+            bool finished = false;
+            std::vector<ControlAction> actions;
+            try {
+                actions = this->controlLoop.update(
+                    channel, measured->getVoltage(channel),
+                    measured->getCurrent(channel), voltageSet, finished);
+            } catch (const std::out_of_range &) {
+                continue;
+            }
+            for (const ControlAction &action : actions) {
+                std::shared_ptr<SerialCommand> com;
+                if (action.outputOff) {
+                    // pushed like a user request so the GUI sees the change
+                    this->setOutput(action.channel, false);
+                    continue;
+                }
+                if (action.target == globcon::LPQ_DATATYPE::SETVOLTAGE) {
+                    QString value = QString::number(action.value, 'f',
+                                                    this->voltageAccuracy);
+                    // nothing to send below the resolution of the device
+                    if (value ==
+                        QString::number(voltageSet, 'f', this->voltageAccuracy))
+                        continue;
+                    com = std::make_shared<SerialCommand>(
+                        static_cast<int>(powcon::COMMANDS::SETVOLTAGESET),
+                        action.channel, QVariant(value));
+                } else {
+                    QString value = QString::number(action.value, 'f',
+                                                    this->currentAccuracy);
+                    com = std::make_shared<SerialCommand>(
+                        static_cast<int>(powcon::COMMANDS::SETCURRENTSET),
+                        action.channel, QVariant(value));
+                }
+                // applies the setpoint to powStatus once it was written
+                this->transferCommand(com, this->powStatus);
+            }
+            if (finished)
+                emit this->controlLoopFinished(channel);
+        }
+    }
+    PerfMetrics::get_instance().sample(
+        "control.cycle.ms",
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - cycleStart)
+            .count());
+    // a fast port must not be flooded, the loops do not need more than that
+    std::this_thread::sleep_until(
+        cycleStart + std::chrono::milliseconds(ctrlcon::MIN_PERIOD));
+}
+
+void PowerSupplySCPI::checkWatchdog(
+    const std::shared_ptr<SerialCommand> &c,
+    const std::shared_ptr<PowerSupplyStatus> &measured)
+{
+    if (c->getCommand() != powcon::COMMANDS::GETVOLTAGE &&
+        c->getCommand() != powcon::COMMANDS::GETCURRENT)
+        return;
+    if (!this->watchdog.isActive())
+        return;
+    int channel = c->getPowerSupplyChannel();
+    double voltage = 0;
+    double current = 0;
+    bool output = false;
+    try {
+        voltage = measured->getVoltage(channel);
+        current = measured->getCurrent(channel);
+    } catch (const std::out_of_range &) {
+        // not all values of this status are known yet
+        return;
+    }
+    try {
+        output = this->powStatus->getChannelOutput(channel);
+    } catch (const std::out_of_range &) {
+        // the status byte of this update was not read yet
+        if (!this->lastStatus)
+            return;
+        try {
+            output = this->lastStatus->getChannelOutput(channel);
+        } catch (const std::out_of_range &) {
+            return;
+        }
+    }
+    std::chrono::steady_clock::time_point detected =
+        std::chrono::steady_clock::now();
+    WatchdogTrip trip;
+    if (!this->watchdog.evaluate(channel, voltage, current, output, detected,
+                                 trip))
+        return;
+    for (int attempt = 0;
+         attempt < watchdog_constants::OUTPUT_OFF_ATTEMPTS && !trip.outputOff;
+         attempt++) {
+        trip.outputOff = this->transferCommand(
+            this->prepareOutputCommand(channel, false), this->powStatus);
+    }
+    if (trip.outputOff) {
+        trip.latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - detected)
+                           .count();
+        PerfMetrics::get_instance().sample("watchdog.trip.latency.us",
+                                           static_cast<double>(trip.latency));
+    }
+    trip.time = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+    // a control loop would switch the output on again
+    for (int loopChannel : this->controlLoop.getChannels()) {
+        this->controlLoop.configure(loopChannel, ControlConfig());
+        emit this->controlLoopFinished(loopChannel);
+    }
+    std::string tripText = "Watchdog rule " + std::to_string(trip.rule + 1) +
+                           " tripped on channel " + std::to_string(channel) +
+                           " with " + std::to_string(trip.value);
+    if (trip.outputOff) {
+        LogInstance::get_instance().eal_warn(
+            tripText + ", output off after " + std::to_string(trip.latency) +
+            " µs");
+    } else {
+        LogInstance::get_instance().eal_error(
+            tripText + ", the output could not be switched off after " +
+            std::to_string(watchdog_constants::OUTPUT_OFF_ATTEMPTS) +
+            " attempts and may still be on");
+    }
+    emit this->watchdogTripped(trip);
+}
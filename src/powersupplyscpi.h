@@ -31,8 +31,11 @@
 #include <QString>
 #include <QtSerialPort/QtSerialPort>
 
+#include "controlloop.h"
 #include "log_instance.h"
+#include "perfmetrics.h"
 #include "powersupplystatus.h"
+#include "safetywatchdog.h"
 #include "serialcommand.h"
 #include "serialqueue.h"
 
@@ -70,6 +73,10 @@ enum COMMANDS {
     GETOTP,
     SETDUMMY = 100 /**< A dummy command intended for internal use. */
 };
+/**
+ * @brief Consecutive failed commands after which the connection is lost
+ */
+const int LINK_LOST_ERRORS = 3;
 }
 
 /**
@@ -120,6 +127,20 @@ public:
     virtual void setBeep(bool status) = 0;
     virtual void setTracking(global_constants::LPQ_TRACKING trMode) = 0;
     virtual void setOutput(int channel, bool status) = 0;
+    /**
+     * @brief Run a closed loop control mode on channel
+     *
+     * @details
+     *
+     * The loop is executed by the worker thread whenever no commands are
+     * queued, the loop period only depends on the latency of the serial port.
+     * CONTROL_MODE::OFF stops the loop of the channel.
+     */
+    void setControlMode(int channel, const ControlConfig &config);
+    /**
+     * @brief Replace the trip rules of the watchdog, see SafetyWatchdog
+     */
+    void setWatchdogRules(std::vector<WatchdogRule> rules);
 
 signals:
 
@@ -143,8 +164,41 @@ signals:
     void deviceOpen();
 
     void backgroundThreadStopped();
+    /**
+     * @brief The control loop of channel has ended by itself
+     */
+    void controlLoopFinished(int channel);
+    /**
+     * @brief A watchdog rule tripped and the output was switched off
+     */
+    void watchdogTripped(WatchdogTrip trip);
+    /**
+     * @brief The port was closed because the device stopped answering
+     *
+     * @details
+     *
+     * Emitted after LINK_LOST_ERRORS consecutive commands failed or the port
+     * reported a resource error, e.g. because the USB adapter was unplugged.
+     * The worker thread keeps running, use reconnect to open the port again.
+     */
+    void connectionLost(const QString &errorString);
+    /**
+     * @brief A reconnect could not open the port
+     */
+    void reconnectFailed(const QString &errorString);
 
 public slots:
+    /**
+     * @brief Open the port again after connectionLost
+     *
+     * @details
+     *
+     * Must be invoked queued so it runs on the worker thread. Emits deviceOpen
+     * and continues with the queued commands on success, reconnectFailed
+     * otherwise. If the worker was stopped meanwhile backgroundThreadStopped
+     * is emitted instead.
+     */
+    void reconnect();
 
 protected:
     /**
@@ -182,6 +236,12 @@ protected:
     QMutex qserialPortGuard;
 
     bool backgroundWorkerThreadRun;
+    /**
+     * @brief Consecutive commands that failed, only used by the worker thread
+     */
+    int linkErrors;
+    bool linkLost;
+    QString linkErrorString;
 
     /**
      * @brief statusCommands The commands needed to get the Power Supply status
@@ -189,6 +249,13 @@ protected:
     std::vector<PowerSupplySCPI_constants::COMMANDS> statusCommands;
 
     std::shared_ptr<PowerSupplyStatus> powStatus;
+    /**
+     * @brief Last complete status, knows the outputs before powStatus does
+     */
+    std::shared_ptr<PowerSupplyStatus> lastStatus;
+
+    ControlLoop controlLoop;
+    SafetyWatchdog watchdog;
 
     /**
      * @brief This method is run by a external QThread instance
@@ -198,12 +265,62 @@ protected:
      * the same thread that accesses it later.
      */
     void threadFunc();
+    /**
+     * @brief Create and open serialPort, it is deleted again on failure
+     */
+    bool openPort(QString &errorString);
+    /**
+     * @brief Process commands until the worker is stopped or the link is lost
+     */
+    void workerLoop();
 
     virtual void readWriteData(std::shared_ptr<SerialCommand> com);
+    /**
+     * @brief Write c to the port and process the reply into status
+     *
+     * @details
+     *
+     * The caller must hold qserialPortGuard.
+     *
+     * @return False if writing or reading failed
+     */
+    bool transferCommand(const std::shared_ptr<SerialCommand> &c,
+                         const std::shared_ptr<PowerSupplyStatus> &status);
+    /**
+     * @brief Measure all channels with a control loop and adjust them
+     */
+    void controlCycle();
+    /**
+     * @brief Evaluate the watchdog after c was processed into measured
+     *
+     * @details
+     *
+     * Once voltage and current of the channel of c are known the rules are
+     * evaluated. measured is powStatus for status updates and the scratch
+     * status of a control cycle, the output state is taken from powStatus or
+     * lastStatus. A trip writes the output off command immediately, queued
+     * commands are not waited for. The caller must hold qserialPortGuard.
+     */
+    void checkWatchdog(const std::shared_ptr<SerialCommand> &c,
+                       const std::shared_ptr<PowerSupplyStatus> &measured);
     virtual QByteArray prepareCommandByteArray(
         const std::shared_ptr<SerialCommand> &com) = 0;
     virtual std::vector<std::shared_ptr<SerialCommand>>
     prepareStatusCommands() = 0;
+    /**
+     * @brief Command that switches the output of channel on or off
+     */
+    virtual std::shared_ptr<SerialCommand> prepareOutputCommand(
+        int channel, bool status) = 0;
+    /**
+     * @brief Apply the reply of com or the setpoint it has written to status
+     *
+     * @details
+     *
+     * Called on the worker thread for every command that was written to the
+     * device. The setters only queue commands, so powStatus is never written
+     * from the threads that call them.
+     */
     virtual void processCommands(
         const std::shared_ptr<PowerSupplyStatus> &status,
         const std::shared_ptr<SerialCommand> &com) = 0;
@@ -22,6 +22,7 @@
 #include <memory>
 #include <ostream>
 #include <utility>
+#include <vector>
 
 #include <QMutex>
 #include <QMutexLocker>
@@ -183,7 +184,8 @@ public:
 
     void setChannelOutput(PowerSupplyStatus_constants::CHANNELOUTPUT output)
     {
-        this->channelOutput.insert(output);
+        // an output command overrides the state read from the device
+        this->channelOutput[output.first] = output.second;
     }
     bool getChannelOutput(int channel)
     {
@@ -228,5 +230,6 @@ private:
 // Register our metatype. Needed to send this kind of object wrapped in a std
 // smart pointer via SIGNAL/SLOT mechanism
 Q_DECLARE_METATYPE(std::shared_ptr<PowerSupplyStatus>)
+Q_DECLARE_METATYPE(std::vector<std::shared_ptr<PowerSupplyStatus>>)
 
 #endif  // POWERSUPPLYSTATUS
@@ -0,0 +1,68 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "reconnectsupervisor.h"
+
+#include <algorithm>
+
+namespace reccon = reconnect_constants;
+
+ReconnectSupervisor::ReconnectSupervisor()
+    : QObject(), active(false), delay(reccon::INITIAL_DELAY), attempts(0)
+{
+    this->timer.setSingleShot(true);
+    QObject::connect(&this->timer, &QTimer::timeout, [this]() {
+        this->attempts++;
+        emit this->attempt(this->attempts);
+    });
+}
+
+void ReconnectSupervisor::connectionLost()
+{
+    if (this->active)
+        return;
+    this->active = true;
+    this->attempts = 0;
+    this->delay = reccon::INITIAL_DELAY;
+    this->lostAt = std::chrono::steady_clock::now();
+    this->timer.start(this->delay);
+}
+
+void ReconnectSupervisor::attemptFailed()
+{
+    if (!this->active)
+        return;
+    this->delay = std::min(this->delay * 2, reccon::MAX_DELAY);
+    this->timer.start(this->delay);
+}
+
+qint64 ReconnectSupervisor::reconnected()
+{
+    this->timer.stop();
+    this->active = false;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - this->lostAt)
+        .count();
+}
+
+void ReconnectSupervisor::stop()
+{
+    this->timer.stop();
+    this->active = false;
+}
+
+bool ReconnectSupervisor::isActive() const { return this->active; }
+int ReconnectSupervisor::getAttempts() const { return this->attempts; }
@@ -0,0 +1,94 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef RECONNECTSUPERVISOR_H
+#define RECONNECTSUPERVISOR_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+namespace reconnect_constants
+{
+/**
+ * @brief Delay in ms before the first reconnect attempt
+ */
+const int INITIAL_DELAY = 250;
+/**
+ * @brief Upper bound in ms of the delay between two attempts
+ */
+const int MAX_DELAY = 30000;
+}
+
+/**
+ * @brief Schedules reconnect attempts with exponential backoff
+ *
+ * @details
+ *
+ * After connectionLost the first attempt is signalled after INITIAL_DELAY ms.
+ * Every failed attempt doubles the delay up to MAX_DELAY, so an adapter that
+ * is back after a glitch is reopened right away while a device that is
+ * switched off for the night is only probed twice a minute. The supervisor
+ * measures the downtime on a monotonic clock.
+ */
+class ReconnectSupervisor : public QObject
+{
+    Q_OBJECT
+
+public:
+    ReconnectSupervisor();
+
+    /**
+     * @brief The connection was lost, start the downtime and schedule the
+     * first attempt
+     */
+    void connectionLost();
+    /**
+     * @brief The last attempt failed, schedule the next one
+     */
+    void attemptFailed();
+    /**
+     * @brief The device is connected again
+     *
+     * @return Downtime in ms
+     */
+    qint64 reconnected();
+    /**
+     * @brief Give up, no further attempts are made
+     */
+    void stop();
+    bool isActive() const;
+    /**
+     * @brief Number of attempts since the connection was lost
+     */
+    int getAttempts() const;
+
+signals:
+    /**
+     * @brief Time for the next attempt to open the port
+     */
+    void attempt(int number);
+
+private:
+    QTimer timer;
+    bool active;
+    int delay;
+    int attempts;
+    std::chrono::steady_clock::time_point lostAt;
+};
+
+#endif  // RECONNECTSUPERVISOR_H
@@ -0,0 +1,126 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "recordflushpolicy.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace flushcon = record_flush_constants;
+
+RecordFlushPolicy::RecordFlushPolicy()
+{
+    this->maxSamples = 1;
+    this->maxAge = std::chrono::milliseconds(0);
+    this->sampleLimit = 1;
+    this->flushes = 0;
+    this->sumW = 0;
+    this->sumN = 0;
+    this->sumT = 0;
+    this->sumNN = 0;
+    this->sumNT = 0;
+    this->commitCost = -1;
+    this->sampleCost = -1;
+}
+
+void RecordFlushPolicy::setMaxSamples(int maxSamples)
+{
+    this->maxSamples = std::max(1, maxSamples);
+    this->updateLimit();
+}
+
+void RecordFlushPolicy::setMaxAge(std::chrono::milliseconds maxAge)
+{
+    this->maxAge = maxAge;
+}
+
+flushcon::FLUSH_REASON RecordFlushPolicy::check(
+    int bufferedSamples, std::chrono::milliseconds age) const
+{
+    if (bufferedSamples <= 0)
+        return flushcon::FLUSH_REASON::NONE;
+    if (bufferedSamples >= this->sampleLimit)
+        return flushcon::FLUSH_REASON::COUNT;
+    if (this->maxAge.count() > 0 && age >= this->maxAge)
+        return flushcon::FLUSH_REASON::AGE;
+    return flushcon::FLUSH_REASON::NONE;
+}
+
+void RecordFlushPolicy::flushed(int samples, double durationMs)
+{
+    if (samples <= 0)
+        return;
+    this->flushes++;
+    double n = static_cast<double>(samples);
+    this->sumW = this->sumW * flushcon::COST_DECAY + 1;
+    this->sumN = this->sumN * flushcon::COST_DECAY + n;
+    this->sumT = this->sumT * flushcon::COST_DECAY + durationMs;
+    this->sumNN = this->sumNN * flushcon::COST_DECAY + n * n;
+    this->sumNT = this->sumNT * flushcon::COST_DECAY + n * durationMs;
+    this->updateLimit();
+}
+
+int RecordFlushPolicy::getSampleLimit() const { return this->sampleLimit; }
+double RecordFlushPolicy::getCommitCost() const { return this->commitCost; }
+double RecordFlushPolicy::getSampleCost() const { return this->sampleCost; }
+void RecordFlushPolicy::updateLimit()
+{
+    if (this->sumW <= 0) {
+        // nothing measured yet
+        this->sampleLimit = this->maxSamples;
+        return;
+    }
+
+    double denom = this->sumW * this->sumNN - this->sumN * this->sumN;
+    if (denom > 1e-6 * this->sumW * this->sumNN) {
+        this->sampleCost =
+            (this->sumW * this->sumNT - this->sumN * this->sumT) / denom;
+        this->commitCost =
+            (this->sumT - this->sampleCost * this->sumN) / this->sumW;
+    } else if (this->sampleCost < 0) {
+        // All flushes had the same size so fixed and per sample cost can not
+        // be separated. Use a different buffer size for the next flush.
+        this->sampleLimit = std::max(1, this->maxSamples / 2);
+        return;
+    }
+    this->sampleCost = std::max(this->sampleCost, 1e-6);
+    this->commitCost = std::max(this->commitCost, 0.0);
+
+    // smallest buffer where the commit cost is an acceptable share ...
+    double lower = this->commitCost /
+                   (flushcon::COMMIT_OVERHEAD_SHARE * this->sampleCost);
+    // ... and the largest buffer that can be written within the budget
+    double upper =
+        (flushcon::FLUSH_BUDGET_MS - this->commitCost) / this->sampleCost;
+    int minLimit = std::min(this->maxSamples, flushcon::MIN_SAMPLES);
+    int upperLimit = std::max(
+        minLimit, static_cast<int>(std::floor(std::min(
+                      upper, static_cast<double>(this->maxSamples)))));
+    this->sampleLimit = std::max(
+        minLimit, static_cast<int>(std::ceil(
+                      std::min(lower, static_cast<double>(upperLimit)))));
+
+    // the next flush uses another size so the fit can recover from stale
+    // costs
+    if (this->flushes % flushcon::PROBE_INTERVAL == 0) {
+        if (this->sampleLimit * 2 <= this->maxSamples) {
+            this->sampleLimit *= 2;
+        } else {
+            this->sampleLimit = std::max(1, this->sampleLimit / 2);
+        }
+    }
+}
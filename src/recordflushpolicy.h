@@ -0,0 +1,126 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RECORDFLUSHPOLICY_H
+#define RECORDFLUSHPOLICY_H
+
+#include <chrono>
+
+namespace record_flush_constants
+{
+enum class FLUSH_REASON { NONE = 0, COUNT, AGE, STOP };
+/**
+ * @brief Time a single flush may block the GUI thread
+ */
+const double FLUSH_BUDGET_MS = 50.0;
+/**
+ * @brief Maximum share of the fixed commit cost on the total insert cost
+ */
+const double COMMIT_OVERHEAD_SHARE = 0.1;
+/**
+ * @brief Weight of older flushes in the cost model
+ */
+const double COST_DECAY = 0.9;
+/**
+ * @brief Smallest buffer limit, unless the user configured a smaller buffer
+ *
+ * @details
+ *
+ * Noisy fsync timings easily produce a fitted commit cost of zero which would
+ * otherwise reduce the limit to one sample per transaction.
+ */
+const int MIN_SAMPLES = 16;
+/**
+ * @brief Every PROBE_INTERVAL-th flush uses a different buffer size
+ *
+ * @details
+ *
+ * Fixed and per sample cost can only be separated if the flushes have
+ * different sizes, probing keeps the fit from getting stuck.
+ */
+const int PROBE_INTERVAL = 8;
+}
+
+/**
+ * @brief Decides when the measurement buffer has to be written to disk
+ *
+ * @details
+ *
+ * The buffer is flushed when it holds enough samples or when the oldest sample
+ * exceeds a maximum age. The age limit bounds the data lost in a crash.
+ *
+ * The number of samples is derived from the measured cost of previous
+ * flushes. The insert time of a flush is modelled as t = c + r * n where c is
+ * the fixed commit cost and r the cost per sample. Both are fitted with an
+ * exponentially weighted least squares regression. The buffer limit is chosen
+ * large enough that c stays below COMMIT_OVERHEAD_SHARE of the total cost and
+ * small enough that a flush stays within FLUSH_BUDGET_MS. The user configured
+ * buffer size is the upper bound, MIN_SAMPLES the lower bound. Every
+ * PROBE_INTERVAL-th flush is done with twice or half the limit so the model
+ * always sees different flush sizes.
+ */
+class RecordFlushPolicy
+{
+public:
+    RecordFlushPolicy();
+
+    void setMaxSamples(int maxSamples);
+    void setMaxAge(std::chrono::milliseconds maxAge);
+
+    /**
+     * @brief Check if the buffer has to be flushed
+     *
+     * @param bufferedSamples Number of samples in the buffer
+     * @param age Age of the oldest sample in the buffer
+     */
+    record_flush_constants::FLUSH_REASON check(
+        int bufferedSamples, std::chrono::milliseconds age) const;
+    /**
+     * @brief Feed the cost model with a finished flush
+     *
+     * @param samples Number of samples that were written
+     * @param durationMs Time the flush took
+     */
+    void flushed(int samples, double durationMs);
+
+    /**
+     * @brief Current buffer limit derived from the cost model
+     */
+    int getSampleLimit() const;
+    double getCommitCost() const;
+    double getSampleCost() const;
+
+private:
+    int maxSamples;
+    std::chrono::milliseconds maxAge;
+    int sampleLimit;
+    int flushes;
+
+    // exponentially weighted sums for the least squares fit
+    double sumW;
+    double sumN;
+    double sumT;
+    double sumNN;
+    double sumNT;
+
+    double commitCost;
+    double sampleCost;
+
+    void updateLimit();
+};
+
+#endif  // RECORDFLUSHPOLICY_H
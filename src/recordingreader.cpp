@@ -0,0 +1,230 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "recordingreader.h"
+
+#include <chrono>
+#include <limits>
+
+namespace dbcon = database_constants;
+namespace rollcon = rollup_constants;
+namespace rollutil = rollup_utils;
+
+RecordingReader::RecordingReader() : QObject()
+{
+    this->connectionName =
+        QString("recordingreader_%1")
+            .arg(reinterpret_cast<quintptr>(this), 0, 16);
+}
+
+RecordingReader::~RecordingReader()
+{
+    if (QSqlDatabase::contains(this->connectionName)) {
+        QSqlDatabase::database(this->connectionName, false).close();
+        QSqlDatabase::removeDatabase(this->connectionName);
+    }
+}
+
+void RecordingReader::readRange(QString dbFile, QString device, qint64 from,
+                                qint64 to, int maxPoints)
+{
+    std::vector<std::shared_ptr<PowerSupplyStatus>> statuses;
+    if (!this->openDatabase(dbFile)) {
+        emit this->rangeRead(from, to, std::move(statuses));
+        return;
+    }
+    QSqlDatabase db = QSqlDatabase::database(this->connectionName);
+
+    QSqlQuery recQuery(db);
+    // clang-format off
+    recQuery.prepare(QString("SELECT ") + dbcon::TBL_RECORDING_ID + ", "
+                     + dbcon::TBL_RECORDING_FILE + " FROM " + dbcon::TBL_RECORDING
+                     + " WHERE " + dbcon::TBL_RECORDING_DEVICE + " = ? AND "
+                     + dbcon::TBL_RECORDING_START + " <= ? AND ("
+                     + dbcon::TBL_RECORDING_STOP + " IS NULL OR "
+                     + dbcon::TBL_RECORDING_STOP + " >= ?) ORDER BY "
+                     + dbcon::TBL_RECORDING_START);
+    // clang-format on
+    recQuery.bindValue(0, device);
+    recQuery.bindValue(1, QDateTime::fromMSecsSinceEpoch(to));
+    recQuery.bindValue(2, QDateTime::fromMSecsSinceEpoch(from));
+    if (!recQuery.exec()) {
+        LogInstance::get_instance().eal_error(
+            recQuery.lastError().text().toStdString());
+        emit this->rangeRead(from, to, std::move(statuses));
+        return;
+    }
+
+    rollcon::LEVEL level = rollutil::levelForSpan(to - from, maxPoints);
+    while (recQuery.next()) {
+        long long recID = recQuery.value(0).toLongLong();
+        QString dataFile = recQuery.value(1).toString();
+        if (level != rollcon::LEVEL::RAW &&
+            this->readRollup(recID, level, from, to, statuses))
+            continue;
+        if (dataFile.isEmpty()) {
+            this->readDatabase(recID, from, to, statuses);
+        } else {
+            this->readBinary(dataFile, from, to, statuses);
+        }
+    }
+    emit this->rangeRead(from, to, std::move(statuses));
+}
+
+bool RecordingReader::openDatabase(const QString &dbFile)
+{
+    QSqlDatabase db;
+    if (QSqlDatabase::contains(this->connectionName)) {
+        db = QSqlDatabase::database(this->connectionName, false);
+        if (db.databaseName() == dbFile && db.isOpen())
+            return true;
+        db.close();
+    } else {
+        db = QSqlDatabase::addDatabase("QSQLITE", this->connectionName);
+    }
+    db.setDatabaseName(dbFile);
+    db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+    if (!db.open()) {
+        LogInstance::get_instance().eal_error(
+            "Can not open database for reading recordings: " +
+            db.lastError().text().toStdString());
+        return false;
+    }
+    return true;
+}
+
+void RecordingReader::readDatabase(
+    long long recID, qint64 from, qint64 to,
+    std::vector<std::shared_ptr<PowerSupplyStatus>> &out)
+{
+    QSqlQuery query(QSqlDatabase::database(this->connectionName));
+    query.setForwardOnly(true);
+    // clang-format off
+    query.prepare(QString("SELECT m.") + dbcon::TBL_MEASUREMENT_TIME + ", "
+                  + "c." + dbcon::TBL_CHANNEL_CHAN + ", "
+                  + "c." + dbcon::TBL_CHANNEL_VS + ", "
+                  + "c." + dbcon::TBL_CHANNEL_V + ", "
+                  + "c." + dbcon::TBL_CHANNEL_AS + ", "
+                  + "c." + dbcon::TBL_CHANNEL_A + ", "
+                  + "c." + dbcon::TBL_CHANNEL_W + " \n"
+                  + "FROM " + dbcon::TBL_CHANNEL + " AS c \n"
+                  + "INNER JOIN " + dbcon::TBL_MEASUREMENT + " AS m \n"
+                  + "ON c." + dbcon::TBL_CHANNEL_MES + " = m." + dbcon::TBL_MEASUREMENT_ID + "\n"
+                  + "WHERE m." + dbcon::TBL_MEASUREMENT_REC + " = ? AND m."
+                  + dbcon::TBL_MEASUREMENT_TIME + " BETWEEN ? AND ? \n"
+                  + "ORDER BY m." + dbcon::TBL_MEASUREMENT_TIME + ", c." + dbcon::TBL_CHANNEL_CHAN);
+    // clang-format on
+    query.bindValue(0, recID);
+    query.bindValue(1, QDateTime::fromMSecsSinceEpoch(from));
+    query.bindValue(2, QDateTime::fromMSecsSinceEpoch(to));
+    if (!query.exec()) {
+        LogInstance::get_instance().eal_error(
+            query.lastError().text().toStdString());
+        return;
+    }
+    // one row per channel, rows of the same measurement share the time
+    QString lastTime;
+    std::shared_ptr<PowerSupplyStatus> status;
+    while (query.next()) {
+        QString time = query.value(0).toString();
+        if (!status || time != lastTime) {
+            status = std::make_shared<PowerSupplyStatus>();
+            status->setTime(std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(
+                    QDateTime::fromString(time, Qt::ISODateWithMs)
+                        .toMSecsSinceEpoch())));
+            out.push_back(status);
+            lastTime = time;
+        }
+        int channel = query.value(1).toInt();
+        status->setVoltageSet(
+            std::make_pair(channel, query.value(2).toDouble()));
+        status->setVoltage(std::make_pair(channel, query.value(3).toDouble()));
+        status->setCurrentSet(
+            std::make_pair(channel, query.value(4).toDouble()));
+        status->setCurrent(std::make_pair(channel, query.value(5).toDouble()));
+        status->setWattage(std::make_pair(channel, query.value(6).toDouble()));
+    }
+}
+
+void RecordingReader::readBinary(
+    const QString &dataFile, qint64 from, qint64 to,
+    std::vector<std::shared_ptr<PowerSupplyStatus>> &out)
+{
+    BinaryRecordingReader reader(dataFile);
+    if (!reader.open()) {
+        LogInstance::get_instance().eal_error("Can not open binary recording " +
+                                              dataFile.toStdString());
+        return;
+    }
+    long long first = reader.findSample(from);
+    long long last = reader.findSample(to + 1);
+    for (long long i = first; i < last; i++) {
+        out.push_back(reader.sample(i));
+    }
+}
+
+bool RecordingReader::readRollup(
+    long long recID, rollcon::LEVEL level, qint64 from, qint64 to,
+    std::vector<std::shared_ptr<PowerSupplyStatus>> &out)
+{
+    QSqlQuery query(QSqlDatabase::database(this->connectionName));
+    query.setForwardOnly(true);
+    // clang-format off
+    query.prepare(QString("SELECT ") + dbcon::TBL_ROLLUP_BUCKET + ", "
+                  + dbcon::TBL_ROLLUP_CHAN + ", voltage_mean, current_mean, wattage_mean"
+                  + " FROM " + dbcon::TBL_ROLLUP + " WHERE "
+                  + dbcon::TBL_ROLLUP_REC + " = ? AND "
+                  + dbcon::TBL_ROLLUP_LEVEL + " = ? AND "
+                  + dbcon::TBL_ROLLUP_BUCKET + " BETWEEN ? AND ? ORDER BY "
+                  + dbcon::TBL_ROLLUP_BUCKET + ", " + dbcon::TBL_ROLLUP_CHAN);
+    // clang-format on
+    query.bindValue(0, recID);
+    query.bindValue(1, static_cast<int>(level));
+    query.bindValue(2, rollutil::bucketStart(level, from));
+    query.bindValue(3, to);
+    if (!query.exec()) {
+        LogInstance::get_instance().eal_error(
+            query.lastError().text().toStdString());
+        return false;
+    }
+    // set values are not aggregated, NaN leaves a gap in the plot
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    bool found = false;
+    long long lastBucket = 0;
+    std::shared_ptr<PowerSupplyStatus> status;
+    while (query.next()) {
+        found = true;
+        long long bucket = query.value(0).toLongLong();
+        if (!status || bucket != lastBucket) {
+            status = std::make_shared<PowerSupplyStatus>();
+            // plot the mean in the middle of the bucket
+            status->setTime(std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(
+                    bucket + rollutil::bucketLength(level) / 2)));
+            out.push_back(status);
+            lastBucket = bucket;
+        }
+        int channel = query.value(1).toInt();
+        status->setVoltageSet(std::make_pair(channel, nan));
+        status->setVoltage(std::make_pair(channel, query.value(2).toDouble()));
+        status->setCurrentSet(std::make_pair(channel, nan));
+        status->setCurrent(std::make_pair(channel, query.value(3).toDouble()));
+        status->setWattage(std::make_pair(channel, query.value(4).toDouble()));
+    }
+    return found;
+}
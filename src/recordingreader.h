@@ -0,0 +1,98 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RECORDINGREADER_H
+#define RECORDINGREADER_H
+
+#include <QObject>
+#include <QString>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <QDateTime>
+
+#include <memory>
+#include <vector>
+
+#include "binaryrecordingreader.h"
+#include "databasedef.h"
+#include "log_instance.h"
+#include "powersupplystatus.h"
+#include "rollupaccumulator.h"
+
+/**
+ * @brief Reads recorded measurements of a time range in a worker thread
+ *
+ * @details
+ *
+ * Measurements are read from all recordings of a device that overlap the
+ * requested range, no matter if they are stored in the database or in binary
+ * recording files. If the range would yield too many points the means of the
+ * coarsest sufficient rollup level are returned instead. Set values are not
+ * part of the rollups and are NaN in this case.
+ *
+ * The reader uses its own database connection and is meant to be moved to a
+ * QThread.
+ */
+class RecordingReader : public QObject
+{
+    Q_OBJECT
+
+public:
+    RecordingReader();
+    ~RecordingReader();
+
+public slots:
+    /**
+     * @brief Read the measurements between from and to
+     *
+     * @param dbFile Database file
+     * @param device Device name of the recordings
+     * @param from Start of the range in ms since epoch
+     * @param to End of the range in ms since epoch
+     * @param maxPoints Maximum number of status objects before rollups are
+     * used
+     */
+    void readRange(QString dbFile, QString device, qint64 from, qint64 to,
+                   int maxPoints);
+
+signals:
+    /**
+     * @brief Status objects of the requested range in chronological order
+     */
+    void rangeRead(qint64 from, qint64 to,
+                   std::vector<std::shared_ptr<PowerSupplyStatus>> statuses);
+
+private:
+    QString connectionName;
+
+    bool openDatabase(const QString &dbFile);
+    void readDatabase(long long recID, qint64 from, qint64 to,
+                      std::vector<std::shared_ptr<PowerSupplyStatus>> &out);
+    void readBinary(const QString &dataFile, qint64 from, qint64 to,
+                    std::vector<std::shared_ptr<PowerSupplyStatus>> &out);
+    /**
+     * @return False if the recording has no buckets of this level
+     */
+    bool readRollup(long long recID, rollup_constants::LEVEL level,
+                    qint64 from, qint64 to,
+                    std::vector<std::shared_ptr<PowerSupplyStatus>> &out);
+};
+
+#endif  // RECORDINGREADER_H
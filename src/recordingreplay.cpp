@@ -0,0 +1,272 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "recordingreplay.h"
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace dbcon = database_constants;
+namespace replaycon = replay_constants;
+namespace globcon = global_constants;
+
+RecordingReplay::RecordingReplay(SequenceEngine::SetpointSink setpointSink,
+                                 OutputSink outputSink)
+    : QObject(),
+      setpointSink(std::move(setpointSink)),
+      outputSink(std::move(outputSink)),
+      running(false),
+      stopRequested(false),
+      recID(-1),
+      channels(0),
+      timeScale(1)
+{
+    this->connectionName =
+        QString("recordingreplay_%1")
+            .arg(reinterpret_cast<quintptr>(this), 0, 16);
+}
+
+RecordingReplay::~RecordingReplay() { this->stop(); }
+void RecordingReplay::start(QString dbFile, long long recID, QString dataFile,
+                            int channels, double timeScale)
+{
+    this->stop();
+    {
+        std::lock_guard<std::mutex> lock(this->stopMutex);
+        this->stopRequested = false;
+    }
+    this->dbFile = std::move(dbFile);
+    this->recID = recID;
+    this->dataFile = std::move(dataFile);
+    this->channels = channels;
+    this->timeScale = timeScale > 0 ? timeScale : 1;
+    this->running = true;
+    this->timingThread = std::thread(&RecordingReplay::run, this);
+}
+
+void RecordingReplay::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->stopMutex);
+        this->stopRequested = true;
+    }
+    this->stopCondition.notify_all();
+    if (this->timingThread.joinable())
+        this->timingThread.join();
+}
+
+bool RecordingReplay::isRunning() const { return this->running; }
+void RecordingReplay::run()
+{
+    this->firstSample = -1;
+    this->lastProgress = 0;
+    this->lastSent.assign(static_cast<size_t>(this->channels), ReplaySample());
+    bool completed = this->dataFile.isEmpty() ? this->replayDatabase()
+                                              : this->replayBinary();
+    this->running = false;
+    emit this->finished(!completed);
+}
+
+bool RecordingReplay::replayDatabase()
+{
+    bool completed = false;
+    {
+        // the connection belongs to this thread and is removed at the end
+        QSqlDatabase db =
+            QSqlDatabase::addDatabase("QSQLITE", this->connectionName);
+        db.setDatabaseName(this->dbFile);
+        db.setConnectOptions("QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000");
+        if (!db.open()) {
+            LogInstance::get_instance().eal_error(
+                "Can not open database for replaying a recording: " +
+                db.lastError().text().toStdString());
+        } else {
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            // keyset pages of measurements, see HistoryLoader::loadDatabase
+            // clang-format off
+            query.prepare(QString("SELECT m.") + dbcon::TBL_MEASUREMENT_ID + ", "
+                          + "m." + dbcon::TBL_MEASUREMENT_TIME + ", "
+                          + "c." + dbcon::TBL_CHANNEL_CHAN + ", "
+                          + "c." + dbcon::TBL_CHANNEL_VS + ", "
+                          + "c." + dbcon::TBL_CHANNEL_AS + ", "
+                          + "c." + dbcon::TBL_CHANNEL_OUTPUT + " \n"
+                          + "FROM " + dbcon::TBL_MEASUREMENT + " AS m \n"
+                          + "INNER JOIN " + dbcon::TBL_CHANNEL + " AS c \n"
+                          + "ON c." + dbcon::TBL_CHANNEL_MES + " = m." + dbcon::TBL_MEASUREMENT_ID + "\n"
+                          + "WHERE m." + dbcon::TBL_MEASUREMENT_ID + " IN (SELECT " + dbcon::TBL_MEASUREMENT_ID + " FROM " + dbcon::TBL_MEASUREMENT
+                          + " WHERE " + dbcon::TBL_MEASUREMENT_REC + " = ? AND "
+                          + "(" + dbcon::TBL_MEASUREMENT_TIME + ", " + dbcon::TBL_MEASUREMENT_ID + ") > (?, ?) "
+                          + "ORDER BY " + dbcon::TBL_MEASUREMENT_TIME + ", " + dbcon::TBL_MEASUREMENT_ID + " LIMIT ?) \n"
+                          + "ORDER BY m." + dbcon::TBL_MEASUREMENT_TIME + ", m." + dbcon::TBL_MEASUREMENT_ID + ", c." + dbcon::TBL_CHANNEL_CHAN);
+            // clang-format on
+            QVariant cursorTime = QDateTime::fromMSecsSinceEpoch(0);
+            long long cursorID = 0;
+            bool stopped = false;
+            int measurements = replaycon::PAGE_SIZE;
+            while (!stopped && measurements == replaycon::PAGE_SIZE) {
+                query.bindValue(0, this->recID);
+                query.bindValue(1, cursorTime);
+                query.bindValue(2, cursorID);
+                query.bindValue(3, replaycon::PAGE_SIZE);
+                if (!query.exec()) {
+                    LogInstance::get_instance().eal_error(
+                        query.lastError().text().toStdString());
+                    break;
+                }
+                // read the whole page before replaying it, the query must not
+                // be kept open while the thread sleeps
+                std::vector<std::pair<long long, std::vector<ReplaySample>>>
+                    page;
+                measurements = 0;
+                while (query.next()) {
+                    long long id = query.value(0).toLongLong();
+                    if (measurements == 0 || id != cursorID) {
+                        measurements++;
+                        cursorID = id;
+                        cursorTime = query.value(1);
+                        page.emplace_back(
+                            QDateTime::fromString(cursorTime.toString(),
+                                                  Qt::ISODateWithMs)
+                                .toMSecsSinceEpoch(),
+                            std::vector<ReplaySample>());
+                    }
+                    ReplaySample sample;
+                    sample.channel = query.value(2).toInt();
+                    sample.hasVoltage = !query.isNull(3);
+                    sample.voltage = query.value(3).toDouble();
+                    sample.hasCurrent = !query.isNull(4);
+                    sample.current = query.value(4).toDouble();
+                    sample.hasOutput = !query.isNull(5);
+                    sample.output = query.value(5).toBool();
+                    page.back().second.push_back(sample);
+                }
+                query.finish();
+                for (const auto &measurement : page) {
+                    if (!this->replayMeasurement(measurement.first,
+                                                 measurement.second)) {
+                        stopped = true;
+                        break;
+                    }
+                }
+                completed = !stopped && measurements < replaycon::PAGE_SIZE;
+            }
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(this->connectionName);
+    return completed;
+}
+
+bool RecordingReplay::replayBinary()
+{
+    BinaryRecordingReader reader(this->dataFile);
+    if (!reader.open()) {
+        LogInstance::get_instance().eal_error("Can not open binary recording " +
+                                              this->dataFile.toStdString());
+        return false;
+    }
+    // the file is memory mapped, every sample is read when it is due
+    std::vector<ReplaySample> samples;
+    for (long long i = 0; i < reader.getSampleCount(); i++) {
+        std::shared_ptr<PowerSupplyStatus> status = reader.sample(i);
+        samples.clear();
+        for (int c = 1; c <= this->channels; c++) {
+            ReplaySample sample;
+            sample.channel = c;
+            try {
+                sample.voltage = status->getVoltageSet(c);
+                sample.current = status->getCurrentSet(c);
+                sample.output = status->getChannelOutput(c);
+            } catch (const std::out_of_range &) {
+                continue;
+            }
+            sample.hasVoltage = !std::isnan(sample.voltage);
+            sample.hasCurrent = !std::isnan(sample.current);
+            sample.hasOutput = true;
+            samples.push_back(sample);
+        }
+        if (!this->replayMeasurement(reader.sampleTime(i), samples))
+            return false;
+    }
+    return true;
+}
+
+bool RecordingReplay::replayMeasurement(
+    long long time, const std::vector<ReplaySample> &samples)
+{
+    if (this->firstSample == -1) {
+        this->firstSample = time;
+        this->startTime = std::chrono::steady_clock::now();
+    }
+    long long position = time - this->firstSample;
+    std::chrono::steady_clock::time_point scheduled =
+        this->startTime +
+        std::chrono::microseconds(
+            static_cast<long long>(position * 1000.0 / this->timeScale));
+    if (!this->waitUntil(scheduled))
+        return false;
+    std::chrono::steady_clock::time_point achieved =
+        std::chrono::steady_clock::now();
+    for (const ReplaySample &sample : samples) {
+        if (sample.channel < 1 || sample.channel > this->channels)
+            continue;
+        ReplaySample &last = this->lastSent[sample.channel - 1];
+        // skip setpoints the device already has
+        if (sample.hasVoltage &&
+            (!last.hasVoltage || last.voltage != sample.voltage)) {
+            this->setpointSink(sample.channel,
+                               globcon::LPQ_DATATYPE::SETVOLTAGE,
+                               sample.voltage);
+            last.hasVoltage = true;
+            last.voltage = sample.voltage;
+        }
+        if (sample.hasCurrent &&
+            (!last.hasCurrent || last.current != sample.current)) {
+            this->setpointSink(sample.channel,
+                               globcon::LPQ_DATATYPE::SETCURRENT,
+                               sample.current);
+            last.hasCurrent = true;
+            last.current = sample.current;
+        }
+        if (sample.hasOutput &&
+            (!last.hasOutput || last.output != sample.output)) {
+            this->outputSink(sample.channel, sample.output);
+            last.hasOutput = true;
+            last.output = sample.output;
+        }
+    }
+    qint64 jitter = std::chrono::duration_cast<std::chrono::microseconds>(
+                        achieved - scheduled)
+                        .count();
+    PerfMetrics::get_instance().sample("replay.jitter.us",
+                                       static_cast<double>(jitter));
+    if (position - this->lastProgress >= replaycon::PROGRESS_INTERVAL ||
+        position == 0) {
+        this->lastProgress = position;
+        emit this->progress(position, jitter);
+    }
+    return true;
+}
+
+bool RecordingReplay::waitUntil(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(this->stopMutex);
+    return !this->stopCondition.wait_until(
+        lock, deadline, [this]() { return this->stopRequested; });
+}
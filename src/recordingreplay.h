@@ -0,0 +1,169 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef RECORDINGREPLAY_H
+#define RECORDINGREPLAY_H
+
+#include <QObject>
+#include <QString>
+
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+
+#include <QDateTime>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "binaryrecordingreader.h"
+#include "databasedef.h"
+#include "log_instance.h"
+#include "perfmetrics.h"
+#include "sequenceengine.h"
+
+namespace replay_constants
+{
+/**
+ * @brief Number of measurements read from the database at once
+ */
+const int PAGE_SIZE = 1000;
+/**
+ * @brief Interval of the progress signal in ms of the recording
+ */
+const int PROGRESS_INTERVAL = 1000;
+}
+
+/**
+ * @brief Setpoints of one channel at one point of a recording
+ */
+struct ReplaySample {
+    int channel = 0;
+    bool hasVoltage = false;
+    double voltage = 0;
+    bool hasCurrent = false;
+    double current = 0;
+    bool hasOutput = false;
+    bool output = false;
+};
+
+/**
+ * @brief Replays the setpoints of a recording onto a device
+ *
+ * @details
+ *
+ * The set voltage, set current and output of every channel are streamed from
+ * the recording in pages on a dedicated timing thread. Database recordings are
+ * read with keyset pagination like the HistoryLoader does, binary recordings
+ * sample by sample from the mapped file, so the memory needed does not depend
+ * on the length of the recording.
+ *
+ * A measurement recorded t ms after the first one is replayed t / timeScale ms
+ * after the start on a monotonic clock. Like the SequenceEngine every
+ * measurement is scheduled relative to the start. Only setpoints that differ
+ * from the last one sent for the channel are handed to the sinks, a recording
+ * mostly repeats the same setpoints with every status poll.
+ */
+class RecordingReplay : public QObject
+{
+    Q_OBJECT
+
+public:
+    using OutputSink = std::function<void(int channel, bool status)>;
+
+    RecordingReplay(SequenceEngine::SetpointSink setpointSink,
+                    OutputSink outputSink);
+    ~RecordingReplay();
+
+    /**
+     * @brief Start a replay, a running replay is stopped first
+     *
+     * @param dbFile Database file
+     * @param recID Recording
+     * @param dataFile Binary recording file, empty for database recordings
+     * @param channels Channels of the recording
+     * @param timeScale Replay speed, 2 replays twice as fast
+     */
+    void start(QString dbFile, long long recID, QString dataFile, int channels,
+               double timeScale);
+    void stop();
+    bool isRunning() const;
+
+signals:
+    /**
+     * @brief Replay position
+     *
+     * @param position Replayed time of the recording in ms
+     * @param jitter Achieved minus scheduled time of the last measurement in
+     * µs
+     */
+    void progress(qint64 position, qint64 jitter);
+    /**
+     * @brief The replay has ended
+     *
+     * @param aborted True if it was stopped or the recording could not be read
+     */
+    void finished(bool aborted);
+
+private:
+    SequenceEngine::SetpointSink setpointSink;
+    OutputSink outputSink;
+    std::thread timingThread;
+    std::atomic<bool> running;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopRequested;
+
+    QString connectionName;
+    QString dbFile;
+    long long recID;
+    QString dataFile;
+    int channels;
+    double timeScale;
+
+    // replay state of the running thread
+    std::chrono::steady_clock::time_point startTime;
+    long long firstSample;
+    long long lastProgress;
+    std::vector<ReplaySample> lastSent;
+
+    void run();
+    bool replayDatabase();
+    bool replayBinary();
+    /**
+     * @brief Send the setpoints of one measurement at its scheduled time
+     *
+     * @param time Measure time in ms since epoch
+     *
+     * @return False if the replay was stopped meanwhile
+     */
+    bool replayMeasurement(long long time,
+                           const std::vector<ReplaySample> &samples);
+    /**
+     * @brief Sleep until deadline
+     *
+     * @return False if the replay was stopped meanwhile
+     */
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+};
+
+#endif  // RECORDINGREPLAY_H
@@ -32,6 +32,10 @@ QVariant RecordSqlModel::data(const QModelIndex &index, int role) const
         QDateTime dt = value.toDateTime();
         value = dt.toString("yyyy-MM-dd HH:mm:ss");
     }
+    // measurements are either in the database or in a binary recording file
+    if (role == Qt::DisplayRole && index.column() == 9) {
+        value = value.toString().isEmpty() ? "SQLite" : "Binary";
+    }
 
     return value;
 }
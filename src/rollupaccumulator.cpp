@@ -0,0 +1,100 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "rollupaccumulator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace rollcon = rollup_constants;
+namespace rollutil = rollup_utils;
+
+RollupAccumulator::RollupAccumulator(std::vector<rollcon::LEVEL> levels)
+    : levels(std::move(levels))
+{
+}
+
+void RollupAccumulator::add(long long timeMs, int channel, double voltage,
+                            double current, double wattage)
+{
+    const double values[3] = {voltage, current, wattage};
+    for (const auto level : this->levels) {
+        Accumulator &acc = this->buckets[std::make_tuple(
+            static_cast<int>(level), rollutil::bucketStart(level, timeMs),
+            channel)];
+        for (int i = 0; i < 3; i++) {
+            if (acc.samples == 0) {
+                acc.min[i] = values[i];
+                acc.max[i] = values[i];
+            } else {
+                acc.min[i] = std::min(acc.min[i], values[i]);
+                acc.max[i] = std::max(acc.max[i], values[i]);
+            }
+            acc.sum[i] += values[i];
+            acc.last[i] = values[i];
+        }
+        acc.samples++;
+    }
+}
+
+void RollupAccumulator::add(const std::shared_ptr<PowerSupplyStatus> &powStatus,
+                            int channels)
+{
+    long long timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           powStatus->getTime().time_since_epoch())
+                           .count();
+    for (int channel = 1; channel <= channels; channel++) {
+        this->add(timeMs, channel, powStatus->getVoltage(channel),
+                  powStatus->getCurrent(channel),
+                  powStatus->getWattage(channel));
+    }
+}
+
+std::vector<RollupBucket> RollupAccumulator::take(long long beforeMs)
+{
+    std::vector<RollupBucket> taken;
+    for (auto it = this->buckets.begin(); it != this->buckets.end();) {
+        rollcon::LEVEL level =
+            static_cast<rollcon::LEVEL>(std::get<0>(it->first));
+        long long start = std::get<1>(it->first);
+        if (beforeMs != LLONG_MAX &&
+            start + rollutil::bucketLength(level) > beforeMs) {
+            ++it;
+            continue;
+        }
+        const Accumulator &acc = it->second;
+        RollupBucket bucket;
+        bucket.level = level;
+        bucket.bucketStart = start;
+        bucket.channel = std::get<2>(it->first);
+        bucket.samples = acc.samples;
+        RollupValue *values[3] = {&bucket.voltage, &bucket.current,
+                                  &bucket.wattage};
+        for (int i = 0; i < 3; i++) {
+            values[i]->min = acc.min[i];
+            values[i]->max = acc.max[i];
+            values[i]->mean = acc.sum[i] / acc.samples;
+            values[i]->last = acc.last[i];
+        }
+        taken.push_back(bucket);
+        it = this->buckets.erase(it);
+    }
+    return taken;
+}
+
+bool RollupAccumulator::isEmpty() const { return this->buckets.empty(); }
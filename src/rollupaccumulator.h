@@ -0,0 +1,174 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ROLLUPACCUMULATOR_H
+#define ROLLUPACCUMULATOR_H
+
+#include <climits>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "powersupplystatus.h"
+
+/**
+ * @brief Downsampled representations of a recording
+ *
+ * @details
+ *
+ * For every recording the measurements are aggregated into buckets of 1 s,
+ * 1 min and 1 h per channel. A bucket stores the number of samples and min,
+ * max, mean and last value of voltage, current and wattage.
+ */
+namespace rollup_constants
+{
+enum class LEVEL { RAW = -1, SECOND = 0, MINUTE, HOUR };
+/**
+ * @brief All rollup levels from fine to coarse
+ */
+const std::vector<LEVEL> LEVELS = {LEVEL::SECOND, LEVEL::MINUTE, LEVEL::HOUR};
+}
+
+namespace rollup_utils
+{
+namespace rollcon = rollup_constants;
+
+/**
+ * @brief Length of a bucket of level in ms
+ */
+inline long long bucketLength(rollcon::LEVEL level)
+{
+    switch (level) {
+    case rollcon::LEVEL::SECOND:
+        return 1000;
+    case rollcon::LEVEL::MINUTE:
+        return 60 * 1000;
+    case rollcon::LEVEL::HOUR:
+        return 60 * 60 * 1000;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Start of the bucket of level timeMs belongs to
+ */
+inline long long bucketStart(rollcon::LEVEL level, long long timeMs)
+{
+    long long len = bucketLength(level);
+    if (len == 0)
+        return timeMs;
+    // round towards negative infinity
+    long long start = (timeMs / len) * len;
+    return start > timeMs ? start - len : start;
+}
+
+/**
+ * @brief Coarsest level whose buckets are not longer than resolutionMs
+ *
+ * @return LEVEL::RAW if even the finest level is too coarse
+ */
+inline rollcon::LEVEL levelForResolution(long long resolutionMs)
+{
+    rollcon::LEVEL level = rollcon::LEVEL::RAW;
+    for (const auto l : rollcon::LEVELS) {
+        if (bucketLength(l) <= resolutionMs)
+            level = l;
+    }
+    return level;
+}
+
+/**
+ * @brief Coarsest level that still yields about maxPoints buckets for a
+ * time span
+ */
+inline rollcon::LEVEL levelForSpan(long long spanMs, long long maxPoints)
+{
+    if (maxPoints <= 0)
+        return rollcon::LEVEL::RAW;
+    return levelForResolution(spanMs / maxPoints);
+}
+}
+
+/**
+ * @brief Aggregate of one quantity within a bucket
+ */
+struct RollupValue {
+    double min = 0;
+    double max = 0;
+    double mean = 0;
+    double last = 0;
+};
+
+/**
+ * @brief One bucket of one channel
+ */
+struct RollupBucket {
+    rollup_constants::LEVEL level;
+    int channel;
+    long long bucketStart; /**< ms since epoch */
+    long long samples;
+    RollupValue voltage;
+    RollupValue current;
+    RollupValue wattage;
+};
+
+/**
+ * @brief Aggregates measurements into rollup buckets
+ *
+ * @details
+ *
+ * Measurements have to be added in chronological order. The accumulated
+ * buckets are partial aggregates, a bucket may span several flushes of the
+ * record buffer. DBConnector merges them with the stored buckets.
+ */
+class RollupAccumulator
+{
+public:
+    explicit RollupAccumulator(std::vector<rollup_constants::LEVEL> levels =
+                                   rollup_constants::LEVELS);
+
+    void add(long long timeMs, int channel, double voltage, double current,
+             double wattage);
+    void add(const std::shared_ptr<PowerSupplyStatus> &powStatus,
+             int channels);
+
+    /**
+     * @brief Remove and return all buckets that end before beforeMs
+     *
+     * @details
+     *
+     * Buckets are ordered by level, bucket start and channel.
+     */
+    std::vector<RollupBucket> take(long long beforeMs = LLONG_MAX);
+    bool isEmpty() const;
+
+private:
+    struct Accumulator {
+        long long samples = 0;
+        double sum[3] = {0, 0, 0};
+        double min[3] = {0, 0, 0};
+        double max[3] = {0, 0, 0};
+        double last[3] = {0, 0, 0};
+    };
+
+    std::vector<rollup_constants::LEVEL> levels;
+    std::map<std::tuple<int, long long, int>, Accumulator> buckets;
+};
+
+#endif  // ROLLUPACCUMULATOR_H
@@ -0,0 +1,99 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "safetywatchdog.h"
+
+#include <cmath>
+
+namespace wdcon = watchdog_constants;
+
+void SafetyWatchdog::setRules(std::vector<WatchdogRule> rules)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->rules = std::move(rules);
+    this->states.clear();
+}
+
+std::vector<WatchdogRule> SafetyWatchdog::getRules()
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->rules;
+}
+
+bool SafetyWatchdog::isActive()
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return !this->rules.empty();
+}
+
+bool SafetyWatchdog::evaluate(int channel, double voltage, double current,
+                              bool output,
+                              std::chrono::steady_clock::time_point now,
+                              WatchdogTrip &trip)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if (std::isnan(voltage) || std::isnan(current))
+        return false;
+    for (size_t i = 0; i < this->rules.size(); i++) {
+        const WatchdogRule &rule = this->rules[i];
+        if (rule.channel != 0 && rule.channel != channel)
+            continue;
+        RuleState &state = this->states[std::make_pair(i, channel)];
+        if (!output) {
+            // nothing can go wrong with the output off
+            state = RuleState();
+            continue;
+        }
+        double value = 0;
+        bool condition = false;
+        switch (rule.type) {
+        case wdcon::RULE_TYPE::OVERCURRENT:
+            value = current;
+            condition = value > rule.threshold;
+            break;
+        case wdcon::RULE_TYPE::OVERPOWER:
+            value = voltage * current;
+            condition = value > rule.threshold;
+            break;
+        case wdcon::RULE_TYPE::UNDERVOLTAGE:
+            value = voltage;
+            if (value >= rule.threshold)
+                state.armed = true;
+            condition = state.armed && value < rule.threshold;
+            break;
+        }
+        if (!condition) {
+            state.pending = false;
+            continue;
+        }
+        if (!state.pending) {
+            state.pending = true;
+            state.pendingSince = now;
+        }
+        if (now - state.pendingSince < std::chrono::milliseconds(rule.holdTime))
+            continue;
+        trip.rule = static_cast<int>(i);
+        trip.type = rule.type;
+        trip.channel = channel;
+        trip.threshold = rule.threshold;
+        trip.value = value;
+        // the output is switched off, every rule starts again
+        this->states.clear();
+        return true;
+    }
+    return false;
+}
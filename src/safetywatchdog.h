@@ -0,0 +1,142 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SAFETYWATCHDOG_H
+#define SAFETYWATCHDOG_H
+
+#include <QMetaType>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace watchdog_constants
+{
+enum class RULE_TYPE {
+    OVERCURRENT = 0, /**< Current above the threshold */
+    OVERPOWER,       /**< Voltage times current above the threshold */
+    UNDERVOLTAGE     /**< Voltage dropped below the threshold */
+};
+/**
+ * @brief Attempts to switch the output off after a trip
+ */
+const int OUTPUT_OFF_ATTEMPTS = 3;
+}
+
+/**
+ * @brief A user defined trip condition
+ */
+struct WatchdogRule {
+    watchdog_constants::RULE_TYPE type =
+        watchdog_constants::RULE_TYPE::OVERCURRENT;
+    /**
+     * @brief Channel the rule applies to, 0 for every channel
+     */
+    int channel = 0;
+    double threshold = 0;
+    /**
+     * @brief The condition must hold this long before the rule trips in ms
+     */
+    int holdTime = 0;
+};
+
+/**
+ * @brief A tripped rule
+ */
+struct WatchdogTrip {
+    int rule = -1; /**< Index of the rule */
+    watchdog_constants::RULE_TYPE type =
+        watchdog_constants::RULE_TYPE::OVERCURRENT;
+    int channel = 0;
+    double threshold = 0;
+    /**
+     * @brief Measured value that tripped the rule
+     */
+    double value = 0;
+    /**
+     * @brief Time of the trip in ms since epoch
+     */
+    long long time = 0;
+    /**
+     * @brief Detection to output off in µs, -1 if the output could not be
+     * switched off
+     */
+    long long latency = -1;
+    /**
+     * @brief False if the output could not be switched off and may still be on
+     */
+    bool outputOff = false;
+};
+
+Q_DECLARE_METATYPE(WatchdogTrip)
+
+/**
+ * @brief Trip rules evaluated against every measurement on the device thread
+ *
+ * @details
+ *
+ * PowerSupplySCPI evaluates the rules as soon as voltage and current of a
+ * channel have been read during a status update and writes the output off
+ * command right away, before any queued command. The rules can be changed from
+ * the GUI thread at any time, the class has its own mutex.
+ *
+ * The condition of a rule has to hold for at least holdTime. With a hold time
+ * the reaction time is rounded up to the next status update, so it should be
+ * a multiple of the poll interval. Undervoltage rules are armed only after the
+ * voltage was above the threshold with the output on, switching the output off
+ * never trips them.
+ */
+class SafetyWatchdog
+{
+public:
+    /**
+     * @brief Replace the rules, all hold times start again
+     */
+    void setRules(std::vector<WatchdogRule> rules);
+    std::vector<WatchdogRule> getRules();
+    bool isActive();
+    /**
+     * @brief Evaluate all rules for channel
+     *
+     * @param output Output status of the channel
+     * @param now Time of the measurement
+     * @param trip Filled with the first rule that tripped
+     *
+     * @return True if a rule tripped
+     */
+    bool evaluate(int channel, double voltage, double current, bool output,
+                  std::chrono::steady_clock::time_point now,
+                  WatchdogTrip &trip);
+
+private:
+    struct RuleState {
+        bool pending = false; /**< Condition holds since pendingSince */
+        std::chrono::steady_clock::time_point pendingSince;
+        bool armed = false;
+    };
+
+    std::mutex mtx;
+    std::vector<WatchdogRule> rules;
+    /**
+     * @brief State of every rule and channel
+     */
+    std::map<std::pair<size_t, int>, RuleState> states;
+};
+
+#endif  // SAFETYWATCHDOG_H
@@ -0,0 +1,213 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "scriptdevice.h"
+
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace globcon = global_constants;
+
+void ScriptStatusHub::publish(std::shared_ptr<PowerSupplyStatus> status)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mtx);
+        this->status = std::move(status);
+        this->sequence++;
+    }
+    this->cond.notify_all();
+}
+
+std::shared_ptr<PowerSupplyStatus> ScriptStatusHub::latest(
+    unsigned long long &sequence)
+{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    sequence = this->sequence;
+    return this->status;
+}
+
+bool ScriptStatusHub::waitForUpdate(
+    unsigned long long seen, std::chrono::steady_clock::time_point deadline,
+    const std::atomic<bool> &abort)
+{
+    std::unique_lock<std::mutex> lock(this->mtx);
+    this->cond.wait_until(lock, deadline, [this, seen, &abort]() {
+        return abort || this->sequence != seen;
+    });
+    return !abort && this->sequence != seen;
+}
+
+bool ScriptStatusHub::waitUntil(std::chrono::steady_clock::time_point deadline,
+                                const std::atomic<bool> &abort)
+{
+    std::unique_lock<std::mutex> lock(this->mtx);
+    return !this->cond.wait_until(lock, deadline,
+                                  [&abort]() { return abort.load(); });
+}
+
+void ScriptStatusHub::wakeAll()
+{
+    // take the mutex so a script can not miss the notification between
+    // checking its flag and starting to wait
+    { std::lock_guard<std::mutex> lock(this->mtx); }
+    this->cond.notify_all();
+}
+
+ScriptDevice::ScriptDevice(ScriptStatusHub &hub,
+                           SequenceEngine::SetpointSink setpointSink,
+                           OutputSink outputSink,
+                           const std::atomic<bool> &abort)
+    : QObject(),
+      hub(hub),
+      setpointSink(std::move(setpointSink)),
+      outputSink(std::move(outputSink)),
+      abort(abort)
+{
+}
+
+void ScriptDevice::setVoltage(int channel, double value)
+{
+    if (!this->abort)
+        this->setpointSink(channel, globcon::LPQ_DATATYPE::SETVOLTAGE, value);
+}
+
+void ScriptDevice::setCurrent(int channel, double value)
+{
+    if (!this->abort)
+        this->setpointSink(channel, globcon::LPQ_DATATYPE::SETCURRENT, value);
+}
+
+void ScriptDevice::setOutput(int channel, bool status)
+{
+    if (!this->abort)
+        this->outputSink(channel, status);
+}
+
+double ScriptDevice::voltage(int channel)
+{
+    return this->statusValue(
+        [channel](PowerSupplyStatus &s) { return s.getVoltage(channel); });
+}
+
+double ScriptDevice::current(int channel)
+{
+    return this->statusValue(
+        [channel](PowerSupplyStatus &s) { return s.getCurrent(channel); });
+}
+
+double ScriptDevice::wattage(int channel)
+{
+    return this->statusValue(
+        [channel](PowerSupplyStatus &s) { return s.getWattage(channel); });
+}
+
+double ScriptDevice::voltageSet(int channel)
+{
+    return this->statusValue(
+        [channel](PowerSupplyStatus &s) { return s.getVoltageSet(channel); });
+}
+
+double ScriptDevice::currentSet(int channel)
+{
+    return this->statusValue(
+        [channel](PowerSupplyStatus &s) { return s.getCurrentSet(channel); });
+}
+
+bool ScriptDevice::output(int channel)
+{
+    return this->statusValue([channel](PowerSupplyStatus &s) {
+        return s.getChannelOutput(channel) ? 1.0 : 0.0;
+    }) == 1.0;
+}
+
+bool ScriptDevice::waitFor(QJSValue condition, int timeout)
+{
+    if (!condition.isCallable()) {
+        this->log("waitFor needs a function as condition");
+        return false;
+    }
+    std::chrono::steady_clock::time_point until = this->deadline(timeout);
+    while (!this->abort) {
+        unsigned long long sequence = 0;
+        this->hub.latest(sequence);
+        QJSValue result = condition.call();
+        if (result.isError()) {
+            this->log(result.toString());
+            return false;
+        }
+        if (result.toBool())
+            return true;
+        if (!this->hub.waitForUpdate(sequence, until, this->abort))
+            return false;
+    }
+    return false;
+}
+
+bool ScriptDevice::waitForStatus(int timeout)
+{
+    unsigned long long sequence = 0;
+    this->hub.latest(sequence);
+    return this->hub.waitForUpdate(sequence, this->deadline(timeout),
+                                   this->abort);
+}
+
+bool ScriptDevice::sleep(int ms)
+{
+    return this->hub.waitUntil(
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(ms),
+        this->abort);
+}
+
+void ScriptDevice::startRecording(QString name)
+{
+    if (!this->abort)
+        emit this->recordingRequested(true, std::move(name));
+}
+
+void ScriptDevice::stopRecording()
+{
+    emit this->recordingRequested(false, QString());
+}
+
+void ScriptDevice::log(QString message)
+{
+    emit this->logMessage(std::move(message));
+}
+
+double ScriptDevice::statusValue(
+    const std::function<double(PowerSupplyStatus &status)> &getter)
+{
+    unsigned long long sequence = 0;
+    std::shared_ptr<PowerSupplyStatus> status = this->hub.latest(sequence);
+    if (!status)
+        return std::numeric_limits<double>::quiet_NaN();
+    try {
+        return getter(*status);
+    } catch (const std::out_of_range &) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+std::chrono::steady_clock::time_point ScriptDevice::deadline(int timeout)
+{
+    // time_point::max() overflows in some condition variable implementations
+    if (timeout <= 0)
+        return std::chrono::steady_clock::now() + std::chrono::hours(24 * 365);
+    return std::chrono::steady_clock::now() +
+           std::chrono::milliseconds(timeout);
+}
@@ -0,0 +1,164 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SCRIPTDEVICE_H
+#define SCRIPTDEVICE_H
+
+#include <QJSValue>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "powersupplystatus.h"
+#include "sequenceengine.h"
+
+/**
+ * @brief Latest device status shared with all running scripts
+ *
+ * @details
+ *
+ * The controller publishes every status it receives. Scripts block on the
+ * condition variable until a new status arrives, a deadline passes or they
+ * are stopped, no script polls.
+ */
+class ScriptStatusHub
+{
+public:
+    void publish(std::shared_ptr<PowerSupplyStatus> status);
+    /**
+     * @brief The latest status, may be nullptr
+     *
+     * @param sequence Number of the status, increases with every publish
+     */
+    std::shared_ptr<PowerSupplyStatus> latest(unsigned long long &sequence);
+    /**
+     * @brief Wait for a status newer than seen
+     *
+     * @return False on timeout or if abort was set
+     */
+    bool waitForUpdate(unsigned long long seen,
+                       std::chrono::steady_clock::time_point deadline,
+                       const std::atomic<bool> &abort);
+    /**
+     * @brief Sleep until deadline
+     *
+     * @return False if abort was set
+     */
+    bool waitUntil(std::chrono::steady_clock::time_point deadline,
+                   const std::atomic<bool> &abort);
+    /**
+     * @brief Wake all waiting scripts so they can check their abort flag
+     */
+    void wakeAll();
+
+private:
+    std::mutex mtx;
+    std::condition_variable cond;
+    std::shared_ptr<PowerSupplyStatus> status;
+    unsigned long long sequence = 0;
+};
+
+/**
+ * @brief The device API of scripts
+ *
+ * @details
+ *
+ * Available as the global object device in every script. Setpoints go through
+ * the same sinks as the SequenceEngine into the SerialQueue of the connected
+ * device, measurements are read from the ScriptStatusHub. Channels are
+ * numbered from 1.
+ *
+ * @code
+ * device.setVoltage(1, 5.0);
+ * device.setOutput(1, true);
+ * if (!device.waitFor(function() { return device.current(1) > 0.1; }, 5000))
+ *     device.log("no load");
+ * @endcode
+ *
+ * All waits return false once the script has been stopped.
+ */
+class ScriptDevice : public QObject
+{
+    Q_OBJECT
+
+public:
+    using OutputSink = std::function<void(int channel, bool status)>;
+
+    ScriptDevice(ScriptStatusHub &hub,
+                 SequenceEngine::SetpointSink setpointSink,
+                 OutputSink outputSink, const std::atomic<bool> &abort);
+
+    Q_INVOKABLE void setVoltage(int channel, double value);
+    Q_INVOKABLE void setCurrent(int channel, double value);
+    Q_INVOKABLE void setOutput(int channel, bool status);
+    /**
+     * @brief Measured values of the latest status, NaN if unknown
+     */
+    Q_INVOKABLE double voltage(int channel);
+    Q_INVOKABLE double current(int channel);
+    Q_INVOKABLE double wattage(int channel);
+    Q_INVOKABLE double voltageSet(int channel);
+    Q_INVOKABLE double currentSet(int channel);
+    Q_INVOKABLE bool output(int channel);
+    /**
+     * @brief Wait until condition returns true
+     *
+     * @details
+     *
+     * The condition is evaluated right away and then once for every new
+     * status of the device.
+     *
+     * @param timeout ms, 0 waits forever
+     *
+     * @return False on timeout or if the script was stopped
+     */
+    Q_INVOKABLE bool waitFor(QJSValue condition, int timeout = 0);
+    /**
+     * @brief Wait for the next status of the device
+     */
+    Q_INVOKABLE bool waitForStatus(int timeout = 0);
+    Q_INVOKABLE bool sleep(int ms);
+    Q_INVOKABLE void startRecording(QString name);
+    Q_INVOKABLE void stopRecording();
+    Q_INVOKABLE void log(QString message);
+
+signals:
+
+    void logMessage(QString message);
+    void recordingRequested(bool status, QString name);
+
+private:
+    ScriptStatusHub &hub;
+    SequenceEngine::SetpointSink setpointSink;
+    OutputSink outputSink;
+    const std::atomic<bool> &abort;
+
+    /**
+     * @brief Read a value of the latest status, NaN if it is not available
+     */
+    double statusValue(
+        const std::function<double(PowerSupplyStatus &status)> &getter);
+    std::chrono::steady_clock::time_point deadline(int timeout);
+};
+
+#endif  // SCRIPTDEVICE_H
@@ -0,0 +1,115 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "scriptrunner.h"
+
+#include <utility>
+
+ScriptRunner::ScriptRunner(int id, ScriptStatusHub &hub,
+                           SequenceEngine::SetpointSink setpointSink,
+                           ScriptDevice::OutputSink outputSink)
+    : QObject(),
+      id(id),
+      hub(hub),
+      setpointSink(std::move(setpointSink)),
+      outputSink(std::move(outputSink)),
+      running(false),
+      abortRequested(false),
+      engine(nullptr)
+{
+}
+
+ScriptRunner::~ScriptRunner() { this->stop(); }
+void ScriptRunner::start(QString name, QString program)
+{
+    this->name = std::move(name);
+    this->program = std::move(program);
+    this->running = true;
+    this->scriptThread = std::thread(&ScriptRunner::run, this);
+}
+
+void ScriptRunner::requestStop()
+{
+    this->abortRequested = true;
+    {
+        std::lock_guard<std::mutex> lock(this->engineMutex);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        if (this->engine)
+            this->engine->setInterrupted(true);
+#endif
+    }
+    this->hub.wakeAll();
+}
+
+void ScriptRunner::stop()
+{
+    this->requestStop();
+    if (this->scriptThread.joinable())
+        this->scriptThread.join();
+}
+
+bool ScriptRunner::isRunning() const { return this->running; }
+int ScriptRunner::getID() const { return this->id; }
+void ScriptRunner::run()
+{
+    bool success = false;
+    QString message;
+    {
+        // engine and device belong to this thread
+        QJSEngine scriptEngine;
+        ScriptDevice device(this->hub, this->setpointSink, this->outputSink,
+                            this->abortRequested);
+        QObject::connect(&device, &ScriptDevice::logMessage,
+                         [this](QString line) {
+                             emit this->output(this->id, std::move(line));
+                         });
+        QObject::connect(&device, &ScriptDevice::recordingRequested,
+                         [this](bool status, QString recName) {
+                             emit this->recordingRequested(status,
+                                                           std::move(recName));
+                         });
+        // the engine must not delete the device that lives on this stack
+        QJSEngine::setObjectOwnership(&device, QJSEngine::CppOwnership);
+        scriptEngine.globalObject().setProperty(
+            "device", scriptEngine.newQObject(&device));
+        {
+            std::lock_guard<std::mutex> lock(this->engineMutex);
+            this->engine = &scriptEngine;
+        }
+        if (!this->abortRequested) {
+            QJSValue result = scriptEngine.evaluate(this->program, this->name);
+            if (result.isError()) {
+                message = QString("%1:%2: %3")
+                              .arg(this->name)
+                              .arg(result.property("lineNumber").toInt())
+                              .arg(result.toString());
+                LogInstance::get_instance().eal_warn("Script failed: " +
+                                                     message.toStdString());
+            } else {
+                success = !this->abortRequested;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->engineMutex);
+            this->engine = nullptr;
+        }
+    }
+    if (this->abortRequested)
+        message = "Stopped";
+    this->running = false;
+    emit this->finished(this->id, success, message);
+}
@@ -0,0 +1,104 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SCRIPTRUNNER_H
+#define SCRIPTRUNNER_H
+
+#include <QJSEngine>
+#include <QJSValue>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "log_instance.h"
+#include "scriptdevice.h"
+
+/**
+ * @brief Runs one script on its own thread
+ *
+ * @details
+ *
+ * Every script gets its own QJSEngine, created on the script thread, with a
+ * ScriptDevice as global object device. Scripts block in the waits of the
+ * device API, so many of them can run at the same time without using any CPU
+ * while they wait.
+ *
+ * requestStop wakes all waits of the script, they return false and the
+ * device API ignores further commands. With Qt 5.14 or newer the JavaScript
+ * code is interrupted as well, with older versions the script has to end by
+ * itself.
+ */
+class ScriptRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    ScriptRunner(int id, ScriptStatusHub &hub,
+                 SequenceEngine::SetpointSink setpointSink,
+                 ScriptDevice::OutputSink outputSink);
+    ~ScriptRunner();
+
+    /**
+     * @brief Run program, must only be called once
+     *
+     * @param name Shown in error messages
+     */
+    void start(QString name, QString program);
+    /**
+     * @brief Ask the script to stop without waiting for it
+     */
+    void requestStop();
+    void stop();
+    bool isRunning() const;
+    int getID() const;
+
+signals:
+
+    void output(int id, QString message);
+    /**
+     * @brief The script has ended
+     *
+     * @param success False if the script threw an error or was stopped
+     * @param message Error message
+     */
+    void finished(int id, bool success, QString message);
+    void recordingRequested(bool status, QString name);
+
+private:
+    int id;
+    ScriptStatusHub &hub;
+    SequenceEngine::SetpointSink setpointSink;
+    ScriptDevice::OutputSink outputSink;
+    std::thread scriptThread;
+    std::atomic<bool> running;
+    std::atomic<bool> abortRequested;
+    /**
+     * @brief Guards engine, only valid while the script runs
+     */
+    std::mutex engineMutex;
+    QJSEngine *engine;
+
+    QString name;
+    QString program;
+
+    void run();
+};
+
+#endif  // SCRIPTRUNNER_H
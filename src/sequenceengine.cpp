@@ -0,0 +1,160 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "sequenceengine.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace seqcon = sequence_constants;
+
+SequenceEngine::SequenceEngine(SetpointSink sink)
+    : QObject(), sink(std::move(sink)), running(false), stopRequested(false)
+{
+}
+
+SequenceEngine::~SequenceEngine() { this->stop(); }
+void SequenceEngine::start(std::vector<SequenceStep> steps)
+{
+    this->stop();
+    {
+        std::lock_guard<std::mutex> lock(this->stopMutex);
+        this->stopRequested = false;
+    }
+    this->running = true;
+    this->timingThread =
+        std::thread(&SequenceEngine::run, this, std::move(steps));
+}
+
+void SequenceEngine::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->stopMutex);
+        this->stopRequested = true;
+    }
+    this->stopCondition.notify_all();
+    if (this->timingThread.joinable())
+        this->timingThread.join();
+}
+
+bool SequenceEngine::isRunning() const { return this->running; }
+void SequenceEngine::run(std::vector<SequenceStep> steps)
+{
+    using clock = std::chrono::steady_clock;
+    const clock::time_point start = clock::now();
+    // all steps are scheduled relative to start, never relative to the
+    // achieved time of the previous step
+    clock::time_point schedule = start;
+    // remaining jumps of every loop step, -1 if the loop is not active
+    std::vector<int> loopsLeft(steps.size(), -1);
+    bool aborted = false;
+    size_t i = 0;
+    while (i < steps.size() && !aborted) {
+        const SequenceStep &step = steps[i];
+        clock::time_point achieved = schedule;
+        qint64 jitter = 0;
+        switch (step.type) {
+        case seqcon::STEP_TYPE::SET:
+            aborted = !this->setpointAt(schedule, step, step.value, achieved);
+            jitter = std::chrono::duration_cast<std::chrono::microseconds>(
+                         achieved - schedule)
+                         .count();
+            break;
+        case seqcon::STEP_TYPE::RAMP: {
+            int points = std::max(1, step.duration / seqcon::RAMP_INTERVAL);
+            for (int p = 1; p <= points && !aborted; p++) {
+                clock::time_point scheduled =
+                    schedule +
+                    std::chrono::milliseconds(
+                        static_cast<long long>(step.duration) * p / points);
+                double value = step.startValue +
+                               (step.value - step.startValue) * p / points;
+                aborted = !this->setpointAt(scheduled, step, value, achieved);
+                jitter = std::max(
+                    jitter,
+                    static_cast<qint64>(
+                        std::chrono::duration_cast<std::chrono::microseconds>(
+                            achieved - scheduled)
+                            .count()));
+            }
+            schedule += std::chrono::milliseconds(step.duration);
+            break;
+        }
+        case seqcon::STEP_TYPE::DWELL:
+            schedule += std::chrono::milliseconds(step.duration);
+            aborted = !this->waitUntil(schedule);
+            achieved = clock::now();
+            jitter = std::chrono::duration_cast<std::chrono::microseconds>(
+                         achieved - schedule)
+                         .count();
+            break;
+        case seqcon::STEP_TYPE::LOOP:
+            if (step.loopTarget < 0 ||
+                static_cast<size_t>(step.loopTarget) >= i) {
+                LogInstance::get_instance().eal_warn(
+                    "Ignoring loop to invalid step " +
+                    std::to_string(step.loopTarget));
+                i++;
+                continue;
+            }
+            if (loopsLeft[i] == -1)
+                loopsLeft[i] = step.loopCount;
+            if (loopsLeft[i] > 0) {
+                loopsLeft[i]--;
+                i = static_cast<size_t>(step.loopTarget);
+            } else {
+                // a loop that is entered again starts with its full count
+                loopsLeft[i] = -1;
+                i++;
+            }
+            continue;
+        }
+        if (aborted)
+            break;
+        PerfMetrics::get_instance().sample("sequence.jitter.us",
+                                           static_cast<double>(jitter));
+        emit this->stepExecuted(
+            static_cast<int>(i),
+            std::chrono::duration_cast<std::chrono::milliseconds>(achieved -
+                                                                  start)
+                .count(),
+            jitter);
+        i++;
+    }
+    this->running = false;
+    emit this->finished(aborted);
+}
+
+bool SequenceEngine::waitUntil(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(this->stopMutex);
+    // wait_until with a steady_clock deadline is not affected by changes of
+    // the system time
+    return !this->stopCondition.wait_until(
+        lock, deadline, [this]() { return this->stopRequested; });
+}
+
+bool SequenceEngine::setpointAt(std::chrono::steady_clock::time_point scheduled,
+                                const SequenceStep &step, double value,
+                                std::chrono::steady_clock::time_point &achieved)
+{
+    if (!this->waitUntil(scheduled))
+        return false;
+    achieved = std::chrono::steady_clock::now();
+    this->sink(step.channel, step.target, value);
+    return true;
+}
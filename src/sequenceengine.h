@@ -0,0 +1,153 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SEQUENCEENGINE_H
+#define SEQUENCEENGINE_H
+
+#include <QObject>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+#include "log_instance.h"
+#include "perfmetrics.h"
+
+namespace sequence_constants
+{
+enum class STEP_TYPE {
+    SET = 0, /**< Set a setpoint */
+    RAMP,    /**< Linear ramp from one setpoint to another */
+    DWELL,   /**< Wait */
+    LOOP     /**< Jump back to an earlier step */
+};
+/**
+ * @brief Interval of the setpoints of a ramp in ms
+ */
+const int RAMP_INTERVAL = 100;
+}
+
+/**
+ * @brief One step of a sequence
+ *
+ * @details
+ *
+ * Which members are used depends on the type. SET uses channel, target and
+ * value, RAMP additionally startValue and duration, DWELL only duration. LOOP
+ * jumps to the step loopTarget and does so loopCount times before the
+ * sequence continues with the next step.
+ */
+struct SequenceStep {
+    sequence_constants::STEP_TYPE type = sequence_constants::STEP_TYPE::SET;
+    int channel = 1;
+    /**
+     * @brief SETVOLTAGE or SETCURRENT
+     */
+    global_constants::LPQ_DATATYPE target =
+        global_constants::LPQ_DATATYPE::SETVOLTAGE;
+    double startValue = 0;
+    double value = 0;
+    int duration = 0; /**< ms */
+    int loopTarget = 0;
+    int loopCount = 0;
+};
+
+/**
+ * @brief Runs sequences of setpoints on a dedicated timing thread
+ *
+ * @details
+ *
+ * Every setpoint is scheduled at an absolute point of a monotonic clock
+ * relative to the start of the sequence, the thread sleeps until then. Late
+ * wakeups therefore do not add up over the sequence. The difference between
+ * the scheduled and the achieved time is reported for each step with
+ * stepExecuted, a ramp reports the worst setpoint.
+ *
+ * The setpoints are handed to a sink function that is called on the timing
+ * thread, so it must be thread safe. The SerialQueue of the power supply is.
+ */
+class SequenceEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    using SetpointSink = std::function<void(
+        int channel, global_constants::LPQ_DATATYPE target, double value)>;
+
+    explicit SequenceEngine(SetpointSink sink);
+    ~SequenceEngine();
+
+    /**
+     * @brief Start a sequence, a running sequence is stopped first
+     */
+    void start(std::vector<SequenceStep> steps);
+    /**
+     * @brief Stop the sequence and wait for the timing thread
+     */
+    void stop();
+    bool isRunning() const;
+
+signals:
+    /**
+     * @brief A step was executed
+     *
+     * @param step Index of the step
+     * @param elapsed Monotonic time of the (last) setpoint since the start of
+     * the sequence in ms
+     * @param jitter Achieved minus scheduled time in µs
+     */
+    void stepExecuted(int step, qint64 elapsed, qint64 jitter);
+    /**
+     * @brief The sequence has ended
+     *
+     * @param aborted True if it was stopped before the last step
+     */
+    void finished(bool aborted);
+
+private:
+    SetpointSink sink;
+    std::thread timingThread;
+    std::atomic<bool> running;
+    std::mutex stopMutex;
+    std::condition_variable stopCondition;
+    bool stopRequested;
+
+    void run(std::vector<SequenceStep> steps);
+    /**
+     * @brief Sleep until deadline
+     *
+     * @return False if the sequence was stopped meanwhile
+     */
+    bool waitUntil(std::chrono::steady_clock::time_point deadline);
+    /**
+     * @brief Send a setpoint at its scheduled time
+     *
+     * @param achieved Time the setpoint was handed to the sink
+     *
+     * @return False if the sequence was stopped meanwhile
+     */
+    bool setpointAt(std::chrono::steady_clock::time_point scheduled,
+                    const SequenceStep &step, double value,
+                    std::chrono::steady_clock::time_point &achieved);
+};
+
+#endif  // SEQUENCEENGINE_H
@@ -0,0 +1,89 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "settingscache.h"
+
+namespace setcon = settings_constants;
+namespace setdef = settings_default;
+
+SettingsCache::SettingsCache() : generation(0) { this->reload(); }
+const SettingsSnapshot &SettingsCache::snapshot()
+{
+    thread_local std::shared_ptr<const SettingsSnapshot> cached;
+    thread_local unsigned long cachedGeneration = 0;
+    unsigned long gen = this->generation.load(std::memory_order_acquire);
+    if (!cached || cachedGeneration != gen) {
+        cached = std::atomic_load(&this->current);
+        cachedGeneration = gen;
+    }
+    return *cached;
+}
+
+void SettingsCache::reload()
+{
+    auto snap = std::make_shared<SettingsSnapshot>();
+    QSettings settings;
+
+    settings.beginGroup(setcon::DEVICE_GROUP);
+    snap->deviceActive = settings.value(setcon::DEVICE_ACTIVE).toString();
+    settings.beginGroup(snap->deviceActive);
+    snap->deviceConfigured = settings.contains(setcon::DEVICE_PORT);
+    snap->deviceName = settings.value(setcon::DEVICE_NAME).toString();
+    snap->deviceChannels = settings.value(setcon::DEVICE_CHANNELS).toInt();
+    snap->voltageMin = settings.value(setcon::DEVICE_VOLTAGE_MIN).toDouble();
+    snap->voltageMax = settings.value(setcon::DEVICE_VOLTAGE_MAX).toDouble();
+    snap->voltageAccuracy =
+        settings.value(setcon::DEVICE_VOLTAGE_ACCURACY).toInt();
+    snap->currentMin = settings.value(setcon::DEVICE_CURRENT_MIN).toDouble();
+    snap->currentMax = settings.value(setcon::DEVICE_CURRENT_MAX).toDouble();
+    snap->currentAccuracy =
+        settings.value(setcon::DEVICE_CURRENT_ACCURACY).toInt();
+    snap->pollFrequency = settings.value(setcon::DEVICE_POLL_FREQ, 1000).toInt();
+    settings.endGroup();
+    settings.endGroup();
+
+    settings.beginGroup(setcon::PLOT_GROUP);
+    snap->plotZoomMin =
+        settings
+            .value(setcon::PLOT_ZOOM_MIN,
+                   setdef::general_defaults.at(setcon::PLOT_ZOOM_MIN))
+            .toDouble();
+    snap->plotZoomMax =
+        settings
+            .value(setcon::PLOT_ZOOM_MAX,
+                   setdef::general_defaults.at(setcon::PLOT_ZOOM_MAX))
+            .toDouble();
+    snap->plotFps = settings
+                        .value(setcon::PLOT_FPS,
+                               setdef::general_defaults.at(setcon::PLOT_FPS))
+                        .toInt();
+    snap->plotRetentionTime =
+        settings
+            .value(setcon::PLOT_RETENTION_TIME,
+                   setdef::general_defaults.at(setcon::PLOT_RETENTION_TIME))
+            .toInt();
+    snap->plotRetentionPoints =
+        settings
+            .value(setcon::PLOT_RETENTION_POINTS,
+                   setdef::general_defaults.at(setcon::PLOT_RETENTION_POINTS))
+            .toInt();
+    settings.endGroup();
+
+    std::atomic_store(&this->current,
+                      std::shared_ptr<const SettingsSnapshot>(std::move(snap)));
+    this->generation.fetch_add(1, std::memory_order_release);
+}
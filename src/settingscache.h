@@ -0,0 +1,102 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SETTINGSCACHE_H
+#define SETTINGSCACHE_H
+
+#include <QSettings>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+#include "settingsdefault.h"
+#include "settingsdefinitions.h"
+
+/**
+ * @brief Typed copy of the settings that are needed on hot paths
+ *
+ * @details
+ *
+ * The device values belong to the active device. A snapshot is never modified
+ * after it was published.
+ */
+struct SettingsSnapshot {
+    // device
+    bool deviceConfigured = false; /**< The active device has a port */
+    QString deviceActive;
+    QString deviceName;
+    int deviceChannels = 0;
+    double voltageMin = 0;
+    double voltageMax = 0;
+    int voltageAccuracy = 0;
+    double currentMin = 0;
+    double currentMax = 0;
+    int currentAccuracy = 0;
+    int pollFrequency = 1000;
+    // plot
+    double plotZoomMin = 0;
+    double plotZoomMax = 0;
+    int plotFps = 0;
+    int plotRetentionTime = 0;
+    int plotRetentionPoints = 0;
+};
+
+/**
+ * @brief Publishes immutable settings snapshots to all threads
+ *
+ * @details
+ *
+ * Implementation of Meyers' Singleton pattern like PerfMetrics. The snapshot
+ * is read from QSettings once and again whenever reload is called, e.g. after
+ * the SettingsDialog saved the settings. A new snapshot is published with an
+ * atomic store and a generation counter. Every thread keeps a thread local
+ * copy of the shared pointer and only touches the shared one if the
+ * generation changed, so reading the settings costs one atomic load.
+ *
+ * A reference returned by snapshot stays valid until the same thread calls
+ * snapshot again after a reload.
+ */
+class SettingsCache
+{
+public:
+    SettingsCache(SettingsCache const &) = delete;
+    void operator=(SettingsCache const &) = delete;
+
+    static SettingsCache &get_instance()
+    {
+        static SettingsCache cache;
+        return cache;
+    }
+
+    /**
+     * @brief The current settings
+     */
+    const SettingsSnapshot &snapshot();
+    /**
+     * @brief Read the settings and publish a new snapshot
+     */
+    void reload();
+
+private:
+    SettingsCache();
+
+    std::shared_ptr<const SettingsSnapshot> current;
+    std::atomic<unsigned long> generation;
+};
+
+#endif  // SETTINGSCACHE_H
@@ -18,6 +18,7 @@
 #define SETTINGSDEFAULT_H
 
 #include <QStandardPaths>
+#include <QStringList>
 #include <QVariant>
 
 #include <map>
@@ -37,10 +38,19 @@ const std::map<const char* const, QVariant> general_defaults{
     {settings_constants::GENERAL_INFO_SETTINGS, QVariant(false)},
     {settings_constants::PLOT_ZOOM_MIN, QVariant(60)},
     {settings_constants::PLOT_ZOOM_MAX, QVariant(1800)},
+    {settings_constants::PLOT_FPS, QVariant(20)},
+    {settings_constants::PLOT_RETENTION_TIME, QVariant(60)},
+    {settings_constants::PLOT_RETENTION_POINTS, QVariant(0)},
     {settings_constants::RECORD_BUFFER, QVariant(60)},
+    {settings_constants::RECORD_BUFFER_AGE, QVariant(10)},
+    {settings_constants::RECORD_BACKEND, QVariant(0)},
+    {settings_constants::RECORD_RETENTION_DAYS, QVariant(0)},
+    {settings_constants::RECORD_RETENTION_SIZE, QVariant(0)},
+    {settings_constants::RECORD_RETENTION_RECORDINGS, QVariant(0)},
     {settings_constants::LOG_ENABLED, QVariant(false)},
     {settings_constants::LOG_MIN_SEVERITY, QVariant(1)},
-    {settings_constants::LOG_FLUSH, QVariant(false)}};
+    {settings_constants::LOG_FLUSH, QVariant(false)},
+    {settings_constants::WATCHDOG_RULES, QVariant(QStringList())}};
 }
 
 #endif /* SETTINGSDEFAULT_H */
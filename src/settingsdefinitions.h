@@ -55,6 +55,7 @@ const char *const DEVICE_VOLTAGE_MIN = "voltage_min";
 const char *const DEVICE_VOLTAGE_MAX = "voltage_max";
 const char *const DEVICE_VOLTAGE_ACCURACY = "voltage_accuracy";
 const char *const DEVICE_POLL_FREQ = "poll_freq";
+const char *const DEVICE_IDENTIFICATION = "identification";
 // plot
 const char *const PLOT_GROUP = "plot";
 const char *const PLOT_ENABLED = "enabled";
@@ -68,16 +69,27 @@ const char *const PLOT_GRAPH_LS = "graph_%1_ls";
 const char *const PLOT_GRAPH_LINE = "graph_%1_line";
 const char *const PLOT_ZOOM_MIN = "zoom_min";
 const char *const PLOT_ZOOM_MAX = "zoom_max";
+const char *const PLOT_FPS = "fps";
+const char *const PLOT_RETENTION_TIME = "retention_time";
+const char *const PLOT_RETENTION_POINTS = "retention_points";
 // record
 const char *const RECORD_GROUP = "record";
 const char *const RECORD_SQLPATH = "sqlpath";
 const char *const RECORD_TBLPRE = "tblprefix";
 const char *const RECORD_BUFFER = "buffersize";
+const char *const RECORD_BUFFER_AGE = "bufferage";
+const char *const RECORD_BACKEND = "backend";
+const char *const RECORD_RETENTION_DAYS = "retentiondays";
+const char *const RECORD_RETENTION_SIZE = "retentionsize";
+const char *const RECORD_RETENTION_RECORDINGS = "retentionrecordings";
 // log
 const char *const LOG_GROUP = "logging";
 const char *const LOG_ENABLED = "enabled";
 const char *const LOG_DIRECTORY = "directory";
 const char *const LOG_MIN_SEVERITY = "severity";
 const char *const LOG_FLUSH = "flush";
+// watchdog
+const char *const WATCHDOG_GROUP = "watchdog";
+const char *const WATCHDOG_RULES = "rules";
 }
 #endif  // SETTINGSDEFINITIONS_H
@@ -133,6 +133,7 @@ SettingsDialog::SettingsDialog(QWidget *parent)
                     ui->comboBoxDeviceActive->currentText())) {
                 settings.remove(ui->comboBoxDeviceActive->currentText());
                 settings.setValue(setcon::DEVICE_ACTIVE, "");
+                SettingsCache::get_instance().reload();
                 this->devicesComboBoxUpdate();
             }
         });
@@ -224,6 +225,20 @@ void SettingsDialog::initPlot()
         settings.value(setcon::PLOT_ZOOM_MAX,
                        setdef::general_defaults.at(setcon::PLOT_ZOOM_MAX))
             .toInt());
+    ui->spinBoxPlotFps->setValue(
+        settings.value(setcon::PLOT_FPS,
+                       setdef::general_defaults.at(setcon::PLOT_FPS))
+            .toInt());
+    ui->spinBoxPlotRetentionTime->setValue(
+        settings
+            .value(setcon::PLOT_RETENTION_TIME,
+                   setdef::general_defaults.at(setcon::PLOT_RETENTION_TIME))
+            .toInt());
+    ui->spinBoxPlotRetentionPoints->setValue(
+        settings
+            .value(setcon::PLOT_RETENTION_POINTS,
+                   setdef::general_defaults.at(setcon::PLOT_RETENTION_POINTS))
+            .toInt());
 }
 void SettingsDialog::initRecord()
 {
@@ -237,6 +252,30 @@ void SettingsDialog::initRecord()
         settings.value(setcon::RECORD_BUFFER,
                        setdef::general_defaults.at(setcon::RECORD_BUFFER))
             .toInt());
+    ui->spinBoxRecordBufferAge->setValue(
+        settings.value(setcon::RECORD_BUFFER_AGE,
+                       setdef::general_defaults.at(setcon::RECORD_BUFFER_AGE))
+            .toInt());
+    ui->comboBoxRecordBackend->setCurrentIndex(
+        settings.value(setcon::RECORD_BACKEND,
+                       setdef::general_defaults.at(setcon::RECORD_BACKEND))
+            .toInt());
+    ui->spinBoxRetentionDays->setValue(
+        settings
+            .value(setcon::RECORD_RETENTION_DAYS,
+                   setdef::general_defaults.at(setcon::RECORD_RETENTION_DAYS))
+            .toInt());
+    ui->spinBoxRetentionSize->setValue(
+        settings
+            .value(setcon::RECORD_RETENTION_SIZE,
+                   setdef::general_defaults.at(setcon::RECORD_RETENTION_SIZE))
+            .toInt());
+    ui->spinBoxRetentionRecordings->setValue(
+        settings
+            .value(setcon::RECORD_RETENTION_RECORDINGS,
+                   setdef::general_defaults.at(
+                       setcon::RECORD_RETENTION_RECORDINGS))
+            .toInt());
 }
 
 void SettingsDialog::initLog()
@@ -323,6 +362,27 @@ bool SettingsDialog::checkSettingsChanged(QListWidgetItem *lastItem)
                 .toInt()) {
             somethingChanged = true;
         }
+        if (ui->spinBoxPlotFps->value() !=
+            settings.value(setcon::PLOT_FPS,
+                           setdef::general_defaults.at(setcon::PLOT_FPS))
+                .toInt()) {
+            somethingChanged = true;
+        }
+        if (ui->spinBoxPlotRetentionTime->value() !=
+            settings
+                .value(setcon::PLOT_RETENTION_TIME,
+                       setdef::general_defaults.at(setcon::PLOT_RETENTION_TIME))
+                .toInt()) {
+            somethingChanged = true;
+        }
+        if (ui->spinBoxPlotRetentionPoints->value() !=
+            settings
+                .value(setcon::PLOT_RETENTION_POINTS,
+                       setdef::general_defaults.at(
+                           setcon::PLOT_RETENTION_POINTS))
+                .toInt()) {
+            somethingChanged = true;
+        }
         break;
     case 3:
         settings.beginGroup(setcon::RECORD_GROUP);
@@ -342,6 +402,41 @@ bool SettingsDialog::checkSettingsChanged(QListWidgetItem *lastItem)
                     .toInt()) {
                 somethingChanged = true;
             }
+            if (ui->spinBoxRecordBufferAge->value() !=
+                settings.value(setcon::RECORD_BUFFER_AGE,
+                               setdef::general_defaults.at(
+                                   setcon::RECORD_BUFFER_AGE))
+                    .toInt()) {
+                somethingChanged = true;
+            }
+            if (ui->comboBoxRecordBackend->currentIndex() !=
+                settings.value(
+                            setcon::RECORD_BACKEND,
+                            setdef::general_defaults.at(setcon::RECORD_BACKEND))
+                    .toInt()) {
+                somethingChanged = true;
+            }
+            if (ui->spinBoxRetentionDays->value() !=
+                settings.value(setcon::RECORD_RETENTION_DAYS,
+                               setdef::general_defaults.at(
+                                   setcon::RECORD_RETENTION_DAYS))
+                    .toInt()) {
+                somethingChanged = true;
+            }
+            if (ui->spinBoxRetentionSize->value() !=
+                settings.value(setcon::RECORD_RETENTION_SIZE,
+                               setdef::general_defaults.at(
+                                   setcon::RECORD_RETENTION_SIZE))
+                    .toInt()) {
+                somethingChanged = true;
+            }
+            if (ui->spinBoxRetentionRecordings->value() !=
+                settings.value(setcon::RECORD_RETENTION_RECORDINGS,
+                               setdef::general_defaults.at(
+                                   setcon::RECORD_RETENTION_RECORDINGS))
+                    .toInt()) {
+                somethingChanged = true;
+            }
         }
         break;
     case 4:
@@ -406,6 +501,11 @@ void SettingsDialog::saveSettings(int currentRow)
                           ui->spinBoxPlotZoomMin->value());
         settings.setValue(setcon::PLOT_ZOOM_MAX,
                           ui->spinBoxPlotZoomMax->value());
+        settings.setValue(setcon::PLOT_FPS, ui->spinBoxPlotFps->value());
+        settings.setValue(setcon::PLOT_RETENTION_TIME,
+                          ui->spinBoxPlotRetentionTime->value());
+        settings.setValue(setcon::PLOT_RETENTION_POINTS,
+                          ui->spinBoxPlotRetentionPoints->value());
     };
     if (currentRow == 3) {
         settings.beginGroup(setcon::RECORD_GROUP);
@@ -425,11 +525,21 @@ void SettingsDialog::saveSettings(int currentRow)
                                      QMessageBox::StandardButton::Ok);
             } else {
                 dbutil::setDBOptimizations();
-                dbutil::initTables();
+                dbutil::updateSchema();
             }
         }
         settings.setValue(setcon::RECORD_BUFFER,
                           ui->spinBoxRecordBuffer->value());
+        settings.setValue(setcon::RECORD_BUFFER_AGE,
+                          ui->spinBoxRecordBufferAge->value());
+        settings.setValue(setcon::RECORD_BACKEND,
+                          ui->comboBoxRecordBackend->currentIndex());
+        settings.setValue(setcon::RECORD_RETENTION_DAYS,
+                          ui->spinBoxRetentionDays->value());
+        settings.setValue(setcon::RECORD_RETENTION_SIZE,
+                          ui->spinBoxRetentionSize->value());
+        settings.setValue(setcon::RECORD_RETENTION_RECORDINGS,
+                          ui->spinBoxRetentionRecordings->value());
     }
 
     if (currentRow == 4) {
@@ -442,6 +552,8 @@ void SettingsDialog::saveSettings(int currentRow)
                           ui->comboBoxLogLoglevel->currentIndex());
         settings.setValue(setcon::LOG_FLUSH, ui->checkBoxLogFlush->isChecked());
     }
+    // publish the new values to all threads
+    SettingsCache::get_instance().reload();
 }
 
 void SettingsDialog::restoreSettings(int currentRow)
@@ -460,12 +572,30 @@ void SettingsDialog::restoreSettings(int currentRow)
             setdef::general_defaults.at(setcon::PLOT_ZOOM_MIN).toInt());
         ui->spinBoxPlotZoomMax->setValue(
             setdef::general_defaults.at(setcon::PLOT_ZOOM_MAX).toInt());
+        ui->spinBoxPlotFps->setValue(
+            setdef::general_defaults.at(setcon::PLOT_FPS).toInt());
+        ui->spinBoxPlotRetentionTime->setValue(
+            setdef::general_defaults.at(setcon::PLOT_RETENTION_TIME).toInt());
+        ui->spinBoxPlotRetentionPoints->setValue(
+            setdef::general_defaults.at(setcon::PLOT_RETENTION_POINTS)
+                .toInt());
     }
     if (currentRow == 3) {
         ui->lineEditSqlitePath->setText(this->defaultSqlFile);
         ui->lineEditRecordTablePrefix->setText("");
         ui->spinBoxRecordBuffer->setValue(
             setdef::general_defaults.at(setcon::RECORD_BUFFER).toInt());
+        ui->spinBoxRecordBufferAge->setValue(
+            setdef::general_defaults.at(setcon::RECORD_BUFFER_AGE).toInt());
+        ui->comboBoxRecordBackend->setCurrentIndex(
+            setdef::general_defaults.at(setcon::RECORD_BACKEND).toInt());
+        ui->spinBoxRetentionDays->setValue(
+            setdef::general_defaults.at(setcon::RECORD_RETENTION_DAYS).toInt());
+        ui->spinBoxRetentionSize->setValue(
+            setdef::general_defaults.at(setcon::RECORD_RETENTION_SIZE).toInt());
+        ui->spinBoxRetentionRecordings->setValue(
+            setdef::general_defaults.at(setcon::RECORD_RETENTION_RECORDINGS)
+                .toInt());
     }
     if (currentRow == 4) {
         ui->checkBoxLogEnabled->setChecked(
@@ -23,7 +23,6 @@
 #include <QFileDialog>
 #include <QListWidgetItem>
 #include <QMessageBox>
-#include <QQuickView>
 #include <QStandardPaths>
 
 #include <QtSerialPort/QSerialPort>
@@ -39,6 +38,7 @@
 
 #include "databasedef.h"
 #include "devicewizard.h"
+#include "settingscache.h"
 #include "settingsdefault.h"
 #include "settingsdefinitions.h"
 
@@ -18,30 +18,24 @@
 #include "tabhistory.h"
 
 namespace dbcon = database_constants;
-namespace dbutil = database_utils;
-namespace setcon = settings_constants;
 
 TabHistory::TabHistory(QWidget *parent) : QWidget(parent)
 {
     this->lay = new QGridLayout();
     this->setLayout(this->lay);
-    QSettings settings;
-    settings.beginGroup(setcon::RECORD_GROUP);
-    dbutil::initDatabase(
-        "QSQLITE",
-        settings
-            .value(
-                setcon::RECORD_SQLPATH,
-                QStandardPaths::writableLocation(QStandardPaths::DataLocation) +
-                    QDir::separator() + QString("labpowerqt.sqlite"))
-            .toString());
-
+    // the database is opened by the DBConnector of the controller, the model
+    // is created when the tab is shown for the first time.
     this->setupUI();
     this->setupConnections();
 }
 
 void TabHistory::updateModel()
 {
+    // recordingsDeleted also ends a delete job of the user
+    this->maintenanceProgress.reset();
+    // selected anyway once the model is created
+    if (!this->tblModel)
+        return;
     this->tblModel->select();
     this->tblView->resizeColumnsToContents();
 }
@@ -51,9 +45,75 @@ void TabHistory::indexChanged(ATTR_UNUSED const QModelIndex &current,
 {
 }
 
+void TabHistory::replayProgress(qint64 position, qint64 jitter)
+{
+    qint64 seconds = position / 1000;
+    this->labelReplay->setText(tr("Replaying %1:%2:%3, jitter %4 µs")
+                                   .arg(seconds / 3600)
+                                   .arg((seconds / 60) % 60, 2, 10, QChar('0'))
+                                   .arg(seconds % 60, 2, 10, QChar('0'))
+                                   .arg(jitter));
+}
+
+void TabHistory::replayFinished(bool aborted)
+{
+    this->actionReplay->setChecked(false);
+    this->labelReplay->setText(aborted ? tr("Replay stopped")
+                                       : tr("Replay finished"));
+}
+
+void TabHistory::databaseCompacted()
+{
+    this->maintenanceProgress.reset();
+    QMessageBox::information(this, "Compact Database",
+                             "The database has been compacted.");
+}
+
+void TabHistory::maintenanceFailed(QString errorString)
+{
+    this->maintenanceProgress.reset();
+    QMessageBox::critical(this, "Database maintenance failed", errorString);
+}
+
+void TabHistory::showEvent(QShowEvent *ev)
+{
+    this->setupModel();
+    QWidget::showEvent(ev);
+}
+
 void TabHistory::toolBarAction(QAction *action)
 {
+    if (action == this->actionReplay) {
+        QModelIndexList selectedRows =
+            this->tblView->selectionModel()->selectedRows();
+        if (!this->actionReplay->isChecked()) {
+            emit this->stopReplay();
+        } else if (selectedRows.size() != 1) {
+            this->actionReplay->setChecked(false);
+            QMessageBox::information(this, "Replay recording",
+                                     "Please select one recording to replay.");
+        } else {
+            QSqlRecord rec = this->tblModel->record(selectedRows.at(0).row());
+            this->labelReplay->setText(tr("Replay starting"));
+            emit this->replayRecording(
+                rec.value(dbcon::TBL_RECORDING_ID).toLongLong(),
+                rec.value(dbcon::TBL_RECORDING_FILE).toString(),
+                rec.value(dbcon::TBL_RECORDING_CHAN).toInt(),
+                this->spinReplaySpeed->value());
+        }
+        return;
+    }
+    if (action == this->actionCompact) {
+        this->compactDatabase();
+        return;
+    }
     if (this->tblView->selectionModel()->selectedRows().size() > 0) {
+        if (action == this->actionView) {
+            for (const auto &index :
+                 this->tblView->selectionModel()->selectedRows()) {
+                this->viewRecording(index.row());
+            }
+        }
         if (action == this->actionDelete) {
             this->deleteRecordings();
         }
@@ -69,13 +129,61 @@ void TabHistory::setupUI()
     this->tbar->setFloatable(false);
     this->tbar->setMovable(false);
     this->lay->addWidget(this->tbar, 0, 0);
+    this->actionView = this->tbar->addAction("View");
+    this->actionView->setIcon(QPixmap(":/icons/graph_32.png"));
+    this->actionView->setToolTip("Plot selected recordings");
     this->actionDelete = this->tbar->addAction("Delete");
     this->actionDelete->setIcon(QPixmap(":/icons/trash32.png"));
     this->actionDelete->setToolTip("Delete selected recordings");
     this->actionExport = this->tbar->addAction("Export");
     this->actionExport->setIcon(QPixmap(":/icons/csv32.png"));
     this->actionExport->setToolTip("Export selected recordings to CSV");
+    this->tbar->addSeparator();
+    this->tbar->addWidget(new QLabel(tr("Resolution ")));
+    this->comboResolution = new QComboBox();
+    this->comboResolution->setToolTip(
+        "Export raw measurements or min, max, mean and last value per interval");
+    this->comboResolution->addItem(
+        tr("Raw"), static_cast<int>(rollup_constants::LEVEL::RAW));
+    this->comboResolution->addItem(
+        tr("1 s"), static_cast<int>(rollup_constants::LEVEL::SECOND));
+    this->comboResolution->addItem(
+        tr("1 min"), static_cast<int>(rollup_constants::LEVEL::MINUTE));
+    this->comboResolution->addItem(
+        tr("1 h"), static_cast<int>(rollup_constants::LEVEL::HOUR));
+    this->tbar->addWidget(this->comboResolution);
+    this->tbar->addSeparator();
+    this->actionReplay = this->tbar->addAction("Replay");
+    this->actionReplay->setIcon(QPixmap(":/icons/device32.png"));
+    this->actionReplay->setCheckable(true);
+    this->actionReplay->setToolTip(
+        "Replay set voltage, set current and output of the selected recording "
+        "on the connected device");
+    this->tbar->addWidget(new QLabel(tr("Speed ")));
+    this->spinReplaySpeed = new QDoubleSpinBox();
+    this->spinReplaySpeed->setRange(0.01, 1000);
+    this->spinReplaySpeed->setValue(1);
+    this->spinReplaySpeed->setSuffix("x");
+    this->spinReplaySpeed->setToolTip("Time scale of the replay");
+    this->tbar->addWidget(this->spinReplaySpeed);
+    this->labelReplay = new QLabel();
+    this->tbar->addWidget(this->labelReplay);
+    this->tbar->addSeparator();
+    this->actionCompact = this->tbar->addAction("Compact");
+    this->actionCompact->setIcon(QPixmap(":/icons/gear_32.png"));
+    this->actionCompact->setToolTip(
+        "Rebuild the database file to give free space back to the system");
+
+    this->tblView = new QTableView();
+    this->tblView->horizontalHeader()->setStretchLastSection(true);
+    this->lay->addWidget(this->tblView, 1, 0);
+}
 
+void TabHistory::setupModel()
+{
+    if (this->tblModel)
+        return;
+    ScopedTiming timing("history.model.ms");
     this->tblModel = std::unique_ptr<RecordSqlModel>(new RecordSqlModel());
     this->tblModel->setTable(dbcon::TBL_RECORDING);
     this->tblModel->setEditStrategy(QSqlTableModel::OnFieldChange);
@@ -87,25 +195,54 @@ void TabHistory::setupUI()
     this->tblModel->setHeaderData(5, Qt::Horizontal, tr("Channels"));
     this->tblModel->setHeaderData(6, Qt::Horizontal, tr("Beginn"));
     this->tblModel->setHeaderData(7, Qt::Horizontal, tr("End"));
+    this->tblModel->setHeaderData(9, Qt::Horizontal, tr("Storage"));
 
-    this->tblView = new QTableView();
     this->tblView->setModel(this->tblModel.get());
     // hide id and timestamp column
     this->tblView->hideColumn(0);
     this->tblView->hideColumn(8);
-    this->tblView->horizontalHeader()->setStretchLastSection(true);
     this->tblView->resizeColumnsToContents();
-    this->lay->addWidget(this->tblView, 1, 0);
+
+    QObject::connect(this->tblView->selectionModel(),
+                     &QItemSelectionModel::currentRowChanged, this,
+                     &TabHistory::indexChanged);
 }
 
 void TabHistory::setupConnections()
 {
+    this->exporter = std::unique_ptr<CsvExporter>(new CsvExporter());
+    QObject::connect(this->exporter.get(), &CsvExporter::progress,
+                     [this](long long rowsDone, long long rowsTotal) {
+                         if (!this->exportProgress || rowsTotal <= 0)
+                             return;
+                         // QProgressDialog only supports int ranges
+                         this->exportProgress->setMaximum(1000);
+                         this->exportProgress->setValue(static_cast<int>(
+                             std::min(rowsDone, rowsTotal) * 1000 / rowsTotal));
+                     });
+    QObject::connect(this->exporter.get(), &CsvExporter::finished, this,
+                     &TabHistory::exportFinished);
+
     QObject::connect(this->tbar, &QToolBar::actionTriggered, this,
                      &TabHistory::toolBarAction);
+}
 
-    QObject::connect(this->tblView->selectionModel(),
-                     &QItemSelectionModel::currentRowChanged, this,
-                     &TabHistory::indexChanged);
+void TabHistory::viewRecording(int row)
+{
+    QSqlRecord rec = this->tblModel->record(row);
+    QDateTime start = rec.value(dbcon::TBL_RECORDING_START).toDateTime();
+    // a running recording has no end yet
+    QDateTime stop = rec.isNull(dbcon::TBL_RECORDING_STOP)
+                         ? QDateTime::currentDateTime()
+                         : rec.value(dbcon::TBL_RECORDING_STOP).toDateTime();
+    HistoryViewer *viewer = new HistoryViewer(
+        rec.value(dbcon::TBL_RECORDING_ID).toLongLong(),
+        rec.value(dbcon::TBL_RECORDING_NAME).toString(),
+        rec.value(dbcon::TBL_RECORDING_CHAN).toInt(),
+        rec.value(dbcon::TBL_RECORDING_FILE).toString(),
+        start.toMSecsSinceEpoch(), stop.toMSecsSinceEpoch(), this);
+    viewer->setAttribute(Qt::WA_DeleteOnClose);
+    viewer->show();
 }
 
 void TabHistory::deleteRecordings()
@@ -116,16 +253,44 @@ void TabHistory::deleteRecordings()
     if (static_cast<QMessageBox::StandardButton>(ret) == QMessageBox::Yes) {
         QModelIndexList selectedRows =
             this->tblView->selectionModel()->selectedRows();
+        std::vector<long long> recIDs;
         for (const auto &index : selectedRows) {
-            this->tblModel->removeRows(index.row(), 1);
+            recIDs.push_back(this->tblModel->record(index.row())
+                                 .value(dbcon::TBL_RECORDING_ID)
+                                 .toLongLong());
         }
-        this->tblModel->select();
+        // the dialog is closed by updateModel or maintenanceFailed
+        this->showMaintenanceProgress("Deleting recordings...");
+        emit this->deleteRequested(std::move(recIDs));
+    }
+}
+
+void TabHistory::compactDatabase()
+{
+    int ret = QMessageBox::question(
+        this, "Compact Database",
+        "Compacting rewrites the whole database file and can take several "
+        "minutes. It is not possible while recording. Continue?");
+    if (static_cast<QMessageBox::StandardButton>(ret) == QMessageBox::Yes) {
+        this->showMaintenanceProgress("Compacting database...");
+        emit this->compactRequested();
     }
 }
 
+void TabHistory::showMaintenanceProgress(const QString &labelText)
+{
+    // the jobs can not be canceled
+    this->maintenanceProgress = std::unique_ptr<QProgressDialog>(
+        new QProgressDialog(labelText, QString(), 0, 0, this));
+    this->maintenanceProgress->setWindowTitle("Database Maintenance");
+    this->maintenanceProgress->setWindowModality(Qt::WindowModal);
+    this->maintenanceProgress->setMinimumDuration(500);
+}
+
 void TabHistory::exportToCsv()
 {
-    ealogger::Logger &log = LogInstance::get_instance();
+    if (this->exporter->isRunning())
+        return;
     QModelIndexList selectedRows =
         this->tblView->selectionModel()->selectedRows();
     QString csvFile = QFileDialog::getSaveFileName(
@@ -133,71 +298,49 @@ void TabHistory::exportToCsv()
         QStandardPaths::writableLocation(QStandardPaths::HomeLocation) +
             QDir::separator() + "labpowerqt_export.csv",
         "CSV (*.csv)");
-    log.eal_info("Exporting data to csv file " + csvFile.toStdString());
-    if (csvFile != "") {
-        QFile csvf(csvFile);
-        csvf.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Text);
-        QTextStream txt(&csvf);
-        txt << "Recording;Device;OCP;OVP;OTP;TrackingMode;DateTime;Channel;"
-               "Output;Mode;Voltage;VoltageSet;Current;CurrentSet;Wattage"
-            << Qt::endl;
-        for (const auto &index : selectedRows) {
-            int recId = this->tblModel->record(index.row())
-                            .value(dbcon::TBL_RECORDING_ID)
-                            .toInt();
-            QString recName = this->tblModel->record(index.row())
-                                  .value(dbcon::TBL_RECORDING_NAME)
-                                  .toString();
-            QString devName = this->tblModel->record(index.row())
-                                  .value(dbcon::TBL_RECORDING_DEVICE)
-                                  .toString();
-            // in fact it is nonsense to select the default connection as this is
-            // done by default
-            QSqlQuery getMeasurements(QSqlDatabase::database());
-            // clang-format off
-            if (!getMeasurements.prepare(QString("SELECT m.") + dbcon::TBL_MEASUREMENT_OCP + ", "
-                                    + "m." + dbcon::TBL_MEASUREMENT_OVP + ", "
-                                    + "m." + dbcon::TBL_MEASUREMENT_OTP + ", "
-                                    + "m." + dbcon::TBL_MEASUREMENT_TRMODE + ", "
-                                    + "m." + dbcon::TBL_MEASUREMENT_TIME + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_CHAN + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_OUTPUT + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_MODE + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_V + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_VS + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_A + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_AS + ", "
-                                    + "c." + dbcon::TBL_CHANNEL_W + " \n"
-                                    + "FROM " + dbcon::TBL_CHANNEL + " AS c \n"
-                                    + "INNER JOIN " + dbcon::TBL_MEASUREMENT + " AS m \n"
-                                    + "ON c." + dbcon::TBL_CHANNEL_MES + " = m." + dbcon::TBL_MEASUREMENT_ID + "\n"
-                                    + "WHERE m." + dbcon::TBL_MEASUREMENT_REC + " = ?")) {
-                log.eal_error(getMeasurements.lastError().text().toStdString());
-            }
-            log.eal_debug(getMeasurements.executedQuery().toStdString());
-            // clang-format on
-            getMeasurements.bindValue(0, recId);
-            if (getMeasurements.exec()) {
-                while (getMeasurements.next()) {
-                    txt << "\"" << recName << "\""
-                        << ";"
-                        << "\"" << devName << "\"";
-                    // TODO: Fixed value for number of columns in for loop. Maybe
-                    // we could do this differently
-                    for (int i = 0; i < 14; i++) {
-                        txt << ";" << getMeasurements.value(i).toString();
-                    }
-                    txt << Qt::endl;
-                }
-            } else {
-                LogInstance::get_instance().eal_error(
-                    "Could not export recording " + recName.toStdString());
-                LogInstance::get_instance().eal_error(
-                    getMeasurements.lastError().text().toStdString());
-                QMessageBox::critical(this,
-                                      "Could not export Recording " + recName,
-                                      getMeasurements.lastError().text());
-            }
-        }
+    if (csvFile == "")
+        return;
+
+    std::vector<CsvExportJob> jobs;
+    for (const auto &index : selectedRows) {
+        QSqlRecord rec = this->tblModel->record(index.row());
+        CsvExportJob job;
+        job.recId = rec.value(dbcon::TBL_RECORDING_ID).toLongLong();
+        job.recName = rec.value(dbcon::TBL_RECORDING_NAME).toString();
+        job.devName = rec.value(dbcon::TBL_RECORDING_DEVICE).toString();
+        job.channels = rec.value(dbcon::TBL_RECORDING_CHAN).toInt();
+        job.dataFile = rec.value(dbcon::TBL_RECORDING_FILE).toString();
+        jobs.push_back(std::move(job));
+    }
+
+    this->exportProgress = std::unique_ptr<QProgressDialog>(
+        new QProgressDialog("Exporting recordings...", "Cancel", 0, 0, this));
+    this->exportProgress->setWindowTitle("Export Recordings");
+    this->exportProgress->setWindowModality(Qt::WindowModal);
+    this->exportProgress->setMinimumDuration(500);
+    QObject::connect(this->exportProgress.get(), &QProgressDialog::canceled,
+                     this->exporter.get(), &CsvExporter::cancel);
+    if (!this->exporter->start(
+            std::move(jobs), csvFile,
+            static_cast<rollup_constants::LEVEL>(
+                this->comboResolution->currentData().toInt()))) {
+        this->exportProgress.reset();
+    }
+}
+
+void TabHistory::exportFinished(bool success, QString errorString)
+{
+    bool canceled = false;
+    if (this->exportProgress) {
+        canceled = this->exportProgress->wasCanceled();
+        // do not report the reset of the dialog as cancel
+        QObject::disconnect(this->exportProgress.get(),
+                            &QProgressDialog::canceled, this->exporter.get(),
+                            &CsvExporter::cancel);
+        this->exportProgress->reset();
+        this->exportProgress.reset();
+    }
+    if (!success && !canceled) {
+        QMessageBox::critical(this, "Could not export Recordings", errorString);
     }
 }
@@ -19,6 +19,8 @@
 #define TABHISTORY_H
 
 #include <QAction>
+#include <QComboBox>
+#include <QDoubleSpinBox>
 #include <QGridLayout>
 #include <QHBoxLayout>
 #include <QHeaderView>
@@ -33,25 +35,35 @@
 #include <QSqlTableModel>
 
 #include <QSettings>
+#include <QShowEvent>
 
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QProgressDialog>
 
 #include <QDir>
 #include <QFile>
 #include <QStandardPaths>
-#include <QTextStream>
 
+#include <algorithm>
 #include <memory>
 
+#include "csvexporter.h"
 #include "databasedef.h"
+#include "historyviewer.h"
 #include "log_instance.h"
+#include "perfmetrics.h"
 #include "settingsdefinitions.h"
 
 #include "recordsqlmodel.h"
 
 /**
  * @brief Base widget for the Recordings History tab
+ *
+ * @details
+ *
+ * The table model is created and selected the first time the tab is shown,
+ * an application that never shows the history does not query the recordings.
  */
 class TabHistory : public QWidget
 {
@@ -61,9 +73,27 @@ public:
 
 signals:
 
+    /**
+     * @brief Replay the setpoints of a recording onto the device
+     *
+     * @param timeScale Replay speed, 2 replays twice as fast
+     */
+    void replayRecording(long long recID, QString dataFile, int channels,
+                         double timeScale);
+    void stopReplay();
+    /**
+     * @brief Delete recordings in the background, see DBMaintenance
+     */
+    void deleteRequested(std::vector<long long> recIDs);
+    void compactRequested();
+
 public slots:
 
     void updateModel();
+    void replayProgress(qint64 position, qint64 jitter);
+    void replayFinished(bool aborted);
+    void databaseCompacted();
+    void maintenanceFailed(QString errorString);
 
 private slots:
 
@@ -73,16 +103,45 @@ private slots:
 private:
     QGridLayout *lay;
     QToolBar *tbar;
+    QAction *actionView;
     QAction *actionDelete;
     QAction *actionExport;
+    QAction *actionReplay;
+    QAction *actionCompact;
+    QComboBox *comboResolution;
+    QDoubleSpinBox *spinReplaySpeed;
+    QLabel *labelReplay;
     std::unique_ptr<QSqlTableModel> tblModel;
     QTableView *tblView;
+    std::unique_ptr<CsvExporter> exporter;
+    std::unique_ptr<QProgressDialog> exportProgress;
+    std::unique_ptr<QProgressDialog> maintenanceProgress;
 
     void setupUI();
     void setupConnections();
+    void setupModel();
 
+    /**
+     * @brief Plot the recording in row in a HistoryViewer
+     */
+    void viewRecording(int row);
     void deleteRecordings();
+    /**
+     * @brief Rebuild the database file so free pages can be reclaimed
+     */
+    void compactDatabase();
+    /**
+     * @brief Show a busy dialog until the maintenance job has finished
+     */
+    void showMaintenanceProgress(const QString &labelText);
+    /**
+     * @brief Export the selected recordings in the background
+     */
     void exportToCsv();
+    void exportFinished(bool success, QString errorString);
+
+protected:
+    void showEvent(QShowEvent *ev);
 };
 
 #endif  // TABHISTORY_H
@@ -17,16 +17,338 @@
 
 #include "tabprogram.h"
 
+#include <algorithm>
+
+namespace ctrlcon = control_constants;
+namespace globcon = global_constants;
+namespace progcon = program_constants;
+namespace seqcon = sequence_constants;
+
 TabProgram::TabProgram(QWidget *parent) : QWidget(parent)
 {
     this->programLayout = new QGridLayout();
     this->setLayout(this->programLayout);
+    this->setupUI();
+    this->setRunning(false);
+}
+
+void TabProgram::stepExecuted(int step, qint64 elapsed, qint64 jitter)
+{
+    if (step < 0 || step >= this->tblSteps->rowCount())
+        return;
+    if (static_cast<size_t>(step) >= this->maxJitter.size())
+        this->maxJitter.resize(static_cast<size_t>(step) + 1, 0);
+    this->maxJitter[step] = std::max(this->maxJitter[step], jitter);
+    this->tblSteps->item(step, progcon::COL_EXECUTED)
+        ->setText(QString::number(elapsed));
+    this->tblSteps->item(step, progcon::COL_JITTER)
+        ->setText(QString::number(jitter));
+    this->tblSteps->item(step, progcon::COL_JITTERMAX)
+        ->setText(QString::number(this->maxJitter[step]));
+    this->labelStatus->setText(tr("Running step %1").arg(step + 1));
+}
+
+void TabProgram::sequenceFinished(bool aborted)
+{
+    this->setRunning(false);
+    this->labelStatus->setText(aborted ? tr("Aborted") : tr("Finished"));
+}
+
+void TabProgram::controlLoopFinished(int channel)
+{
+    this->labelControlStatus->setText(
+        tr("Control loop of channel %1 finished").arg(channel));
+}
+
+void TabProgram::toolBarAction(QAction *action)
+{
+    if (action == this->actionAdd) {
+        this->addStep(SequenceStep());
+    }
+    if (action == this->actionRemove) {
+        QList<QTableWidgetSelectionRange> ranges =
+            this->tblSteps->selectedRanges();
+        // remove from the bottom so the row numbers stay valid
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const QTableWidgetSelectionRange &a,
+                     const QTableWidgetSelectionRange &b) {
+                      return a.topRow() > b.topRow();
+                  });
+        for (const auto &range : ranges) {
+            for (int row = range.bottomRow(); row >= range.topRow(); row--) {
+                this->tblSteps->removeRow(row);
+            }
+        }
+    }
+    if (action == this->actionStart && this->tblSteps->rowCount() > 0) {
+        this->maxJitter.assign(
+            static_cast<size_t>(this->tblSteps->rowCount()), 0);
+        for (int row = 0; row < this->tblSteps->rowCount(); row++) {
+            for (int col : {progcon::COL_EXECUTED, progcon::COL_JITTER,
+                            progcon::COL_JITTERMAX}) {
+                this->tblSteps->item(row, col)->setText("");
+            }
+        }
+        this->setRunning(true);
+        this->labelStatus->setText(tr("Running"));
+        emit this->startSequence(this->steps());
+    }
+    if (action == this->actionStop) {
+        emit this->stopSequence();
+    }
+}
+
+void TabProgram::setupUI()
+{
+    this->tbar = new QToolBar();
+    this->tbar->setFloatable(false);
+    this->tbar->setMovable(false);
+    this->programLayout->addWidget(this->tbar, 0, 0);
+    this->actionAdd = this->tbar->addAction("Add");
+    this->actionAdd->setToolTip("Append a step");
+    this->actionRemove = this->tbar->addAction("Remove");
+    this->actionRemove->setIcon(QPixmap(":/icons/trash32.png"));
+    this->actionRemove->setToolTip("Remove selected steps");
+    this->tbar->addSeparator();
+    this->actionStart = this->tbar->addAction("Start");
+    this->actionStart->setIcon(QPixmap(":/icons/checkmark_32.png"));
+    this->actionStart->setToolTip("Run the sequence on the connected device");
+    this->actionStop = this->tbar->addAction("Stop");
+    this->actionStop->setIcon(QPixmap(":/icons/cancel_close_32.png"));
+    this->actionStop->setToolTip("Stop the running sequence");
+    this->tbar->addSeparator();
+    this->labelStatus = new QLabel();
+    this->tbar->addWidget(this->labelStatus);
+
+    this->tblSteps = new QTableWidget(0, progcon::COL_COUNT);
+    this->tblSteps->setHorizontalHeaderLabels(
+        {tr("Type"), tr("Channel"), tr("Setpoint"), tr("From"), tr("Value"),
+         tr("Time (ms)"), tr("Loop to"), tr("Repeat"), tr("Executed (ms)"),
+         tr("Jitter (µs)"), tr("Max jitter (µs)")});
+    this->tblSteps->setSelectionBehavior(QAbstractItemView::SelectRows);
+    this->tblSteps->horizontalHeader()->setStretchLastSection(true);
+    this->programLayout->addWidget(this->tblSteps, 1, 0);
+
+    QObject::connect(this->tbar, &QToolBar::actionTriggered, this,
+                     &TabProgram::toolBarAction);
+
+    this->setupControlUI();
+}
+
+void TabProgram::setupControlUI()
+{
+    const SettingsSnapshot &snap = SettingsCache::get_instance().snapshot();
+    this->groupControl = new QGroupBox(tr("Control mode"));
+    QGridLayout *controlLayout = new QGridLayout();
+    this->groupControl->setLayout(controlLayout);
+    this->programLayout->addWidget(this->groupControl, 2, 0);
+
+    this->comboControlMode = new QComboBox();
+    this->comboControlMode->addItem(
+        tr("Constant power"),
+        static_cast<int>(ctrlcon::CONTROL_MODE::CONSTANT_POWER));
+    this->comboControlMode->addItem(
+        tr("CC-CV charge"),
+        static_cast<int>(ctrlcon::CONTROL_MODE::CC_CV_CHARGE));
+    this->spinControlChannel = new QSpinBox();
+    this->spinControlChannel->setRange(1, std::max(1, snap.deviceChannels));
+
+    auto valueSpin = [](int decimals, double max, const QString &suffix) {
+        QDoubleSpinBox *spin = new QDoubleSpinBox();
+        spin->setDecimals(decimals);
+        spin->setRange(0, max > 0 ? max : 1000);
+        spin->setSuffix(suffix);
+        return spin;
+    };
+    this->spinControlPower =
+        valueSpin(3, snap.voltageMax * snap.currentMax, " W");
+    this->spinControlVoltageLimit =
+        valueSpin(snap.voltageAccuracy, snap.voltageMax, " V");
+    this->spinControlChargeVoltage =
+        valueSpin(snap.voltageAccuracy, snap.voltageMax, " V");
+    this->spinControlChargeCurrent =
+        valueSpin(snap.currentAccuracy, snap.currentMax, " A");
+    this->spinControlTermination =
+        valueSpin(snap.currentAccuracy, snap.currentMax, " A");
+
+    this->buttonControlApply = new QPushButton(tr("Apply"));
+    this->buttonControlStop = new QPushButton(tr("Stop"));
+    this->labelControlStatus = new QLabel();
 
-    QLabel *niy = new QLabel("Not implemented yet...");
-    niy->setAlignment(Qt::AlignmentFlag::AlignCenter);
-    QFont f;
-    f.setPixelSize(24);
-    niy->setFont(f);
+    controlLayout->addWidget(new QLabel(tr("Mode")), 0, 0);
+    controlLayout->addWidget(this->comboControlMode, 0, 1);
+    controlLayout->addWidget(new QLabel(tr("Channel")), 0, 2);
+    controlLayout->addWidget(this->spinControlChannel, 0, 3);
+    controlLayout->addWidget(this->buttonControlApply, 0, 4);
+    controlLayout->addWidget(this->buttonControlStop, 0, 5);
+    controlLayout->addWidget(new QLabel(tr("Power")), 1, 0);
+    controlLayout->addWidget(this->spinControlPower, 1, 1);
+    controlLayout->addWidget(new QLabel(tr("Voltage limit")), 1, 2);
+    controlLayout->addWidget(this->spinControlVoltageLimit, 1, 3);
+    controlLayout->addWidget(new QLabel(tr("Charge voltage")), 2, 0);
+    controlLayout->addWidget(this->spinControlChargeVoltage, 2, 1);
+    controlLayout->addWidget(new QLabel(tr("Charge current")), 2, 2);
+    controlLayout->addWidget(this->spinControlChargeCurrent, 2, 3);
+    controlLayout->addWidget(new QLabel(tr("Termination current")), 2, 4);
+    controlLayout->addWidget(this->spinControlTermination, 2, 5);
+    controlLayout->addWidget(this->labelControlStatus, 3, 0, 1, 6);
 
-    this->programLayout->addWidget(niy);
+    QObject::connect(
+        this->comboControlMode,
+        static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+        this, &TabProgram::controlModeChanged);
+    QObject::connect(this->buttonControlApply, &QPushButton::clicked, this,
+                     &TabProgram::controlApply);
+    QObject::connect(this->buttonControlStop, &QPushButton::clicked, this,
+                     &TabProgram::controlStop);
+    this->controlModeChanged();
+}
+
+void TabProgram::controlModeChanged()
+{
+    bool power = static_cast<ctrlcon::CONTROL_MODE>(
+                     this->comboControlMode->currentData().toInt()) ==
+                 ctrlcon::CONTROL_MODE::CONSTANT_POWER;
+    this->spinControlPower->setEnabled(power);
+    this->spinControlVoltageLimit->setEnabled(power);
+    this->spinControlChargeVoltage->setEnabled(!power);
+    this->spinControlChargeCurrent->setEnabled(!power);
+    this->spinControlTermination->setEnabled(!power);
+}
+
+void TabProgram::controlApply()
+{
+    ControlConfig config;
+    config.mode = static_cast<ctrlcon::CONTROL_MODE>(
+        this->comboControlMode->currentData().toInt());
+    config.power = this->spinControlPower->value();
+    config.voltageLimit = this->spinControlVoltageLimit->value();
+    config.chargeVoltage = this->spinControlChargeVoltage->value();
+    config.chargeCurrent = this->spinControlChargeCurrent->value();
+    config.terminationCurrent = this->spinControlTermination->value();
+    this->labelControlStatus->setText(
+        tr("%1 running on channel %2")
+            .arg(this->comboControlMode->currentText())
+            .arg(this->spinControlChannel->value()));
+    emit this->setControlMode(this->spinControlChannel->value(), config);
+}
+
+void TabProgram::controlStop()
+{
+    this->labelControlStatus->setText(
+        tr("Control loop of channel %1 stopped")
+            .arg(this->spinControlChannel->value()));
+    emit this->setControlMode(this->spinControlChannel->value(),
+                              ControlConfig());
+}
+
+void TabProgram::addStep(const SequenceStep &step)
+{
+    const SettingsSnapshot &snap = SettingsCache::get_instance().snapshot();
+    int row = this->tblSteps->rowCount();
+    this->tblSteps->insertRow(row);
+
+    QComboBox *type = new QComboBox();
+    type->addItem(tr("Set"), static_cast<int>(seqcon::STEP_TYPE::SET));
+    type->addItem(tr("Ramp"), static_cast<int>(seqcon::STEP_TYPE::RAMP));
+    type->addItem(tr("Dwell"), static_cast<int>(seqcon::STEP_TYPE::DWELL));
+    type->addItem(tr("Loop"), static_cast<int>(seqcon::STEP_TYPE::LOOP));
+    type->setCurrentIndex(type->findData(static_cast<int>(step.type)));
+    this->tblSteps->setCellWidget(row, progcon::COL_TYPE, type);
+
+    QSpinBox *channel = new QSpinBox();
+    channel->setRange(1, std::max(1, snap.deviceChannels));
+    channel->setValue(step.channel);
+    this->tblSteps->setCellWidget(row, progcon::COL_CHANNEL, channel);
+
+    QComboBox *target = new QComboBox();
+    target->addItem(tr("Voltage"),
+                    static_cast<int>(globcon::LPQ_DATATYPE::SETVOLTAGE));
+    target->addItem(tr("Current"),
+                    static_cast<int>(globcon::LPQ_DATATYPE::SETCURRENT));
+    target->setCurrentIndex(target->findData(static_cast<int>(step.target)));
+    this->tblSteps->setCellWidget(row, progcon::COL_TARGET, target);
+
+    int accuracy = std::max(snap.voltageAccuracy, snap.currentAccuracy);
+    double maxValue = std::max(snap.voltageMax, snap.currentMax);
+    for (int col : {progcon::COL_START, progcon::COL_VALUE}) {
+        QDoubleSpinBox *value = new QDoubleSpinBox();
+        value->setDecimals(accuracy);
+        value->setRange(0, maxValue > 0 ? maxValue : 1000);
+        value->setValue(col == progcon::COL_START ? step.startValue
+                                                  : step.value);
+        this->tblSteps->setCellWidget(row, col, value);
+    }
+
+    QSpinBox *duration = new QSpinBox();
+    duration->setRange(0, 24 * 60 * 60 * 1000);
+    duration->setSingleStep(100);
+    duration->setValue(step.duration);
+    this->tblSteps->setCellWidget(row, progcon::COL_DURATION, duration);
+
+    // steps are numbered from 1 in the table
+    QSpinBox *loopTarget = new QSpinBox();
+    loopTarget->setRange(1, 9999);
+    loopTarget->setValue(step.loopTarget + 1);
+    this->tblSteps->setCellWidget(row, progcon::COL_LOOPTARGET, loopTarget);
+    QSpinBox *loopCount = new QSpinBox();
+    loopCount->setRange(0, 1000000);
+    loopCount->setValue(step.loopCount);
+    this->tblSteps->setCellWidget(row, progcon::COL_LOOPCOUNT, loopCount);
+
+    for (int col : {progcon::COL_EXECUTED, progcon::COL_JITTER,
+                    progcon::COL_JITTERMAX}) {
+        QTableWidgetItem *item = new QTableWidgetItem();
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        this->tblSteps->setItem(row, col, item);
+    }
+}
+
+std::vector<SequenceStep> TabProgram::steps() const
+{
+    std::vector<SequenceStep> steps;
+    for (int row = 0; row < this->tblSteps->rowCount(); row++) {
+        auto combo = [this, row](int col) {
+            return static_cast<QComboBox *>(
+                       this->tblSteps->cellWidget(row, col))
+                ->currentData()
+                .toInt();
+        };
+        auto spin = [this, row](int col) {
+            return static_cast<QSpinBox *>(this->tblSteps->cellWidget(row, col))
+                ->value();
+        };
+        auto doubleSpin = [this, row](int col) {
+            return static_cast<QDoubleSpinBox *>(
+                       this->tblSteps->cellWidget(row, col))
+                ->value();
+        };
+        SequenceStep step;
+        step.type = static_cast<seqcon::STEP_TYPE>(combo(progcon::COL_TYPE));
+        step.channel = spin(progcon::COL_CHANNEL);
+        step.target =
+            static_cast<globcon::LPQ_DATATYPE>(combo(progcon::COL_TARGET));
+        step.startValue = doubleSpin(progcon::COL_START);
+        step.value = doubleSpin(progcon::COL_VALUE);
+        step.duration = spin(progcon::COL_DURATION);
+        step.loopTarget = spin(progcon::COL_LOOPTARGET) - 1;
+        step.loopCount = spin(progcon::COL_LOOPCOUNT);
+        steps.push_back(step);
+    }
+    return steps;
+}
+
+void TabProgram::setRunning(bool running)
+{
+    this->actionAdd->setEnabled(!running);
+    this->actionRemove->setEnabled(!running);
+    this->actionStart->setEnabled(!running);
+    this->actionStop->setEnabled(running);
+    // the steps must not change while the engine works on a copy of them
+    for (int row = 0; row < this->tblSteps->rowCount(); row++) {
+        for (int col = progcon::COL_TYPE; col <= progcon::COL_LOOPCOUNT;
+             col++) {
+            this->tblSteps->cellWidget(row, col)->setEnabled(!running);
+        }
+    }
 }
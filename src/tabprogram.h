@@ -18,13 +18,54 @@
 #ifndef TABPROGRAM_H
 #define TABPROGRAM_H
 
-#include <QWidget>
+#include <QAction>
+#include <QComboBox>
+#include <QDoubleSpinBox>
 #include <QGridLayout>
-
+#include <QGroupBox>
+#include <QHeaderView>
 #include <QLabel>
+#include <QPushButton>
+#include <QSpinBox>
+#include <QTableWidget>
+#include <QToolBar>
+#include <QWidget>
+
+#include <vector>
+
+#include "controlloop.h"
+#include "sequenceengine.h"
+#include "settingscache.h"
+
+namespace program_constants
+{
+enum COLUMNS {
+    COL_TYPE = 0,
+    COL_CHANNEL,
+    COL_TARGET,
+    COL_START,
+    COL_VALUE,
+    COL_DURATION,
+    COL_LOOPTARGET,
+    COL_LOOPCOUNT,
+    COL_EXECUTED,
+    COL_JITTER,
+    COL_JITTERMAX,
+    COL_COUNT
+};
+}
 
 /**
  * @brief Base widget for Program tab
+ *
+ * @details
+ *
+ * A table of SequenceSteps that are run by the SequenceEngine of the
+ * controller. The last columns show when a step was executed and the timing
+ * jitter of the last and the worst execution.
+ *
+ * Below the table a closed loop control mode can be started for a channel,
+ * see ControlLoop.
  */
 class TabProgram : public QWidget
 {
@@ -34,10 +75,58 @@ public:
 
 signals:
 
+    void startSequence(std::vector<SequenceStep> steps);
+    void stopSequence();
+    void setControlMode(int channel, ControlConfig config);
+
 public slots:
 
+    void stepExecuted(int step, qint64 elapsed, qint64 jitter);
+    void sequenceFinished(bool aborted);
+    void controlLoopFinished(int channel);
+
+private slots:
+
+    void toolBarAction(QAction *action);
+    void controlModeChanged();
+    void controlApply();
+    void controlStop();
+
 private:
     QGridLayout *programLayout;
+    QToolBar *tbar;
+    QAction *actionAdd;
+    QAction *actionRemove;
+    QAction *actionStart;
+    QAction *actionStop;
+    QLabel *labelStatus;
+    QTableWidget *tblSteps;
+
+    QGroupBox *groupControl;
+    QComboBox *comboControlMode;
+    QSpinBox *spinControlChannel;
+    QDoubleSpinBox *spinControlPower;
+    QDoubleSpinBox *spinControlVoltageLimit;
+    QDoubleSpinBox *spinControlChargeVoltage;
+    QDoubleSpinBox *spinControlChargeCurrent;
+    QDoubleSpinBox *spinControlTermination;
+    QPushButton *buttonControlApply;
+    QPushButton *buttonControlStop;
+    QLabel *labelControlStatus;
+
+    std::vector<qint64> maxJitter;
+
+    void setupUI();
+    void setupControlUI();
+    /**
+     * @brief Append a row with the editors for step
+     */
+    void addStep(const SequenceStep &step);
+    /**
+     * @brief The steps as they are shown in the table
+     */
+    std::vector<SequenceStep> steps() const;
+    void setRunning(bool running);
 };
 
 #endif  // TABPROGRAM_H
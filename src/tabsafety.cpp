@@ -0,0 +1,253 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "tabsafety.h"
+
+#include <algorithm>
+
+namespace safcon = safety_constants;
+namespace setcon = settings_constants;
+namespace setdef = settings_default;
+namespace wdcon = watchdog_constants;
+
+TabSafety::TabSafety(QWidget *parent) : QWidget(parent)
+{
+    this->safetyLayout = new QGridLayout();
+    this->setLayout(this->safetyLayout);
+    this->setupUI();
+    for (const WatchdogRule &rule : this->rules()) {
+        this->addRule(rule);
+    }
+}
+
+std::vector<WatchdogRule> TabSafety::rules() const
+{
+    QSettings settings;
+    settings.beginGroup(setcon::WATCHDOG_GROUP);
+    // every rule is stored as type;channel;threshold;holdtime
+    QStringList stored =
+        settings
+            .value(setcon::WATCHDOG_RULES,
+                   setdef::general_defaults.at(setcon::WATCHDOG_RULES))
+            .toStringList();
+    std::vector<WatchdogRule> rules;
+    for (const QString &entry : stored) {
+        QStringList fields = entry.split(";");
+        if (fields.size() != 4)
+            continue;
+        WatchdogRule rule;
+        rule.type = static_cast<wdcon::RULE_TYPE>(fields.at(0).toInt());
+        rule.channel = fields.at(1).toInt();
+        rule.threshold = fields.at(2).toDouble();
+        rule.holdTime = fields.at(3).toInt();
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+void TabSafety::watchdogTripped(WatchdogTrip trip)
+{
+    int row = this->tblEvents->rowCount();
+    this->tblEvents->insertRow(row);
+    QStringList values = {
+        QDateTime::fromMSecsSinceEpoch(trip.time).toString("HH:mm:ss.zzz"),
+        QString::number(trip.channel),
+        tr("%1: %2 %3")
+            .arg(trip.rule + 1)
+            .arg(this->ruleName(trip.type))
+            .arg(trip.threshold),
+        QString::number(trip.value),
+        trip.latency == -1 ? tr("failed") : QString::number(trip.latency)};
+    for (int col = 0; col < safcon::EVCOL_COUNT; col++) {
+        QTableWidgetItem *item = new QTableWidgetItem(values.at(col));
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        this->tblEvents->setItem(row, col, item);
+    }
+    this->tblEvents->scrollToBottom();
+    if (trip.outputOff) {
+        this->labelStatus->setStyleSheet(QString());
+        this->labelStatus->setText(
+            tr("Rule %1 tripped on channel %2, output switched off")
+                .arg(trip.rule + 1)
+                .arg(trip.channel));
+        return;
+    }
+    QString message =
+        tr("Rule %1 tripped on channel %2 but the output could not be "
+           "switched off. It may still be on, check the device!")
+            .arg(trip.rule + 1)
+            .arg(trip.channel);
+    this->labelStatus->setStyleSheet("QLabel {color: red;}");
+    this->labelStatus->setText(message);
+    QMessageBox::critical(this, tr("Watchdog trip failed"), message);
+}
+
+void TabSafety::toolBarAction(QAction *action)
+{
+    if (action == this->actionAdd) {
+        this->addRule(WatchdogRule());
+    }
+    if (action == this->actionRemove) {
+        QList<QTableWidgetSelectionRange> ranges =
+            this->tblRules->selectedRanges();
+        std::sort(ranges.begin(), ranges.end(),
+                  [](const QTableWidgetSelectionRange &a,
+                     const QTableWidgetSelectionRange &b) {
+                      return a.topRow() > b.topRow();
+                  });
+        for (const auto &range : ranges) {
+            for (int row = range.bottomRow(); row >= range.topRow(); row--) {
+                this->tblRules->removeRow(row);
+            }
+        }
+    }
+    if (action == this->actionApply) {
+        std::vector<WatchdogRule> rules = this->tableRules();
+        this->storeRules(rules);
+        this->labelStatus->setStyleSheet(QString());
+        this->labelStatus->setText(
+            tr("%1 rules active").arg(static_cast<int>(rules.size())));
+        emit this->rulesChanged(rules);
+    }
+}
+
+void TabSafety::setupUI()
+{
+    this->tbar = new QToolBar();
+    this->tbar->setFloatable(false);
+    this->tbar->setMovable(false);
+    this->safetyLayout->addWidget(this->tbar, 0, 0);
+    this->actionAdd = this->tbar->addAction("Add");
+    this->actionAdd->setToolTip("Append a rule");
+    this->actionRemove = this->tbar->addAction("Remove");
+    this->actionRemove->setIcon(QPixmap(":/icons/trash32.png"));
+    this->actionRemove->setToolTip("Remove selected rules");
+    this->tbar->addSeparator();
+    this->actionApply = this->tbar->addAction("Apply");
+    this->actionApply->setIcon(QPixmap(":/icons/checkmark_32.png"));
+    this->actionApply->setToolTip("Store the rules and activate them");
+    this->tbar->addSeparator();
+    this->labelStatus = new QLabel();
+    this->tbar->addWidget(this->labelStatus);
+
+    this->tblRules = new QTableWidget(0, safcon::COL_COUNT);
+    this->tblRules->setHorizontalHeaderLabels(
+        {tr("Rule"), tr("Channel"), tr("Threshold"), tr("Hold time (ms)")});
+    this->tblRules->setSelectionBehavior(QAbstractItemView::SelectRows);
+    this->tblRules->horizontalHeader()->setStretchLastSection(true);
+    this->safetyLayout->addWidget(this->tblRules, 1, 0);
+
+    this->safetyLayout->addWidget(new QLabel(tr("Trips")), 2, 0);
+    this->tblEvents = new QTableWidget(0, safcon::EVCOL_COUNT);
+    this->tblEvents->setHorizontalHeaderLabels(
+        {tr("Time"), tr("Channel"), tr("Rule"), tr("Value"),
+         tr("Output off after (µs)")});
+    this->tblEvents->horizontalHeader()->setStretchLastSection(true);
+    this->safetyLayout->addWidget(this->tblEvents, 3, 0);
+
+    QObject::connect(this->tbar, &QToolBar::actionTriggered, this,
+                     &TabSafety::toolBarAction);
+}
+
+void TabSafety::addRule(const WatchdogRule &rule)
+{
+    const SettingsSnapshot &snap = SettingsCache::get_instance().snapshot();
+    int row = this->tblRules->rowCount();
+    this->tblRules->insertRow(row);
+
+    QComboBox *type = new QComboBox();
+    for (wdcon::RULE_TYPE t :
+         {wdcon::RULE_TYPE::OVERCURRENT, wdcon::RULE_TYPE::OVERPOWER,
+          wdcon::RULE_TYPE::UNDERVOLTAGE}) {
+        type->addItem(this->ruleName(t), static_cast<int>(t));
+    }
+    type->setCurrentIndex(type->findData(static_cast<int>(rule.type)));
+    this->tblRules->setCellWidget(row, safcon::COL_TYPE, type);
+
+    QSpinBox *channel = new QSpinBox();
+    channel->setRange(0, std::max(1, snap.deviceChannels));
+    channel->setSpecialValueText(tr("All"));
+    channel->setValue(rule.channel);
+    this->tblRules->setCellWidget(row, safcon::COL_CHANNEL, channel);
+
+    QDoubleSpinBox *threshold = new QDoubleSpinBox();
+    threshold->setDecimals(
+        std::max(snap.voltageAccuracy, snap.currentAccuracy));
+    threshold->setRange(0, 100000);
+    threshold->setValue(rule.threshold);
+    this->tblRules->setCellWidget(row, safcon::COL_THRESHOLD, threshold);
+
+    QSpinBox *holdTime = new QSpinBox();
+    holdTime->setRange(0, 60 * 60 * 1000);
+    holdTime->setSingleStep(100);
+    holdTime->setValue(rule.holdTime);
+    this->tblRules->setCellWidget(row, safcon::COL_HOLDTIME, holdTime);
+}
+
+std::vector<WatchdogRule> TabSafety::tableRules() const
+{
+    std::vector<WatchdogRule> rules;
+    for (int row = 0; row < this->tblRules->rowCount(); row++) {
+        WatchdogRule rule;
+        rule.type = static_cast<wdcon::RULE_TYPE>(
+            static_cast<QComboBox *>(
+                this->tblRules->cellWidget(row, safcon::COL_TYPE))
+                ->currentData()
+                .toInt());
+        rule.channel = static_cast<QSpinBox *>(
+                           this->tblRules->cellWidget(row, safcon::COL_CHANNEL))
+                           ->value();
+        rule.threshold =
+            static_cast<QDoubleSpinBox *>(
+                this->tblRules->cellWidget(row, safcon::COL_THRESHOLD))
+                ->value();
+        rule.holdTime =
+            static_cast<QSpinBox *>(
+                this->tblRules->cellWidget(row, safcon::COL_HOLDTIME))
+                ->value();
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+void TabSafety::storeRules(const std::vector<WatchdogRule> &rules)
+{
+    QStringList stored;
+    for (const WatchdogRule &rule : rules) {
+        stored << QString("%1;%2;%3;%4")
+                      .arg(static_cast<int>(rule.type))
+                      .arg(rule.channel)
+                      .arg(rule.threshold, 0, 'g', 10)
+                      .arg(rule.holdTime);
+    }
+    QSettings settings;
+    settings.beginGroup(setcon::WATCHDOG_GROUP);
+    settings.setValue(setcon::WATCHDOG_RULES, stored);
+}
+
+QString TabSafety::ruleName(wdcon::RULE_TYPE type) const
+{
+    switch (type) {
+    case wdcon::RULE_TYPE::OVERCURRENT:
+        return tr("Current above (A)");
+    case wdcon::RULE_TYPE::OVERPOWER:
+        return tr("Power above (W)");
+    case wdcon::RULE_TYPE::UNDERVOLTAGE:
+        return tr("Voltage dropout below (V)");
+    }
+    return QString();
+}
@@ -0,0 +1,114 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TABSAFETY_H
+#define TABSAFETY_H
+
+#include <QAction>
+#include <QComboBox>
+#include <QDateTime>
+#include <QDoubleSpinBox>
+#include <QGridLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QSettings>
+#include <QSpinBox>
+#include <QStringList>
+#include <QTableWidget>
+#include <QToolBar>
+#include <QWidget>
+
+#include <vector>
+
+#include "safetywatchdog.h"
+#include "settingscache.h"
+#include "settingsdefault.h"
+#include "settingsdefinitions.h"
+
+namespace safety_constants
+{
+enum RULE_COLUMNS {
+    COL_TYPE = 0,
+    COL_CHANNEL,
+    COL_THRESHOLD,
+    COL_HOLDTIME,
+    COL_COUNT
+};
+enum EVENT_COLUMNS {
+    EVCOL_TIME = 0,
+    EVCOL_CHANNEL,
+    EVCOL_RULE,
+    EVCOL_VALUE,
+    EVCOL_LATENCY,
+    EVCOL_COUNT
+};
+}
+
+/**
+ * @brief Base widget for the Safety tab
+ *
+ * @details
+ *
+ * Edits the rules of the SafetyWatchdog and lists the trips of this session.
+ * The rules are stored in the settings and applied to every device that is
+ * connected.
+ */
+class TabSafety : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit TabSafety(QWidget *parent = 0);
+
+    /**
+     * @brief The stored rules
+     */
+    std::vector<WatchdogRule> rules() const;
+
+signals:
+
+    void rulesChanged(std::vector<WatchdogRule> rules);
+
+public slots:
+
+    void watchdogTripped(WatchdogTrip trip);
+
+private slots:
+
+    void toolBarAction(QAction *action);
+
+private:
+    QGridLayout *safetyLayout;
+    QToolBar *tbar;
+    QAction *actionAdd;
+    QAction *actionRemove;
+    QAction *actionApply;
+    QLabel *labelStatus;
+    QTableWidget *tblRules;
+    QTableWidget *tblEvents;
+
+    void setupUI();
+    void addRule(const WatchdogRule &rule);
+    /**
+     * @brief The rules as they are shown in the table
+     */
+    std::vector<WatchdogRule> tableRules() const;
+    void storeRules(const std::vector<WatchdogRule> &rules);
+    QString ruleName(watchdog_constants::RULE_TYPE type) const;
+};
+
+#endif  // TABSAFETY_H
@@ -0,0 +1,141 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "tabscript.h"
+
+#include <algorithm>
+
+TabScript::TabScript(QWidget *parent) : QWidget(parent), runningScripts(0)
+{
+    this->scriptLayout = new QGridLayout();
+    this->setLayout(this->scriptLayout);
+    this->setupUI();
+}
+
+void TabScript::scriptStarted(int id, QString name)
+{
+    this->runningScripts++;
+    this->appendOutput(id, tr("started %1").arg(name));
+    this->labelStatus->setText(tr("%1 running").arg(this->runningScripts));
+}
+
+void TabScript::scriptOutput(int id, QString message)
+{
+    this->appendOutput(id, message);
+}
+
+void TabScript::scriptFinished(int id, bool success, QString message)
+{
+    this->runningScripts = std::max(0, this->runningScripts - 1);
+    this->appendOutput(id, success ? tr("finished")
+                                   : tr("failed: %1").arg(message));
+    this->labelStatus->setText(tr("%1 running").arg(this->runningScripts));
+}
+
+void TabScript::toolBarAction(QAction *action)
+{
+    if (action == this->actionOpen) {
+        QString file = QFileDialog::getOpenFileName(
+            this, tr("Open script"), this->fileName,
+            tr("JavaScript (*.js);;All files (*)"));
+        if (file.isEmpty())
+            return;
+        QFile scriptFile(file);
+        if (!scriptFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            LogInstance::get_instance().eal_error("Can not open script " +
+                                                  file.toStdString());
+            return;
+        }
+        this->editor->setPlainText(QTextStream(&scriptFile).readAll());
+        this->fileName = file;
+    }
+    if (action == this->actionSave) {
+        QString file = QFileDialog::getSaveFileName(
+            this, tr("Save script"), this->fileName,
+            tr("JavaScript (*.js);;All files (*)"));
+        if (file.isEmpty())
+            return;
+        QFile scriptFile(file);
+        if (!scriptFile.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            LogInstance::get_instance().eal_error("Can not write script " +
+                                                  file.toStdString());
+            return;
+        }
+        QTextStream(&scriptFile) << this->editor->toPlainText();
+        this->fileName = file;
+    }
+    if (action == this->actionRun) {
+        QString name = this->fileName.isEmpty()
+                           ? tr("script")
+                           : QFileInfo(this->fileName).fileName();
+        emit this->runScript(name, this->editor->toPlainText());
+    }
+    if (action == this->actionStop) {
+        emit this->stopScripts();
+    }
+}
+
+void TabScript::setupUI()
+{
+    this->tbar = new QToolBar();
+    this->tbar->setFloatable(false);
+    this->tbar->setMovable(false);
+    this->scriptLayout->addWidget(this->tbar, 0, 0);
+    this->actionOpen = this->tbar->addAction("Open");
+    this->actionOpen->setToolTip("Load a script from a file");
+    this->actionSave = this->tbar->addAction("Save");
+    this->actionSave->setToolTip("Save the script to a file");
+    this->tbar->addSeparator();
+    this->actionRun = this->tbar->addAction("Run");
+    this->actionRun->setIcon(QPixmap(":/icons/checkmark_32.png"));
+    this->actionRun->setToolTip("Run the script, scripts can run in parallel");
+    this->actionStop = this->tbar->addAction("Stop");
+    this->actionStop->setIcon(QPixmap(":/icons/cancel_close_32.png"));
+    this->actionStop->setToolTip("Stop all running scripts");
+    this->tbar->addSeparator();
+    this->labelStatus = new QLabel();
+    this->tbar->addWidget(this->labelStatus);
+
+    QFont fixed = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    this->editor = new QPlainTextEdit();
+    this->editor->setFont(fixed);
+    this->editor->setPlaceholderText(
+        "device.setVoltage(1, 5.0);\n"
+        "device.setOutput(1, true);\n"
+        "device.waitFor(function() { return device.voltage(1) > 4.9; },\n"
+        "               2000);\n"
+        "device.log(\"current \" + device.current(1));");
+    this->output = new QPlainTextEdit();
+    this->output->setFont(fixed);
+    this->output->setReadOnly(true);
+    this->output->setMaximumBlockCount(10000);
+
+    QSplitter *splitter = new QSplitter(Qt::Vertical);
+    splitter->addWidget(this->editor);
+    splitter->addWidget(this->output);
+    splitter->setStretchFactor(0, 3);
+    splitter->setStretchFactor(1, 1);
+    this->scriptLayout->addWidget(splitter, 1, 0);
+
+    QObject::connect(this->tbar, &QToolBar::actionTriggered, this,
+                     &TabScript::toolBarAction);
+}
+
+void TabScript::appendOutput(int id, const QString &line)
+{
+    this->output->appendPlainText(QString("[%1] %2").arg(id).arg(line));
+}
@@ -0,0 +1,87 @@
+// This file is part of labpowerqt, a Gui application to control programmable
+// lab power supplies.
+// Copyright © 2015, 2016 Christian Rapp <0x2a at posteo dot org>
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TABSCRIPT_H
+#define TABSCRIPT_H
+
+#include <QAction>
+#include <QFile>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QGridLayout>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QSplitter>
+#include <QTextStream>
+#include <QToolBar>
+#include <QWidget>
+
+#include "log_instance.h"
+
+/**
+ * @brief Base widget for the Scripts tab
+ *
+ * @details
+ *
+ * A simple editor for JavaScript test scripts that use the device API, see
+ * ScriptDevice. Every click on Run starts the script in the editor on a new
+ * thread, the output of all scripts is collected below the editor.
+ */
+class TabScript : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit TabScript(QWidget *parent = 0);
+
+signals:
+
+    void runScript(QString name, QString program);
+    void stopScripts();
+
+public slots:
+
+    /**
+     * @brief A script was started by the controller
+     */
+    void scriptStarted(int id, QString name);
+    void scriptOutput(int id, QString message);
+    void scriptFinished(int id, bool success, QString message);
+
+private slots:
+
+    void toolBarAction(QAction *action);
+
+private:
+    QGridLayout *scriptLayout;
+    QToolBar *tbar;
+    QAction *actionOpen;
+    QAction *actionSave;
+    QAction *actionRun;
+    QAction *actionStop;
+    QLabel *labelStatus;
+    QPlainTextEdit *editor;
+    QPlainTextEdit *output;
+
+    QString fileName;
+    int runningScripts;
+
+    void setupUI();
+    void appendOutput(int id, const QString &line);
+};
+
+#endif  // TABSCRIPT_H
@@ -19,8 +19,9 @@
 namespace globcon = global_constants;
 
 YAxisHelper::YAxisHelper() {}
-YAxisBounds YAxisHelper::getyAxisBounds(const QCPRange &currentXRange,
-                                        QCustomPlot *plot, int noChannels)
+YAxisBounds YAxisHelper::getyAxisBounds(
+    const QCPRange &currentXRange, QCustomPlot *plot,
+    const std::vector<std::unique_ptr<PlotSeries>> &series)
 {
     std::vector<double> voltageBounds;
     std::vector<double> currentBounds;
@@ -28,54 +29,31 @@ YAxisBounds YAxisHelper::getyAxisBounds(const QCPRange &currentXRange,
 
     YAxisBounds axb;
 
-    // loop through all channels
-    for (int i = 1; i <= noChannels; i++) {
-        for (int j = 0; j < 5; j++) {
-            globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(j);
-            // only visible graphs count
-            if (!plot->graph(j)->visible())
-                continue;
-            auto dataContainer = plot->graph(j)->data();
-            std::vector<double> graphValues;
-            std::pair<double, double> lowHighPair = {0, 0};
-            if (dataContainer->size() > 1) {
-                // get the nearest key to lower
-                auto itbegin =
-                    dataContainer->findBegin(currentXRange.lower, false);
-                if (itbegin == dataContainer->end())
-                    itbegin = dataContainer->begin();
-                // get the nearest key to upper
-                auto itend =
-                    dataContainer->findEnd(currentXRange.upper, false);
-                if (itend == dataContainer->end())
-                    itend = dataContainer->end() - 1;
-                // extract all the data for the visible time frame and put it in
-                // vector
-                for (; itbegin != itend; itbegin++) {
-                    graphValues.push_back((*itbegin).value);
-                }
-                lowHighPair = this->lowHighVectorValue(std::move(graphValues));
-            } else if (!dataContainer->isEmpty()) {
-                // what exactly is meant here? Can only be true if there is one element in the dataContainer
-                lowHighPair.first = dataContainer->begin()->value;
-                lowHighPair.second = dataContainer->begin()->value;
-            }
+    // five graphs per channel in the order of LPQ_DATATYPE
+    int graphs = std::min(plot->graphCount(), static_cast<int>(series.size()));
+    for (int i = 0; i < graphs; i++) {
+        globcon::LPQ_DATATYPE dt = static_cast<globcon::LPQ_DATATYPE>(i % 5);
+        // only visible graphs count
+        if (!plot->graph(i)->visible())
+            continue;
+        bool foundRange = false;
+        QCPRange valueRange = series[i]->valueRange(currentXRange, foundRange);
+        if (!foundRange)
+            continue;
 
-            if (dt == globcon::LPQ_DATATYPE::SETVOLTAGE ||
-                dt == globcon::LPQ_DATATYPE::VOLTAGE) {
-                voltageBounds.push_back(lowHighPair.first);
-                voltageBounds.push_back(lowHighPair.second);
-            }
-            if (dt == globcon::LPQ_DATATYPE::SETCURRENT ||
-                dt == globcon::LPQ_DATATYPE::CURRENT) {
-                currentBounds.push_back(lowHighPair.first);
-                currentBounds.push_back(lowHighPair.second);
-            }
-            if (dt == globcon::LPQ_DATATYPE::WATTAGE ||
-                dt == globcon::LPQ_DATATYPE::WATTAGE) {
-                wattageBounds.push_back(lowHighPair.first);
-                wattageBounds.push_back(lowHighPair.second);
-            }
+        if (dt == globcon::LPQ_DATATYPE::SETVOLTAGE ||
+            dt == globcon::LPQ_DATATYPE::VOLTAGE) {
+            voltageBounds.push_back(valueRange.lower);
+            voltageBounds.push_back(valueRange.upper);
+        }
+        if (dt == globcon::LPQ_DATATYPE::SETCURRENT ||
+            dt == globcon::LPQ_DATATYPE::CURRENT) {
+            currentBounds.push_back(valueRange.lower);
+            currentBounds.push_back(valueRange.upper);
+        }
+        if (dt == globcon::LPQ_DATATYPE::WATTAGE) {
+            wattageBounds.push_back(valueRange.lower);
+            wattageBounds.push_back(valueRange.upper);
         }
     }
 
@@ -90,7 +68,7 @@ YAxisBounds YAxisHelper::getyAxisBounds(const QCPRange &currentXRange,
     std::pair<double, double> wattageLowHigh =
         lowHighVectorValue(std::move(wattageBounds));
     axb.wattageLower = wattageLowHigh.first;
-    axb.wattageLower = wattageLowHigh.second;
+    axb.wattageUpper = wattageLowHigh.second;
 
     return axb;
 }
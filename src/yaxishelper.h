@@ -21,10 +21,12 @@
 
 #include <vector>
 #include <algorithm>
+#include <memory>
 
 #include "qcustomplot.h"
 
 #include "global.h"
+#include "plotseries.h"
 
 struct YAxisBounds {
     double voltageUpper;
@@ -52,14 +54,23 @@ struct YAxisBounds {
  * This helper class is used by the plottingarea to calculate the range for
  * different y-axis. The range is dependent from the values of the graph in the
  * current viewport of the QCustomPlot.
+ *
+ * The minimum and maximum of every graph are answered by the index of its
+ * PlotSeries, so the costs do not depend on the amount of visible data.
  */
 class YAxisHelper
 {
 public:
     YAxisHelper();
 
-    YAxisBounds getyAxisBounds(const QCPRange &currentXRange, QCustomPlot *plot,
-                               int noChannels);
+    /**
+     * @brief Bounds of the visible graphs within currentXRange
+     *
+     * @param series Data of the graphs, same index as the graphs of plot
+     */
+    YAxisBounds getyAxisBounds(
+        const QCPRange &currentXRange, QCustomPlot *plot,
+        const std::vector<std::unique_ptr<PlotSeries>> &series);
 
 private:
     std::pair<double, double> lowHighVectorValue(std::vector<double> values);